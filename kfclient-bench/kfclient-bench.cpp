@@ -0,0 +1,302 @@
+#include <benchmark/benchmark.h>
+
+#include <kfbuffer.hpp>
+#include <kfdetails.hpp>
+#include <kfrules.hpp>
+#include <kfplayers.hpp>
+#include <kfcapture.hpp>
+#include <kfstring.hpp>
+
+#include <fmt/format.h>
+
+#include "kfencoder.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <string>
+#include <vector>
+
+// Every allocation of the process is counted, which includes those made inside libkfclient.
+static std::atomic<std::uint64_t> allocations { 0 };
+static std::atomic<std::uint64_t> allocated_bytes { 0 };
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) // NOLINT(cppcoreguidelines-no-malloc)
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+void operator delete(void* p, std::size_t /*size*/) noexcept {
+    std::free(p); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+namespace {
+    struct corpus {
+        std::vector<sim::datagram> details;
+        std::vector<sim::datagram> rules;
+        std::vector<sim::datagram> players;
+    };
+
+    corpus& packets() {
+        static corpus instance;
+        return instance;
+    }
+
+    // Reports allocations and allocated bytes per iteration, every iteration parses one packet.
+    class allocation_counter {
+    public:
+        allocation_counter()
+            : allocations_(allocations.load(std::memory_order_relaxed)), bytes_(allocated_bytes.load(std::memory_order_relaxed)) {}
+
+        void report(benchmark::State& state, std::size_t bytes_processed) const {
+            state.counters["allocs/packet"] = benchmark::Counter(static_cast<double>(allocations.load(std::memory_order_relaxed) - allocations_), benchmark::Counter::kAvgIterations);
+            state.counters["bytes_alloc/packet"] = benchmark::Counter(static_cast<double>(allocated_bytes.load(std::memory_order_relaxed) - bytes_), benchmark::Counter::kAvgIterations);
+            state.SetItemsProcessed(state.iterations());
+            state.SetBytesProcessed(static_cast<std::int64_t>(bytes_processed));
+        }
+
+    private:
+        std::uint64_t allocations_;
+        std::uint64_t bytes_;
+    };
+
+    std::string padded(std::string name, std::size_t length) {
+        while (name.size() < length)
+            name += static_cast<char>('a' + (name.size() % 26));
+        return name;
+    }
+
+    // A spread of response sizes like those of real servers: empty to full, short to long names.
+    void build_corpus(corpus& c) {
+        for (std::size_t length : { 12, 40 }) {
+            for (std::size_t count : { 0, 1, 6, 12, 32, 64 }) {
+                kfc::kfdetails details;
+                details.protocol = 17;
+                details.hostname = padded("Killing Floor 2 Server", length + count);
+                details.map = "KF-BurningParis";
+                details.game_dir = "kfgame";
+                details.game_description = "Killing Floor 2";
+                details.player_count = static_cast<std::uint8_t>(count);
+                details.player_cap = 64;
+                details.version = "1113";
+                details.additional_string = fmt::format("a:{},b:1,c:0,d:10,e:{},f:2,", count, count % 11);
+                c.details.push_back(sim::encode(details));
+
+                kfc::kfplayers players;
+                for (std::size_t i = 0; i < count; ++i) {
+                    kfc::kfplayer player;
+                    player.id = static_cast<std::uint8_t>(i);
+                    player.name = padded(fmt::format("Player {} ", i), length);
+                    player.score = static_cast<std::uint32_t>(i * 100);
+                    player.time = static_cast<std::uint32_t>(i * 60);
+                    players.players.push_back(player);
+                }
+                c.players.push_back(sim::encode(players));
+            }
+        }
+
+        for (std::size_t count : { 10, 60, 250 }) {
+            kfc::kfrules rules;
+            for (std::size_t i = 0; i < count; ++i) {
+                kfc::kfrule rule;
+                rule.name = fmt::format("Rule{:03}", i);
+                switch (i % 3) {
+                case 0: rule.value = (i % 2) == 0; break;
+                case 1: rule.value = static_cast<double>(i) / 4; break;
+                default: rule.value = fmt::format("value {}", i); break;
+                }
+                rules.rules.push_back(rule);
+            }
+            c.rules.push_back(sim::encode(rules));
+        }
+    }
+
+    void add_packet(corpus& c, sim::datagram packet) {
+        if (packet.size() < 5)
+            return;
+
+        std::int32_t magic = 0;
+        std::memcpy(&magic, packet.data(), sizeof(magic));
+        if (magic != sim::SINGLE_MAGIC)
+            return;
+
+        switch (static_cast<std::int8_t>(packet.at(4))) {
+        case sim::PACKET_DETAILS: c.details.push_back(std::move(packet)); break;
+        case sim::PACKET_RULES: c.rules.push_back(std::move(packet)); break;
+        case sim::PACKET_PLAYERS: c.players.push_back(std::move(packet)); break;
+        default: break;
+        }
+    }
+
+    // Captured responses replace the built-in corpus: capture files (see kfcapture.hpp) or raw
+    // datagram files holding one response each. Split responses are skipped.
+    bool load_corpus(corpus& c, int argc, char** argv) {
+        static constexpr const char CAPTURE_MAGIC[] = "KFCAP";
+
+        for (int i = 1; i < argc; ++i) {
+            std::string path = argv[i]; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+                throw std::runtime_error("cannot open " + path);
+
+            sim::datagram packet((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+            if (packet.size() >= sizeof(CAPTURE_MAGIC) && std::memcmp(packet.data(), CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) == 0) {
+                kfc::kfcapture_reader reader(path);
+                kfc::kfcapture_record record;
+                while (reader.next(record)) {
+                    if (record.direction == kfc::kfcapture_direction::received)
+                        add_packet(c, sim::datagram(record.data, record.data + record.size));
+                }
+            } else {
+                add_packet(c, std::move(packet));
+            }
+        }
+
+        return !c.details.empty() || !c.rules.empty() || !c.players.empty();
+    }
+
+    // parses every packet of the set in turn, skipping the response header like kfclient does
+    template <typename T>
+    void parse_packets(benchmark::State& state, std::vector<sim::datagram>& set, kfc::kfinterner* interner = nullptr) {
+        if (set.empty()) {
+            state.SkipWithError("no packets of this type in the corpus");
+            return;
+        }
+
+        std::size_t index = 0;
+        std::size_t bytes = 0;
+        allocation_counter counter;
+
+        for (auto _ : state) {
+            auto& packet = set.at(index);
+            kfc::kfbuffer buffer(packet.data(), packet.size());
+            buffer.seek(5);
+
+            T result(buffer, interner);
+            benchmark::DoNotOptimize(result);
+
+            bytes += packet.size();
+            index = index + 1 == set.size() ? 0 : index + 1;
+        }
+
+        counter.report(state, bytes);
+    }
+
+    void BM_details(benchmark::State& state) {
+        parse_packets<kfc::kfdetails>(state, packets().details);
+    }
+
+    void BM_rules(benchmark::State& state) {
+        parse_packets<kfc::kfrules>(state, packets().rules);
+    }
+
+    void BM_players(benchmark::State& state) {
+        parse_packets<kfc::kfplayers>(state, packets().players);
+    }
+
+    // the same, with repeated strings shared through an interner
+    template <typename T>
+    void parse_packets_interned(benchmark::State& state, std::vector<sim::datagram>& set) {
+        kfc::kfinterner interner;
+        parse_packets<T>(state, set, &interner);
+    }
+
+    void BM_details_interned(benchmark::State& state) {
+        parse_packets_interned<kfc::kfdetails>(state, packets().details);
+    }
+
+    void BM_players_interned(benchmark::State& state) {
+        parse_packets_interned<kfc::kfplayers>(state, packets().players);
+    }
+
+    // the numeric run of the details response: one variadic consume of six fields
+    void BM_consume_variadic_numeric(benchmark::State& state) {
+        std::array<std::uint8_t, 7> data = { 0x9A, 0x8A, 6, 64, 0, 'd', 'l' };
+        kfc::kfbuffer buffer(data.data(), data.size());
+        std::uint16_t app = 0;
+        std::uint8_t a = 0;
+        std::uint8_t b = 0;
+        std::uint8_t c = 0;
+        std::uint8_t d = 0;
+        std::uint8_t e = 0;
+        allocation_counter counter;
+
+        for (auto _ : state) {
+            buffer.rewind();
+            buffer.consume(app, a, b, c, d, e);
+            benchmark::DoNotOptimize(e);
+        }
+
+        counter.report(state, data.size() * static_cast<std::size_t>(state.iterations()));
+    }
+
+    // the string run of the details response: one variadic consume of four NUL terminated strings
+    void BM_consume_variadic_strings(benchmark::State& state) {
+        sim::datagram data;
+        sim::kfencoder(data).put(std::string("Killing Floor 2 Server | Long Game | Hard"), std::string("KF-BurningParis"), std::string("kfgame"), std::string("Killing Floor 2"));
+        kfc::kfbuffer buffer(data.data(), data.size());
+        std::string hostname;
+        std::string map;
+        std::string game_dir;
+        std::string description;
+        allocation_counter counter;
+
+        for (auto _ : state) {
+            buffer.rewind();
+            buffer.consume(hostname, map, game_dir, description);
+            benchmark::DoNotOptimize(hostname.data());
+        }
+
+        counter.report(state, data.size() * static_cast<std::size_t>(state.iterations()));
+    }
+
+    void BM_additional_string(benchmark::State& state) {
+        const std::string additional = "a:6,b:1,c:0,d:10,e:4,f:2,g:KF-BurningParis,h:0,";
+        allocation_counter counter;
+
+        for (auto _ : state) {
+            auto pairs = kfc::kfdetails::tokenize_additional(additional);
+            benchmark::DoNotOptimize(pairs);
+        }
+
+        counter.report(state, additional.size() * static_cast<std::size_t>(state.iterations()));
+    }
+}
+
+BENCHMARK(BM_details);
+BENCHMARK(BM_rules);
+BENCHMARK(BM_players);
+BENCHMARK(BM_details_interned);
+BENCHMARK(BM_players_interned);
+BENCHMARK(BM_consume_variadic_numeric);
+BENCHMARK(BM_consume_variadic_strings);
+BENCHMARK(BM_additional_string);
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+
+    try {
+        if (!load_corpus(packets(), argc, argv))
+            build_corpus(packets());
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -25,6 +25,51 @@ namespace commandline {
         static constexpr auto NAME_PLAYER_COUNT = "playercount";
         static constexpr const option_descriptor DESC_PLAYER_COUNT(NAME_PLAYER_COUNT, "-P,--player-count", "output the player count and nothing else");
 
+        static constexpr auto NAME_PUBLISH = "publish";
+        static constexpr const option_descriptor DESC_PUBLISH(NAME_PUBLISH, "--publish", "keep polling the server, or every --hosts server, and publish every snapshot to the named shared memory region.");
+
+        static constexpr auto NAME_FORCE = "force";
+        static constexpr const option_descriptor DESC_FORCE(NAME_FORCE, "--force", "replace the --publish region when it already exists, after a publisher did not exit cleanly.");
+
+        static constexpr auto NAME_LOG = "log";
+        static constexpr const option_descriptor DESC_LOG(NAME_LOG, "-l,--log", "keep polling the server, or every --hosts server, and append every snapshot to the given snapshot log file.");
+
+        static constexpr auto NAME_SNAPSHOT = "snapshot";
+        static constexpr const option_descriptor DESC_SNAPSHOT(NAME_SNAPSHOT, "-s,--snapshot", "read details and players from the named shared memory region instead of querying the server.");
+
+        static constexpr auto NAME_CAPTURE = "capture";
+        static constexpr const option_descriptor DESC_CAPTURE(NAME_CAPTURE, "--capture", "record every datagram sent to and received from the server to the given capture file.");
+
+        static constexpr auto NAME_REPLAY = "replay";
+        static constexpr const option_descriptor DESC_REPLAY(NAME_REPLAY, "--replay", "answer from the responses of host:port in the given capture file instead of querying the server.");
+
+        static constexpr auto NAME_INTERVAL = "interval";
+        static constexpr const option_descriptor DESC_INTERVAL(NAME_INTERVAL, "-i,--interval", "the polling interval in seconds for --publish and --log, and the shortest one for --wait-empty.");
+
+        static constexpr auto NAME_HOSTS = "hosts";
+        static constexpr const option_descriptor DESC_HOSTS(NAME_HOSTS, "-m,--hosts", "query many servers concurrently: host, host:port or host:first-last (a port range).");
+
+        static constexpr auto NAME_HOSTS_FILE = "hostsfile";
+        static constexpr const option_descriptor DESC_HOSTS_FILE(NAME_HOSTS_FILE, "-f,--hosts-file", "read more --hosts from a file, one per line, or from stdin when the file is -.");
+
+        static constexpr auto NAME_DISCOVER = "discover";
+        static constexpr const option_descriptor DESC_DISCOVER(NAME_DISCOVER, "-D,--discover", "find the query servers in a range: host or network (10.0.0.0/24), with :port or :first-last.");
+
+        static constexpr auto NAME_PARALLEL = "parallel";
+        static constexpr const option_descriptor DESC_PARALLEL(NAME_PARALLEL, "-j,--parallel", "the maximum number of servers that are queried at the same time with --hosts, --discover, --publish and --log.");
+
+        static constexpr auto NAME_ENGINE = "engine";
+        static constexpr const option_descriptor DESC_ENGINE(NAME_ENGINE, "--engine", "how --hosts queries move their datagrams: asio, or io_uring on Linux 6.0 and newer.");
+
+        static constexpr auto NAME_FORMAT = "format";
+        static constexpr const option_descriptor DESC_FORMAT(NAME_FORMAT, "--format", "the output format of reports: table, or json, ndjson and csv for scripts.");
+
+        static constexpr auto NAME_WATCH = "watch";
+        static constexpr const option_descriptor DESC_WATCH(NAME_WATCH, "-w,--watch", "keep polling the server every this many seconds and print what changed: players joining and leaving, scores, map and wave.");
+
+        static constexpr auto NAME_WAIT_EMPTY = "waitempty";
+        static constexpr const option_descriptor DESC_WAIT_EMPTY(NAME_WAIT_EMPTY, "--wait-empty", "wait until the server, or every --hosts server, has had no players for this many seconds, then exit.");
+
         static constexpr auto NAME_REPORT = "report";
         static constexpr const option_descriptor DESC_REPORT(NAME_REPORT, "-r,--report", "report a category of information (details, rules, players)");
 
@@ -1,5 +1,12 @@
 #include <boost/asio.hpp>
 #include <kfclient.hpp>
+#include <kfpoller.hpp>
+#include <kfquery.hpp>
+#include <kfuring.hpp>
+#include <kfwait.hpp>
+#include <kfdiscover.hpp>
+#include <kfshm.hpp>
+#include <kflog.hpp>
 
 #include <fmt/core.h>
 #include <fmt/format.h>
@@ -8,8 +15,16 @@
 #include <fort.hpp>
 
 #include "definition.hpp"
+#include "output.hpp"
 
+#include <algorithm>
 #include <memory>
+#include <chrono>
+#include <csignal>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
 
 using udp = boost::asio::ip::udp;
 
@@ -28,6 +43,13 @@ void set_border_style(T& table, const commandline::kfclient_cli& cli) {
 
 static const std::size_t DEFAULT_TIMEOUT = 10;
 static const std::size_t DEFAULT_PORT = 27015;
+static const std::size_t DEFAULT_INTERVAL = 5;
+static const std::size_t DEFAULT_PARALLEL = 64;
+static const std::size_t DEFAULT_DISCOVER_PARALLEL = 1024;
+static const std::size_t DEFAULT_DISCOVER_TIMEOUT = 1;
+
+// names and hostnames end up in JSON and tables, which need valid UTF-8 without control characters
+static const kfc::utf8::policy TEXT_POLICY = kfc::utf8::policy::replace;
 
 static inline const std::vector<std::string> DETAIL_HEADERS = { "field", "value" };
 static inline const std::vector<std::string> RULE_HEADERS = { "rule", "value" };
@@ -35,16 +57,110 @@ static inline const std::vector<std::string> PLAYER_HEADERS = { "id", "name", "s
 static inline const std::vector<std::string> FILTER_PRECEDENCE = { "details", "rules", "players" };
 
 struct client_instance {
+    client_instance() = default;
+    client_instance(const client_instance&) = delete;
+    client_instance(client_instance&&) = delete;
+    client_instance& operator=(const client_instance&) = delete;
+    client_instance& operator=(client_instance&&) = delete;
+    virtual ~client_instance() = default;
+
+    virtual const kfc::kfdetails& details() = 0;
+    virtual const kfc::kfrules& rules() = 0;
+    virtual const kfc::kfplayers& players() = 0;
+};
+
+struct network_instance : client_instance {
     boost::asio::io_context io_context;
     udp::resolver resolver;
     boost::asio::ip::basic_resolver_results<udp> endpoints;
+    std::unique_ptr<kfc::kfcapture_writer> capture; // outlives the client that records to it
     std::unique_ptr<kfc::kfclient> client;
 
-    client_instance(const std::string& host, const std::string& protocol)
+    network_instance(const std::string& host, const std::string& protocol, std::chrono::milliseconds timeout, const std::string& capture_path)
         : io_context(), resolver(io_context) {
             endpoints = resolver.resolve(udp::v4(), host, protocol);
             client = std::make_unique<kfc::kfclient>(io_context, endpoints);
+            client->timeout(timeout);
+            client->utf8_policy(TEXT_POLICY);
+
+            if (!capture_path.empty()) {
+                capture = std::make_unique<kfc::kfcapture_writer>(capture_path);
+                client->capture(capture.get());
+            }
         }
+
+    const kfc::kfdetails& details() override { return client->request_details(); }
+    const kfc::kfrules& rules() override { return client->request_rules(); }
+    const kfc::kfplayers& players() override { return client->request_players(); }
+};
+
+struct replay_instance : client_instance {
+    kfc::kfclient client;
+
+    replay_instance(const std::string& path, const std::string& host, std::uint16_t port)
+        : client(std::make_unique<kfc::kfreplay_transport>(path, fmt::format("{}:{}", host, port))) {
+            client.utf8_policy(TEXT_POLICY);
+        }
+
+    const kfc::kfdetails& details() override { return client.request_details(); }
+    const kfc::kfrules& rules() override { return client.request_rules(); }
+    const kfc::kfplayers& players() override { return client.request_players(); }
+};
+
+struct snapshot_instance : client_instance {
+    kfc::kfsnapshot snapshot;
+    kfc::kfdetails snapshot_details;
+    kfc::kfplayers snapshot_players;
+
+    snapshot_instance(const std::string& region, const std::string& host, std::uint16_t port) {
+        kfc::kfshm_reader reader(region);
+        if (!reader.read(host, port, snapshot))
+            throw std::runtime_error(fmt::format("no snapshot of {}:{} has been published to {}", host, port, region));
+    }
+
+    const kfc::kfdetails& details() override {
+        assert_has(kfc::kfsnapshot::HAS_DETAILS);
+        snapshot_details = snapshot.details();
+        return snapshot_details;
+    }
+
+    const kfc::kfrules& rules() override {
+        throw std::runtime_error("rules are not published to snapshots");
+    }
+
+    const kfc::kfplayers& players() override {
+        assert_has(kfc::kfsnapshot::HAS_PLAYERS);
+        snapshot_players = snapshot.players();
+        return snapshot_players;
+    }
+
+private:
+    void assert_has(std::uint32_t flag) const {
+        if ((snapshot.flags & flag) == 0)
+            throw std::runtime_error((snapshot.flags & kfc::kfsnapshot::HAS_ERROR) != 0 ? snapshot.error.str() : "section is not available in the snapshot");
+    }
+};
+
+// the result of one server queried with --hosts
+struct result_instance : client_instance {
+    kfc::kfquery_result& result;
+
+    explicit result_instance(kfc::kfquery_result& r)
+        : result(r) {}
+
+    const kfc::kfdetails& details() override { return section(result.details); }
+    const kfc::kfrules& rules() override { return section(result.rules); }
+    const kfc::kfplayers& players() override { return section(result.players); }
+
+private:
+    template <typename T>
+    const T& section(const std::shared_ptr<const T>& value) const {
+        if (!result.error.empty())
+            throw std::runtime_error(result.error);
+        if (value == nullptr)
+            throw std::runtime_error("section was not requested");
+        return *value;
+    }
 };
 
 using report_function = int(*)(client_instance& instance, const commandline::kfclient_cli& cli);
@@ -68,9 +184,24 @@ std::unique_ptr<commandline::kfclient_cli> create_cli() {
     cli->add_flag(descriptors::DESC_VERBOSE);
     cli->add_flag(descriptors::DESC_CLEAN);
     cli->add_flag(descriptors::DESC_PLAYER_COUNT);
+    cli->add_option<std::string>(descriptors::DESC_FORMAT)->required(false)->default_val("table")->default_str("table")->check(CLI::IsMember({ "table", "json", "ndjson", "csv" }));
     cli->add_option<std::vector<std::string>>(descriptors::DESC_REPORT)->required(false)->check(CLI::IsMember({ "details", "rules", "players", "d", "r", "p" }));
     cli->add_option<std::size_t>(descriptors::DESC_TIMEOUT)->required(false)->default_val(DEFAULT_TIMEOUT)->default_str(std::to_string(DEFAULT_TIMEOUT));
-    cli->add_option<std::string>(descriptors::DESC_HOST)->required(true);
+    cli->add_option<std::string>(descriptors::DESC_PUBLISH)->required(false);
+    cli->add_flag(descriptors::DESC_FORCE);
+    cli->add_option<std::string>(descriptors::DESC_LOG)->required(false);
+    cli->add_option<std::string>(descriptors::DESC_SNAPSHOT)->required(false);
+    cli->add_option<std::string>(descriptors::DESC_CAPTURE)->required(false);
+    cli->add_option<std::string>(descriptors::DESC_REPLAY)->required(false);
+    cli->add_option<std::size_t>(descriptors::DESC_WATCH)->required(false);
+    cli->add_option<std::size_t>(descriptors::DESC_WAIT_EMPTY)->required(false);
+    cli->add_option<std::size_t>(descriptors::DESC_INTERVAL)->required(false)->default_val(DEFAULT_INTERVAL)->default_str(std::to_string(DEFAULT_INTERVAL));
+    cli->add_option<std::vector<std::string>>(descriptors::DESC_HOSTS)->required(false);
+    cli->add_option<std::string>(descriptors::DESC_HOSTS_FILE)->required(false);
+    cli->add_option<std::vector<std::string>>(descriptors::DESC_DISCOVER)->required(false);
+    cli->add_option<std::size_t>(descriptors::DESC_PARALLEL)->required(false)->default_val(DEFAULT_PARALLEL)->default_str(std::to_string(DEFAULT_PARALLEL));
+    cli->add_option<std::string>(descriptors::DESC_ENGINE)->required(false)->default_val("asio")->default_str("asio")->check(CLI::IsMember({ "asio", "io_uring" }));
+    cli->add_option<std::string>(descriptors::DESC_HOST)->required(false);
     cli->add_option<std::size_t>(descriptors::DESC_PORT)->required(false)->default_val(DEFAULT_PORT)->default_str(std::to_string(DEFAULT_PORT));
 
 	cli->add_flag(descriptors::DESC_VERSION, [](auto) {
@@ -81,8 +212,17 @@ std::unique_ptr<commandline::kfclient_cli> create_cli() {
     return cli;
 }
 
-std::unique_ptr<client_instance> open_client(const std::string& host, const std::string& protocol) {
-    return std::make_unique<client_instance>(host, protocol);
+std::unique_ptr<client_instance> open_client(const commandline::kfclient_cli& cli, const std::string& host, std::size_t port) {
+    using namespace commandline;
+
+    if (cli.isset(descriptors::NAME_SNAPSHOT))
+        return std::make_unique<snapshot_instance>(cli.get<std::string>(descriptors::NAME_SNAPSHOT), host, static_cast<std::uint16_t>(port));
+
+    if (cli.isset(descriptors::NAME_REPLAY))
+        return std::make_unique<replay_instance>(cli.get<std::string>(descriptors::NAME_REPLAY), host, static_cast<std::uint16_t>(port));
+
+    return std::make_unique<network_instance>(host, fmt::format("{}", port), std::chrono::seconds(cli.get<std::size_t>(descriptors::NAME_TIMEOUT)),
+        cli.isset(descriptors::NAME_CAPTURE) ? cli.get<std::string>(descriptors::NAME_CAPTURE) : std::string());
 }
 
 void verify_cli(const commandline::kfclient_cli&) {
@@ -91,12 +231,118 @@ void verify_cli(const commandline::kfclient_cli&) {
     // todo: make sure invalid options are not used together
 }
 
+// the state of a watched server that changes are reported against
+struct watch_state {
+    bool valid = false;
+    std::string hostname;
+    std::string map;
+    std::int32_t waves_current = 0;
+    std::int32_t waves_total = 0;
+    std::unordered_map<std::string, std::uint32_t> scores; // by player name
+};
+
+static void print_change(const std::string& what) {
+    auto now = std::time(nullptr);
+    std::array<char, 16> stamp = {};
+    std::strftime(stamp.data(), stamp.size(), "%H:%M:%S", std::localtime(&now)); // NOLINT(concurrency-mt-unsafe)
+    fmt::print("[{}] {}\n", stamp.data(), what);
+}
+
+static void report_changes(watch_state& state, const kfc::kfdetails& details, const kfc::kfplayers& players) {
+    if (!state.valid) {
+        print_change(fmt::format("{} on {}, wave {}/{}, {}/{} players", details.hostname.str(), details.map.str(), details.waves_current, details.waves_total,
+            static_cast<std::uint32_t>(details.player_count), static_cast<std::uint32_t>(details.player_cap)));
+    } else {
+        if (details.hostname != state.hostname)
+            print_change(fmt::format("name: {} -> {}", state.hostname, details.hostname.str()));
+        if (details.map != state.map)
+            print_change(fmt::format("map: {} -> {}", state.map, details.map.str()));
+        if (details.waves_current != state.waves_current || details.waves_total != state.waves_total)
+            print_change(fmt::format("wave: {}/{} -> {}/{}", state.waves_current, state.waves_total, details.waves_current, details.waves_total));
+    }
+
+    // players have no stable id in the protocol, they are told apart by name
+    std::unordered_map<std::string, std::uint32_t> scores;
+    for (const auto& player : players.players) {
+        scores[player.name] = player.score;
+
+        auto previous = state.scores.find(player.name);
+        if (previous == state.scores.end())
+            print_change(fmt::format("join: {} ({})", player.name.str(), player.score));
+        else if (previous->second != player.score)
+            print_change(fmt::format("score: {} {} -> {}", player.name.str(), previous->second, player.score));
+    }
+
+    for (const auto& previous : state.scores) {
+        if (scores.count(previous.first) == 0)
+            print_change(fmt::format("leave: {}", previous.first));
+    }
+
+    state.valid = true;
+    state.hostname = details.hostname;
+    state.map = details.map;
+    state.waves_current = details.waves_current;
+    state.waves_total = details.waves_total;
+    state.scores = std::move(scores);
+}
+
+// Polls one server on a steady timer with a single client, so the socket, challenge and buffers
+// are reused, and prints only what changed since the previous poll.
+int watch(const commandline::kfclient_cli& cli) {
+    using namespace commandline;
+
+    const auto& host = cli.get<std::string>(descriptors::NAME_HOST);
+    const auto port = cli.get<std::size_t>(descriptors::NAME_PORT);
+    const auto interval = std::chrono::seconds(std::max<std::size_t>(cli.get<std::size_t>(descriptors::NAME_WATCH), 1));
+
+    try {
+        network_instance instance(host, fmt::format("{}", port), std::chrono::seconds(cli.get<std::size_t>(descriptors::NAME_TIMEOUT)),
+            cli.isset(descriptors::NAME_CAPTURE) ? cli.get<std::string>(descriptors::NAME_CAPTURE) : std::string());
+        instance.client->reuse_challenge(true);
+
+        boost::asio::steady_timer timer(instance.io_context);
+        watch_state state;
+        auto next = std::chrono::steady_clock::now();
+        auto failing = false;
+
+        for (;;) {
+            try {
+                const auto& details = instance.client->request_details();
+                auto details_unchanged = instance.client->unchanged();
+                const auto& players = instance.client->request_players();
+
+                if (!state.valid || !details_unchanged || !instance.client->unchanged())
+                    report_changes(state, details, players);
+                if (failing)
+                    print_change("server is answering again");
+                failing = false;
+            } catch (const std::exception& ex) {
+                if (!failing)
+                    print_change(fmt::format("error: {}", ex.what()));
+                failing = true;
+            }
+
+            std::fflush(stdout);
+
+            // after a slow poll (timeouts) the next one starts right away instead of catching up
+            next = std::max(next + interval, std::chrono::steady_clock::now());
+            timer.expires_at(next);
+            timer.wait();
+        }
+    } catch (const std::exception& ex) {
+        fmt::print(std::cerr, "error: could not watch udp://{}:{}: {}\n", host, port, ex.what());
+        return EXIT_FAILURE;
+    }
+}
+
 template <typename T>
 void report_detail_impl(fort::utf8_table& t, const char* name, const T& value) {
     std::vector<std::string> row(2);
     row[0] = name;
     if constexpr (std::disjunction_v<std::is_same<T, std::uint8_t>, std::is_same<T, std::int8_t>>)
         row[1] = fmt::format("{}", static_cast<std::uint32_t>(value));
+    else if constexpr (std::is_same_v<T, kfc::kfstring>)
+        row[1] = value;
     else 
         row[1] = fmt::format("{}", value);
     t.range_write_ln(row.begin(), row.end());
@@ -108,7 +354,7 @@ void report_detail_impl(fort::utf8_table& t, const char* name, const T& value) {
 
 int report_details(client_instance& instance, const commandline::kfclient_cli& cli) {
     try {
-        const auto& details = instance.client->request_details();
+        const auto& details = instance.details();
         
         fort::utf8_table table;
         set_border_style(table, cli);
@@ -141,7 +387,7 @@ int report_details(client_instance& instance, const commandline::kfclient_cli& c
 
 int report_rules(client_instance& instance, const commandline::kfclient_cli& cli) {
     try {
-        const auto& rules = instance.client->request_rules();
+        const auto& rules = instance.rules();
 
         fort::utf8_table table;
         set_border_style(table, cli);
@@ -174,7 +420,7 @@ int report_rules(client_instance& instance, const commandline::kfclient_cli& cli
 
 int report_players(client_instance& instance, const commandline::kfclient_cli& cli) {
     try {
-        const auto& players = instance.client->request_players();
+        const auto& players = instance.players();
 
         fort::utf8_table table;
         set_border_style(table, cli);
@@ -200,6 +446,369 @@ int report_players(client_instance& instance, const commandline::kfclient_cli& c
     }
 }
 
+// runs the reports that were asked for, in the order of FILTER_PRECEDENCE
+int report(client_instance& client, const commandline::kfclient_cli& cli) {
+    using namespace commandline;
+
+    if (cli.isset(descriptors::NAME_PLAYER_COUNT)) {
+        try {
+            const auto& players = client.players();
+            fmt::print("online players: {}\n", static_cast<std::size_t>(players.count));
+        } catch (const std::exception& ex) {
+            fmt::print(std::cerr, "could not successfully obtain player count: {}\n", ex.what());
+            return EXIT_FAILURE;
+        }
+    } else if (cli.isset(descriptors::NAME_REPORT)) {
+        const auto& report_filters = cli.get<std::vector<std::string>>(descriptors::NAME_REPORT);
+        for (const auto& f : FILTER_PRECEDENCE) {
+            auto iter = std::find_if(report_filters.begin(), report_filters.end(), [&f](const auto& v){
+                return f == v || (v.size() == 1 && f[0] == v[0]);
+            });
+
+            if (iter != report_filters.end() && reporters.count(f) != 0) {
+                auto status = reporters.at(f)(client, cli);
+                if (status != 0)
+                    return status;
+            }
+        }
+    }
+
+    return 0;
+}
+
+struct port_range {
+    std::string host;
+    std::uint16_t first;
+    std::uint16_t last;
+};
+
+// host, host:port or host:first-last, where an IPv6 address is either bare (without a port) or
+// in brackets: [addr], [addr]:port or [addr]:first-last
+static port_range parse_ports(const std::string& target) {
+    std::string host;
+    std::string ports;
+
+    if (!target.empty() && target[0] == '[') {
+        auto bracket = target.find(']');
+        if (bracket == std::string::npos || bracket == 1)
+            throw std::invalid_argument("invalid address in " + target);
+        if (bracket + 1 < target.size() && target[bracket + 1] != ':')
+            throw std::invalid_argument("invalid port range in " + target);
+
+        host = target.substr(1, bracket - 1);
+        if (bracket + 1 < target.size())
+            ports = target.substr(bracket + 2);
+        else
+            return { host, static_cast<std::uint16_t>(DEFAULT_PORT), static_cast<std::uint16_t>(DEFAULT_PORT) };
+    } else {
+        auto colon = target.find(':');
+        if (colon == std::string::npos || target.find(':', colon + 1) != std::string::npos)
+            return { target, static_cast<std::uint16_t>(DEFAULT_PORT), static_cast<std::uint16_t>(DEFAULT_PORT) };
+
+        host = target.substr(0, colon);
+        ports = target.substr(colon + 1);
+    }
+
+    auto dash = ports.find('-');
+    auto first = std::stoul(ports.substr(0, dash));
+    auto last = dash == std::string::npos ? first : std::stoul(ports.substr(dash + 1));
+
+    if (first == 0 || last > 65535 || last < first)
+        throw std::invalid_argument("invalid port range in " + target);
+
+    return { host, static_cast<std::uint16_t>(first), static_cast<std::uint16_t>(last) };
+}
+
+// adds every port of a target to a kfbatch or kfwaiter
+template <typename Targets>
+static void parse_target(const std::string& target, Targets& batch) {
+    auto range = parse_ports(target);
+    for (std::size_t port = range.first; port <= range.last; ++port)
+        batch.add_target(range.host, static_cast<std::uint16_t>(port));
+}
+
+template <typename Targets>
+static void read_targets(std::istream& in, Targets& batch) {
+    std::string line;
+    while (std::getline(in, line)) {
+        auto begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#')
+            continue;
+        parse_target(line.substr(begin, line.find_last_not_of(" \t\r") - begin + 1), batch);
+    }
+}
+
+// adds the --hosts and --hosts-file targets, or reports why they are invalid
+template <typename Targets>
+static bool add_targets(const commandline::kfclient_cli& cli, Targets& batch) {
+    using namespace commandline;
+
+    try {
+        if (cli.isset(descriptors::NAME_HOSTS)) {
+            for (const auto& target : cli.get<std::vector<std::string>>(descriptors::NAME_HOSTS))
+                parse_target(target, batch);
+        }
+
+        if (cli.isset(descriptors::NAME_HOSTS_FILE)) {
+            const auto& path = cli.get<std::string>(descriptors::NAME_HOSTS_FILE);
+            if (path == "-") {
+                read_targets(std::cin, batch);
+            } else {
+                std::ifstream file(path);
+                if (!file)
+                    throw std::runtime_error("cannot open " + path);
+                read_targets(file, batch);
+            }
+        }
+    } catch (const std::exception& ex) {
+        fmt::print(std::cerr, "error: invalid host list: {}\n", ex.what());
+        return false;
+    }
+
+    return true;
+}
+
+static kfc::kfpoller* active_poller = nullptr;
+
+extern "C" void stop_poller(int /*signal*/) {
+    if (active_poller != nullptr)
+        active_poller->stop();
+}
+
+// Polls the host, or every --hosts target, and publishes or logs every snapshot until interrupted.
+int poll(const commandline::kfclient_cli& cli, bool verbose) {
+    using namespace commandline;
+
+    try {
+        kfc::kfpoller poller(std::chrono::seconds(cli.get<std::size_t>(descriptors::NAME_INTERVAL)), std::chrono::seconds(cli.get<std::size_t>(descriptors::NAME_TIMEOUT)));
+        poller.utf8_policy(TEXT_POLICY);
+        poller.parallel(cli.get<std::size_t>(descriptors::NAME_PARALLEL));
+
+        if (cli.anyset({ descriptors::NAME_HOSTS, descriptors::NAME_HOSTS_FILE })) {
+            if (!add_targets(cli, poller))
+                return EXIT_FAILURE;
+        } else {
+            poller.add_target(cli.get<std::string>(descriptors::NAME_HOST), static_cast<std::uint16_t>(cli.get<std::size_t>(descriptors::NAME_PORT)));
+        }
+
+        std::unique_ptr<kfc::kfshm_publisher> publisher;
+        std::unique_ptr<kfc::kflog_writer> log;
+        std::unique_ptr<kfc::kfcapture_writer> capture;
+
+        if (cli.isset(descriptors::NAME_CAPTURE)) {
+            capture = std::make_unique<kfc::kfcapture_writer>(cli.get<std::string>(descriptors::NAME_CAPTURE));
+            poller.capture(capture.get());
+        }
+
+        if (cli.isset(descriptors::NAME_PUBLISH))
+            publisher = std::make_unique<kfc::kfshm_publisher>(cli.get<std::string>(descriptors::NAME_PUBLISH), poller.size(), cli.isset(descriptors::NAME_FORCE));
+        if (cli.isset(descriptors::NAME_LOG))
+            log = std::make_unique<kfc::kflog_writer>(cli.get<std::string>(descriptors::NAME_LOG));
+
+        active_poller = &poller;
+        std::signal(SIGINT, stop_poller);
+        std::signal(SIGTERM, stop_poller);
+
+        poller.run([&publisher, &log, verbose](const kfc::kfpoll_result& result) {
+            kfc::kfsnapshot snapshot;
+            snapshot.timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+
+            if (result.details != nullptr)
+                snapshot.store(*result.details);
+            if (result.players != nullptr)
+                snapshot.store(*result.players);
+            if (!result.error.empty()) {
+                snapshot.store_error(result.error);
+                if (verbose) fmt::print(std::cerr, "could not successfully poll udp://{}:{}: {}\n", result.host, result.port, result.error);
+            }
+
+            if (publisher != nullptr)
+                publisher->publish(result.host, result.port, snapshot);
+            if (log != nullptr)
+                log->append(result.host, result.port, snapshot);
+        });
+
+        active_poller = nullptr;
+        return 0;
+    } catch (const std::exception& ex) {
+        active_poller = nullptr;
+        fmt::print(std::cerr, "error: could not poll: {}\n", ex.what());
+        return EXIT_FAILURE;
+    }
+}
+
+// the sections the reports need, details for the summary line when there are none
+static std::uint32_t report_sections(const commandline::kfclient_cli& cli) {
+    using namespace commandline;
+
+    if (cli.isset(descriptors::NAME_PLAYER_COUNT))
+        return kfc::SECTION_PLAYERS;
+    if (!cli.isset(descriptors::NAME_REPORT))
+        return kfc::SECTION_DETAILS;
+
+    // main rejects empty categories, they are skipped here rather than read past their end
+    std::uint32_t sections = 0;
+    for (const auto& f : cli.get<std::vector<std::string>>(descriptors::NAME_REPORT)) {
+        if (!f.empty())
+            sections |= f[0] == 'd' ? kfc::SECTION_DETAILS : f[0] == 'r' ? kfc::SECTION_RULES : kfc::SECTION_PLAYERS;
+    }
+    return sections;
+}
+
+// writes the requested sections of one server as a record, or the error that prevented it
+int write_record(client_instance& client, const std::string& server, std::uint32_t sections, output::record_writer& writer) {
+    try {
+        const auto* details = (sections & kfc::SECTION_DETAILS) != 0 ? &client.details() : nullptr;
+        const auto* rules = (sections & kfc::SECTION_RULES) != 0 ? &client.rules() : nullptr;
+        const auto* players = (sections & kfc::SECTION_PLAYERS) != 0 ? &client.players() : nullptr;
+        writer.record(server, details, rules, players);
+        return 0;
+    } catch (const std::exception& ex) {
+        writer.error(server, ex.what(), dynamic_cast<const kfc::timeout_error*>(&ex) != nullptr);
+        return 2;
+    }
+}
+
+// Queries every --hosts target concurrently and reports each server as soon as it answered.
+int query_hosts(const commandline::kfclient_cli& cli) {
+    using namespace commandline;
+
+    kfc::kfbatch batch(cli.get<std::size_t>(descriptors::NAME_PARALLEL), std::chrono::seconds(cli.get<std::size_t>(descriptors::NAME_TIMEOUT)), report_sections(cli));
+    batch.utf8_policy(TEXT_POLICY);
+    if (cli.get<std::string>(descriptors::NAME_ENGINE) == "io_uring") {
+        if (!kfc::kfuring_batch::available()) {
+            fmt::print(std::cerr, "error: the io_uring engine is not available on this system, it needs Linux 6.0 or newer\n");
+            return EXIT_FAILURE;
+        }
+        batch.engine(kfc::kfengine::io_uring);
+    }
+    if (!add_targets(cli, batch))
+        return EXIT_FAILURE;
+
+    auto status = 0;
+    auto summary = !cli.anyset({ descriptors::NAME_PLAYER_COUNT, descriptors::NAME_REPORT });
+    auto format = output::parse_format(cli.get<std::string>(descriptors::NAME_FORMAT));
+
+    output::record_writer writer(format);
+    writer.begin();
+
+    // the engine may still fail halfway, the records written until then are closed properly
+    try {
+        batch.run([&cli, &status, &writer, summary, format](const std::string& host, std::uint16_t port, kfc::kfquery_result& result) {
+            if (format != output::format::table) {
+                if (!result.error.empty()) {
+                    writer.error(fmt::format("{}:{}", host, port), result.error, result.timed_out);
+                    status = 2;
+                } else {
+                    writer.record(fmt::format("{}:{}", host, port), result.details.get(), result.rules.get(), result.players.get());
+                }
+                return;
+            }
+
+            if (!result.error.empty()) {
+                fmt::print(std::cerr, "udp://{}:{} could not be queried: {}\n", host, port, result.error);
+                status = 2;
+                return;
+            }
+
+            if (summary) {
+                const auto& details = *result.details;
+                fmt::print("udp://{}:{}\t{}\t{}\t{}/{}\n", host, port, details.hostname.str(), details.map.str(), static_cast<std::uint32_t>(details.player_count), static_cast<std::uint32_t>(details.player_cap));
+                return;
+            }
+
+            fmt::print("udp://{}:{}\n", host, port);
+
+            result_instance instance(result);
+            if (auto s = report(instance, cli); s != 0)
+                status = s;
+        });
+    } catch (const std::exception& ex) {
+        writer.end();
+        std::fflush(stdout);
+        fmt::print(std::cerr, "error: could not query the servers: {}\n", ex.what());
+        return EXIT_FAILURE;
+    }
+
+    writer.end();
+    std::fflush(stdout);
+    return status;
+}
+
+// Sweeps the --discover ranges and reports every query server that answered.
+int discover(const commandline::kfclient_cli& cli) {
+    using namespace commandline;
+
+    // most endpoints of a sweep never answer, so it probes wider and gives up sooner by default
+    auto parallel = cli.get_isset_or<std::size_t>(descriptors::NAME_PARALLEL, DEFAULT_DISCOVER_PARALLEL);
+    auto timeout = cli.get_isset_or<std::size_t>(descriptors::NAME_TIMEOUT, DEFAULT_DISCOVER_TIMEOUT);
+    kfc::kfdiscovery discovery(parallel, std::chrono::seconds(timeout));
+    discovery.utf8_policy(TEXT_POLICY);
+
+    try {
+        for (const auto& target : cli.get<std::vector<std::string>>(descriptors::NAME_DISCOVER)) {
+            auto range = parse_ports(target);
+            discovery.add_range(range.host, range.first, range.last);
+        }
+    } catch (const std::exception& ex) {
+        fmt::print(std::cerr, "error: invalid range: {}\n", ex.what());
+        return EXIT_FAILURE;
+    }
+
+    if (cli.isset(descriptors::NAME_VERBOSE))
+        fmt::print(std::cerr, "probing {} endpoints\n", discovery.size());
+
+    auto format = output::parse_format(cli.get<std::string>(descriptors::NAME_FORMAT));
+    output::record_writer writer(format);
+    writer.begin();
+
+    discovery.run([&writer, format](kfc::kfdiscovered& server) {
+        auto address = fmt::format("{}:{}", server.endpoint.address().to_string(), server.endpoint.port());
+        if (format != output::format::table)
+            return writer.record(address, server.details.get(), nullptr, nullptr);
+
+        const auto& details = *server.details;
+        fmt::print("udp://{}\t{}\t{}\t{}/{}\n", address, details.hostname.str(), details.map.str(), static_cast<std::uint32_t>(details.player_count), static_cast<std::uint32_t>(details.player_cap));
+    });
+
+    writer.end();
+    std::fflush(stdout);
+    return 0;
+}
+
+// Waits until the host, or every --hosts target, has had no players for the grace period.
+int wait_empty(const commandline::kfclient_cli& cli) {
+    using namespace commandline;
+
+    kfc::kfwait_options options;
+    options.grace = std::chrono::seconds(cli.get<std::size_t>(descriptors::NAME_WAIT_EMPTY));
+    options.interval = std::chrono::seconds(std::max<std::size_t>(cli.get<std::size_t>(descriptors::NAME_INTERVAL), 1));
+    options.max_interval = std::max(options.max_interval, options.interval);
+    options.timeout = std::chrono::seconds(cli.get<std::size_t>(descriptors::NAME_TIMEOUT));
+
+    kfc::kfwaiter waiter(options);
+    if (cli.anyset({ descriptors::NAME_HOSTS, descriptors::NAME_HOSTS_FILE })) {
+        if (!add_targets(cli, waiter))
+            return EXIT_FAILURE;
+    } else if (cli.isset(descriptors::NAME_HOST)) {
+        waiter.add_target(cli.get<std::string>(descriptors::NAME_HOST), static_cast<std::uint16_t>(cli.get<std::size_t>(descriptors::NAME_PORT)));
+    } else {
+        fmt::print(std::cerr, "error: a host or --hosts is required\n");
+        return EXIT_FAILURE;
+    }
+
+    auto empty = waiter.run([](const std::string& host, std::uint16_t port) {
+        fmt::print("udp://{}:{} is empty\n", host, port);
+        std::fflush(stdout);
+    });
+
+    // a server that cannot be resolved is never empty, scripts must not carry on as if it were
+    for (const auto& target : waiter.unresolved())
+        fmt::print(std::cerr, "error: cannot resolve {}:{}\n", target.first, target.second);
+
+    return empty ? 0 : EXIT_FAILURE;
+}
+
 int main(int argc, const char* argv[]) {
     using namespace commandline;
 
@@ -222,12 +831,41 @@ int main(int argc, const char* argv[]) {
 		return cli->command().exit(e);
 	}
 
+    if (cli->isset(descriptors::NAME_REPORT)) {
+        const auto& categories = cli->get<std::vector<std::string>>(descriptors::NAME_REPORT);
+        if (std::any_of(categories.begin(), categories.end(), [](const auto& c) { return c.empty(); })) {
+            fmt::print(std::cerr, "error: --report needs a category (details, rules, players)\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (cli->isset(descriptors::NAME_DISCOVER))
+        return discover(*cli);
+
+    if (cli->isset(descriptors::NAME_WAIT_EMPTY))
+        return wait_empty(*cli);
+
+    auto many = cli->anyset({ descriptors::NAME_HOSTS, descriptors::NAME_HOSTS_FILE });
+    if (!many && !cli->isset(descriptors::NAME_HOST)) {
+        fmt::print(std::cerr, "error: a host or --hosts is required\n");
+        return EXIT_FAILURE;
+    }
+
+    if (cli->anyset({ descriptors::NAME_PUBLISH, descriptors::NAME_LOG }))
+        return poll(*cli, verbose);
+
+    if (many)
+        return query_hosts(*cli);
+
+    if (cli->isset(descriptors::NAME_WATCH))
+        return watch(*cli);
+
     std::unique_ptr<client_instance> client = nullptr;
 
     try {
         const auto& host = cli->get<std::string>(descriptors::NAME_HOST);
         const auto& port = cli->get<std::size_t>(descriptors::NAME_PORT);
-        client = open_client(host, fmt::format("{}", port));
+        client = open_client(*cli, host, port);
         if (verbose) fmt::print("error: connection established to udp://{}:{}\n", host, port);
     } catch (const std::exception& ex) {
         fmt::print(std::cerr, "error: could not successfully instantiate client: {}\n", ex.what());
@@ -236,28 +874,14 @@ int main(int argc, const char* argv[]) {
 
     verify_cli(*cli);
 
-    if (cli->isset(descriptors::NAME_PLAYER_COUNT)) {
-        try {
-            const auto& players = client->client->request_players();
-            fmt::print("online players: {}\n", static_cast<std::size_t>(players.count));
-        } catch (const std::exception& ex) {
-            fmt::print(std::cerr, "could not successfully obtain player count: {}\n", ex.what());
-            return EXIT_FAILURE;
-        }
-    } else {
-        if (cli->isset(descriptors::NAME_REPORT)) {
-            const auto& report_filters = cli->get<std::vector<std::string>>(descriptors::NAME_REPORT);
-            for (const auto& f : FILTER_PRECEDENCE) {
-                auto iter = std::find_if(report_filters.begin(), report_filters.end(), [&f](const auto& v){
-                    return f == v || (v.size() == 1 && f[0] == v[0]);
-                });
-
-                if (iter != report_filters.end() && reporters.count(f) != 0) {
-                    auto status = reporters.at(f)(*client, *cli);
-                    if (status != 0)
-                        return status;
-                }
-            }
-        }
+    auto format = output::parse_format(cli->get<std::string>(descriptors::NAME_FORMAT));
+    if (format != output::format::table) {
+        output::record_writer writer(format);
+        writer.begin();
+        auto status = write_record(*client, fmt::format("{}:{}", cli->get<std::string>(descriptors::NAME_HOST), cli->get<std::size_t>(descriptors::NAME_PORT)), report_sections(*cli), writer);
+        writer.end();
+        return status;
     }
+
+    return report(*client, *cli);
 }
\ No newline at end of file
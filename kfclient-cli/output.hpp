@@ -0,0 +1,319 @@
+#ifndef commandline_output_hpp
+#define commandline_output_hpp
+
+#include <kfdetails.hpp>
+#include <kfrules.hpp>
+#include <kfplayers.hpp>
+#include <kfutf8.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <variant>
+
+namespace output {
+    enum class format { table, json, ndjson, csv };
+
+    inline format parse_format(const std::string& name) {
+        if (name == "json") return format::json;
+        if (name == "ndjson") return format::ndjson;
+        if (name == "csv") return format::csv;
+        return format::table;
+    }
+
+    // Writes one record per server straight into a buffer that is flushed to stdout whenever it
+    // grows past FLUSH_SIZE, without building tables or rows first. The schema is stable:
+    //
+    //   json/ndjson: { "server": "host:port", "details": {...}, "rules": {...}, "players": [...] }
+    //                or { "server": "host:port", "error": "...", "timed_out": false }
+    //   csv:         server,section,index,field,value with one row per field (index numbers the
+    //                players and is empty otherwise), and section "error" for failed servers
+    class record_writer {
+        static constexpr const std::size_t FLUSH_SIZE = 64 * 1024;
+
+    public:
+        explicit record_writer(format f)
+            : format_(f) {}
+
+        // collects the output in sink rather than writing it to stdout
+        record_writer(format f, std::string& sink)
+            : format_(f), sink_(&sink) {}
+
+        record_writer(const record_writer&) = delete;
+        record_writer(record_writer&&) = delete;
+        record_writer& operator=(const record_writer&) = delete;
+        record_writer& operator=(record_writer&&) = delete;
+
+        ~record_writer() { flush(); }
+
+        void begin() {
+            if (format_ == format::json)
+                append("[\n");
+            else if (format_ == format::csv)
+                append("server,section,index,field,value\n");
+        }
+
+        void end() {
+            if (format_ == format::json)
+                append(first_ ? "]\n" : "\n]\n");
+            flush();
+        }
+
+        // every section is optional, pass nullptr for those that were not requested
+        void record(const std::string& server, const kfc::kfdetails* details, const kfc::kfrules* rules, const kfc::kfplayers* players) {
+            if (format_ == format::csv) {
+                if (details != nullptr) csv_details(server, *details);
+                if (rules != nullptr) csv_rules(server, *rules);
+                if (players != nullptr) csv_players(server, *players);
+            } else {
+                open_record(server);
+                if (details != nullptr) json_details(*details);
+                if (rules != nullptr) json_rules(*rules);
+                if (players != nullptr) json_players(*players);
+                close_record();
+            }
+
+            flush_if_full();
+        }
+
+        void error(const std::string& server, const std::string& message, bool timed_out) {
+            if (format_ == format::csv) {
+                csv_row(server, "error", "", "message", message);
+                csv_row(server, "error", "", "timed_out", timed_out ? "true" : "false");
+            } else {
+                open_record(server);
+                append(",\"error\":");
+                json_string(message);
+                fmt::format_to(out(), ",\"timed_out\":{}", timed_out);
+                close_record();
+            }
+
+            flush_if_full();
+        }
+
+        void flush() {
+            if (buffer_.size() == 0)
+                return;
+            if (sink_ != nullptr) {
+                sink_->append(buffer_.data(), buffer_.size());
+                buffer_.clear();
+                return;
+            }
+            std::fwrite(buffer_.data(), 1, buffer_.size(), stdout);
+            std::fflush(stdout);
+            buffer_.clear();
+        }
+
+    private:
+        std::back_insert_iterator<fmt::memory_buffer> out() { return std::back_inserter(buffer_); }
+
+        void append(const char* text) { fmt::format_to(out(), "{}", text); }
+
+        void flush_if_full() {
+            // ndjson consumers may act on every line, so they get each record right away
+            if (buffer_.size() >= FLUSH_SIZE || format_ == format::ndjson)
+                flush();
+        }
+
+        void open_record(const std::string& server) {
+            if (format_ == format::json)
+                append(first_ ? "  " : ",\n  ");
+            first_ = false;
+
+            append("{\"server\":");
+            json_string(server);
+        }
+
+        void close_record() {
+            append(format_ == format::ndjson ? "}\n" : "}");
+        }
+
+        // Text with bytes that may not be valid UTF-8 (rule names and values, the version, kfstrings
+        // parsed under utf8::policy::keep) is sanitized like utf8::policy::replace would, so the
+        // output is always valid JSON. ASCII text keeps its control characters, escaped.
+        void json_string(const std::string& value) {
+            if (!kfc::utf8::clean(value.data(), value.size())
+                && std::any_of(value.begin(), value.end(), [](char c) { return static_cast<unsigned char>(c) >= 0x80; })) {
+                kfc::utf8::sanitize(value.data(), value.size(), sanitized_);
+                json_escaped(sanitized_);
+                return;
+            }
+
+            json_escaped(value);
+        }
+
+        void json_escaped(const std::string& value) {
+            auto& b = buffer_;
+            b.push_back('"');
+            for (auto c : value) {
+                switch (c) {
+                case '"': append("\\\""); break;
+                case '\\': append("\\\\"); break;
+                case '\n': append("\\n"); break;
+                case '\r': append("\\r"); break;
+                case '\t': append("\\t"); break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                        fmt::format_to(out(), "\\u{:04x}", static_cast<int>(c));
+                    else
+                        b.push_back(c);
+                }
+            }
+            b.push_back('"');
+        }
+
+        // a clean string has no control characters, only quotes and backslashes need escaping
+        void json_string(const kfc::kfstring& value) {
+            if (!value.clean()) {
+                json_string(value.str());
+                return;
+            }
+
+            auto& b = buffer_;
+            const auto& text = value.str();
+            b.push_back('"');
+
+            std::size_t begin = 0;
+            for (auto pos = text.find_first_of("\"\\"); pos != std::string::npos; pos = text.find_first_of("\"\\", begin)) {
+                b.append(text.data() + begin, text.data() + pos);
+                b.push_back('\\');
+                b.push_back(text[pos]);
+                begin = pos + 1;
+            }
+
+            b.append(text.data() + begin, text.data() + text.size());
+            b.push_back('"');
+        }
+
+        void json_value(const kfc::kfrule::variant_t& value) {
+            if (auto b = std::get_if<bool>(&value))
+                fmt::format_to(out(), "{}", *b);
+            else if (auto d = std::get_if<double>(&value); d != nullptr && std::isfinite(*d))
+                fmt::format_to(out(), "{}", *d);
+            else if (d != nullptr)
+                append("null");
+            else
+                json_string(std::get<std::string>(value));
+        }
+
+        void json_details(const kfc::kfdetails& d) {
+            append(",\"details\":{\"hostname\":");
+            json_string(d.hostname);
+            append(",\"map\":");
+            json_string(d.map);
+            append(",\"game_dir\":");
+            json_string(d.game_dir);
+            append(",\"game_description\":");
+            json_string(d.game_description);
+            append(",\"version\":");
+            json_string(d.version);
+            fmt::format_to(out(), ",\"protocol\":{},\"steam_app_id\":{},\"player_count\":{},\"player_cap\":{},\"operating_system\":{},\"password_set\":{},\"waves_total\":{},\"waves_current\":{}}}",
+                d.protocol, d.steam_app_id, d.player_count, d.player_cap, d.operating_system, d.password_set, d.waves_total, d.waves_current);
+        }
+
+        void json_rules(const kfc::kfrules& rules) {
+            append(",\"rules\":{");
+            auto first = true;
+            for (const auto& rule : rules.rules) {
+                if (!first)
+                    buffer_.push_back(',');
+                first = false;
+                json_string(rule.name);
+                buffer_.push_back(':');
+                json_value(rule.value);
+            }
+            buffer_.push_back('}');
+        }
+
+        void json_players(const kfc::kfplayers& players) {
+            append(",\"players\":[");
+            auto first = true;
+            for (const auto& player : players.players) {
+                fmt::format_to(out(), "{}{{\"id\":{},\"name\":", first ? "" : ",", player.id);
+                json_string(player.name);
+                fmt::format_to(out(), ",\"score\":{},\"time\":{}}}", player.score, player.time);
+                first = false;
+            }
+            buffer_.push_back(']');
+        }
+
+        void csv_field(const std::string& value) {
+            if (value.find_first_of(",\"\r\n") == std::string::npos) {
+                buffer_.append(value.data(), value.data() + value.size());
+                return;
+            }
+
+            buffer_.push_back('"');
+            for (auto c : value) {
+                if (c == '"')
+                    buffer_.push_back('"');
+                buffer_.push_back(c);
+            }
+            buffer_.push_back('"');
+        }
+
+        template <typename T>
+        void csv_row(const std::string& server, const char* section, const std::string& index, const char* field, const T& value) {
+            csv_field(server);
+            fmt::format_to(out(), ",{},{},{},", section, index, field);
+            if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, kfc::kfstring>)
+                csv_field(value);
+            else
+                fmt::format_to(out(), "{}", value);
+            buffer_.push_back('\n');
+        }
+
+        void csv_details(const std::string& server, const kfc::kfdetails& d) {
+            csv_row(server, "details", "", "hostname", d.hostname);
+            csv_row(server, "details", "", "map", d.map);
+            csv_row(server, "details", "", "game_dir", d.game_dir);
+            csv_row(server, "details", "", "game_description", d.game_description);
+            csv_row(server, "details", "", "version", d.version);
+            csv_row(server, "details", "", "protocol", static_cast<std::uint32_t>(d.protocol));
+            csv_row(server, "details", "", "steam_app_id", d.steam_app_id);
+            csv_row(server, "details", "", "player_count", static_cast<std::uint32_t>(d.player_count));
+            csv_row(server, "details", "", "player_cap", static_cast<std::uint32_t>(d.player_cap));
+            csv_row(server, "details", "", "operating_system", static_cast<std::uint32_t>(d.operating_system));
+            csv_row(server, "details", "", "password_set", d.password_set);
+            csv_row(server, "details", "", "waves_total", d.waves_total);
+            csv_row(server, "details", "", "waves_current", d.waves_current);
+        }
+
+        void csv_rules(const std::string& server, const kfc::kfrules& rules) {
+            for (const auto& rule : rules.rules) {
+                csv_field(server);
+                append(",rules,,");
+                csv_field(rule.name);
+                buffer_.push_back(',');
+                if (auto s = std::get_if<std::string>(&rule.value))
+                    csv_field(*s);
+                else
+                    json_value(rule.value);
+                buffer_.push_back('\n');
+            }
+        }
+
+        void csv_players(const std::string& server, const kfc::kfplayers& players) {
+            std::size_t index = 0;
+            for (const auto& player : players.players) {
+                auto i = std::to_string(index++);
+                csv_row(server, "players", i, "id", static_cast<std::uint32_t>(player.id));
+                csv_row(server, "players", i, "name", player.name);
+                csv_row(server, "players", i, "score", player.score);
+                csv_row(server, "players", i, "time", player.time);
+            }
+        }
+
+        format format_;
+        std::string* sink_ = nullptr;
+        bool first_ = true;
+        fmt::memory_buffer buffer_;
+        std::string sanitized_; // kept to avoid allocations
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,27 @@
+#ifndef commandline_server_hpp
+#define commandline_server_hpp
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace commandline {
+    static const std::uint16_t DEFAULT_QUERY_PORT = 27015;
+
+    // Splits a host:port server argument of the daemons; a server without a port is queried on
+    // DEFAULT_QUERY_PORT.
+    inline std::pair<std::string, std::uint16_t> split_server(const std::string& server) {
+        auto colon = server.rfind(':');
+        if (colon == std::string::npos)
+            return { server, DEFAULT_QUERY_PORT };
+
+        auto port = std::stoul(server.substr(colon + 1));
+        if (port == 0 || port > 65535)
+            throw std::invalid_argument("invalid port in " + server);
+
+        return { server.substr(0, colon), static_cast<std::uint16_t>(port) };
+    }
+}
+
+#endif
\ No newline at end of file
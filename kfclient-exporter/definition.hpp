@@ -0,0 +1,37 @@
+#ifndef kfexporter_definition_hpp
+#define kfexporter_definition_hpp
+
+#include <dynacli.hpp>
+#include <string>
+#include <vector>
+
+namespace commandline {
+	namespace descriptors {
+		static constexpr auto PROGRAM_NAME = "kfexporter";
+		static constexpr auto PROGRAM_DESC = "a Prometheus exporter that polls Killing Floor 2 servers and serves their state at /metrics";
+
+		static constexpr auto NAME_LISTEN = "listen";
+		static constexpr const option_descriptor DESC_LISTEN(NAME_LISTEN, "-l,--listen", "the address to serve /metrics on.");
+
+		static constexpr auto NAME_HTTP_PORT = "httpport";
+		static constexpr const option_descriptor DESC_HTTP_PORT(NAME_HTTP_PORT, "-p,--port", "the tcp port to serve /metrics on.");
+
+		static constexpr auto NAME_INTERVAL = "interval";
+		static constexpr const option_descriptor DESC_INTERVAL(NAME_INTERVAL, "-i,--interval", "the polling interval in seconds.");
+
+		static constexpr auto NAME_TIMEOUT = "timeout";
+		static constexpr const option_descriptor DESC_TIMEOUT(NAME_TIMEOUT, "-t,--timeout", "the timeout for datagram operations.");
+
+		static constexpr auto NAME_PARALLEL = "parallel";
+		static constexpr const option_descriptor DESC_PARALLEL(NAME_PARALLEL, "-j,--parallel", "the maximum number of servers that are polled at the same time.");
+
+		static constexpr auto NAME_SERVERS = "servers";
+		static constexpr const option_descriptor DESC_SERVERS(NAME_SERVERS, "servers", "the servers to poll, as host or host:port (the port defaults to 27015).");
+	}
+
+	using kfexporter_cli = commandline::dynacli<
+		bool, std::size_t, std::string, std::vector<std::string>
+	>;
+}
+
+#endif
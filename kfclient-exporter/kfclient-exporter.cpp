@@ -0,0 +1,264 @@
+#include <boost/asio.hpp>
+#include <kfpoller.hpp>
+#include <kffleet.hpp>
+#include <kfhttpd.hpp>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include "definition.hpp"
+#include "server.hpp"
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using tcp = boost::asio::ip::tcp;
+
+static const std::size_t DEFAULT_TIMEOUT = 5;
+static const std::size_t DEFAULT_INTERVAL = 15;
+static const std::size_t DEFAULT_HTTP_PORT = 9527;
+static const std::size_t DEFAULT_PARALLEL = 16;
+static inline const std::string DEFAULT_LISTEN = "127.0.0.1";
+
+// upper bounds in seconds of the query duration histogram
+static constexpr const std::array<double, 12> DURATION_BUCKETS = {
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0
+};
+
+static constexpr const std::array<const char*, 2> REQUEST_NAMES = { "details", "players" };
+
+struct histogram {
+    std::array<std::uint64_t, DURATION_BUCKETS.size()> buckets = {};
+    std::uint64_t count = 0;
+    double sum = 0.0;
+
+    void observe(double value) {
+        for (std::size_t i = 0; i < DURATION_BUCKETS.size(); ++i) {
+            if (value <= DURATION_BUCKETS.at(i))
+                buckets.at(i)++;
+        }
+        count++;
+        sum += value;
+    }
+};
+
+struct server_state {
+    bool up = false;
+    double last_poll = 0.0;
+    std::uint8_t player_count = 0;
+    std::uint8_t player_cap = 0;
+    std::int32_t waves_current = 0;
+    std::int32_t waves_total = 0;
+    std::uint64_t timeouts = 0;
+    std::uint64_t failures = 0;
+    std::array<histogram, REQUEST_NAMES.size()> durations;
+};
+
+class metrics {
+public:
+    void update(const kfc::kfpoll_result& result) {
+        fleet_.update(result);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& state = servers_[fmt::format("{}:{}", result.host, result.port)];
+
+        state.up = result.error.empty();
+        state.last_poll = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        if (!result.error.empty()) {
+            (result.timed_out ? state.timeouts : state.failures)++;
+            return;
+        }
+
+        if (result.details != nullptr) {
+            state.player_count = result.details->player_count;
+            state.player_cap = result.details->player_cap;
+            state.waves_current = result.details->waves_current;
+            state.waves_total = result.details->waves_total;
+            state.durations.at(0).observe(std::chrono::duration<double>(result.details_round_trip).count());
+        }
+
+        if (result.players != nullptr)
+            state.durations.at(1).observe(std::chrono::duration<double>(result.players_round_trip).count());
+    }
+
+    std::string render() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::memory_buffer out;
+
+        gauge(out, "kf_up", "Whether the last poll of the server succeeded.", [](const server_state& s) { return s.up ? 1.0 : 0.0; });
+        gauge(out, "kf_player_count", "Number of players on the server.", [](const server_state& s) { return s.player_count; });
+        gauge(out, "kf_player_cap", "Maximum number of players on the server.", [](const server_state& s) { return s.player_cap; });
+        gauge(out, "kf_waves_current", "Current wave of the running game.", [](const server_state& s) { return s.waves_current; });
+        gauge(out, "kf_waves_total", "Number of waves of the running game.", [](const server_state& s) { return s.waves_total; });
+        gauge(out, "kf_last_poll_timestamp_seconds", "Unix time of the last poll of the server.", [](const server_state& s) { return s.last_poll; });
+
+        fmt::format_to(std::back_inserter(out), "# HELP kf_query_errors_total Number of failed polls of the server.\n# TYPE kf_query_errors_total counter\n");
+        for (const auto& pair : servers_) {
+            fmt::format_to(std::back_inserter(out), "kf_query_errors_total{{server=\"{}\",kind=\"timeout\"}} {}\n", escape(pair.first), pair.second.timeouts);
+            fmt::format_to(std::back_inserter(out), "kf_query_errors_total{{server=\"{}\",kind=\"error\"}} {}\n", escape(pair.first), pair.second.failures);
+        }
+
+        fmt::format_to(std::back_inserter(out), "# HELP kf_query_duration_seconds Round trip time of successful queries.\n# TYPE kf_query_duration_seconds histogram\n");
+        for (const auto& pair : servers_) {
+            auto server = escape(pair.first);
+            for (std::size_t r = 0; r < REQUEST_NAMES.size(); ++r) {
+                const auto& h = pair.second.durations.at(r);
+                for (std::size_t i = 0; i < DURATION_BUCKETS.size(); ++i)
+                    fmt::format_to(std::back_inserter(out), "kf_query_duration_seconds_bucket{{server=\"{}\",request=\"{}\",le=\"{}\"}} {}\n", server, REQUEST_NAMES.at(r), DURATION_BUCKETS.at(i), h.buckets.at(i));
+                fmt::format_to(std::back_inserter(out), "kf_query_duration_seconds_bucket{{server=\"{}\",request=\"{}\",le=\"+Inf\"}} {}\n", server, REQUEST_NAMES.at(r), h.count);
+                fmt::format_to(std::back_inserter(out), "kf_query_duration_seconds_sum{{server=\"{}\",request=\"{}\"}} {}\n", server, REQUEST_NAMES.at(r), h.sum);
+                fmt::format_to(std::back_inserter(out), "kf_query_duration_seconds_count{{server=\"{}\",request=\"{}\"}} {}\n", server, REQUEST_NAMES.at(r), h.count);
+            }
+        }
+
+        render_fleet(out);
+
+        auto stats = kfc::kfstats::global();
+        fmt::format_to(std::back_inserter(out), "# HELP kf_client_events_total Events counted by libkfclient across all servers.\n# TYPE kf_client_events_total counter\n");
+        for (std::size_t i = 0; i < static_cast<std::size_t>(kfc::kfcounter::count); ++i) {
+            auto counter = static_cast<kfc::kfcounter>(i);
+            fmt::format_to(std::back_inserter(out), "kf_client_events_total{{event=\"{}\"}} {}\n", kfc::to_string(counter), stats.counter(counter));
+        }
+
+        return fmt::to_string(out);
+    }
+
+private:
+    static std::string escape(const std::string& value) {
+        std::string result;
+        for (auto c : value) {
+            if (c == '\\' || c == '"')
+                result += '\\';
+            if (c == '\n') {
+                result += "\\n";
+                continue;
+            }
+            result += c;
+        }
+        return result;
+    }
+
+    // fleet-wide aggregates, kept up to date by every poll rather than summed up here
+    void render_fleet(fmt::memory_buffer& out) const {
+        auto totals = fleet_.totals();
+        auto append = std::back_inserter(out);
+
+        fmt::format_to(append, "# HELP kf_fleet_servers Number of servers that answered their last poll.\n# TYPE kf_fleet_servers gauge\nkf_fleet_servers {}\n", totals.servers);
+        fmt::format_to(append, "# HELP kf_fleet_players Number of players on all servers.\n# TYPE kf_fleet_players gauge\nkf_fleet_players {}\n", totals.players);
+        fmt::format_to(append, "# HELP kf_fleet_slots Number of player slots on all servers.\n# TYPE kf_fleet_slots gauge\nkf_fleet_slots {}\n", totals.slots);
+
+        fmt::format_to(append, "# HELP kf_fleet_players_by_map Number of players per map.\n# TYPE kf_fleet_players_by_map gauge\n");
+        for (const auto& pair : totals.players_by_map)
+            fmt::format_to(append, "kf_fleet_players_by_map{{map=\"{}\"}} {}\n", escape(pair.first), pair.second);
+
+        fmt::format_to(append, "# HELP kf_fleet_servers_by_wave Number of servers per current wave.\n# TYPE kf_fleet_servers_by_wave gauge\n");
+        for (const auto& pair : totals.servers_by_wave)
+            fmt::format_to(append, "kf_fleet_servers_by_wave{{wave=\"{}\"}} {}\n", pair.first, pair.second);
+
+        fmt::format_to(append, "# HELP kf_fleet_servers_by_free_slots Number of servers per number of free slots.\n# TYPE kf_fleet_servers_by_free_slots gauge\n");
+        for (const auto& pair : totals.servers_by_free_slots)
+            fmt::format_to(append, "kf_fleet_servers_by_free_slots{{free=\"{}\"}} {}\n", pair.first, pair.second);
+    }
+
+    template <typename F>
+    void gauge(fmt::memory_buffer& out, const char* name, const char* help, F value) const {
+        fmt::format_to(std::back_inserter(out), "# HELP {0} {1}\n# TYPE {0} gauge\n", name, help);
+        for (const auto& pair : servers_)
+            fmt::format_to(std::back_inserter(out), "{}{{server=\"{}\"}} {}\n", name, escape(pair.first), value(pair.second));
+    }
+
+    mutable std::mutex mutex_;
+    std::map<std::string, server_state> servers_;
+    kfc::kffleet fleet_;
+};
+
+std::unique_ptr<commandline::kfexporter_cli> create_cli() {
+    using namespace commandline;
+
+    auto cli = std::make_unique<kfexporter_cli>(descriptors::PROGRAM_DESC, descriptors::PROGRAM_NAME);
+
+    cli->add_option<std::string>(descriptors::DESC_LISTEN)->required(false)->default_val(DEFAULT_LISTEN)->default_str(DEFAULT_LISTEN);
+    cli->add_option<std::size_t>(descriptors::DESC_HTTP_PORT)->required(false)->default_val(DEFAULT_HTTP_PORT)->default_str(std::to_string(DEFAULT_HTTP_PORT));
+    cli->add_option<std::size_t>(descriptors::DESC_INTERVAL)->required(false)->default_val(DEFAULT_INTERVAL)->default_str(std::to_string(DEFAULT_INTERVAL));
+    cli->add_option<std::size_t>(descriptors::DESC_TIMEOUT)->required(false)->default_val(DEFAULT_TIMEOUT)->default_str(std::to_string(DEFAULT_TIMEOUT));
+    cli->add_option<std::size_t>(descriptors::DESC_PARALLEL)->required(false)->default_val(DEFAULT_PARALLEL)->default_str(std::to_string(DEFAULT_PARALLEL));
+    cli->add_option<std::vector<std::string>>(descriptors::DESC_SERVERS)->required(true);
+
+    return cli;
+}
+
+int main(int argc, const char* argv[]) {
+    using namespace commandline;
+
+    std::unique_ptr<commandline::kfexporter_cli> cli;
+
+    try {
+        cli = create_cli();
+    } catch (const std::exception& error) {
+        fmt::print(std::cerr, "error: cannot initialize cli parser: {}\n", error.what());
+        return EXIT_FAILURE;
+    }
+
+    try {
+        cli->command().parse(argc, argv);
+    } catch (const CLI::ParseError& e) {
+        return cli->command().exit(e);
+    }
+
+    try {
+        metrics state;
+        kfc::kfpoller poller(std::chrono::seconds(cli->get<std::size_t>(descriptors::NAME_INTERVAL)), std::chrono::seconds(cli->get<std::size_t>(descriptors::NAME_TIMEOUT)));
+
+        // servers that do not answer must not hold up the polls of the others
+        poller.parallel(cli->get<std::size_t>(descriptors::NAME_PARALLEL));
+
+        // map names become label values, which must be valid UTF-8
+        poller.utf8_policy(kfc::utf8::policy::replace);
+
+        for (const auto& server : cli->get<std::vector<std::string>>(descriptors::NAME_SERVERS)) {
+            auto target = split_server(server);
+            poller.add_target(target.first, target.second);
+        }
+
+        boost::asio::io_context context;
+        tcp::endpoint endpoint(boost::asio::ip::make_address(cli->get<std::string>(descriptors::NAME_LISTEN)), static_cast<std::uint16_t>(cli->get<std::size_t>(descriptors::NAME_HTTP_PORT)));
+
+        kfc::httpd::server server(context, endpoint, [&state](const kfc::httpd::request& req, kfc::httpd::response& res) {
+            if (req.target != "/metrics") {
+                res.status = 404;
+                res.body = "see /metrics\n";
+                return;
+            }
+
+            res.content_type = "text/plain; version=0.0.4; charset=utf-8";
+            res.body = state.render();
+        });
+
+        boost::asio::signal_set signals(context, SIGINT, SIGTERM);
+        signals.async_wait([&context, &poller](const boost::system::error_code&, int) {
+            poller.stop();
+            context.stop();
+        });
+
+        std::thread polling([&poller, &state]() {
+            poller.run([&state](const kfc::kfpoll_result& result) { state.update(result); });
+        });
+
+        fmt::print("serving metrics of {} servers at http://{}:{}/metrics\n", poller.size(), server.local_endpoint().address().to_string(), server.local_endpoint().port());
+        context.run();
+
+        poller.stop();
+        polling.join();
+        return 0;
+    } catch (const std::exception& ex) {
+        fmt::print(std::cerr, "error: {}\n", ex.what());
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef kfgateway_definition_hpp
+#define kfgateway_definition_hpp
+
+#include <dynacli.hpp>
+#include <string>
+#include <vector>
+
+namespace commandline {
+	namespace descriptors {
+		static constexpr auto PROGRAM_NAME = "kfgateway";
+		static constexpr auto PROGRAM_DESC = "a daemon that polls Killing Floor 2 servers and serves their details, rules and players as JSON over HTTP";
+
+		static constexpr auto NAME_LISTEN = "listen";
+		static constexpr const option_descriptor DESC_LISTEN(NAME_LISTEN, "-l,--listen", "the address to serve the JSON on.");
+
+		static constexpr auto NAME_HTTP_PORT = "httpport";
+		static constexpr const option_descriptor DESC_HTTP_PORT(NAME_HTTP_PORT, "-p,--port", "the tcp port to serve the JSON on.");
+
+		static constexpr auto NAME_INTERVAL = "interval";
+		static constexpr const option_descriptor DESC_INTERVAL(NAME_INTERVAL, "-i,--interval", "the polling interval in seconds.");
+
+		static constexpr auto NAME_TIMEOUT = "timeout";
+		static constexpr const option_descriptor DESC_TIMEOUT(NAME_TIMEOUT, "-t,--timeout", "the timeout for datagram operations.");
+
+		static constexpr auto NAME_WORKERS = "workers";
+		static constexpr const option_descriptor DESC_WORKERS(NAME_WORKERS, "-w,--workers", "the number of polling threads, the servers are divided between them.");
+
+		static constexpr auto NAME_QUEUE = "queue";
+		static constexpr const option_descriptor DESC_QUEUE(NAME_QUEUE, "-q,--queue", "the number of poll results that can wait for the cache.");
+
+		static constexpr auto NAME_PARALLEL = "parallel";
+		static constexpr const option_descriptor DESC_PARALLEL(NAME_PARALLEL, "-j,--parallel", "the maximum number of servers that are polled at the same time by every worker.");
+
+		static constexpr auto NAME_SERVERS = "servers";
+		static constexpr const option_descriptor DESC_SERVERS(NAME_SERVERS, "servers", "the servers to poll, as host or host:port (the port defaults to 27015).");
+	}
+
+	using kfgateway_cli = commandline::dynacli<
+		bool, std::size_t, std::string, std::vector<std::string>
+	>;
+}
+
+#endif
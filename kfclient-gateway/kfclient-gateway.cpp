@@ -0,0 +1,398 @@
+#include <boost/asio.hpp>
+#include <kfpoller.hpp>
+#include <kfqueue.hpp>
+#include <kfhash.hpp>
+#include <kfhttpd.hpp>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include "definition.hpp"
+#include "output.hpp"
+#include "server.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using tcp = boost::asio::ip::tcp;
+
+static const std::size_t DEFAULT_TIMEOUT = 5;
+static const std::size_t DEFAULT_INTERVAL = 5;
+static const std::size_t DEFAULT_HTTP_PORT = 9528;
+static const std::size_t DEFAULT_WORKERS = 1;
+static const std::size_t DEFAULT_PARALLEL = 16;
+static const std::size_t DEFAULT_QUEUE = 256;
+static inline const std::string DEFAULT_LISTEN = "127.0.0.1";
+
+// the body of the whole record of a server, followed by that of every section on its own
+static constexpr const std::array<const char*, 4> VIEW_NAMES = { "", "details", "rules", "players" };
+
+// A rendered response. The ETag is a hash of the body, so a poll that brings nothing new
+// produces the same tag and clients keep their copy.
+struct view {
+    int status = 200;
+    std::string body;
+    std::string etag;
+};
+
+using view_ptr = std::shared_ptr<const view>;
+
+// Keeps the last poll of every server as ready-made JSON in the schema of the CLI output. Only
+// the views a poll changed are rendered again, requests copy a pointer and never serialize.
+class snapshot_cache {
+    struct server_entry {
+        std::string name;
+        std::shared_ptr<const kfc::kfdetails> details;
+        std::shared_ptr<const kfc::kfrules> rules;
+        std::shared_ptr<const kfc::kfplayers> players;
+        std::string error;
+        std::array<view_ptr, VIEW_NAMES.size()> views;
+    };
+
+public:
+    void add_server(const std::string& name) {
+        auto& entry = servers_.emplace_back();
+        entry.name = name;
+        entry.views.fill(render_error(name, "not polled yet", false));
+        index_.emplace(name, servers_.size() - 1);
+    }
+
+    void update(const kfc::kfpoll_result& result) {
+        auto found = index_.find(fmt::format("{}:{}", result.host, result.port));
+        if (found == index_.end())
+            return;
+
+        auto& entry = servers_.at(found->second);
+
+        if (!result.error.empty()) {
+            if (entry.error == result.error)
+                return;
+
+            auto failed = render_error(entry.name, result.error, result.timed_out);
+            std::lock_guard<std::mutex> lock(mutex_);
+            entry.details = nullptr;
+            entry.rules = nullptr;
+            entry.players = nullptr;
+            entry.error = result.error;
+            entry.views.fill(failed);
+            list_ = nullptr;
+            return;
+        }
+
+        // a failed poll dropped the sections, so a server that comes back renders all of them
+        auto details = changed(entry.details, result.details, result.details_unchanged);
+        auto rules = changed(entry.rules, result.rules, result.rules_unchanged);
+        auto players = changed(entry.players, result.players, result.players_unchanged);
+
+        if (details == nullptr && rules == nullptr && players == nullptr)
+            return;
+
+        // rendered before taking the lock, only this thread writes the entries
+        std::array<view_ptr, VIEW_NAMES.size()> views = entry.views;
+        const auto* d = details != nullptr ? details.get() : entry.details.get();
+        const auto* r = rules != nullptr ? rules.get() : entry.rules.get();
+        const auto* p = players != nullptr ? players.get() : entry.players.get();
+
+        views.at(0) = render(entry.name, d, r, p);
+        if (details != nullptr) views.at(1) = render(entry.name, d, nullptr, nullptr);
+        if (rules != nullptr) views.at(2) = render(entry.name, nullptr, r, nullptr);
+        if (players != nullptr) views.at(3) = render(entry.name, nullptr, nullptr, p);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (details != nullptr) entry.details = std::move(details);
+        if (rules != nullptr) entry.rules = std::move(rules);
+        if (players != nullptr) entry.players = std::move(players);
+        entry.error.clear();
+
+        for (std::size_t i = 0; i < views.size(); ++i) {
+            if (views.at(i)->etag != entry.views.at(i)->etag) {
+                entry.views.at(i) = views.at(i);
+                if (i == 0)
+                    list_ = nullptr;
+            }
+        }
+    }
+
+    // /servers, /servers/host:port and /servers/host:port/{details,rules,players}
+    view_ptr lookup(const std::string& path) {
+        static const std::string PREFIX = "/servers";
+
+        if (path.compare(0, PREFIX.size(), PREFIX) != 0)
+            return nullptr;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (path.size() == PREFIX.size() || path == PREFIX + "/")
+            return list();
+
+        if (path.at(PREFIX.size()) != '/')
+            return nullptr;
+
+        auto name = path.substr(PREFIX.size() + 1);
+        std::string section;
+        if (auto slash = name.find('/'); slash != std::string::npos) {
+            section = name.substr(slash + 1);
+            name.erase(slash);
+        }
+
+        if (name.find(':') == std::string::npos)
+            name += fmt::format(":{}", commandline::DEFAULT_QUERY_PORT);
+
+        auto found = index_.find(name);
+        if (found == index_.end())
+            return nullptr;
+
+        for (std::size_t i = 0; i < VIEW_NAMES.size(); ++i) {
+            if (section == VIEW_NAMES.at(i))
+                return servers_.at(found->second).views.at(i);
+        }
+
+        return nullptr;
+    }
+
+private:
+    template <typename T>
+    static std::shared_ptr<const T> changed(const std::shared_ptr<const T>& cached, const T* polled, bool unchanged) {
+        if (polled == nullptr || (unchanged && cached != nullptr))
+            return nullptr;
+        return std::make_shared<const T>(*polled);
+    }
+
+    static std::string etag(const std::string& body) {
+        return fmt::format("\"{:016x}\"", kfc::kfhash(reinterpret_cast<const std::uint8_t*>(body.data()), body.size()));
+    }
+
+    static view_ptr render(const std::string& name, const kfc::kfdetails* details, const kfc::kfrules* rules, const kfc::kfplayers* players) {
+        auto result = std::make_shared<view>();
+        output::record_writer(output::format::ndjson, result->body).record(name, details, rules, players);
+        result->etag = etag(result->body);
+        return result;
+    }
+
+    // failed servers answer 503 with the error record and are never cached by clients
+    static view_ptr render_error(const std::string& name, const std::string& message, bool timed_out) {
+        auto result = std::make_shared<view>();
+        output::record_writer(output::format::ndjson, result->body).error(name, message, timed_out);
+        result->status = 503;
+        return result;
+    }
+
+    // the records of all servers, joined again only after one of them changed; failed servers
+    // are part of it, so its ETag also changes when a server goes down or comes back
+    view_ptr list() {
+        if (list_ != nullptr)
+            return list_;
+
+        auto result = std::make_shared<view>();
+        result->body = "[";
+        for (const auto& entry : servers_) {
+            const auto& body = entry.views.at(0)->body;
+            if (result->body.size() > 1)
+                result->body += ",\n";
+            result->body.append(body, 0, body.size() - 1);
+        }
+        result->body += "]\n";
+        result->etag = etag(result->body);
+
+        list_ = result;
+        return list_;
+    }
+
+    std::mutex mutex_;
+    std::vector<server_entry> servers_;
+    std::map<std::string, std::size_t> index_;
+    view_ptr list_;
+};
+
+// true when the If-None-Match header lists the tag (or *), weak tags compare equal to strong ones
+static bool matches(const std::string& header, const std::string& tag) {
+    std::size_t begin = 0;
+    while (begin < header.size()) {
+        auto end = header.find(',', begin);
+        if (end == std::string::npos)
+            end = header.size();
+
+        auto candidate = header.substr(begin, end - begin);
+        candidate.erase(0, candidate.find_first_not_of(" \t"));
+        candidate.erase(candidate.find_last_not_of(" \t") + 1);
+        if (candidate.compare(0, 2, "W/") == 0)
+            candidate.erase(0, 2);
+
+        if (candidate == "*" || candidate == tag)
+            return true;
+        begin = end + 1;
+    }
+
+    return false;
+}
+
+static void serve(snapshot_cache& cache, const kfc::httpd::request& req, kfc::httpd::response& res) {
+    if (req.method != "GET" && req.method != "HEAD") {
+        res.status = 405;
+        res.headers.emplace_back("Allow", "GET, HEAD");
+        return;
+    }
+
+    auto current = cache.lookup(req.target.substr(0, req.target.find('?')));
+    if (current == nullptr) {
+        res.status = 404;
+        res.body = "see /servers\n";
+        return;
+    }
+
+    res.status = current->status;
+    res.content_type = "application/json";
+
+    if (!current->etag.empty()) {
+        res.headers.emplace_back("ETag", current->etag);
+        res.headers.emplace_back("Cache-Control", "no-cache");
+
+        if (const auto* tags = req.header("if-none-match"); tags != nullptr && matches(*tags, current->etag)) {
+            res.status = 304;
+            return;
+        }
+    } else {
+        res.headers.emplace_back("Cache-Control", "no-store");
+    }
+
+    res.body = current->body;
+}
+
+std::unique_ptr<commandline::kfgateway_cli> create_cli() {
+    using namespace commandline;
+
+    auto cli = std::make_unique<kfgateway_cli>(descriptors::PROGRAM_DESC, descriptors::PROGRAM_NAME);
+
+    cli->add_option<std::string>(descriptors::DESC_LISTEN)->required(false)->default_val(DEFAULT_LISTEN)->default_str(DEFAULT_LISTEN);
+    cli->add_option<std::size_t>(descriptors::DESC_HTTP_PORT)->required(false)->default_val(DEFAULT_HTTP_PORT)->default_str(std::to_string(DEFAULT_HTTP_PORT));
+    cli->add_option<std::size_t>(descriptors::DESC_INTERVAL)->required(false)->default_val(DEFAULT_INTERVAL)->default_str(std::to_string(DEFAULT_INTERVAL));
+    cli->add_option<std::size_t>(descriptors::DESC_TIMEOUT)->required(false)->default_val(DEFAULT_TIMEOUT)->default_str(std::to_string(DEFAULT_TIMEOUT));
+    cli->add_option<std::size_t>(descriptors::DESC_WORKERS)->required(false)->default_val(DEFAULT_WORKERS)->default_str(std::to_string(DEFAULT_WORKERS));
+    cli->add_option<std::size_t>(descriptors::DESC_QUEUE)->required(false)->default_val(DEFAULT_QUEUE)->default_str(std::to_string(DEFAULT_QUEUE));
+    cli->add_option<std::size_t>(descriptors::DESC_PARALLEL)->required(false)->default_val(DEFAULT_PARALLEL)->default_str(std::to_string(DEFAULT_PARALLEL));
+    cli->add_option<std::vector<std::string>>(descriptors::DESC_SERVERS)->required(true);
+
+    return cli;
+}
+
+// Polls its share of the servers and hands the results to the cache thread, so rendering never
+// holds up the sockets. A result the queue had no room for is dropped; the next one of that
+// server is then passed on as changed, otherwise the cache would keep the state before the drop.
+static void poll_worker(kfc::kfpoller& poller, kfc::kfresult_queue& queue) {
+    std::set<std::pair<std::string, std::uint16_t>> stale;
+
+    poller.run([&queue, &stale](const kfc::kfpoll_result& result) {
+        auto key = std::make_pair(result.host, result.port);
+
+        if (stale.empty() || stale.count(key) == 0) {
+            if (!queue.push(result))
+                stale.insert(std::move(key));
+            return;
+        }
+
+        kfc::kfpoll_result changed = result;
+        changed.details_unchanged = false;
+        changed.rules_unchanged = false;
+        changed.players_unchanged = false;
+        if (queue.push(changed))
+            stale.erase(key);
+    });
+}
+
+int main(int argc, const char* argv[]) {
+    using namespace commandline;
+
+    std::unique_ptr<commandline::kfgateway_cli> cli;
+
+    try {
+        cli = create_cli();
+    } catch (const std::exception& error) {
+        fmt::print(std::cerr, "error: cannot initialize cli parser: {}\n", error.what());
+        return EXIT_FAILURE;
+    }
+
+    try {
+        cli->command().parse(argc, argv);
+    } catch (const CLI::ParseError& e) {
+        return cli->command().exit(e);
+    }
+
+    try {
+        snapshot_cache cache;
+        kfc::kfresult_queue queue(std::max<std::size_t>(cli->get<std::size_t>(descriptors::NAME_QUEUE), 1));
+        std::vector<std::unique_ptr<kfc::kfpoller>> pollers(std::max<std::size_t>(cli->get<std::size_t>(descriptors::NAME_WORKERS), 1));
+        std::size_t servers = 0;
+
+        for (auto& poller : pollers) {
+            poller = std::make_unique<kfc::kfpoller>(std::chrono::seconds(cli->get<std::size_t>(descriptors::NAME_INTERVAL)), std::chrono::seconds(cli->get<std::size_t>(descriptors::NAME_TIMEOUT)), kfc::SECTION_ALL);
+            poller->parallel(cli->get<std::size_t>(descriptors::NAME_PARALLEL));
+
+            // names and hostnames end up in JSON, which needs valid UTF-8 without control characters
+            poller->utf8_policy(kfc::utf8::policy::replace);
+        }
+
+        for (const auto& server : cli->get<std::vector<std::string>>(descriptors::NAME_SERVERS)) {
+            auto target = split_server(server);
+            pollers.at(servers++ % pollers.size())->add_target(target.first, target.second);
+            cache.add_server(fmt::format("{}:{}", target.first, target.second));
+        }
+
+        boost::asio::io_context context;
+        tcp::endpoint endpoint(boost::asio::ip::make_address(cli->get<std::string>(descriptors::NAME_LISTEN)), static_cast<std::uint16_t>(cli->get<std::size_t>(descriptors::NAME_HTTP_PORT)));
+
+        kfc::httpd::server server(context, endpoint, [&cache](const kfc::httpd::request& req, kfc::httpd::response& res) {
+            serve(cache, req, res);
+        });
+
+        auto stop_polling = [&pollers]() {
+            for (auto& poller : pollers)
+                poller->stop();
+        };
+
+        boost::asio::signal_set signals(context, SIGINT, SIGTERM);
+        signals.async_wait([&context, &stop_polling](const boost::system::error_code&, int) {
+            stop_polling();
+            context.stop();
+        });
+
+        std::vector<std::thread> polling;
+        for (auto& poller : pollers)
+            polling.emplace_back([&poller, &queue]() { poll_worker(*poller, queue); });
+
+        std::atomic<bool> stopped { false };
+        std::thread caching([&queue, &cache, &stopped]() {
+            kfc::kfresult_ptr result;
+            while (!stopped.load()) {
+                if (queue.pop(result, std::chrono::milliseconds(100))) {
+                    cache.update(result->view());
+                    result.reset();
+                }
+            }
+        });
+
+        fmt::print("serving {} servers at http://{}:{}/servers\n", servers, server.local_endpoint().address().to_string(), server.local_endpoint().port());
+        context.run();
+
+        stop_polling();
+        for (auto& thread : polling)
+            thread.join();
+        stopped.store(true);
+        caching.join();
+
+        if (queue.dropped() != 0)
+            fmt::print(std::cerr, "dropped {} poll results the cache could not keep up with\n", queue.dropped());
+        return 0;
+    } catch (const std::exception& ex) {
+        fmt::print(std::cerr, "error: {}\n", ex.what());
+        return EXIT_FAILURE;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef kfload_definition_hpp
+#define kfload_definition_hpp
+
+#include <dynacli.hpp>
+#include <string>
+#include <vector>
+
+namespace commandline {
+	namespace descriptors {
+		static constexpr auto PROGRAM_NAME = "kfload";
+		static constexpr auto PROGRAM_DESC = "drives concurrent virtual clients against Killing Floor 2 query servers and reports throughput and latency as JSON";
+
+		static constexpr auto NAME_CLIENTS = "clients";
+		static constexpr const option_descriptor DESC_CLIENTS(NAME_CLIENTS, "-c,--clients", "the number of concurrent virtual clients.");
+
+		static constexpr auto NAME_DURATION = "duration";
+		static constexpr const option_descriptor DESC_DURATION(NAME_DURATION, "-d,--duration", "how long to run in seconds.");
+
+		static constexpr auto NAME_REQUEST = "request";
+		static constexpr const option_descriptor DESC_REQUEST(NAME_REQUEST, "-r,--request", "the requests every virtual client sends in turn (details, rules, players).");
+
+		static constexpr auto NAME_TIMEOUT = "timeout";
+		static constexpr const option_descriptor DESC_TIMEOUT(NAME_TIMEOUT, "-t,--timeout", "the timeout for datagram operations in milliseconds.");
+
+		static constexpr auto NAME_ENGINE = "engine";
+		static constexpr const option_descriptor DESC_ENGINE(NAME_ENGINE, "-e,--engine", "sweep the endpoints of every virtual client with a kfbatch on this engine (asio, io_uring) instead of one blocking client per endpoint.");
+
+		static constexpr auto NAME_PARALLEL = "parallel";
+		static constexpr const option_descriptor DESC_PARALLEL(NAME_PARALLEL, "-j,--parallel", "the queries every virtual client keeps in flight with --engine, all of its endpoints by default.");
+
+		static constexpr auto NAME_OUTPUT = "output";
+		static constexpr const option_descriptor DESC_OUTPUT(NAME_OUTPUT, "-o,--output", "write the JSON report to this file instead of stdout.");
+
+		static constexpr auto NAME_TARGETS = "targets";
+		static constexpr const option_descriptor DESC_TARGETS(NAME_TARGETS, "targets", "the endpoints to query, as host, host:port or host:first-last (the port defaults to 27015).");
+	}
+
+	using kfload_cli = commandline::dynacli<
+		bool, std::size_t, std::string, std::vector<std::string>
+	>;
+}
+
+#endif
@@ -0,0 +1,331 @@
+#include <kfclient.hpp>
+#include <kfpoller.hpp>
+#include <kfquery.hpp>
+#include <kfuring.hpp>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include "definition.hpp"
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifdef KFCLIENT_UNIX
+#include <sys/resource.h>
+#endif
+
+using udp = boost::asio::ip::udp;
+using clock_type = std::chrono::steady_clock;
+
+static const std::size_t DEFAULT_CLIENTS = 8;
+static const std::size_t DEFAULT_DURATION = 10;
+static const std::size_t DEFAULT_TIMEOUT = 1000;
+static const std::uint16_t DEFAULT_PORT = 27015;
+
+static constexpr const std::array<double, 4> QUANTILES = { 0.5, 0.9, 0.99, 0.999 };
+static constexpr const std::array<const char*, 4> QUANTILE_NAMES = { "p50_us", "p90_us", "p99_us", "p999_us" };
+
+struct endpoint {
+    std::string host;
+    std::uint16_t port;
+};
+
+struct client_result {
+    std::uint64_t queries = 0;
+    std::map<std::string, std::uint64_t> errors; // by message
+};
+
+// host, host:port or host:first-last
+static void parse_target(const std::string& target, std::vector<endpoint>& endpoints) {
+    auto colon = target.rfind(':');
+    if (colon == std::string::npos) {
+        endpoints.push_back({ target, DEFAULT_PORT });
+        return;
+    }
+
+    auto host = target.substr(0, colon);
+    auto ports = target.substr(colon + 1);
+    auto dash = ports.find('-');
+    auto first = std::stoul(ports.substr(0, dash));
+    auto last = dash == std::string::npos ? first : std::stoul(ports.substr(dash + 1));
+
+    if (first == 0 || last > 65535 || last < first)
+        throw std::invalid_argument("invalid port range in " + target);
+
+    for (auto port = first; port <= last; ++port)
+        endpoints.push_back({ host, static_cast<std::uint16_t>(port) });
+}
+
+// cpu time and context switches of the whole process
+struct usage {
+    double user = 0.0;
+    double system = 0.0;
+    std::int64_t voluntary = 0;
+    std::int64_t involuntary = 0;
+};
+
+static usage process_usage() {
+    usage result;
+#ifdef KFCLIENT_UNIX
+    rusage ru {};
+    getrusage(RUSAGE_SELF, &ru);
+    result.user = static_cast<double>(ru.ru_utime.tv_sec) + static_cast<double>(ru.ru_utime.tv_usec) / 1e6;
+    result.system = static_cast<double>(ru.ru_stime.tv_sec) + static_cast<double>(ru.ru_stime.tv_usec) / 1e6;
+    result.voluntary = ru.ru_nvcsw;
+    result.involuntary = ru.ru_nivcsw;
+#endif
+    return result;
+}
+
+// With at least as many endpoints as clients the endpoints are partitioned, otherwise they are shared.
+static std::vector<const endpoint*> assign(std::size_t id, std::size_t clients, const std::vector<endpoint>& endpoints) {
+    std::vector<const endpoint*> assigned;
+    if (endpoints.size() >= clients) {
+        for (auto i = id; i < endpoints.size(); i += clients)
+            assigned.push_back(&endpoints.at(i));
+    } else {
+        assigned.push_back(&endpoints.at(id % endpoints.size()));
+    }
+    return assigned;
+}
+
+// Every virtual client owns its own io_context and one kfclient per endpoint it queries.
+static void run_client(std::size_t id, std::size_t clients, const std::vector<endpoint>& endpoints, std::uint32_t sections, std::chrono::milliseconds timeout, clock_type::time_point end, client_result& result) {
+    auto assigned = assign(id, clients, endpoints);
+    boost::asio::io_context context;
+    udp::resolver resolver(context);
+    std::vector<std::unique_ptr<kfc::kfclient>> connections(assigned.size());
+
+    for (std::size_t i = 0; clock_type::now() < end; i = (i + 1) % assigned.size()) {
+        auto& client = connections.at(i);
+
+        try {
+            if (client == nullptr) {
+                auto resolved = resolver.resolve(udp::v4(), assigned.at(i)->host, std::to_string(assigned.at(i)->port));
+                client = std::make_unique<kfc::kfclient>(context, resolved);
+                client->timeout(timeout);
+            }
+
+            if ((sections & kfc::SECTION_DETAILS) != 0) {
+                client->request_details();
+                result.queries++;
+            }
+            if ((sections & kfc::SECTION_RULES) != 0) {
+                client->request_rules();
+                result.queries++;
+            }
+            if ((sections & kfc::SECTION_PLAYERS) != 0) {
+                client->request_players();
+                result.queries++;
+            }
+        } catch (const std::exception& ex) {
+            client = nullptr;
+            result.errors[ex.what()]++;
+        }
+    }
+}
+
+// The same endpoints swept over and over by a kfbatch, which is how large sweeps query servers.
+// A batch that fails as a whole (the io_uring engine may, halfway) ends the client with an error.
+static void run_batch(std::size_t id, std::size_t clients, const std::vector<endpoint>& endpoints, std::uint32_t sections, std::chrono::milliseconds timeout, kfc::kfengine engine, std::size_t parallel, clock_type::time_point end, client_result& result) {
+    try {
+        auto assigned = assign(id, clients, endpoints);
+        kfc::kfbatch batch(parallel == 0 ? assigned.size() : parallel, timeout, sections);
+        for (const auto* e : assigned)
+            batch.add_target(e->host, e->port);
+        batch.engine(engine);
+
+        std::uint64_t requests = 0;
+        for (auto s : { kfc::SECTION_DETAILS, kfc::SECTION_RULES, kfc::SECTION_PLAYERS })
+            requests += (sections & s) != 0 ? 1 : 0;
+
+        while (clock_type::now() < end) {
+            batch.run([&result, requests](const std::string&, std::uint16_t, kfc::kfquery_result& query) {
+                if (query.error.empty())
+                    result.queries += requests;
+                else
+                    result.errors[query.error]++;
+            });
+        }
+    } catch (const std::exception& ex) {
+        result.errors[ex.what()]++;
+    }
+}
+
+static std::string escape(const std::string& value) {
+    std::string result;
+    for (auto c : value) {
+        switch (c) {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                result += fmt::format("\\u{:04x}", static_cast<int>(c));
+            else
+                result += c;
+        }
+    }
+    return result;
+}
+
+static std::string report(std::size_t clients, std::size_t endpoints, const std::string& engine, double elapsed, const client_result& total, const usage& cpu, const kfc::kfstats_snapshot& stats) {
+    fmt::memory_buffer out;
+    auto append = std::back_inserter(out);
+
+    fmt::format_to(append, "{{\n  \"clients\": {},\n  \"endpoints\": {},\n  \"duration_seconds\": {:.3f},\n", clients, endpoints, elapsed);
+    fmt::format_to(append, "  \"engine\": \"{}\",\n  \"queries\": {},\n  \"queries_per_second\": {:.1f},\n", engine, total.queries, static_cast<double>(total.queries) / elapsed);
+
+    // queries per cpu second is the ceiling of one core, whatever the number of clients
+    auto seconds = cpu.user + cpu.system;
+    fmt::format_to(append, "  \"cpu\": {{ \"user_seconds\": {:.3f}, \"system_seconds\": {:.3f}, \"queries_per_cpu_second\": {:.1f}, ", cpu.user, cpu.system, seconds > 0.0 ? static_cast<double>(total.queries) / seconds : 0.0);
+    fmt::format_to(append, "\"voluntary_context_switches\": {}, \"involuntary_context_switches\": {} }},\n  \"requests\": {{\n", cpu.voluntary, cpu.involuntary);
+
+    for (std::size_t r = 0; r < static_cast<std::size_t>(kfc::kfrequest::count); ++r) {
+        auto request = static_cast<kfc::kfrequest>(r);
+        const auto& h = stats.latency(request);
+
+        fmt::format_to(append, "    \"{}\": {{ \"count\": {}, \"per_second\": {:.1f}, \"mean_us\": {}", kfc::to_string(request), h.count(), static_cast<double>(h.count()) / elapsed, h.count() == 0 ? 0 : h.sum() / h.count());
+        for (std::size_t q = 0; q < QUANTILES.size(); ++q)
+            fmt::format_to(append, ", \"{}\": {}", QUANTILE_NAMES.at(q), h.percentile(QUANTILES.at(q)));
+        fmt::format_to(append, " }}{}\n", r + 1 < static_cast<std::size_t>(kfc::kfrequest::count) ? "," : "");
+    }
+
+    std::uint64_t errors = 0;
+    for (const auto& pair : total.errors)
+        errors += pair.second;
+
+    fmt::format_to(append, "  }},\n  \"errors\": {{\n    \"total\": {},\n", errors);
+    fmt::format_to(append, "    \"timeouts\": {},\n", stats.counter(kfc::kfcounter::timeouts));
+    fmt::format_to(append, "    \"parse_failures\": {},\n    \"by_message\": {{", stats.counter(kfc::kfcounter::parse_failures));
+
+    auto first = true;
+    for (const auto& pair : total.errors) {
+        fmt::format_to(append, "{}\n      \"{}\": {}", first ? "" : ",", escape(pair.first), pair.second);
+        first = false;
+    }
+
+    fmt::format_to(append, "{}}}\n  }},\n  \"counters\": {{", first ? "" : "\n    ");
+    for (std::size_t i = 0; i < static_cast<std::size_t>(kfc::kfcounter::count); ++i) {
+        auto counter = static_cast<kfc::kfcounter>(i);
+        fmt::format_to(append, "{} \"{}\": {}", i == 0 ? "" : ",", kfc::to_string(counter), stats.counter(counter));
+    }
+    fmt::format_to(append, " }}\n}}\n");
+
+    return fmt::to_string(out);
+}
+
+std::unique_ptr<commandline::kfload_cli> create_cli() {
+    using namespace commandline;
+
+    auto cli = std::make_unique<kfload_cli>(descriptors::PROGRAM_DESC, descriptors::PROGRAM_NAME);
+
+    cli->add_option<std::size_t>(descriptors::DESC_CLIENTS)->required(false)->default_val(DEFAULT_CLIENTS)->default_str(std::to_string(DEFAULT_CLIENTS));
+    cli->add_option<std::size_t>(descriptors::DESC_DURATION)->required(false)->default_val(DEFAULT_DURATION)->default_str(std::to_string(DEFAULT_DURATION));
+    cli->add_option<std::vector<std::string>>(descriptors::DESC_REQUEST)->required(false)->check(CLI::IsMember({ "details", "rules", "players" }));
+    cli->add_option<std::size_t>(descriptors::DESC_TIMEOUT)->required(false)->default_val(DEFAULT_TIMEOUT)->default_str(std::to_string(DEFAULT_TIMEOUT));
+    cli->add_option<std::string>(descriptors::DESC_ENGINE)->required(false)->check(CLI::IsMember({ "asio", "io_uring" }));
+    cli->add_option<std::size_t>(descriptors::DESC_PARALLEL)->required(false)->default_val(0);
+    cli->add_option<std::string>(descriptors::DESC_OUTPUT)->required(false);
+    cli->add_option<std::vector<std::string>>(descriptors::DESC_TARGETS)->required(true);
+
+    return cli;
+}
+
+int main(int argc, const char* argv[]) {
+    using namespace commandline;
+
+    std::unique_ptr<commandline::kfload_cli> cli;
+
+    try {
+        cli = create_cli();
+    } catch (const std::exception& error) {
+        fmt::print(std::cerr, "error: cannot initialize cli parser: {}\n", error.what());
+        return EXIT_FAILURE;
+    }
+
+    try {
+        cli->command().parse(argc, argv);
+    } catch (const CLI::ParseError& e) {
+        return cli->command().exit(e);
+    }
+
+    try {
+        std::vector<endpoint> endpoints;
+        for (const auto& target : cli->get<std::vector<std::string>>(descriptors::NAME_TARGETS))
+            parse_target(target, endpoints);
+
+        std::uint32_t sections = kfc::SECTION_DETAILS | kfc::SECTION_PLAYERS;
+        if (cli->isset(descriptors::NAME_REQUEST)) {
+            sections = 0;
+            for (const auto& request : cli->get<std::vector<std::string>>(descriptors::NAME_REQUEST))
+                sections |= request == "details" ? kfc::SECTION_DETAILS : request == "rules" ? kfc::SECTION_RULES : kfc::SECTION_PLAYERS;
+        }
+
+        auto clients = std::max<std::size_t>(cli->get<std::size_t>(descriptors::NAME_CLIENTS), 1);
+        auto timeout = std::chrono::milliseconds(cli->get<std::size_t>(descriptors::NAME_TIMEOUT));
+        auto duration = std::chrono::seconds(cli->get<std::size_t>(descriptors::NAME_DURATION));
+
+        auto batch = cli->isset(descriptors::NAME_ENGINE);
+        auto engine = batch ? cli->get<std::string>(descriptors::NAME_ENGINE) : std::string("blocking");
+        auto parallel = cli->get<std::size_t>(descriptors::NAME_PARALLEL);
+
+        if (engine == "io_uring" && !kfc::kfuring_batch::available()) {
+            fmt::print(std::cerr, "error: the io_uring engine is not available on this system, it needs Linux 6.0 or newer\n");
+            return EXIT_FAILURE;
+        }
+
+        fmt::print(std::cerr, "running {} {} clients against {} endpoints for {} seconds\n", clients, engine, endpoints.size(), duration.count());
+
+        std::vector<client_result> results(clients);
+        std::vector<std::thread> threads;
+        auto before = process_usage();
+        auto start = clock_type::now();
+        auto end = start + duration;
+
+        for (std::size_t i = 0; i < clients; ++i) {
+            if (batch)
+                threads.emplace_back(run_batch, i, clients, std::cref(endpoints), sections, timeout, engine == "io_uring" ? kfc::kfengine::io_uring : kfc::kfengine::asio, parallel, end, std::ref(results.at(i)));
+            else
+                threads.emplace_back(run_client, i, clients, std::cref(endpoints), sections, timeout, end, std::ref(results.at(i)));
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        auto elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+        auto after = process_usage();
+        usage cpu { after.user - before.user, after.system - before.system, after.voluntary - before.voluntary, after.involuntary - before.involuntary };
+
+        // every client thread has exited, so the global statistics hold all of their events
+        client_result total;
+        for (const auto& result : results) {
+            total.queries += result.queries;
+            for (const auto& pair : result.errors)
+                total.errors[pair.first] += pair.second;
+        }
+
+        auto json = report(clients, endpoints.size(), engine, elapsed, total, cpu, kfc::kfstats::global());
+
+        if (cli->isset(descriptors::NAME_OUTPUT)) {
+            std::ofstream file(cli->get<std::string>(descriptors::NAME_OUTPUT), std::ios::trunc);
+            if (!file)
+                throw std::runtime_error("cannot open " + cli->get<std::string>(descriptors::NAME_OUTPUT));
+            file << json;
+        } else {
+            fmt::print("{}", json);
+        }
+
+        return 0;
+    } catch (const std::exception& ex) {
+        fmt::print(std::cerr, "error: {}\n", ex.what());
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef kflog_definition_hpp
+#define kflog_definition_hpp
+
+#include <dynacli.hpp>
+#include <string>
+#include <vector>
+
+namespace commandline {
+	namespace descriptors {
+		static constexpr auto PROGRAM_NAME = "kflog";
+		static constexpr auto PROGRAM_DESC = "query snapshot logs written by kfclient --log";
+
+		static constexpr auto NAME_SERVERS = "servers";
+		static constexpr const option_descriptor DESC_SERVERS(NAME_SERVERS, "-S,--servers", "list the servers that occur in the log and nothing else.");
+
+		static constexpr auto NAME_PLAYERS = "players";
+		static constexpr const option_descriptor DESC_PLAYERS(NAME_PLAYERS, "-p,--players", "output the player list of every snapshot.");
+
+		static constexpr auto NAME_SUMMARY = "summary";
+		static constexpr const option_descriptor DESC_SUMMARY(NAME_SUMMARY, "-s,--summary", "output player count statistics and map usage instead of every snapshot.");
+
+		static constexpr auto NAME_FROM = "from";
+		static constexpr const option_descriptor DESC_FROM(NAME_FROM, "-f,--from", "only include snapshots taken at or after this unix time (seconds).");
+
+		static constexpr auto NAME_TO = "to";
+		static constexpr const option_descriptor DESC_TO(NAME_TO, "-t,--to", "only include snapshots taken at or before this unix time (seconds).");
+
+		static constexpr auto NAME_FILE = "file";
+		static constexpr const option_descriptor DESC_FILE(NAME_FILE, "file", "the snapshot log file.");
+
+		static constexpr auto NAME_HOST = "host";
+		static constexpr const option_descriptor DESC_HOST(NAME_HOST, "host", "the host of the server to output snapshots for.");
+
+		static constexpr auto NAME_PORT = "port";
+		static constexpr const option_descriptor DESC_PORT(NAME_PORT, "port", "the query port of the server to output snapshots for. By default, this is 27015");
+	}
+
+	using kflog_cli = commandline::dynacli<
+		bool, std::size_t, std::string
+	>;
+}
+
+#endif
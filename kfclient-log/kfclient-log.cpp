@@ -0,0 +1,130 @@
+#include <kflog.hpp>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include "definition.hpp"
+
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+
+static const std::size_t DEFAULT_PORT = 27015;
+
+std::unique_ptr<commandline::kflog_cli> create_cli() {
+    using namespace commandline;
+
+    auto cli = std::make_unique<kflog_cli>(descriptors::PROGRAM_DESC, descriptors::PROGRAM_NAME);
+
+    cli->add_flag(descriptors::DESC_SERVERS);
+    cli->add_flag(descriptors::DESC_PLAYERS);
+    cli->add_flag(descriptors::DESC_SUMMARY);
+    cli->add_option<std::size_t>(descriptors::DESC_FROM)->required(false);
+    cli->add_option<std::size_t>(descriptors::DESC_TO)->required(false);
+    cli->add_option<std::string>(descriptors::DESC_FILE)->required(true);
+    cli->add_option<std::string>(descriptors::DESC_HOST)->required(false);
+    cli->add_option<std::size_t>(descriptors::DESC_PORT)->required(false)->default_val(DEFAULT_PORT)->default_str(std::to_string(DEFAULT_PORT));
+
+    return cli;
+}
+
+void print_record(const kfc::kflog_record& record, bool players) {
+    if ((record.flags & kfc::kfsnapshot::HAS_DETAILS) != 0)
+        fmt::print("{}\t{}/{}\t{}/{}\t{}\t{}\n", record.timestamp / 1000, record.player_count, record.player_cap,
+            record.waves_current, record.waves_total, *record.map, *record.hostname);
+    else
+        fmt::print("{}\terror\t{}\n", record.timestamp / 1000, record.error != nullptr ? *record.error : "");
+
+    if (players) {
+        for (const auto& player : record.players)
+            fmt::print("\t{}\t{}\t{}\n", *player.name, player.score, player.time);
+    }
+}
+
+struct summary {
+    std::size_t snapshots = 0;
+    std::size_t errors = 0;
+    std::size_t empty = 0;
+    std::size_t players = 0;
+    std::size_t peak = 0;
+    std::map<std::string, std::size_t> maps;
+
+    void add(const kfc::kflog_record& record) {
+        snapshots++;
+
+        if ((record.flags & kfc::kfsnapshot::HAS_DETAILS) == 0) {
+            errors++;
+            return;
+        }
+
+        players += record.player_count;
+        peak = std::max<std::size_t>(peak, record.player_count);
+        if (record.player_count == 0)
+            empty++;
+        maps[*record.map]++;
+    }
+
+    void print() const {
+        auto online = snapshots - errors;
+        fmt::print("snapshots: {}\nerrors: {}\n", snapshots, errors);
+        fmt::print("average players: {:.2f}\npeak players: {}\n", online == 0 ? 0.0 : static_cast<double>(players) / static_cast<double>(online), peak);
+        fmt::print("empty: {:.1f}%\n", online == 0 ? 0.0 : 100.0 * static_cast<double>(empty) / static_cast<double>(online));
+        for (const auto& pair : maps)
+            fmt::print("map {}: {}\n", pair.first, pair.second);
+    }
+};
+
+int main(int argc, const char* argv[]) {
+    using namespace commandline;
+
+    std::unique_ptr<commandline::kflog_cli> cli;
+
+    try {
+        cli = create_cli();
+    } catch (const std::exception& error) {
+        fmt::print(std::cerr, "error: cannot initialize cli parser: {}\n", error.what());
+        return EXIT_FAILURE;
+    }
+
+    try {
+        cli->command().parse(argc, argv);
+    } catch (const CLI::ParseError& e) {
+        return cli->command().exit(e);
+    }
+
+    try {
+        kfc::kflog_reader reader(cli->get<std::string>(descriptors::NAME_FILE));
+
+        if (cli->isset(descriptors::NAME_SERVERS)) {
+            for (const auto& server : reader.servers())
+                fmt::print("{}\n", server);
+            return 0;
+        }
+
+        if (!cli->isset(descriptors::NAME_HOST)) {
+            fmt::print(std::cerr, "error: a host is required unless --servers is used\n");
+            return EXIT_FAILURE;
+        }
+
+        const auto& host = cli->get<std::string>(descriptors::NAME_HOST);
+        const auto port = static_cast<std::uint16_t>(cli->get<std::size_t>(descriptors::NAME_PORT));
+        const auto from = static_cast<std::uint64_t>(cli->get_isset_or<std::size_t>(descriptors::NAME_FROM, 0)) * 1000;
+        const auto to = cli->isset(descriptors::NAME_TO) ? static_cast<std::uint64_t>(cli->get<std::size_t>(descriptors::NAME_TO)) * 1000 + 999 : std::numeric_limits<std::uint64_t>::max();
+        const auto players = cli->isset(descriptors::NAME_PLAYERS);
+
+        if (cli->isset(descriptors::NAME_SUMMARY)) {
+            summary s;
+            reader.scan(host, port, [&s](const kfc::kflog_record& record) { s.add(record); }, from, to);
+            s.print();
+        } else {
+            reader.scan(host, port, [players](const kfc::kflog_record& record) { print_record(record, players); }, from, to);
+        }
+
+        return 0;
+    } catch (const std::exception& ex) {
+        fmt::print(std::cerr, "error: could not read the snapshot log: {}\n", ex.what());
+        return EXIT_FAILURE;
+    }
+}
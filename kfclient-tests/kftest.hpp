@@ -0,0 +1,233 @@
+#ifndef kfclient_test_hpp
+#define kfclient_test_hpp
+
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/process.hpp>
+#include <kfclient.hpp>
+
+#ifdef KFCLIENT_UNIX
+#include <signal.h>
+#endif
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A test is a program that exits with EXIT_SUCCESS when every check held, see kftest::result.
+#define KFTEST_CHECK(expression) kftest::check((expression), #expression, __FILE__, __LINE__)
+
+namespace kftest {
+    inline int& failures() noexcept {
+        static int count = 0;
+        return count;
+    }
+
+    inline bool check(bool passed, const char* expression, const char* file, int line) {
+        if (!passed) {
+            std::cerr << file << ":" << line << ": check failed: " << expression << "\n";
+            ++failures();
+        }
+
+        return passed;
+    }
+
+    inline int result() {
+        if (failures() == 0)
+            return EXIT_SUCCESS;
+
+        std::cerr << failures() << " check(s) failed\n";
+        return EXIT_FAILURE;
+    }
+
+    // A new directory for the files of a test, removed with everything in it at the end of the test.
+    class directory {
+    public:
+        directory()
+            : path_(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("kftest-%%%%-%%%%-%%%%")) {
+                boost::filesystem::create_directories(path_);
+        }
+
+        directory(const directory&) = delete;
+        directory(directory&&) = delete;
+        directory& operator=(const directory&) = delete;
+        directory& operator=(directory&&) = delete;
+
+        ~directory() {
+            boost::system::error_code error;
+            boost::filesystem::remove_all(path_, error);
+        }
+
+        std::string file(const std::string& name) const {
+            return (path_ / name).string();
+        }
+
+    private:
+        boost::filesystem::path path_;
+    };
+
+    // Runs a program (kfserver-sim, kfexporter) for the lifetime of the object.
+    class process {
+    public:
+        process(const std::string& path, const std::vector<std::string>& arguments)
+            : child_(path, boost::process::args(arguments), boost::process::std_out > output_) {}
+
+        process(const process&) = delete;
+        process(process&&) = delete;
+        process& operator=(const process&) = delete;
+        process& operator=(process&&) = delete;
+
+        ~process() {
+            try {
+                stop();
+            } catch (...) {
+            }
+        }
+
+        // asks the program to exit like ^C would and returns what it printed
+        std::string stop() {
+            if (stopped_)
+                return std::string();
+            stopped_ = true;
+
+#ifdef KFCLIENT_UNIX
+            ::kill(child_.id(), SIGTERM);
+#else
+            child_.terminate();
+#endif
+
+            std::ostringstream printed;
+            printed << output_.rdbuf();
+            child_.wait();
+            return printed.str();
+        }
+
+    private:
+        boost::process::ipstream output_;
+        boost::process::child child_;
+        bool stopped_ = false;
+    };
+
+    // Forwards datagrams between one client and a server on the local host, holding the server's
+    // answers of one packet type (or those a function picks) back for a while.
+    class relay {
+        using udp = boost::asio::ip::udp;
+
+    public:
+        // how long to hold a datagram of the server back, zero forwards it at once; called on the relay's thread
+        using delay_function = std::function<std::chrono::milliseconds(const std::uint8_t* data, std::size_t size)>;
+
+        relay(std::uint16_t server_port, std::int8_t delayed_packet, std::chrono::milliseconds delay)
+            : relay(server_port, [delayed_packet, delay](const std::uint8_t* data, std::size_t size) {
+                  return size > 4 && static_cast<std::int8_t>(data[4]) == delayed_packet ? delay : std::chrono::milliseconds(0);
+              }) {}
+
+        relay(std::uint16_t server_port, delay_function delay)
+            : front_(context_, udp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0)),
+              back_(context_, udp::endpoint(udp::v4(), 0)),
+              server_(boost::asio::ip::make_address("127.0.0.1"), server_port),
+              delay_(std::move(delay)) {
+            receive_front();
+            receive_back();
+            thread_ = std::thread([this]() { context_.run(); });
+        }
+
+        relay(const relay&) = delete;
+        relay(relay&&) = delete;
+        relay& operator=(const relay&) = delete;
+        relay& operator=(relay&&) = delete;
+
+        ~relay() {
+            context_.stop();
+            thread_.join();
+        }
+
+        std::uint16_t port() const { return front_.local_endpoint().port(); }
+
+    private:
+        void receive_front() {
+            front_.async_receive_from(boost::asio::buffer(front_buffer_), client_, [this](const boost::system::error_code& error, std::size_t size) {
+                if (error)
+                    return;
+                back_.send_to(boost::asio::buffer(front_buffer_.data(), size), server_);
+                receive_front();
+            });
+        }
+
+        void receive_back() {
+            back_.async_receive(boost::asio::buffer(back_buffer_), [this](const boost::system::error_code& error, std::size_t size) {
+                if (error)
+                    return;
+
+                auto datagram = std::make_shared<std::vector<std::uint8_t>>(back_buffer_.begin(), back_buffer_.begin() + size);
+                auto delay = delay_(datagram->data(), datagram->size());
+                if (delay.count() > 0) {
+                    auto timer = std::make_shared<boost::asio::steady_timer>(context_, delay);
+                    timer->async_wait([this, timer, datagram](const boost::system::error_code&) {
+                        front_.send_to(boost::asio::buffer(*datagram), client_);
+                    });
+                } else {
+                    front_.send_to(boost::asio::buffer(*datagram), client_);
+                }
+
+                receive_back();
+            });
+        }
+
+        boost::asio::io_context context_;
+        udp::socket front_;
+        udp::socket back_;
+        udp::endpoint server_;
+        udp::endpoint client_;
+        delay_function delay_;
+        std::array<std::uint8_t, 2048> front_buffer_ = {};
+        std::array<std::uint8_t, 2048> back_buffer_ = {};
+        std::thread thread_;
+    };
+
+    // the number printed after a name at the start of a line of a program's output, 0 without one
+    inline std::uint64_t printed_count(const std::string& output, const std::string& name) {
+        std::istringstream lines(output);
+        std::string line;
+
+        while (std::getline(lines, line)) {
+            std::istringstream fields(line);
+            std::string field;
+            std::uint64_t count = 0;
+            if (fields >> field && field == name && fields >> count)
+                return count;
+        }
+
+        return 0;
+    }
+
+    // waits until a query server answers on the port, false when it did not within the timeout
+    inline bool wait_for_server(std::uint16_t port, std::chrono::milliseconds timeout = std::chrono::seconds(10)) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        while (std::chrono::steady_clock::now() < deadline) {
+            try {
+                boost::asio::io_context context;
+                boost::asio::ip::udp::resolver resolver(context);
+                kfc::kfclient client(context, resolver.resolve(boost::asio::ip::udp::v4(), "127.0.0.1", std::to_string(port)));
+                client.timeout(std::chrono::milliseconds(250));
+                client.request_details();
+                return true;
+            } catch (const std::exception&) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+
+        return false;
+    }
+}
+
+#endif
\ No newline at end of file
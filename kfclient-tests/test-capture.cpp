@@ -0,0 +1,196 @@
+#include "kftest.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <set>
+
+// Captures kfclients querying kfserver-sim, with rules split over several datagrams, and a server
+// that never answers, then replays every peer through a kfreplay_transport: the results, the
+// challenges and the timeouts must come out as they went in, also from a capture with a torn end.
+
+static const std::uint16_t FIRST_PORT = 47710;
+
+struct queried {
+    std::string hostname;
+    std::vector<std::string> rules;
+    std::vector<std::string> players;
+    std::uint64_t sent = 0;
+    std::uint64_t received = 0;
+};
+
+// what a client returns for the details, rules and players of its server
+static queried query(kfc::kfclient& client) {
+    queried result;
+    result.hostname = client.request_details().hostname.str();
+
+    for (const auto& rule : client.request_rules().rules) {
+        std::string value;
+        kfc::kfrule_value::encode(rule.value, value);
+        result.rules.push_back(rule.name + "=" + value);
+    }
+
+    for (const auto& player : client.request_players().players)
+        result.players.push_back(player.name.str() + " " + std::to_string(player.score));
+
+    auto snapshot = client.stats().snapshot();
+    result.sent = snapshot.counter(kfc::kfcounter::packets_sent);
+    result.received = snapshot.counter(kfc::kfcounter::packets_received);
+    return result;
+}
+
+static bool same(const queried& a, const queried& b) {
+    return a.hostname == b.hostname && a.rules == b.rules && a.players == b.players && a.sent == b.sent && a.received == b.received;
+}
+
+// a request to a server that does not answer, the number of timeouts
+static std::uint64_t query_silent(kfc::kfclient& client) {
+    client.retries(1);
+
+    try {
+        client.request_details();
+        return 0;
+    } catch (const kfc::timeout_error&) {
+        return client.stats().snapshot().counter(kfc::kfcounter::timeouts);
+    }
+}
+
+static std::size_t count_records(const std::string& path) {
+    kfc::kfcapture_reader reader(path);
+    kfc::kfcapture_record record;
+    std::size_t count = 0;
+    while (reader.next(record))
+        ++count;
+    return count;
+}
+
+static void write_bytes(const std::string& path, const std::vector<char>& bytes, std::size_t size) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(size));
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " path-to-kfserver-sim\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        kftest::directory directory;
+        auto path = directory.file("capture.kfcap");
+
+        kftest::process sim(argv[1], { "-p", std::to_string(FIRST_PORT), "-n", "2", "--players", "5", "--rules", "30", "--split", "200" });
+        if (!KFTEST_CHECK(kftest::wait_for_server(FIRST_PORT)))
+            return kftest::result();
+
+        boost::asio::io_context context;
+        boost::asio::ip::udp::resolver resolver(context);
+        boost::asio::ip::udp::socket silent(context, boost::asio::ip::udp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0));
+
+        std::vector<std::string> peers = {
+            "127.0.0.1:" + std::to_string(FIRST_PORT),
+            "127.0.0.1:" + std::to_string(FIRST_PORT + 1),
+            "127.0.0.1:" + std::to_string(silent.local_endpoint().port())
+        };
+
+        std::vector<queried> live;
+        std::uint64_t live_timeouts = 0;
+
+        {
+            kfc::kfcapture_writer writer(path);
+
+            for (std::uint16_t i = 0; i < 2; ++i) {
+                kfc::kfclient client(context, resolver.resolve(boost::asio::ip::udp::v4(), "127.0.0.1", std::to_string(FIRST_PORT + i)));
+                client.timeout(std::chrono::seconds(2));
+                client.capture(&writer);
+                live.push_back(query(client));
+            }
+
+            kfc::kfclient client(context, resolver.resolve(boost::asio::ip::udp::v4(), "127.0.0.1", std::to_string(silent.local_endpoint().port())));
+            client.timeout(std::chrono::milliseconds(100));
+            client.capture(&writer);
+            live_timeouts = query_silent(client);
+        }
+
+        KFTEST_CHECK(live[0].hostname == "kfserver-sim #0" && live[1].hostname == "kfserver-sim #1");
+        KFTEST_CHECK(live[0].rules.size() == 30 && live[0].players.size() == 5);
+        KFTEST_CHECK(live_timeouts == 2);
+
+        // every peer was captured, and the rules arrived split
+        std::set<std::string> captured;
+        std::size_t split = 0;
+        {
+            kfc::kfcapture_reader reader(path);
+            kfc::kfcapture_record record;
+            while (reader.next(record)) {
+                captured.insert(*record.peer);
+                if (record.direction == kfc::kfcapture_direction::received && kfc::protocol::is_split(record.data, record.size))
+                    ++split;
+            }
+        }
+
+        KFTEST_CHECK(captured == std::set<std::string>(peers.begin(), peers.end()));
+        KFTEST_CHECK(split >= 4);
+
+        // every peer replays on its own, challenges included
+        for (std::size_t i = 0; i < 2; ++i) {
+            kfc::kfclient client(std::make_unique<kfc::kfreplay_transport>(path, peers[i]));
+            KFTEST_CHECK(same(query(client), live[i]));
+        }
+
+        {
+            kfc::kfclient client(std::make_unique<kfc::kfreplay_transport>(path, peers[2]));
+            KFTEST_CHECK(query_silent(client) == live_timeouts);
+        }
+
+        // without a peer the capture replays in the order it was captured
+        {
+            kfc::kfclient client(std::make_unique<kfc::kfreplay_transport>(path));
+            KFTEST_CHECK(same(query(client), live[0]));
+            KFTEST_CHECK(client.request_details().hostname.str() == "kfserver-sim #1");
+        }
+
+        bool unknown = false;
+        try {
+            kfc::kfreplay_transport transport(path, "127.0.0.1:1");
+        } catch (const std::runtime_error&) {
+            unknown = true;
+        }
+
+        KFTEST_CHECK(unknown);
+
+        // a capture cut anywhere in its final entry ends before it
+        std::vector<char> bytes;
+        {
+            std::ifstream file(path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        auto records = count_records(path);
+        auto torn = directory.file("torn.kfcap");
+        for (std::size_t cut = 1; cut <= 4; ++cut) {
+            write_bytes(torn, bytes, bytes.size() - cut);
+            KFTEST_CHECK(count_records(torn) == records - 1);
+
+            kfc::kfclient client(std::make_unique<kfc::kfreplay_transport>(torn, peers[0]));
+            KFTEST_CHECK(same(query(client), live[0]));
+        }
+
+        // and a capture of only the file header holds nothing to replay
+        write_bytes(torn, bytes, 8);
+        KFTEST_CHECK(count_records(torn) == 0);
+
+        bool empty = false;
+        try {
+            kfc::kfreplay_transport transport(torn);
+        } catch (const std::runtime_error&) {
+            empty = true;
+        }
+
+        KFTEST_CHECK(empty);
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "kftest.hpp"
+
+#include <kfdiscover.hpp>
+
+#include <map>
+
+// Sweeps a port range around the servers of kfserver-sim, by host and by network, and expects to
+// find exactly those servers. A handler that throws ends the sweep with its exception, which is
+// no parse failure, and the next sweep starts afresh.
+
+static const std::uint16_t FIRST_PORT = 47630;
+static const std::uint16_t SERVERS = 5;
+static const std::uint16_t SWEEP_FIRST = 47620;
+static const std::uint16_t SWEEP_LAST = 47644;
+
+static void sweep(const std::string& hosts, std::uint64_t endpoints) {
+    kfc::kfdiscovery discovery(16, std::chrono::milliseconds(500));
+    discovery.add_range(hosts, SWEEP_FIRST, SWEEP_LAST);
+    KFTEST_CHECK(discovery.size() == endpoints);
+
+    std::map<std::uint16_t, std::string> found;
+    discovery.run([&found](kfc::kfdiscovered& server) {
+        KFTEST_CHECK(server.endpoint.address().to_string() == "127.0.0.1");
+        KFTEST_CHECK(found.count(server.endpoint.port()) == 0);
+        if (KFTEST_CHECK(server.details != nullptr))
+            found[server.endpoint.port()] = server.details->hostname.str();
+    });
+
+    KFTEST_CHECK(found.size() == SERVERS);
+    for (std::uint16_t i = 0; i < SERVERS; ++i) {
+        auto server = found.find(static_cast<std::uint16_t>(FIRST_PORT + i));
+        if (KFTEST_CHECK(server != found.end()))
+            KFTEST_CHECK(server->second == "kfserver-sim #" + std::to_string(i));
+    }
+}
+
+static void throwing_handler() {
+    kfc::kfdiscovery discovery(16, std::chrono::milliseconds(500));
+    discovery.add_range("127.0.0.1", SWEEP_FIRST, SWEEP_LAST);
+
+    auto failures = kfc::kfstats::global().counter(kfc::kfcounter::parse_failures);
+    std::size_t called = 0;
+    std::string message;
+    try {
+        discovery.run([&called](kfc::kfdiscovered& /*server*/) {
+            ++called;
+            throw std::runtime_error("handler failed");
+        });
+    } catch (const std::runtime_error& ex) {
+        message = ex.what();
+    }
+
+    KFTEST_CHECK(message == "handler failed");
+    KFTEST_CHECK(called == 1);
+    KFTEST_CHECK(kfc::kfstats::global().counter(kfc::kfcounter::parse_failures) == failures);
+
+    std::size_t found = 0;
+    discovery.run([&found](kfc::kfdiscovered& /*server*/) { ++found; });
+    KFTEST_CHECK(found == SERVERS);
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " path-to-kfserver-sim\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        // the latency keeps answers of several endpoints in flight at once
+        kftest::process sim(argv[1], { "-p", std::to_string(FIRST_PORT), "-n", std::to_string(SERVERS), "--latency", "20" });
+        if (!KFTEST_CHECK(kftest::wait_for_server(FIRST_PORT)))
+            return kftest::result();
+
+        std::uint64_t ports = SWEEP_LAST - SWEEP_FIRST + 1;
+        sweep("127.0.0.1", ports);
+
+        // 127.0.0.1 and 127.0.0.2, the network and broadcast addresses are skipped
+        sweep("127.0.0.0/30", 2 * ports);
+
+        throwing_handler();
+
+        bool rejected = false;
+        try {
+            kfc::kfdiscovery discovery(16, std::chrono::milliseconds(500));
+            discovery.add_range("127.0.0.0/33", SWEEP_FIRST, SWEEP_LAST);
+        } catch (const std::exception&) {
+            rejected = true;
+        }
+
+        KFTEST_CHECK(rejected);
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "kftest.hpp"
+
+#include <future>
+
+// Runs kfexporter against two kfserver-sim servers and scrapes /metrics like Prometheus would.
+// Servers that never answer are polled next to them and must not slow down their polls. A client
+// that never completes its request is disconnected and does not keep others from being served.
+
+static const std::uint16_t FIRST_PORT = 47650;
+static const std::uint16_t HTTP_PORT = 47660;
+static const std::size_t SILENT_SERVERS = 6;
+
+// the status line and body of a GET, empty when the exporter did not accept the connection
+static std::string get(const std::string& target) {
+    try {
+        boost::asio::io_context context;
+        boost::asio::ip::tcp::socket socket(context);
+        socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), HTTP_PORT));
+
+        auto request = "GET " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+        boost::asio::write(socket, boost::asio::buffer(request));
+
+        std::string response;
+        boost::system::error_code error;
+        boost::asio::read(socket, boost::asio::dynamic_buffer(response), error);
+        return response;
+    } catch (const std::exception&) {
+        return std::string();
+    }
+}
+
+// how long the exporter kept a connection open that only sent part of a request, at most limit
+static std::chrono::steady_clock::duration held_open(std::chrono::seconds limit) {
+    boost::asio::io_context context;
+    boost::asio::ip::tcp::socket socket(context);
+    socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), HTTP_PORT));
+    boost::asio::write(socket, boost::asio::buffer(std::string("GET /metrics HTTP/1.1\r\n")));
+
+    auto started = std::chrono::steady_clock::now();
+    auto closed = started + limit;
+    std::array<char, 256> buffer {};
+    socket.async_read_some(boost::asio::buffer(buffer), [&closed](const boost::system::error_code&, std::size_t) {
+        closed = std::chrono::steady_clock::now();
+    });
+
+    context.run_for(limit);
+    return closed - started;
+}
+
+static bool contains(const std::string& value, const std::string& part) {
+    return value.find(part) != std::string::npos;
+}
+
+// the value of a metric with its labels, 0 when it is not there
+static std::uint64_t value_of(const std::string& metrics, const std::string& metric) {
+    auto found = metrics.find(metric + " ");
+    if (found == std::string::npos)
+        return 0;
+    return std::stoull(metrics.substr(found + metric.size() + 1));
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " path-to-kfserver-sim path-to-kfexporter\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        kftest::process sim(argv[1], { "-p", std::to_string(FIRST_PORT), "-n", "2", "--players", "3", "--slots", "6" });
+        if (!KFTEST_CHECK(kftest::wait_for_server(FIRST_PORT)))
+            return kftest::result();
+
+        // sockets that receive the queries and never answer them
+        boost::asio::io_context context;
+        std::vector<boost::asio::ip::udp::socket> silent;
+        std::vector<std::string> arguments = {
+            "-l", "127.0.0.1", "-p", std::to_string(HTTP_PORT), "-i", "1", "-t", "1",
+            "127.0.0.1:" + std::to_string(FIRST_PORT), "127.0.0.1:" + std::to_string(FIRST_PORT + 1)
+        };
+
+        for (std::size_t i = 0; i < SILENT_SERVERS; ++i) {
+            silent.emplace_back(context, boost::asio::ip::udp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0));
+            arguments.push_back("127.0.0.1:" + std::to_string(silent.back().local_endpoint().port()));
+        }
+
+        kftest::process exporter(argv[2], arguments);
+
+        // the metrics of a server appear once it was polled
+        auto first = "{server=\"127.0.0.1:" + std::to_string(FIRST_PORT) + "\"}";
+        auto second = "{server=\"127.0.0.1:" + std::to_string(FIRST_PORT + 1) + "\"}";
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        std::string metrics;
+
+        while (std::chrono::steady_clock::now() < deadline) {
+            metrics = get("/metrics");
+            if (contains(metrics, "kf_up" + first + " 1") && contains(metrics, "kf_up" + second + " 1"))
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        if (!KFTEST_CHECK(contains(metrics, "HTTP/1.1 200"))) {
+            std::cerr << metrics << "\n";
+            return kftest::result();
+        }
+
+        KFTEST_CHECK(contains(metrics, "kf_up" + first + " 1"));
+        KFTEST_CHECK(contains(metrics, "kf_up" + second + " 1"));
+        KFTEST_CHECK(contains(metrics, "kf_player_count" + first + " 3"));
+        KFTEST_CHECK(contains(metrics, "kf_player_cap" + first + " 6"));
+        KFTEST_CHECK(contains(metrics, "kf_waves_total" + first + " 10"));
+        KFTEST_CHECK(contains(metrics, "# TYPE kf_query_duration_seconds histogram"));
+        KFTEST_CHECK(contains(metrics, "kf_query_duration_seconds_count{server=\"127.0.0.1:" + std::to_string(FIRST_PORT) + "\",request=\"details\"}"));
+        KFTEST_CHECK(contains(metrics, "kf_query_errors_total{server=\"127.0.0.1:" + std::to_string(FIRST_PORT) + "\",kind=\"timeout\"} 0"));
+        KFTEST_CHECK(contains(metrics, "kf_fleet_servers 2\n"));
+        KFTEST_CHECK(contains(metrics, "kf_fleet_players 6\n"));
+        KFTEST_CHECK(contains(metrics, "kf_fleet_slots 12\n"));
+        KFTEST_CHECK(contains(metrics, "kf_fleet_servers_by_free_slots{free=\"3\"} 2\n"));
+
+        KFTEST_CHECK(contains(get("/"), "HTTP/1.1 404"));
+
+        // a scrape is served while the incomplete request waits for its deadline
+        auto incomplete = std::async(std::launch::async, held_open, std::chrono::seconds(20));
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        KFTEST_CHECK(contains(get("/metrics"), "HTTP/1.1 200"));
+        KFTEST_CHECK(incomplete.get() < std::chrono::seconds(10));
+
+        // polled one after another, the silent servers would stretch every round to six timeouts
+        auto polls = "kf_query_duration_seconds_count{server=\"127.0.0.1:" + std::to_string(FIRST_PORT) + "\",request=\"details\"}";
+        auto before = value_of(metrics, polls);
+        std::this_thread::sleep_for(std::chrono::seconds(4));
+        metrics = get("/metrics");
+        KFTEST_CHECK(value_of(metrics, polls) >= before + 2);
+        KFTEST_CHECK(contains(metrics, "kf_up{server=\"127.0.0.1:" + std::to_string(silent.front().local_endpoint().port()) + "\"} 0"));
+
+        // a server that stops answering is down on a later scrape, and its timeouts are counted
+        sim.stop();
+        deadline = std::chrono::steady_clock::now() + std::chrono::seconds(15);
+        while (std::chrono::steady_clock::now() < deadline) {
+            metrics = get("/metrics");
+            if (contains(metrics, "kf_up" + first + " 0"))
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        KFTEST_CHECK(contains(metrics, "kf_up" + first + " 0"));
+        KFTEST_CHECK(!contains(metrics, "kf_query_errors_total{server=\"127.0.0.1:" + std::to_string(FIRST_PORT) + "\",kind=\"error\"} 0\n")
+            || !contains(metrics, "kf_query_errors_total{server=\"127.0.0.1:" + std::to_string(FIRST_PORT) + "\",kind=\"timeout\"} 0\n"));
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "kftest.hpp"
+
+#include <kffleet.hpp>
+
+#include <array>
+#include <map>
+#include <random>
+
+// Feeds a kffleet 200k random updates, removals and poll results, and compares its running
+// aggregates to the aggregates recomputed from scratch from the latest details of every server.
+
+static const std::size_t UPDATES = 200000;
+static const std::size_t SERVERS = 64;
+static const std::size_t COMPARE_EVERY = 100;
+
+static constexpr const std::array<const char*, 4> MAPS = { "KF-BurningParis", "KF-Outpost", "KF-BioticsLab", "KF-Nuked" };
+
+static kfc::kffleet_totals recompute(const std::map<std::string, kfc::kfdetails>& servers) {
+    kfc::kffleet_totals result;
+
+    for (const auto& pair : servers) {
+        const auto& details = pair.second;
+        std::uint32_t players = details.player_count;
+        std::uint32_t slots = details.player_cap;
+
+        result.servers++;
+        result.players += players;
+        result.slots += slots;
+        if (players != 0)
+            result.players_by_map[details.map.str()] += players;
+        result.servers_by_map[details.map.str()]++;
+        result.servers_by_wave[details.waves_current]++;
+        result.servers_by_length[details.waves_total]++;
+        result.servers_by_free_slots[slots > players ? slots - players : 0]++;
+    }
+
+    return result;
+}
+
+static bool same(const kfc::kffleet_totals& a, const kfc::kffleet_totals& b) {
+    return a.servers == b.servers && a.players == b.players && a.slots == b.slots
+        && a.players_by_map == b.players_by_map && a.servers_by_map == b.servers_by_map
+        && a.servers_by_wave == b.servers_by_wave && a.servers_by_length == b.servers_by_length
+        && a.servers_by_free_slots == b.servers_by_free_slots;
+}
+
+int main() {
+    std::mt19937 random(27015);
+    auto pick = [&random](std::uint32_t last) { return std::uniform_int_distribution<std::uint32_t>(0, last)(random); };
+
+    kfc::kffleet fleet;
+    std::map<std::string, kfc::kfdetails> servers;
+    std::size_t mismatches = 0;
+
+    for (std::size_t i = 0; i < UPDATES; ++i) {
+        auto port = static_cast<std::uint16_t>(7777 + pick(SERVERS - 1));
+        auto host = std::string("10.0.0.1");
+        auto server = host + ":" + std::to_string(port);
+        auto action = pick(99);
+
+        if (action < 10) {
+            fleet.remove(server);
+            servers.erase(server);
+            continue;
+        }
+
+        // small ranges, so fields often keep their value and servers are often full or overfull
+        kfc::kfdetails details;
+        if (servers.count(server) != 0 && pick(1) == 0)
+            details = servers.at(server);
+        details.map = MAPS.at(pick(MAPS.size() - 1));
+        details.player_count = static_cast<std::uint8_t>(pick(6));
+        details.player_cap = static_cast<std::uint8_t>(pick(6));
+        details.waves_total = static_cast<std::int32_t>(4 + (3 * pick(2)));
+        details.waves_current = static_cast<std::int32_t>(pick(static_cast<std::uint32_t>(details.waves_total)));
+
+        if (action < 20) {
+            // a failed poll removes the server, a successful one updates it
+            kfc::kfpoll_result result { host, port, nullptr, nullptr, nullptr, {}, {}, {}, false, false, false, std::string(), false };
+            if (pick(1) == 0) {
+                result.error = "timed out";
+                result.timed_out = true;
+                servers.erase(server);
+            } else {
+                result.details = &details;
+                servers[server] = details;
+            }
+            fleet.update(result);
+        } else {
+            fleet.update(server, details);
+            servers[server] = details;
+        }
+
+        if ((i % COMPARE_EVERY) == 0 && !same(fleet.totals(), recompute(servers)))
+            ++mismatches;
+    }
+
+    KFTEST_CHECK(mismatches == 0);
+    KFTEST_CHECK(same(fleet.totals(), recompute(servers)));
+
+    for (const auto& pair : servers)
+        fleet.remove(pair.first);
+    KFTEST_CHECK(same(fleet.totals(), kfc::kffleet_totals()));
+
+    return kftest::result();
+}
\ No newline at end of file
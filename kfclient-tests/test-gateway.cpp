@@ -0,0 +1,181 @@
+#include "kftest.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+
+// Runs kfgateway against kfserver-sim and checks its caching headers: ETag revalidation to 304,
+// HEAD, the uncacheable 503 of failed servers and a /servers list that changes with them.
+
+static const std::uint16_t FIRST_PORT = 47690;
+static const std::uint16_t MISSING_PORT = 47692; // nothing answers there
+static const std::uint16_t HTTP_PORT = 47695;
+
+struct http_response {
+    int status = 0;
+    std::map<std::string, std::string> headers; // names are lower case
+    std::string body;
+
+    std::string header(const std::string& name) const {
+        auto found = headers.find(name);
+        return found == headers.end() ? std::string() : found->second;
+    }
+};
+
+// a status of 0 when the gateway did not accept the connection
+static http_response request(const std::string& method, const std::string& target, const std::string& if_none_match = std::string()) {
+    http_response result;
+
+    try {
+        boost::asio::io_context context;
+        boost::asio::ip::tcp::socket socket(context);
+        socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), HTTP_PORT));
+
+        auto out = method + " " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n";
+        if (!if_none_match.empty())
+            out += "If-None-Match: " + if_none_match + "\r\n";
+        out += "\r\n";
+        boost::asio::write(socket, boost::asio::buffer(out));
+
+        std::string response;
+        boost::system::error_code error;
+        boost::asio::read(socket, boost::asio::dynamic_buffer(response), error);
+
+        auto end = response.find("\r\n\r\n");
+        if (end == std::string::npos)
+            return result;
+
+        std::istringstream lines(response.substr(0, end));
+        std::string line;
+        std::getline(lines, line);
+        result.status = std::stoi(line.substr(line.find(' ') + 1, 3));
+
+        while (std::getline(lines, line)) {
+            auto colon = line.find(':');
+            if (colon == std::string::npos)
+                continue;
+
+            auto name = line.substr(0, colon);
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            auto value = line.substr(colon + 1);
+            value.erase(0, value.find_first_not_of(' '));
+            value.erase(value.find_last_not_of("\r ") + 1);
+            result.headers[name] = value;
+        }
+
+        result.body = response.substr(end + 4);
+    } catch (const std::exception&) {
+        result.status = 0;
+    }
+
+    return result;
+}
+
+static bool contains(const std::string& value, const std::string& part) {
+    return value.find(part) != std::string::npos;
+}
+
+// requests the target until the predicate holds, returns the last response
+template <typename Predicate>
+static http_response wait_for(const std::string& target, Predicate predicate, std::chrono::seconds timeout = std::chrono::seconds(15)) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    http_response response;
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        response = request("GET", target);
+        if (predicate(response))
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    return response;
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " path-to-kfserver-sim path-to-kfgateway\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        kftest::process sim(argv[1], { "-p", std::to_string(FIRST_PORT), "-n", "2", "--players", "3" });
+        if (!KFTEST_CHECK(kftest::wait_for_server(FIRST_PORT)))
+            return kftest::result();
+
+        kftest::process gateway(argv[2], {
+            "-l", "127.0.0.1", "-p", std::to_string(HTTP_PORT), "-i", "1", "-t", "1", "-w", "2",
+            "127.0.0.1:" + std::to_string(FIRST_PORT), "127.0.0.1:" + std::to_string(FIRST_PORT + 1), "127.0.0.1:" + std::to_string(MISSING_PORT)
+        });
+
+        auto first = "/servers/127.0.0.1:" + std::to_string(FIRST_PORT);
+        auto missing = "/servers/127.0.0.1:" + std::to_string(MISSING_PORT);
+
+        // every server has been polled, the missing one has failed
+        auto served = wait_for(first, [](const http_response& r) { return r.status == 200; });
+        auto failed = wait_for(missing, [](const http_response& r) { return r.status == 503 && !contains(r.body, "not polled yet"); });
+        wait_for("/servers/127.0.0.1:" + std::to_string(FIRST_PORT + 1), [](const http_response& r) { return r.status == 200; });
+
+        if (!KFTEST_CHECK(served.status == 200)) {
+            std::cerr << served.body << "\n";
+            return kftest::result();
+        }
+
+        auto tag = served.header("etag");
+        KFTEST_CHECK(tag.size() > 2 && tag.front() == '"' && tag.back() == '"');
+        KFTEST_CHECK(served.header("cache-control") == "no-cache");
+        KFTEST_CHECK(served.header("content-type") == "application/json");
+        KFTEST_CHECK(contains(served.body, "kfserver-sim #0"));
+        KFTEST_CHECK(served.header("content-length") == std::to_string(served.body.size()));
+
+        // revalidation: the current tag, also weak or in a list, is not modified, another one is
+        auto revalidated = request("GET", first, tag);
+        KFTEST_CHECK(revalidated.status == 304);
+        KFTEST_CHECK(revalidated.body.empty());
+        KFTEST_CHECK(revalidated.header("etag") == tag);
+        KFTEST_CHECK(request("GET", first, "\"0\", W/" + tag).status == 304);
+        KFTEST_CHECK(request("GET", first, "*").status == 304);
+        KFTEST_CHECK(request("GET", first, "\"0123456789abcdef\"").status == 200);
+
+        // HEAD announces the length of the body GET returns, without sending it
+        auto head = request("HEAD", first);
+        KFTEST_CHECK(head.status == 200);
+        KFTEST_CHECK(head.body.empty());
+        KFTEST_CHECK(head.header("etag") == tag);
+        KFTEST_CHECK(head.header("content-length") == std::to_string(served.body.size()));
+
+        // failed servers are served, but never cached or revalidated
+        KFTEST_CHECK(failed.status == 503);
+        KFTEST_CHECK(failed.header("cache-control") == "no-store");
+        KFTEST_CHECK(failed.header("etag").empty());
+        KFTEST_CHECK(contains(failed.body, "\"error\""));
+        KFTEST_CHECK(request("GET", missing, "*").status == 503);
+
+        // the list is stable while nothing changes
+        auto list = request("GET", "/servers");
+        auto list_tag = list.header("etag");
+        KFTEST_CHECK(list.status == 200);
+        KFTEST_CHECK(contains(list.body, "kfserver-sim #0") && contains(list.body, "kfserver-sim #1"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+        KFTEST_CHECK(request("GET", "/servers", list_tag).status == 304);
+
+        KFTEST_CHECK(request("POST", first).status == 405);
+        KFTEST_CHECK(request("GET", "/servers/127.0.0.1:1").status == 404);
+        KFTEST_CHECK(request("GET", "/").status == 404);
+
+        // a server that goes down fails on its own and invalidates the list
+        sim.stop();
+        auto down = wait_for(first, [](const http_response& r) { return r.status == 503; });
+        KFTEST_CHECK(down.status == 503);
+        KFTEST_CHECK(down.header("cache-control") == "no-store");
+
+        auto changed = request("GET", "/servers", list_tag);
+        KFTEST_CHECK(changed.status == 200);
+        KFTEST_CHECK(!changed.header("etag").empty() && changed.header("etag") != list_tag);
+        KFTEST_CHECK(!contains(changed.body, "kfserver-sim #0"));
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
\ No newline at end of file
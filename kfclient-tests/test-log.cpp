@@ -0,0 +1,177 @@
+#include "kftest.hpp"
+
+#include <kflog.hpp>
+
+#include <fstream>
+
+// Writes snapshots of several servers over many small segments, scans them back whole and between
+// bounds, then tears the last segment like a crash would and appends to the log again: the torn
+// segment is dropped and what follows uses the string table of the segments before it.
+
+static const std::uint64_t BASE_TIMESTAMP = 1700000000000;
+static const std::uint16_t SERVERS = 3;
+
+struct expected_record {
+    std::uint16_t port;
+    kfc::kfsnapshot snapshot;
+};
+
+// the i-th snapshot, of server i % SERVERS; every seventh one failed
+static expected_record make_record(std::size_t i, const std::string& hostname) {
+    expected_record result;
+    result.port = static_cast<std::uint16_t>(7000 + i % SERVERS);
+
+    auto& snapshot = result.snapshot;
+    snapshot.timestamp = BASE_TIMESTAMP + i * 1000;
+
+    if (i % 7 == 6) {
+        snapshot.store_error("timed out waiting for a response");
+        return result;
+    }
+
+    snapshot.flags = kfc::kfsnapshot::HAS_DETAILS | kfc::kfsnapshot::HAS_PLAYERS;
+    snapshot.hostname.assign(hostname + " " + std::to_string(result.port));
+    snapshot.map.assign("KF-Map-" + std::to_string(i % 4));
+    snapshot.player_count = static_cast<std::uint8_t>(i % 5);
+    snapshot.player_cap = 6;
+    snapshot.waves_total = 10;
+    snapshot.waves_current = static_cast<std::int32_t>(i % 11);
+
+    snapshot.player_list_count = snapshot.player_count;
+    for (std::size_t p = 0; p < snapshot.player_list_count; ++p) {
+        auto& player = snapshot.player_list.at(p);
+        player.name.assign("player " + std::to_string(p));
+        player.score = static_cast<std::uint32_t>(i * 100 + p);
+        player.time = static_cast<std::uint32_t>(i * 60);
+    }
+
+    return result;
+}
+
+static bool matches(const kfc::kflog_record& record, const kfc::kfsnapshot& snapshot) {
+    if (record.timestamp != snapshot.timestamp || record.flags != snapshot.flags)
+        return false;
+
+    // a failed poll carries none of the details of the record before it
+    if ((snapshot.flags & kfc::kfsnapshot::HAS_ERROR) != 0)
+        return record.error != nullptr && *record.error == snapshot.error.str() && record.hostname == nullptr && record.map == nullptr
+            && record.player_count == 0 && record.player_cap == 0 && record.waves_total == 0 && record.waves_current == 0 && record.players.empty();
+
+    if (*record.hostname != snapshot.hostname.str() || *record.map != snapshot.map.str() || record.player_count != snapshot.player_count
+        || record.player_cap != snapshot.player_cap || record.waves_total != snapshot.waves_total || record.waves_current != snapshot.waves_current
+        || record.players.size() != snapshot.player_list_count || record.error != nullptr)
+        return false;
+
+    for (std::size_t p = 0; p < record.players.size(); ++p) {
+        const auto& player = snapshot.player_list.at(p);
+        if (*record.players[p].name != player.name.str() || record.players[p].score != player.score || record.players[p].time != player.time)
+            return false;
+    }
+
+    return true;
+}
+
+// scans every server between the bounds and checks the records against what was appended
+static void check_scan(const kfc::kflog_reader& reader, const std::vector<expected_record>& written, std::uint64_t from, std::uint64_t to) {
+    for (std::uint16_t s = 0; s < SERVERS; ++s) {
+        auto port = static_cast<std::uint16_t>(7000 + s);
+
+        std::vector<const kfc::kfsnapshot*> expected;
+        for (const auto& record : written) {
+            if (record.port == port && record.snapshot.timestamp >= from && record.snapshot.timestamp <= to)
+                expected.push_back(&record.snapshot);
+        }
+
+        std::size_t seen = 0;
+        bool ordered = true;
+        auto count = reader.scan("127.0.0.1", port, [&](const kfc::kflog_record& record) {
+            if (seen >= expected.size() || !matches(record, *expected[seen]))
+                ordered = false;
+            ++seen;
+        }, from, to);
+
+        KFTEST_CHECK(count == expected.size());
+        KFTEST_CHECK(seen == expected.size());
+        KFTEST_CHECK(ordered);
+    }
+}
+
+int main() {
+    try {
+        kftest::directory directory;
+        auto path = directory.file("snapshots.kflog");
+        std::vector<expected_record> written;
+
+        // 32 records in segments of 5, the last one sealed by the destructor
+        {
+            kfc::kflog_writer writer(path, 5);
+            for (std::size_t i = 0; i < 32; ++i) {
+                written.push_back(make_record(i, "server"));
+                writer.append("127.0.0.1", written.back().port, written.back().snapshot);
+            }
+        }
+
+        {
+            kfc::kflog_reader reader(path);
+            KFTEST_CHECK(reader.servers().size() == SERVERS);
+            KFTEST_CHECK(reader.scan("127.0.0.1", 1, [](const kfc::kflog_record&) {}) == 0);
+
+            check_scan(reader, written, 0, std::numeric_limits<std::uint64_t>::max());
+
+            // bounds are inclusive, fall inside segments and may select nothing at all
+            check_scan(reader, written, BASE_TIMESTAMP + 6000, BASE_TIMESTAMP + 14000);
+            check_scan(reader, written, BASE_TIMESTAMP + 6500, BASE_TIMESTAMP + 6900);
+            check_scan(reader, written, BASE_TIMESTAMP + 31000, std::numeric_limits<std::uint64_t>::max());
+            check_scan(reader, written, BASE_TIMESTAMP + 40000, std::numeric_limits<std::uint64_t>::max());
+            check_scan(reader, written, 0, BASE_TIMESTAMP - 1);
+        }
+
+        // a crash while a segment was written leaves its header and part of its records
+        auto valid_size = boost::filesystem::file_size(path);
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::app);
+            const char torn[] = { 'F', 'K', 'S', 'G', 0x00, 0x01, 0x00, 0x00, 0x05, 0x01, 0x02 };
+            file.write(torn, sizeof(torn));
+        }
+
+        {
+            kfc::kflog_reader reader(path);
+            check_scan(reader, written, 0, std::numeric_limits<std::uint64_t>::max());
+        }
+
+        // appending drops the torn segment, old strings are referenced and new ones added
+        {
+            kfc::kflog_writer writer(path, 4);
+            KFTEST_CHECK(boost::filesystem::file_size(path) == valid_size);
+
+            for (std::size_t i = 32; i < 50; ++i) {
+                written.push_back(make_record(i, i % 2 == 0 ? "server" : "renamed"));
+                writer.append("127.0.0.1", written.back().port, written.back().snapshot);
+            }
+        }
+
+        {
+            kfc::kflog_reader reader(path);
+            KFTEST_CHECK(reader.servers().size() == SERVERS);
+            check_scan(reader, written, 0, std::numeric_limits<std::uint64_t>::max());
+            check_scan(reader, written, BASE_TIMESTAMP + 30000, BASE_TIMESTAMP + 35000);
+        }
+
+        // and a log reopened without a torn segment is only appended to
+        valid_size = boost::filesystem::file_size(path);
+        {
+            kfc::kflog_writer writer(path);
+            KFTEST_CHECK(boost::filesystem::file_size(path) == valid_size);
+            written.push_back(make_record(50, "server"));
+            writer.append("127.0.0.1", written.back().port, written.back().snapshot);
+        }
+
+        kfc::kflog_reader reader(path);
+        check_scan(reader, written, 0, std::numeric_limits<std::uint64_t>::max());
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
\ No newline at end of file
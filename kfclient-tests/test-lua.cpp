@@ -0,0 +1,200 @@
+#include "kftest.hpp"
+
+#include <lua.hpp>
+
+// Loads the Lua library into a fresh state and queries kfserver-sim, which churns, from scripts:
+// a lazy result requested after a filled one must show the response of the filled one, not the
+// copy the lazy result before it kept. The asynchronous requests are run from several coroutines
+// at once, against a port that never answers and with errors raised in between. query_many gets a
+// list of live and dead servers, one at a time and all at once.
+
+static const std::uint16_t FIRST_PORT = 47950;
+static const std::uint16_t SILENT_PORT = FIRST_PORT + 5;
+
+static const char* const LAZY_SCRIPT = R"lua(
+local kfc = require "kfclient";
+local client = kfc.open("127.0.0.1", port);
+
+client:lazy(true);
+local first = client:details();
+check(type(first) == "userdata", "a lazy result is userdata");
+local waves = first.waves_current;
+
+-- the sim moves on to the next wave in the meantime
+sleep(churn * 3 // 2);
+client:lazy(false);
+local filled = {};
+client:details(filled);
+check(filled.waves_current ~= waves, "the filled result is a later response");
+
+-- the response did not change since it was filled
+client:lazy(true);
+local second = client:details();
+check(second.waves_current ~= waves, "a lazy result after a filled one is not the lazy one before it");
+check(second.hostname == filled.hostname, "the lazy result reads the fields");
+
+client:close();
+)lua";
+
+static const char* const ASYNC_SCRIPT = R"lua(
+local kfc = require "kfclient";
+
+-- several requests in flight at once
+local clients, results = {}, {};
+local requests = { "details_async", "rules_async", "players_async", "details_async" };
+for i, request in ipairs(requests) do
+  clients[i] = kfc.open("127.0.0.1", port);
+  coroutine.wrap(function() results[i] = clients[i][request](clients[i]); end)();
+end
+check(kfc.pending() == #requests, "every request is in flight");
+
+local resumed = 0;
+while kfc.pending() > 0 do
+  resumed = resumed + kfc.dispatch();
+end
+check(resumed == #requests, "every coroutine is resumed once");
+check(results[1].hostname:find("kfserver-sim #", 1, true) == 1, "details are returned");
+check(next(results[2]) ~= nil, "rules are returned");
+check(type(results[3]) == "table", "players are returned");
+check(results[4].hostname == results[1].hostname, "the same server answers every client");
+
+-- an error raised in a coroutine is raised by dispatch, the other coroutines are left for the next call
+local after = nil;
+coroutine.wrap(function() clients[1]:details_async(); error("raised in the coroutine"); end)();
+coroutine.wrap(function() after = clients[2]:details_async(); end)();
+local ok, message = pcall(kfc.dispatch);
+if ok then
+  ok, message = pcall(kfc.dispatch);
+end
+check(not ok and message:find("raised in the coroutine", 1, true) ~= nil, "the error reaches dispatch");
+while kfc.pending() > 0 do
+  kfc.dispatch();
+end
+check(after ~= nil and after.hostname == results[1].hostname, "the other coroutine completes");
+
+-- a port that never answers times out inside the coroutine
+local silent = kfc.open("127.0.0.1", silent_port);
+silent:timeout(300);
+local failure = nil;
+coroutine.wrap(function()
+  local succeeded, reason = pcall(silent.details_async, silent);
+  failure = not succeeded and reason or "answered";
+end)();
+check(kfc.dispatch(50) == 0, "dispatch returns 0 once its timeout passed");
+check(kfc.pending() == 1 and failure == nil, "the request is still in flight");
+check(kfc.dispatch() == 1, "dispatch resumes the request once it timed out");
+check(failure ~= nil and failure:find("timed out", 1, true) ~= nil, "the timeout is raised in the coroutine");
+
+-- a coroutine resumed by someone else fails there and is skipped by dispatch
+local co = coroutine.create(function() return clients[1]:details_async(); end);
+coroutine.resume(co);
+ok, message = coroutine.resume(co, "not a query");
+check(not ok and message:find("resumed outside kfclient.dispatch", 1, true) ~= nil, "the continuation refuses to run");
+check(kfc.dispatch() == 0 and kfc.pending() == 0, "the dead coroutine is not resumed");
+
+check(kfc.dispatch(0) == 0, "dispatch returns 0 when nothing is pending");
+
+for _, client in ipairs(clients) do client:close(); end
+silent:close();
+)lua";
+
+static const char* const QUERY_SCRIPT = R"lua(
+local kfc = require "kfclient";
+
+local targets = {
+  { "127.0.0.1", port },
+  { host = "127.0.0.1", port = silent_port },
+  { "kfserver-sim.invalid", port },
+  { "localhost", port },
+  { "127.0.0.1", port },
+};
+
+for _, parallel in ipairs({ 1, 64 }) do
+  local results = kfc.query_many(targets, { sections = { "details" }, timeout = 300, parallel = parallel });
+  check(#results == #targets, "one result per server");
+
+  for i, target in ipairs(targets) do
+    check(results[i].host == (target[1] or target.host) and results[i].port == (target[2] or target.port), "the results are in list order");
+  end
+  for _, i in ipairs({ 1, 4, 5 }) do
+    check(results[i].error == nil and results[i].details.hostname:find("kfserver-sim #", 1, true) == 1, "a live server answers");
+  end
+
+  check(results[2].error ~= nil and results[2].timed_out == true and results[2].details == nil, "a silent server times out");
+  check(results[3].error ~= nil and results[3].timed_out == false, "an unknown host fails without timing out");
+end
+
+check(not pcall(kfc.query_many, targets, { parallel = 0 }), "parallel must be positive");
+)lua";
+
+// check(condition, message) counts a failed check like KFTEST_CHECK
+static int lua_check(lua_State* L) {
+    if (lua_toboolean(L, 1) == 0) {
+        std::cerr << "lua check failed: " << luaL_optstring(L, 2, "?") << "\n";
+        ++kftest::failures();
+    }
+    return 0;
+}
+
+// sleep(milliseconds)
+static int lua_sleep(lua_State* L) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(luaL_checkinteger(L, 1)));
+    return 0;
+}
+
+static bool run(lua_State* L, const char* script) {
+    if (luaL_dostring(L, script) != LUA_OK) {
+        std::cerr << "error: " << lua_tostring(L, -1) << "\n";
+        lua_pop(L, 1);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " path-to-kfserver-sim path-to-lua-library\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const std::size_t churn = 300;
+        kftest::process sim(argv[1], { "-p", std::to_string(FIRST_PORT), "-n", "1", "--churn", std::to_string(churn) });
+        if (!KFTEST_CHECK(kftest::wait_for_server(FIRST_PORT)))
+            return kftest::result();
+
+        std::unique_ptr<lua_State, decltype(&lua_close)> state(luaL_newstate(), &lua_close);
+        auto* L = state.get();
+        luaL_openlibs(L);
+
+        // require finds the library where it was built
+        boost::filesystem::path library(argv[2]);
+        auto cpath = (library.parent_path() / ("?" + library.extension().string())).string();
+        lua_getglobal(L, "package");
+        lua_pushstring(L, cpath.c_str());
+        lua_setfield(L, -2, "cpath");
+        lua_pop(L, 1);
+
+        lua_register(L, "check", lua_check);
+        lua_register(L, "sleep", lua_sleep);
+        lua_pushinteger(L, FIRST_PORT);
+        lua_setglobal(L, "port");
+        lua_pushinteger(L, static_cast<lua_Integer>(churn));
+        lua_setglobal(L, "churn");
+
+        lua_pushinteger(L, SILENT_PORT);
+        lua_setglobal(L, "silent_port");
+
+        // bound but never read, requests to it neither get an answer nor an error
+        boost::asio::io_context context;
+        boost::asio::ip::udp::socket silent(context, boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), SILENT_PORT));
+
+        if (!run(L, LAZY_SCRIPT) || !run(L, ASYNC_SCRIPT) || !run(L, QUERY_SCRIPT))
+            return EXIT_FAILURE;
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
@@ -0,0 +1,117 @@
+#include "kftest.hpp"
+
+#include <kfstring.hpp>
+
+#include <algorithm>
+
+#include <deque>
+
+// Answers a kfclient from memory and checks when it returns the previous result unchanged: only
+// for a byte-identical payload, never after the interner or the utf8 policy changed, and never
+// with memoize(false).
+
+// answers challenges with a challenge and every other request with the current details
+class scripted_transport : public kfc::kftransport {
+public:
+    void send(const std::uint8_t* data, std::size_t size) override {
+        std::vector<std::uint8_t> reply = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+        if (size == kfc::protocol::REQUEST_CHALLENGE.size() && std::equal(data, data + size, kfc::protocol::REQUEST_CHALLENGE.begin())) {
+            std::int32_t challenge = 0x1234;
+            reply.push_back(static_cast<std::uint8_t>(kfc::protocol::PACKET_CHALLENGE));
+            reply.insert(reply.end(), reinterpret_cast<const std::uint8_t*>(&challenge), reinterpret_cast<const std::uint8_t*>(&challenge) + sizeof(challenge));
+        } else {
+            reply.push_back(static_cast<std::uint8_t>(kfc::protocol::PACKET_DETAILS));
+            kfc::schema::serialize(details, reply);
+        }
+
+        replies_.push_back(std::move(reply));
+    }
+
+    std::size_t receive(std::uint8_t* data, std::size_t size, std::chrono::milliseconds /*timeout*/) override {
+        if (replies_.empty())
+            throw kfc::timeout_error("nothing to answer");
+
+        auto reply = std::move(replies_.front());
+        replies_.pop_front();
+        std::copy(reply.begin(), reply.begin() + static_cast<std::ptrdiff_t>(std::min(size, reply.size())), data);
+        return std::min(size, reply.size());
+    }
+
+    std::string peer() const override { return "scripted:0"; }
+
+    kfc::kfdetails details;
+
+private:
+    std::deque<std::vector<std::uint8_t>> replies_;
+};
+
+int main() {
+    try {
+        auto transport = std::make_unique<scripted_transport>();
+        auto& server = *transport;
+        const std::string hostname = "a server name\x07 longer than the small string buffer";
+        server.details.hostname.assign(hostname.data(), hostname.size());
+        server.details.map.assign("KF-BurningParis", 15);
+        server.details.version = "1046";
+        server.details.player_count = 3;
+
+        kfc::kfclient client(std::move(transport));
+
+        // the first response is parsed, the same one again is not
+        const auto* first = &client.request_details();
+        KFTEST_CHECK(!client.unchanged());
+        KFTEST_CHECK(first->player_count == 3);
+
+        const auto* second = &client.request_details();
+        KFTEST_CHECK(client.unchanged());
+        KFTEST_CHECK(second == first);
+        KFTEST_CHECK(client.stats().snapshot().counter(kfc::kfcounter::unchanged_responses) == 1);
+
+        // a payload of the same size that differs in one byte is parsed again
+        server.details.player_count = 4;
+        const auto& changed = client.request_details();
+        KFTEST_CHECK(!client.unchanged());
+        KFTEST_CHECK(changed.player_count == 4);
+
+        client.request_details();
+        KFTEST_CHECK(client.unchanged());
+
+        // a result parsed without the interner is not returned for a client that now has one
+        kfc::kfinterner interner;
+        client.interner(&interner);
+        const auto& interned = client.request_details();
+        KFTEST_CHECK(!client.unchanged());
+        KFTEST_CHECK(interned.hostname.same(interner.intern(interned.hostname.data(), interned.hostname.size())));
+
+        client.request_details();
+        KFTEST_CHECK(client.unchanged());
+
+        // nor a result parsed under another policy
+        KFTEST_CHECK(!client.request_details().hostname.clean());
+        client.utf8_policy(kfc::utf8::policy::replace);
+        const auto& replaced = client.request_details();
+        KFTEST_CHECK(!client.unchanged());
+        KFTEST_CHECK(replaced.hostname == "a server name\xEF\xBF\xBD longer than the small string buffer");
+
+        // setting what is already set keeps the memo
+        client.utf8_policy(kfc::utf8::policy::replace);
+        client.interner(&interner);
+        client.request_details();
+        KFTEST_CHECK(client.unchanged());
+
+        // without memoizing every response is parsed
+        client.memoize(false);
+        for (int i = 0; i < 3; ++i) {
+            client.request_details();
+            KFTEST_CHECK(!client.unchanged());
+        }
+
+        client.interner(nullptr);
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
\ No newline at end of file
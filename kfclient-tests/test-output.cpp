@@ -0,0 +1,77 @@
+#include "kftest.hpp"
+
+#include <output.hpp>
+
+// Writes records with text that is not valid UTF-8 in the fields that are not kfstrings, and in
+// kfstrings parsed under utf8::policy::keep: JSON and NDJSON must still come out as valid UTF-8,
+// with the control characters of otherwise valid text escaped.
+
+static const std::string REPLACEMENT = "\xEF\xBF\xBD";
+
+static bool contains(const std::string& value, const std::string& part) {
+    return value.find(part) != std::string::npos;
+}
+
+// every line is valid UTF-8 without control characters
+static bool valid_lines(const std::string& output) {
+    std::istringstream lines(output);
+    std::string line;
+
+    while (std::getline(lines, line)) {
+        if (!kfc::utf8::clean(line.data(), line.size()))
+            return false;
+    }
+
+    return true;
+}
+
+static std::string write(output::format format, const kfc::kfdetails& details, const kfc::kfrules& rules, const kfc::kfplayers& players) {
+    std::string sink;
+    {
+        output::record_writer writer(format, sink);
+        writer.begin();
+        writer.record("127.0.0.1:27015", &details, &rules, &players);
+        writer.error("127.0.0.1:27016", "bad \xC0\xAF answer", false);
+        writer.end();
+    }
+    return sink;
+}
+
+int main() {
+    kfc::kfdetails details;
+    const std::string hostname = "host \xFF\xFE";
+    details.hostname.assign(hostname.data(), hostname.size());
+    details.map = kfc::kfstring("KF-BioticsLab");
+    details.version = "1\xE2\x82";
+
+    kfc::kfrules rules;
+    kfc::kfrule rule;
+    rule.name = "Name\x80";
+    rule.value = std::string("caf\xC3\xA9 \xED\xA0\x80");
+    rules.rules.push_back(rule);
+    rule.name = "Tab";
+    rule.value = std::string("a\tb");
+    rules.rules.push_back(rule);
+    rules.count = static_cast<std::uint16_t>(rules.rules.size());
+
+    kfc::kfplayers players;
+    kfc::kfplayer player;
+    const std::string name = "\xF5player";
+    player.name.assign(name.data(), name.size());
+    players.players.push_back(player);
+    players.count = 1;
+
+    for (auto format : { output::format::json, output::format::ndjson }) {
+        auto json = write(format, details, rules, players);
+        KFTEST_CHECK(valid_lines(json));
+        KFTEST_CHECK(contains(json, "\"hostname\":\"host " + REPLACEMENT + REPLACEMENT + "\""));
+        KFTEST_CHECK(contains(json, "\"map\":\"KF-BioticsLab\""));
+        KFTEST_CHECK(contains(json, "\"Name" + REPLACEMENT + "\":\"caf\xC3\xA9 " + REPLACEMENT));
+        KFTEST_CHECK(contains(json, "\"Tab\":\"a\\tb\""));
+        KFTEST_CHECK(contains(json, "\"name\":\"" + REPLACEMENT + "player\""));
+        KFTEST_CHECK(contains(json, "\"error\":\"bad " + REPLACEMENT));
+        KFTEST_CHECK(!contains(json, "\xFF") && !contains(json, "\x80"));
+    }
+
+    return kftest::result();
+}
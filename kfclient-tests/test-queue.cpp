@@ -0,0 +1,256 @@
+#include "kftest.hpp"
+
+#include <kfqueue.hpp>
+
+#include <atomic>
+
+// Runs several producers and consumers through kfring and kfresult_queue at once: every item that
+// was pushed must be popped exactly once, in the order of its producer, and the results that were
+// dropped must account for the rest. Consumers of the result queue hold on to a few results, so
+// the pool runs dry; once they let go every result must be back in it. A consumer blocked in
+// pop(result, timeout) must wake on a push rather than sleep out its timeout.
+
+static const std::size_t PRODUCERS = 4;
+static const std::size_t CONSUMERS = 3;
+
+// a value tells its producer and its position in the producer's sequence
+static std::uint64_t encode(std::size_t producer, std::size_t sequence) {
+    return (static_cast<std::uint64_t>(producer) << 32U) | sequence;
+}
+
+static std::size_t producer_of(std::uint64_t value) { return static_cast<std::size_t>(value >> 32U); }
+static std::size_t sequence_of(std::uint64_t value) { return static_cast<std::size_t>(value & 0xFFFFFFFFU); }
+
+// the values each consumer popped, in the order it popped them
+using popped_type = std::vector<std::vector<std::uint64_t>>;
+
+// every pushed value is popped once, and each consumer sees the values of a producer in order
+static void check_popped(const popped_type& popped, const std::vector<std::vector<bool>>& pushed) {
+    std::vector<std::vector<std::uint8_t>> seen(pushed.size());
+    for (std::size_t producer = 0; producer < pushed.size(); ++producer)
+        seen.at(producer).resize(pushed.at(producer).size());
+
+    bool unknown = false;
+    bool reordered = false;
+    for (const auto& values : popped) {
+        std::vector<std::size_t> next(pushed.size());
+        for (auto value : values) {
+            auto producer = producer_of(value);
+            auto sequence = sequence_of(value);
+            if (producer >= pushed.size() || sequence >= pushed.at(producer).size()) {
+                unknown = true;
+                continue;
+            }
+
+            reordered = reordered || sequence < next.at(producer);
+            next.at(producer) = sequence + 1;
+            seen.at(producer).at(sequence)++;
+        }
+    }
+
+    KFTEST_CHECK(!unknown);
+    KFTEST_CHECK(!reordered);
+
+    std::size_t lost = 0;
+    std::size_t duplicated = 0;
+    std::size_t invented = 0;
+    for (std::size_t producer = 0; producer < pushed.size(); ++producer) {
+        for (std::size_t sequence = 0; sequence < pushed.at(producer).size(); ++sequence) {
+            auto count = seen.at(producer).at(sequence);
+            if (pushed.at(producer).at(sequence)) {
+                lost += count == 0 ? 1 : 0;
+                duplicated += count > 1 ? 1 : 0;
+            } else {
+                invented += count != 0 ? 1 : 0;
+            }
+        }
+    }
+
+    KFTEST_CHECK(lost == 0);
+    KFTEST_CHECK(duplicated == 0);
+    KFTEST_CHECK(invented == 0);
+}
+
+// Pushes spin until the ring has room, so every value gets through a ring far smaller than them.
+static void ring_stress() {
+    const std::size_t per_producer = 200000;
+    kfc::kfring<std::uint64_t> ring(64);
+    KFTEST_CHECK(ring.capacity() == 64);
+
+    std::vector<std::vector<bool>> pushed(PRODUCERS, std::vector<bool>(per_producer, true));
+    popped_type popped(CONSUMERS);
+    std::atomic<std::size_t> remaining { PRODUCERS * per_producer };
+
+    std::vector<std::thread> threads;
+    for (std::size_t producer = 0; producer < PRODUCERS; ++producer) {
+        threads.emplace_back([&ring, producer]() {
+            for (std::size_t sequence = 0; sequence < per_producer; ++sequence) {
+                while (!ring.try_push(encode(producer, sequence)))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    for (std::size_t consumer = 0; consumer < CONSUMERS; ++consumer) {
+        threads.emplace_back([&ring, &remaining, &values = popped.at(consumer)]() {
+            std::uint64_t value = 0;
+            while (remaining.load() != 0) {
+                if (!ring.try_pop(value)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                values.push_back(value);
+                remaining.fetch_sub(1);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    check_popped(popped, pushed);
+    KFTEST_CHECK(ring.size() == 0);
+
+    std::uint64_t value = 0;
+    KFTEST_CHECK(!ring.try_pop(value));
+}
+
+// Producers push without waiting, so the results they push while the consumers hold the pool are
+// dropped; the host of a result carries its value.
+static void result_queue_stress() {
+    const std::size_t per_producer = 50000;
+    const std::size_t held = 4;
+    kfc::kfresult_queue queue(16);
+
+    std::vector<std::vector<bool>> pushed(PRODUCERS, std::vector<bool>(per_producer));
+    popped_type popped(CONSUMERS);
+    std::vector<std::size_t> mismatched(CONSUMERS);
+    std::atomic<std::size_t> producing { PRODUCERS };
+
+    std::vector<std::thread> threads;
+    for (std::size_t producer = 0; producer < PRODUCERS; ++producer) {
+        threads.emplace_back([&queue, &producing, &accepted = pushed.at(producer), producer]() {
+            std::string host;
+            for (std::size_t sequence = 0; sequence < per_producer; ++sequence) {
+                host = std::to_string(encode(producer, sequence));
+                kfc::kfpoll_result result { host, static_cast<std::uint16_t>(producer) };
+                accepted.at(sequence) = queue.push(result);
+            }
+            producing.fetch_sub(1);
+        });
+    }
+
+    for (std::size_t consumer = 0; consumer < CONSUMERS; ++consumer) {
+        threads.emplace_back([&queue, &producing, &values = popped.at(consumer), &wrong = mismatched.at(consumer), held]() {
+            std::vector<kfc::kfresult_ptr> holding(held);
+            std::size_t next = 0;
+
+            // the queue may still hold results after the last producer finished
+            for (;;) {
+                auto done = producing.load() == 0;
+                kfc::kfresult_ptr result;
+                if (!queue.pop(result, std::chrono::milliseconds(1))) {
+                    if (done)
+                        break;
+                    continue;
+                }
+
+                auto value = std::stoull(result->host);
+                values.push_back(value);
+                wrong += result->port == producer_of(value) ? 0 : 1;
+
+                // replacing the oldest held result gives it back to the pool
+                holding.at(next++ % held) = std::move(result);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    check_popped(popped, pushed);
+    for (auto wrong : mismatched)
+        KFTEST_CHECK(wrong == 0);
+
+    std::size_t accepted = 0;
+    for (const auto& accepted_by : pushed) {
+        for (auto value : accepted_by)
+            accepted += value ? 1 : 0;
+    }
+
+    std::size_t received = 0;
+    for (const auto& values : popped)
+        received += values.size();
+
+    KFTEST_CHECK(queue.size() == 0);
+    KFTEST_CHECK(accepted == received + queue.size());
+    KFTEST_CHECK(accepted + queue.dropped() == PRODUCERS * per_producer);
+
+    // the consumers held the pool long enough for some pushes to fail
+    KFTEST_CHECK(queue.dropped() > 0);
+
+    // every result is back in the pool: exactly capacity() pushes succeed
+    std::string host = "pool";
+    kfc::kfpoll_result result { host, 0 };
+    auto dropped = queue.dropped();
+    std::size_t filled = 0;
+    while (filled <= queue.capacity() && queue.push(result))
+        ++filled;
+
+    KFTEST_CHECK(filled == queue.capacity());
+    KFTEST_CHECK(queue.size() == queue.capacity());
+    KFTEST_CHECK(queue.dropped() == dropped + 1);
+}
+
+// A consumer waits far longer than it takes the push to come.
+static void pop_wakes_on_push() {
+    const auto wait = std::chrono::seconds(10);
+    const auto delay = std::chrono::milliseconds(50);
+    kfc::kfresult_queue queue(4);
+
+    for (int round = 0; round < 5; ++round) {
+        bool popped = false;
+        std::string host;
+        auto started = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::duration waited {};
+
+        std::thread consumer([&queue, &popped, &host, &waited, started, wait]() {
+            kfc::kfresult_ptr result;
+            popped = queue.pop(result, wait);
+            waited = std::chrono::steady_clock::now() - started;
+            if (popped)
+                host = result->host;
+        });
+
+        std::this_thread::sleep_for(delay);
+        std::string pushed = "round " + std::to_string(round);
+        KFTEST_CHECK(queue.push(kfc::kfpoll_result { pushed, 0 }));
+        consumer.join();
+
+        KFTEST_CHECK(popped);
+        KFTEST_CHECK(host == pushed);
+        KFTEST_CHECK(waited >= delay);
+        KFTEST_CHECK(waited < wait / 4);
+    }
+
+    // and times out when nothing comes
+    kfc::kfresult_ptr result;
+    auto started = std::chrono::steady_clock::now();
+    KFTEST_CHECK(!queue.pop(result, std::chrono::milliseconds(20)));
+    KFTEST_CHECK(std::chrono::steady_clock::now() - started >= std::chrono::milliseconds(20));
+    KFTEST_CHECK(!result);
+}
+
+int main() {
+    try {
+        ring_stress();
+        result_queue_stress();
+        pop_wakes_on_push();
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
@@ -0,0 +1,111 @@
+#include "kftest.hpp"
+
+#include <cstring>
+
+// Queries kfserver-sim for rules split over several datagrams through a relay that holds some of
+// them back: a late single datagram answer that arrives while a split answer is collected must be
+// skipped, and a datagram of an abandoned split answer that arrives first must not shut out the
+// answer to the retry. The sim churns, so every answer is split under an id of its own.
+
+static const std::uint16_t FIRST_PORT = 47930;
+static const std::size_t RULES = 100;
+static const auto TIMEOUT = std::chrono::milliseconds(200);
+
+static bool is_split(const std::uint8_t* data, std::size_t size) {
+    return size >= kfc::protocol::SPLIT_HEADER_SIZE && kfc::protocol::is_split(data, size);
+}
+
+static std::int32_t split_id(const std::uint8_t* data) {
+    std::int32_t id = 0;
+    std::memcpy(&id, data + sizeof(std::int32_t), sizeof(id));
+    return id;
+}
+
+static std::unique_ptr<kfc::kfclient> make_client(boost::asio::io_context& context, const kftest::relay& relay) {
+    boost::asio::ip::udp::resolver resolver(context);
+    auto client = std::make_unique<kfc::kfclient>(context, resolver.resolve(boost::asio::ip::udp::v4(), "127.0.0.1", std::to_string(relay.port())));
+    client->timeout(TIMEOUT);
+    client->retries(1);
+    return client;
+}
+
+// The first details request times out and its answer is taken by the retry, so the answer to the
+// retry arrives late, in between the datagrams of the rules (the last one of which is held back).
+static void late_single_datagram() {
+    std::size_t details = 0;
+    kftest::relay relay(FIRST_PORT, [&details](const std::uint8_t* data, std::size_t size) {
+        if (is_split(data, size))
+            return data[9] + 1 == data[8] ? TIMEOUT : std::chrono::milliseconds(0);
+        if (size > 4 && static_cast<std::int8_t>(data[4]) == kfc::protocol::PACKET_DETAILS && details++ < 2)
+            return TIMEOUT + TIMEOUT / 4;
+        return std::chrono::milliseconds(0);
+    });
+
+    boost::asio::io_context context;
+    auto client = make_client(context, relay);
+
+    KFTEST_CHECK(client->request_details().hostname.str().compare(0, 14, "kfserver-sim #") == 0);
+    std::this_thread::sleep_for(TIMEOUT / 2);
+    KFTEST_CHECK(client->request_rules().rules.size() == RULES);
+
+    auto snapshot = client->stats().snapshot();
+    KFTEST_CHECK(snapshot.counter(kfc::kfcounter::retries) == 1);
+    KFTEST_CHECK(snapshot.counter(kfc::kfcounter::late_responses) == 1);
+    KFTEST_CHECK(snapshot.counter(kfc::kfcounter::parse_failures) == 0);
+}
+
+// The first datagram of the first rules answer is held back until the retry was sent, and the
+// answer to the retry for a little longer, so a datagram of the abandoned answer comes first.
+static void abandoned_split_first() {
+    std::int32_t first = -1;
+    std::int32_t second = -1;
+    kftest::relay relay(FIRST_PORT, [&first, &second](const std::uint8_t* data, std::size_t size) {
+        if (!is_split(data, size))
+            return std::chrono::milliseconds(0);
+
+        auto id = split_id(data);
+        if (first == -1)
+            first = id;
+        else if (second == -1 && id != first)
+            second = id;
+
+        if (id == first)
+            return data[9] == 0 ? TIMEOUT + TIMEOUT / 4 : std::chrono::milliseconds(0);
+        return id == second ? TIMEOUT / 2 : std::chrono::milliseconds(0);
+    });
+
+    boost::asio::io_context context;
+    auto client = make_client(context, relay);
+
+    KFTEST_CHECK(client->request_rules().rules.size() == RULES);
+
+    // the other answer is skipped once it is complete
+    std::this_thread::sleep_for(TIMEOUT);
+    KFTEST_CHECK(client->request_players().count > 0);
+
+    auto snapshot = client->stats().snapshot();
+    KFTEST_CHECK(snapshot.counter(kfc::kfcounter::retries) == 1);
+    KFTEST_CHECK(snapshot.counter(kfc::kfcounter::late_responses) == 1);
+    KFTEST_CHECK(snapshot.counter(kfc::kfcounter::parse_failures) == 0);
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " path-to-kfserver-sim\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        kftest::process sim(argv[1], { "-p", std::to_string(FIRST_PORT), "-n", "1", "--rules", std::to_string(RULES), "--split", "500", "--churn", "50" });
+        if (!KFTEST_CHECK(kftest::wait_for_server(FIRST_PORT)))
+            return kftest::result();
+
+        late_single_datagram();
+        abandoned_split_first();
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
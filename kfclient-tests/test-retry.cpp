@@ -0,0 +1,65 @@
+#include "kftest.hpp"
+
+// Queries kfserver-sim through a relay that holds every details answer back for longer than the
+// client's timeout: the retries must not trip over the late answers to the requests they replaced,
+// also when those arrive while a fresh challenge or another request type is awaited. Once those
+// answers are in, an answer of the wrong type is an error again rather than a late one.
+
+static const std::uint16_t FIRST_PORT = 47910;
+static const auto DETAILS_DELAY = std::chrono::milliseconds(150);
+static const auto TIMEOUT = std::chrono::milliseconds(100);
+
+int main(int argc, const char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " path-to-kfserver-sim\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        kftest::process sim(argv[1], { "-p", std::to_string(FIRST_PORT), "-n", "1" });
+        if (!KFTEST_CHECK(kftest::wait_for_server(FIRST_PORT)))
+            return kftest::result();
+
+        kftest::relay relay(FIRST_PORT, kfc::protocol::PACKET_DETAILS, DETAILS_DELAY);
+
+        boost::asio::io_context context;
+        boost::asio::ip::udp::resolver resolver(context);
+        kfc::kfclient client(context, resolver.resolve(boost::asio::ip::udp::v4(), "127.0.0.1", std::to_string(relay.port())));
+        client.timeout(TIMEOUT);
+        client.retries(3);
+
+        // the details arrive late, and the answers to the retried requests are queued in front of
+        // the challenges and the other requests that follow
+        for (int i = 0; i < 3; ++i) {
+            const auto& details = client.request_details();
+            KFTEST_CHECK(details.hostname.str().compare(0, 14, "kfserver-sim #") == 0);
+            auto players = details.player_count;
+            std::this_thread::sleep_for(DETAILS_DELAY * 2);
+
+            KFTEST_CHECK(client.request_players().count == players);
+            KFTEST_CHECK(!client.request_rules().rules.empty());
+        }
+
+        auto snapshot = client.stats().snapshot();
+        KFTEST_CHECK(snapshot.counter(kfc::kfcounter::retries) >= 3);
+        KFTEST_CHECK(snapshot.counter(kfc::kfcounter::late_responses) > 0);
+        KFTEST_CHECK(snapshot.counter(kfc::kfcounter::parse_failures) == 0);
+
+        // the players answer a request that awaits the rules, which is not skipped as a late one
+        std::this_thread::sleep_for(DETAILS_DELAY * 2);
+        bool unexpected = false;
+        try {
+            client.do_request(kfc::protocol::PACKET_RULES, kfc::protocol::REQUEST_PLAYERS);
+        } catch (const kfc::timeout_error&) {
+        } catch (const std::runtime_error&) {
+            unexpected = true;
+        }
+        KFTEST_CHECK(unexpected);
+        KFTEST_CHECK(client.stats().snapshot().counter(kfc::kfcounter::late_responses) == snapshot.counter(kfc::kfcounter::late_responses));
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
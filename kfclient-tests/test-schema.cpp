@@ -0,0 +1,494 @@
+#include "kftest.hpp"
+
+#include <kfplayers.hpp>
+#include <kfrules.hpp>
+
+#include <random>
+
+// Holds the schema derived parsers and serializers to the hand-written kfbuffer consume sequences
+// and encoder they replaced: the same fields from the same bytes, the same bytes from the same
+// fields, and a range_error wherever the old parsers ran out of packet.
+
+namespace legacy {
+    struct details {
+        std::uint8_t protocol = 0;
+        std::string hostname, map, game_dir, game_description;
+        std::uint16_t steam_app_id = 0;
+        std::uint8_t player_count = 0, player_cap = 0, unknown1 = 0, unknown2 = 0, operating_system = 0;
+        bool password_set = false;
+        std::uint8_t unknown3 = 0;
+        std::string version;
+        std::uint32_t unknown4 = 0, unknown5 = 0, unknown6 = 0;
+        std::string additional_string;
+
+        explicit details(const kfc::kfbuffer& buff) {
+            buff.consume(protocol);
+            buff.consume(hostname, map, game_dir, game_description);
+            buff.consume(steam_app_id, player_count, player_cap, unknown1, unknown2, operating_system);
+            buff.consume_cast<std::uint8_t>(password_set);
+            buff.consume(unknown3);
+            buff.consume_string(version, 4);
+            buff.consume(unknown4, unknown5, unknown6);
+            buff.consume(additional_string);
+        }
+    };
+
+    struct rule {
+        std::string name;
+        kfc::kfrule::variant_t value;
+
+        explicit rule(const kfc::kfbuffer& buff) {
+            std::string value_temp;
+            buff.consume(name, value_temp);
+
+            if (value_temp == "True" || value_temp == "False") {
+                value = value_temp == "True";
+                return;
+            }
+
+            char* end = nullptr;
+            double val = strtod(value_temp.c_str(), &end);
+            if (end != value_temp.c_str() && *end == '\0' && val != HUGE_VAL) {
+                value = val;
+                return;
+            }
+
+            value = value_temp;
+        }
+    };
+
+    struct rules {
+        std::uint16_t count = 0;
+        std::vector<rule> list;
+
+        explicit rules(const kfc::kfbuffer& buff) {
+            buff.consume(count);
+            for (std::uint16_t i = 0; i < count; ++i)
+                list.emplace_back(buff);
+        }
+    };
+
+    struct player {
+        std::uint8_t id = 0;
+        std::string name;
+        std::uint32_t score = 0, time = 0;
+
+        explicit player(const kfc::kfbuffer& buff) {
+            buff.consume(id, name, score, time);
+        }
+    };
+
+    struct players {
+        std::uint8_t count = 0;
+        std::vector<player> list;
+
+        explicit players(const kfc::kfbuffer& buff) {
+            buff.consume(count);
+            for (std::uint8_t i = 0; i < count; ++i)
+                list.emplace_back(buff);
+        }
+    };
+
+    // the simulator's encoder before the schema, without the packet header
+    class encoder {
+    public:
+        explicit encoder(std::vector<std::uint8_t>& out) : out_(out) {}
+
+        template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+        void put(T value) {
+            auto offset = out_.size();
+            out_.resize(offset + sizeof(T));
+            std::memcpy(out_.data() + offset, &value, sizeof(T));
+        }
+
+        void put(const std::string& value) {
+            out_.insert(out_.end(), value.begin(), value.end());
+            out_.push_back(0);
+        }
+
+        void put_fixed(const std::string& value, std::size_t length) {
+            auto offset = out_.size();
+            out_.resize(offset + length, 0);
+            std::memcpy(out_.data() + offset, value.data(), std::min(length, value.size()));
+        }
+
+    private:
+        std::vector<std::uint8_t>& out_;
+    };
+}
+
+static std::mt19937 generator(1046);
+
+static std::string random_string(std::size_t max_length) {
+    std::string result(generator() % (max_length + 1), ' ');
+    for (auto& c : result)
+        c = static_cast<char>(' ' + generator() % 95);
+    return result;
+}
+
+static kfc::kfdetails random_details() {
+    kfc::kfdetails details;
+    details.protocol = static_cast<std::uint8_t>(generator());
+    details.hostname = kfc::kfstring(random_string(60));
+    details.map = kfc::kfstring(random_string(20));
+    details.game_dir = kfc::kfstring(random_string(10));
+    details.game_description = kfc::kfstring(random_string(30));
+    details.steam_app_id = static_cast<std::uint16_t>(generator());
+    details.player_count = static_cast<std::uint8_t>(generator());
+    details.player_cap = static_cast<std::uint8_t>(generator());
+    details.unknown1 = static_cast<std::uint8_t>(generator());
+    details.unknown2 = static_cast<std::uint8_t>(generator());
+    details.operating_system = static_cast<std::uint8_t>(generator());
+    details.password_set = generator() % 2 == 0;
+    details.unknown3 = static_cast<std::uint8_t>(generator());
+    details.version = random_string(6); // shorter ones are padded, longer ones cut
+    details.unknown4 = generator();
+    details.unknown5 = generator();
+    details.unknown6 = generator();
+    details.additional_string = "d:" + std::to_string(generator() % 11) + ",e:" + std::to_string(generator() % 11) + ",x:" + std::to_string(generator()) + ",";
+    return details;
+}
+
+static std::vector<std::uint8_t> legacy_encode(const kfc::kfdetails& details) {
+    std::vector<std::uint8_t> out;
+    legacy::encoder e(out);
+    e.put(details.protocol);
+    e.put(details.hostname.str());
+    e.put(details.map.str());
+    e.put(details.game_dir.str());
+    e.put(details.game_description.str());
+    e.put(details.steam_app_id);
+    e.put(details.player_count);
+    e.put(details.player_cap);
+    e.put(details.unknown1);
+    e.put(details.unknown2);
+    e.put(details.operating_system);
+    e.put(static_cast<std::uint8_t>(details.password_set ? 1 : 0));
+    e.put(details.unknown3);
+    e.put_fixed(details.version, 4);
+    e.put(details.unknown4);
+    e.put(details.unknown5);
+    e.put(details.unknown6);
+    e.put(details.additional_string);
+    return out;
+}
+
+static std::vector<std::uint8_t> legacy_encode(const kfc::kfplayers& players) {
+    std::vector<std::uint8_t> out;
+    legacy::encoder e(out);
+    e.put(static_cast<std::uint8_t>(players.players.size()));
+    for (const auto& player : players.players) {
+        e.put(player.id);
+        e.put(player.name.str());
+        e.put(player.score);
+        e.put(player.time);
+    }
+    return out;
+}
+
+// rules from their wire form, the values as a server sends them
+static std::vector<std::uint8_t> legacy_encode(const std::vector<std::pair<std::string, std::string>>& rules) {
+    std::vector<std::uint8_t> out;
+    legacy::encoder e(out);
+    e.put(static_cast<std::uint16_t>(rules.size()));
+    for (const auto& rule : rules) {
+        e.put(rule.first);
+        e.put(rule.second);
+    }
+    return out;
+}
+
+static bool same_value(const kfc::kfrule::variant_t& a, const kfc::kfrule::variant_t& b) {
+    if (a.index() != b.index())
+        return false;
+
+    // bitwise, so that nan equals nan
+    if (const auto* d = std::get_if<double>(&a))
+        return std::memcmp(d, &std::get<double>(b), sizeof(double)) == 0;
+    return a == b;
+}
+
+static bool same(const kfc::kfdetails& parsed, const legacy::details& old) {
+    return parsed.protocol == old.protocol && parsed.hostname.str() == old.hostname && parsed.map.str() == old.map
+        && parsed.game_dir.str() == old.game_dir && parsed.game_description.str() == old.game_description
+        && parsed.steam_app_id == old.steam_app_id && parsed.player_count == old.player_count && parsed.player_cap == old.player_cap
+        && parsed.unknown1 == old.unknown1 && parsed.unknown2 == old.unknown2 && parsed.operating_system == old.operating_system
+        && parsed.password_set == old.password_set && parsed.unknown3 == old.unknown3 && parsed.version == old.version
+        && parsed.unknown4 == old.unknown4 && parsed.unknown5 == old.unknown5 && parsed.unknown6 == old.unknown6
+        && parsed.additional_string == old.additional_string;
+}
+
+static bool same(const kfc::kfrules& parsed, const legacy::rules& old) {
+    if (parsed.count != old.count || parsed.rules.size() != old.list.size())
+        return false;
+
+    for (std::size_t i = 0; i < parsed.rules.size(); ++i) {
+        if (parsed.rules[i].name != old.list[i].name || !same_value(parsed.rules[i].value, old.list[i].value))
+            return false;
+    }
+
+    return true;
+}
+
+static bool same(const kfc::kfplayers& parsed, const legacy::players& old) {
+    if (parsed.count != old.count || parsed.players.size() != old.list.size())
+        return false;
+
+    for (std::size_t i = 0; i < parsed.players.size(); ++i) {
+        const auto& p = parsed.players[i];
+        const auto& o = old.list[i];
+        if (p.id != o.id || p.name.str() != o.name || p.score != o.score || p.time != o.time)
+            return false;
+    }
+
+    return true;
+}
+
+// Parses the bytes both ways, followed by some bytes of another packet; both must agree on the
+// fields and on where they stopped, or both must throw a range_error. True when they parsed.
+template <typename Parsed, typename Legacy>
+static bool check_parse(std::vector<std::uint8_t> bytes, std::size_t trailing = 0) {
+    auto size = bytes.size();
+    bytes.resize(size + trailing, 0xAB);
+
+    bool parsed_threw = false;
+    bool legacy_threw = false;
+    std::size_t parsed_end = 0;
+    std::size_t legacy_end = 0;
+    std::unique_ptr<Parsed> parsed;
+    std::unique_ptr<Legacy> old;
+
+    try {
+        kfc::kfbuffer buff(bytes.data(), bytes.size());
+        parsed = std::make_unique<Parsed>(buff);
+        parsed_end = buff.tell();
+    } catch (const std::range_error&) {
+        parsed_threw = true;
+    }
+
+    try {
+        kfc::kfbuffer buff(bytes.data(), bytes.size());
+        old = std::make_unique<Legacy>(buff);
+        legacy_end = buff.tell();
+    } catch (const std::range_error&) {
+        legacy_threw = true;
+    }
+
+    KFTEST_CHECK(parsed_threw == legacy_threw);
+    if (parsed_threw || legacy_threw)
+        return false;
+
+    KFTEST_CHECK(same(*parsed, *old));
+    KFTEST_CHECK(parsed_end == legacy_end && parsed_end == size);
+    return true;
+}
+
+// every packet cut short throws where the old parser threw
+template <typename Parsed, typename Legacy>
+static void check_truncations(const std::vector<std::uint8_t>& bytes) {
+    for (std::size_t size = 0; size < bytes.size(); ++size)
+        KFTEST_CHECK((!check_parse<Parsed, Legacy>(std::vector<std::uint8_t>(bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(size)))));
+}
+
+static void check_details() {
+    for (int i = 0; i < 200; ++i) {
+        auto details = random_details();
+        auto bytes = legacy_encode(details);
+
+        kfc::schema::writer written;
+        kfc::schema::serialize(details, written);
+        KFTEST_CHECK(written == bytes);
+
+        KFTEST_CHECK((check_parse<kfc::kfdetails, legacy::details>(bytes)));
+        KFTEST_CHECK((check_parse<kfc::kfdetails, legacy::details>(bytes, 7)));
+        if (i < 10)
+            check_truncations<kfc::kfdetails, legacy::details>(bytes);
+    }
+}
+
+static void check_players() {
+    for (int i = 0; i < 100; ++i) {
+        kfc::kfplayers players;
+        for (std::size_t p = generator() % 12; p > 0; --p) {
+            kfc::kfplayer player;
+            player.id = static_cast<std::uint8_t>(generator());
+            player.name = kfc::kfstring(random_string(40));
+            player.score = generator();
+            player.time = generator();
+            players.players.push_back(player);
+        }
+
+        auto bytes = legacy_encode(players);
+
+        kfc::schema::writer written;
+        kfc::schema::serialize(players, written);
+        KFTEST_CHECK(written == bytes);
+
+        KFTEST_CHECK((check_parse<kfc::kfplayers, legacy::players>(bytes)));
+        KFTEST_CHECK((check_parse<kfc::kfplayers, legacy::players>(bytes, 3)));
+        if (i < 10)
+            check_truncations<kfc::kfplayers, legacy::players>(bytes);
+    }
+
+    // a count of more players than the packet holds
+    KFTEST_CHECK((!check_parse<kfc::kfplayers, legacy::players>({ 2, 1, 'a', 0, 1, 0, 0, 0, 2, 0, 0, 0 })));
+}
+
+static void check_rules() {
+    // written as the servers, and the simulator before the schema, write them
+    const std::vector<std::string> canonical = {
+        "True", "False", "", "KF-BurningParis", "0", "1", "-3", "10", "60", "1000", "7200", "0.5", "1.5", "0.1", "123.456",
+        "0.0001", "1e-05", "2.5e-07", "1000000000000000", "1e+16", "0.3333333333333333", "-0", "inf", "-inf", "nan"
+    };
+
+    // decoded as the old parser did, but not written back the same way
+    const std::vector<std::string> other = {
+        "true", "TRUE", "False ", " 7", "12abc", "1e999", "-1e999", "0x1A", "1.50", "+5", ".5", "5.", "1E3", "Infinity", "NAN", "-"
+    };
+
+    std::vector<std::pair<std::string, std::string>> wire;
+    for (const auto& value : canonical)
+        wire.emplace_back(random_string(20), value);
+
+    auto bytes = legacy_encode(wire);
+    KFTEST_CHECK((check_parse<kfc::kfrules, legacy::rules>(bytes)));
+    KFTEST_CHECK((check_parse<kfc::kfrules, legacy::rules>(bytes, 5)));
+    check_truncations<kfc::kfrules, legacy::rules>(bytes);
+
+    kfc::kfbuffer buff(bytes.data(), bytes.size());
+    kfc::kfrules rules(buff);
+    kfc::schema::writer written;
+    kfc::schema::serialize(rules, written);
+    KFTEST_CHECK(written == bytes);
+
+    for (const auto& value : other) {
+        auto single = legacy_encode({ { "rule", value } });
+        KFTEST_CHECK((check_parse<kfc::kfrules, legacy::rules>(single)));
+    }
+}
+
+// the parse checks the minimum size of a layout before it reads a single field
+static void check_minimum_sizes() {
+    KFTEST_CHECK(kfc::schema::min_size<kfc::kfdetails> == 31);
+    KFTEST_CHECK(kfc::schema::min_size<kfc::kfplayer> == 10);
+    KFTEST_CHECK(kfc::schema::min_size<kfc::kfplayers> == 1);
+    KFTEST_CHECK(kfc::schema::min_size<kfc::kfrule> == 2);
+    KFTEST_CHECK(kfc::schema::min_size<kfc::kfrules> == 2);
+
+    // the smallest details, every string empty, and one byte less
+    std::vector<std::uint8_t> smallest(31, 0);
+    KFTEST_CHECK((check_parse<kfc::kfdetails, legacy::details>(smallest)));
+    smallest.pop_back();
+
+    bool rejected = false;
+    try {
+        kfc::kfbuffer buff(smallest.data(), smallest.size());
+        kfc::kfdetails details(buff);
+    } catch (const std::range_error& ex) {
+        rejected = std::string(ex.what()) == "response is shorter than its minimum size";
+    }
+
+    KFTEST_CHECK(rejected);
+}
+
+// a count from the wire reserves no more elements than the rest of the packet can hold
+static void check_claimed_count() {
+    // 65535 rules claimed, one empty rule sent
+    std::vector<std::uint8_t> bytes = { 0xFF, 0xFF, 0x00, 0x00 };
+    kfc::kfrules rules;
+
+    bool rejected = false;
+    try {
+        kfc::kfbuffer buff(bytes.data(), bytes.size());
+        kfc::schema::parse(buff, rules);
+    } catch (const std::range_error&) {
+        rejected = true;
+    }
+
+    KFTEST_CHECK(rejected);
+    KFTEST_CHECK(rules.rules.capacity() <= 2);
+}
+
+// version is four bytes whatever they hold, NULs included
+static void check_fixed_version() {
+    auto details = random_details();
+
+    for (const auto& version : { std::string("1046"), std::string("10\0\0", 4), std::string("\0\0\0\0", 4), std::string("\xFF\x01\x02\x03") }) {
+        details.version = version;
+        auto bytes = legacy_encode(details);
+        KFTEST_CHECK((check_parse<kfc::kfdetails, legacy::details>(bytes)));
+
+        kfc::kfbuffer buff(bytes.data(), bytes.size());
+        kfc::kfdetails parsed(buff);
+        KFTEST_CHECK(parsed.version == version && parsed.version.size() == 4);
+    }
+
+    // shorter versions are padded with NULs and longer ones cut when serialized
+    details.version = "12";
+    kfc::schema::writer written;
+    kfc::schema::serialize(details, written);
+    kfc::kfbuffer padded(written.data(), written.size());
+    KFTEST_CHECK(kfc::kfdetails(padded).version == std::string("12\0\0", 4));
+
+    details.version = "123456";
+    written.clear();
+    kfc::schema::serialize(details, written);
+    kfc::kfbuffer cut(written.data(), written.size());
+    KFTEST_CHECK(kfc::kfdetails(cut).version == "1234");
+}
+
+// a string's NUL is only searched for in the bytes the fields after it leave, so a NUL that is
+// there but inside those bytes does not end it
+static void check_nul_search_limit() {
+    using name_field = kfc::schema::detail::field<kfc::schema::string<&kfc::kfplayer::name>>;
+    using value_field = kfc::schema::detail::field<kfc::schema::text<&kfc::kfrule::value, kfc::kfrule_value>>;
+
+    const std::uint8_t bytes[] = { 'a', 'b', 'c', 0, 1, 2, 3, 4 };
+
+    for (std::size_t tail = 0; tail <= 5; ++tail) {
+        kfc::kfplayer player;
+        kfc::schema::reader r { bytes, bytes + sizeof(bytes), nullptr, kfc::utf8::policy::keep };
+
+        bool found = true;
+        try {
+            name_field::read(r, player, tail);
+        } catch (const std::range_error&) {
+            found = false;
+        }
+
+        KFTEST_CHECK(found == (tail <= 4));
+        if (found)
+            KFTEST_CHECK(player.name.str() == "abc" && r.pos == bytes + 4);
+
+        kfc::kfrule rule;
+        kfc::schema::reader v { bytes, bytes + sizeof(bytes), nullptr, kfc::utf8::policy::keep };
+        found = true;
+        try {
+            value_field::read(v, rule, tail);
+        } catch (const std::range_error&) {
+            found = false;
+        }
+
+        KFTEST_CHECK(found == (tail <= 4));
+    }
+
+    // a player whose only NUL lies in the bytes of its score
+    KFTEST_CHECK((!check_parse<kfc::kfplayers, legacy::players>({ 1, 7, 'a', 'b', 1, 0, 1, 1, 1, 1, 1, 1 })));
+}
+
+int main() {
+    try {
+        check_details();
+        check_players();
+        check_rules();
+        check_minimum_sizes();
+        check_claimed_count();
+        check_fixed_version();
+        check_nul_search_limit();
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
\ No newline at end of file
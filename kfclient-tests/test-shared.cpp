@@ -0,0 +1,227 @@
+#include "kftest.hpp"
+
+#include <kfshared.hpp>
+
+#include <atomic>
+#include <memory>
+
+// Shares one kfshared_client between 8 threads making 50 requests each: concurrent requests for a
+// section must join one round trip, requests for different sections must each get their own
+// response, and results a thread holds must outlive the requests of the others. A request that
+// times out waiting for a slow challenge must not take it away from a request that started later,
+// and the challenge that is asked for again after a timeout must not send the requests that are
+// still in flight a second time.
+
+static const std::uint16_t JOIN_PORT = 47670;
+static const std::uint16_t MIXED_PORT = 47671;
+static const std::size_t THREADS = 8;
+static const std::size_t ITERATIONS = 50;
+static const std::size_t RULES = 40;
+static const std::size_t PLAYERS = 6;
+static const auto TIMEOUT = std::chrono::milliseconds(300);
+static const auto CHALLENGE_DELAY = std::chrono::milliseconds(400);
+static const auto STAGGER = std::chrono::milliseconds(200);
+
+// every thread on the same section, returns the number of requests that were made
+static std::size_t request_details(std::uint16_t port) {
+    kfc::kfshared_client client("127.0.0.1", port, std::chrono::seconds(2));
+    std::atomic<std::size_t> answered { 0 };
+    std::atomic<std::size_t> failed { 0 };
+    std::vector<std::thread> threads;
+
+    for (std::size_t t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&client, &answered, &failed]() {
+            for (std::size_t i = 0; i < ITERATIONS; ++i) {
+                try {
+                    auto details = client.request_details();
+                    if (details != nullptr && details->hostname == "kfserver-sim #0")
+                        ++answered;
+                    else
+                        ++failed;
+                } catch (const std::exception&) {
+                    ++failed;
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    KFTEST_CHECK(failed == 0);
+    KFTEST_CHECK(answered == THREADS * ITERATIONS);
+    return answered + failed;
+}
+
+// every thread cycles through the sections, starting at a different one
+static void request_mixed(std::uint16_t port) {
+    kfc::kfshared_client client("127.0.0.1", port, std::chrono::seconds(2));
+    std::atomic<std::size_t> wrong { 0 };
+    std::vector<std::thread> threads;
+
+    for (std::size_t t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&client, &wrong, t]() {
+            std::shared_ptr<const kfc::kfdetails> first;
+
+            for (std::size_t i = 0; i < ITERATIONS; ++i) {
+                try {
+                    switch ((t + i) % 3) {
+                    case 0: {
+                        auto details = client.request_details();
+                        if (details == nullptr || details->hostname != "kfserver-sim #0" || details->player_count != PLAYERS)
+                            ++wrong;
+                        if (first == nullptr)
+                            first = details;
+                        break;
+                    }
+                    case 1: {
+                        auto rules = client.request_rules();
+                        if (rules == nullptr || rules->rules.size() != RULES || rules->rules.back().name != "SimRule039")
+                            ++wrong;
+                        break;
+                    }
+                    default: {
+                        auto players = client.request_players();
+                        if (players == nullptr || players->players.size() != PLAYERS || players->players.front().name != "Player 1")
+                            ++wrong;
+                        break;
+                    }
+                    }
+                } catch (const std::exception&) {
+                    ++wrong;
+                }
+            }
+
+            // still intact after all the requests made since
+            if (first == nullptr || first->hostname != "kfserver-sim #0")
+                ++wrong;
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    KFTEST_CHECK(wrong == 0);
+}
+
+// the challenge answer arrives after the deadline of the first request, but within that of the
+// second, which started while the first was still waiting for it
+static void request_staggered(std::uint16_t port) {
+    kftest::relay relay(port, kfc::protocol::PACKET_CHALLENGE, CHALLENGE_DELAY);
+    kfc::kfshared_client client("127.0.0.1", relay.port(), TIMEOUT);
+
+    auto details = client.async_details();
+    std::this_thread::sleep_for(STAGGER);
+    auto players = client.async_players();
+
+    auto timed_out = false;
+    try {
+        details.get();
+    } catch (const kfc::timeout_error&) {
+        timed_out = true;
+    }
+    KFTEST_CHECK(timed_out);
+
+    std::shared_ptr<const kfc::kfplayers> result;
+    try {
+        result = players.get();
+    } catch (const std::exception& ex) {
+        std::cerr << "players: " << ex.what() << "\n";
+    }
+    KFTEST_CHECK(result != nullptr && result->players.size() == PLAYERS);
+
+    // and the challenge is known from then on
+    KFTEST_CHECK(client.request_details()->hostname == "kfserver-sim #0");
+}
+
+// Players time out, which makes the client ask for the challenge again for the rules that start
+// after; the details request went out before and is still waiting for its slow answer then.
+static void request_in_flight(std::uint16_t port) {
+    const auto timeout = std::chrono::milliseconds(1000);
+    std::atomic<std::size_t> details_answers { 0 };
+    kftest::relay relay(port, [&details_answers](const std::uint8_t* data, std::size_t size) {
+        if (size <= 4)
+            return std::chrono::milliseconds(0);
+        if (static_cast<std::int8_t>(data[4]) == kfc::protocol::PACKET_PLAYERS)
+            return std::chrono::milliseconds(1500);
+        if (static_cast<std::int8_t>(data[4]) == kfc::protocol::PACKET_DETAILS) {
+            ++details_answers;
+            return std::chrono::milliseconds(700);
+        }
+        return std::chrono::milliseconds(0);
+    });
+
+    kfc::kfshared_client client("127.0.0.1", relay.port(), timeout);
+    auto started = std::chrono::steady_clock::now();
+
+    auto players = client.async_players();
+    std::this_thread::sleep_until(started + std::chrono::milliseconds(600));
+    auto details = client.async_details();
+    std::this_thread::sleep_until(started + timeout + std::chrono::milliseconds(100));
+    auto rules = client.async_rules();
+
+    auto timed_out = false;
+    try {
+        players.get();
+    } catch (const kfc::timeout_error&) {
+        timed_out = true;
+    }
+    KFTEST_CHECK(timed_out);
+
+    try {
+        KFTEST_CHECK(details.get()->hostname == "kfserver-sim #0");
+        KFTEST_CHECK(rules.get()->rules.size() == RULES);
+    } catch (const std::exception& ex) {
+        std::cerr << "details or rules: " << ex.what() << "\n";
+        ++kftest::failures();
+    }
+
+    // a second details request would have been answered by now
+    std::this_thread::sleep_for(std::chrono::milliseconds(900));
+    KFTEST_CHECK(details_answers == 1);
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " path-to-kfserver-sim\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        // the latency keeps requests of several threads in flight at once
+        std::vector<std::string> options = {
+            "-n", "1", "--players", std::to_string(PLAYERS), "--rules", std::to_string(RULES), "--split", "300", "--latency", "20"
+        };
+
+        {
+            auto arguments = options;
+            arguments.insert(arguments.end(), { "-p", std::to_string(JOIN_PORT) });
+            kftest::process sim(argv[1], arguments);
+            if (!KFTEST_CHECK(kftest::wait_for_server(JOIN_PORT)))
+                return kftest::result();
+
+            auto requested = request_details(JOIN_PORT);
+
+            // one of them was made by wait_for_server
+            auto answered = kftest::printed_count(sim.stop(), "details") - 1;
+            std::cout << requested << " details requests of " << THREADS << " threads took " << answered << " round trips\n";
+            KFTEST_CHECK(answered > 0);
+            KFTEST_CHECK(answered < requested);
+        }
+
+        auto arguments = options;
+        arguments.insert(arguments.end(), { "-p", std::to_string(MIXED_PORT) });
+        kftest::process sim(argv[1], arguments);
+        if (!KFTEST_CHECK(kftest::wait_for_server(MIXED_PORT)))
+            return kftest::result();
+
+        request_mixed(MIXED_PORT);
+        request_staggered(MIXED_PORT);
+        request_in_flight(MIXED_PORT);
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
\ No newline at end of file
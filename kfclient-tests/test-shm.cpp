@@ -0,0 +1,186 @@
+#include "kftest.hpp"
+
+#include <kfshm.hpp>
+#include <kfutf8.hpp>
+
+#include <atomic>
+
+// Publishes snapshots of two servers while readers copy them out of the region: every snapshot a
+// reader sees must be one the publisher wrote as a whole, never a mix of two. A second publisher
+// must not take over a region that exists, unless it is asked to replace one left behind.
+
+static const std::uint64_t SNAPSHOTS = 20000;
+static const std::size_t READERS = 2;
+
+// a snapshot whose every field follows from its timestamp, so a torn read does not add up
+static kfc::kfsnapshot make_snapshot(std::uint64_t i) {
+    kfc::kfsnapshot snapshot;
+    snapshot.timestamp = i;
+    snapshot.flags = kfc::kfsnapshot::HAS_DETAILS | kfc::kfsnapshot::HAS_PLAYERS;
+    snapshot.hostname.assign("server " + std::to_string(i));
+    snapshot.waves_current = static_cast<std::int32_t>(i);
+    snapshot.player_list_count = static_cast<std::uint8_t>(i % kfc::kfsnapshot::MAX_PLAYERS);
+
+    for (std::size_t p = 0; p < snapshot.player_list_count; ++p) {
+        snapshot.player_list.at(p).score = static_cast<std::uint32_t>(i);
+        snapshot.player_list.at(p).name.assign("player " + std::to_string(i));
+    }
+
+    return snapshot;
+}
+
+static bool consistent(const kfc::kfsnapshot& snapshot) {
+    auto i = snapshot.timestamp;
+    if (snapshot.hostname.str() != "server " + std::to_string(i) || snapshot.waves_current != static_cast<std::int32_t>(i))
+        return false;
+    if (snapshot.player_list_count != i % kfc::kfsnapshot::MAX_PLAYERS)
+        return false;
+
+    for (std::size_t p = 0; p < snapshot.player_list_count; ++p) {
+        if (snapshot.player_list.at(p).score != i || snapshot.player_list.at(p).name.str() != "player " + std::to_string(i))
+            return false;
+    }
+
+    return true;
+}
+
+static void publish_and_read(const std::string& name) {
+    kfc::kfshm_publisher publisher(name, 2);
+    publisher.publish("127.0.0.1", 27015, make_snapshot(0));
+    publisher.publish("127.0.0.1", 27016, make_snapshot(0));
+
+    std::atomic<bool> done { false };
+    std::atomic<std::size_t> torn { 0 };
+    std::atomic<std::size_t> backwards { 0 };
+    std::atomic<std::size_t> reads { 0 };
+    std::vector<std::thread> readers;
+
+    for (std::size_t r = 0; r < READERS; ++r) {
+        readers.emplace_back([&]() {
+            kfc::kfshm_reader reader(name);
+            kfc::kfsnapshot snapshot;
+            std::uint64_t last = 0;
+
+            while (!done.load()) {
+                if (!reader.read("127.0.0.1", 27015, snapshot))
+                    continue;
+
+                ++reads;
+                if (!consistent(snapshot))
+                    ++torn;
+                if (snapshot.timestamp < last)
+                    ++backwards;
+                last = snapshot.timestamp;
+            }
+        });
+    }
+
+    for (std::uint64_t i = 1; i <= SNAPSHOTS; ++i) {
+        publisher.publish("127.0.0.1", 27015, make_snapshot(i));
+        publisher.publish("127.0.0.1", 27016, make_snapshot(SNAPSHOTS - i));
+    }
+
+    done.store(true);
+    for (auto& reader : readers)
+        reader.join();
+
+    KFTEST_CHECK(reads.load() > 0);
+    KFTEST_CHECK(torn.load() == 0);
+    KFTEST_CHECK(backwards.load() == 0);
+
+    kfc::kfshm_reader reader(name);
+    KFTEST_CHECK(reader.size() == 2);
+
+    std::string host;
+    std::uint16_t port = 0;
+    kfc::kfsnapshot snapshot;
+    reader.read(1, host, port, snapshot);
+    KFTEST_CHECK(host == "127.0.0.1" && port == 27016);
+    KFTEST_CHECK(snapshot.timestamp == 0 && consistent(snapshot));
+    KFTEST_CHECK(reader.read("127.0.0.1", 27015, snapshot) && snapshot.timestamp == SNAPSHOTS);
+    KFTEST_CHECK(!reader.read("127.0.0.1", 27017, snapshot));
+
+    // the region holds two servers
+    bool full = false;
+    try {
+        publisher.publish("127.0.0.1", 27017, make_snapshot(0));
+    } catch (const std::length_error&) {
+        full = true;
+    }
+    KFTEST_CHECK(full);
+
+    // a second publisher must leave the region of the first alone
+    bool refused = false;
+    try {
+        kfc::kfshm_publisher second(name, 8);
+    } catch (const std::runtime_error&) {
+        refused = true;
+    }
+    KFTEST_CHECK(refused);
+    KFTEST_CHECK(kfc::kfshm_reader(name).size() == 2);
+}
+
+static void replace_left_behind(const std::string& name) {
+    using namespace boost::interprocess;
+
+    // a region of a publisher that was killed
+    shared_memory_object left(create_only, name.c_str(), read_write);
+    left.truncate(64);
+
+    bool refused = false;
+    try {
+        kfc::kfshm_publisher publisher(name, 1);
+    } catch (const std::runtime_error&) {
+        refused = true;
+    }
+    KFTEST_CHECK(refused);
+
+    {
+        kfc::kfshm_publisher publisher(name, 1, true);
+        publisher.publish("127.0.0.1", 27015, make_snapshot(7));
+
+        kfc::kfsnapshot snapshot;
+        KFTEST_CHECK(kfc::kfshm_reader(name).read("127.0.0.1", 27015, snapshot) && snapshot.timestamp == 7);
+    }
+
+    // and the publisher removed it when it was done
+    bool removed = false;
+    try {
+        kfc::kfshm_reader reader(name);
+    } catch (const std::exception&) {
+        removed = true;
+    }
+    KFTEST_CHECK(removed);
+}
+
+static void truncate_utf8() {
+    // "é" is two bytes, the first ones that do not fit are cut at its lead byte, not within it
+    kfc::kfflat_string<4> flat;
+    flat.assign("abc\xC3\xA9");
+    KFTEST_CHECK(flat.str() == "abc");
+    flat.assign("ab\xC3\xA9z");
+    KFTEST_CHECK(flat.str() == "ab\xC3\xA9");
+
+    // a four byte sequence right at the end is left out as a whole
+    flat.assign("a\xF0\x9F\x98\x80");
+    KFTEST_CHECK(flat.str() == "a");
+
+    kfc::kfsnapshot snapshot;
+    snapshot.hostname.assign(std::string(126, 'h') + "\xE2\x82\xAC");
+    KFTEST_CHECK(snapshot.hostname.str() == std::string(126, 'h'));
+    KFTEST_CHECK(kfc::utf8::clean(snapshot.hostname.data.data(), snapshot.hostname.length));
+}
+
+int main() {
+    try {
+        truncate_utf8();
+        auto name = boost::filesystem::unique_path("kftest-shm-%%%%-%%%%").string();
+        publish_and_read(name);
+        replace_left_behind(name);
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
@@ -0,0 +1,132 @@
+#include "kftest.hpp"
+
+#include <kfstring.hpp>
+#include <kfquery.hpp>
+#include <kfuring.hpp>
+
+#include <map>
+
+// Queries kfserver-sim with long names, 250 rules and responses split into small datagrams that
+// are delayed and reordered, through the blocking client and through kfbatch on both engines.
+
+static const std::uint16_t FIRST_PORT = 47610;
+static const std::size_t SERVERS = 4;
+static const std::size_t PLAYERS = 24;
+static const std::size_t SLOTS = 32;
+static const std::size_t RULES = 250;
+static const std::size_t NAME_LENGTH = 48;
+
+static bool starts_with(const std::string& value, const std::string& prefix) {
+    return value.compare(0, prefix.size(), prefix) == 0;
+}
+
+static void check_details(const kfc::kfdetails& details, std::size_t index) {
+    KFTEST_CHECK(starts_with(details.hostname.str(), "kfserver-sim #" + std::to_string(index)));
+    KFTEST_CHECK(details.hostname.size() == NAME_LENGTH);
+    KFTEST_CHECK(details.game_description == "Killing Floor 2");
+    KFTEST_CHECK(details.player_count == PLAYERS);
+    KFTEST_CHECK(details.player_cap == SLOTS);
+    KFTEST_CHECK(details.waves_total == 10);
+    KFTEST_CHECK(details.additional.count("d") == 1);
+}
+
+static void check_rules(const kfc::kfrules& rules) {
+    KFTEST_CHECK(rules.count == RULES);
+    if (!KFTEST_CHECK(rules.rules.size() == RULES))
+        return;
+
+    // the sim cycles through booleans, numbers and strings
+    KFTEST_CHECK(rules.rules.at(0).name == "SimRule000");
+    KFTEST_CHECK(std::get<bool>(rules.rules.at(0).value));
+    KFTEST_CHECK(std::get<double>(rules.rules.at(1).value) == 0.5);
+    KFTEST_CHECK(std::get<std::string>(rules.rules.at(2).value) == "value 2");
+    KFTEST_CHECK(rules.rules.at(249).name == "SimRule249");
+    KFTEST_CHECK(!std::get<bool>(rules.rules.at(249).value));
+}
+
+static void check_players(const kfc::kfplayers& players) {
+    KFTEST_CHECK(players.count == PLAYERS);
+    if (!KFTEST_CHECK(players.players.size() == PLAYERS))
+        return;
+
+    for (std::size_t i = 0; i < PLAYERS; ++i) {
+        const auto& player = players.players.at(i);
+        KFTEST_CHECK(starts_with(player.name.str(), "Player " + std::to_string(i + 1)));
+        KFTEST_CHECK(player.name.size() == NAME_LENGTH);
+        KFTEST_CHECK(player.score == i * 100);
+    }
+}
+
+static void query_client() {
+    boost::asio::io_context context;
+    boost::asio::ip::udp::resolver resolver(context);
+    kfc::kfclient client(context, resolver.resolve(boost::asio::ip::udp::v4(), "127.0.0.1", std::to_string(FIRST_PORT + 1)));
+    client.timeout(std::chrono::seconds(2));
+
+    // twice, the second time on the challenge of the first
+    for (int i = 0; i < 2; ++i) {
+        check_details(client.request_details(), 1);
+        check_rules(client.request_rules());
+        check_players(client.request_players());
+    }
+}
+
+static void query_batch(kfc::kfengine engine) {
+    kfc::kfinterner interner;
+    kfc::kfbatch batch(SERVERS, std::chrono::seconds(2), kfc::SECTION_DETAILS | kfc::SECTION_RULES | kfc::SECTION_PLAYERS);
+    batch.interner(&interner);
+    batch.engine(engine);
+
+    for (std::size_t i = 0; i < SERVERS; ++i)
+        batch.add_target("127.0.0.1", static_cast<std::uint16_t>(FIRST_PORT + i));
+
+    std::map<std::uint16_t, bool> answered;
+    batch.run([&answered](const std::string&, std::uint16_t port, kfc::kfquery_result& result) {
+        if (!KFTEST_CHECK(result.error.empty())) {
+            std::cerr << "127.0.0.1:" << port << ": " << result.error << "\n";
+            return;
+        }
+
+        answered[port] = true;
+        if (KFTEST_CHECK(result.details != nullptr))
+            check_details(*result.details, port - FIRST_PORT);
+        if (KFTEST_CHECK(result.rules != nullptr))
+            check_rules(*result.rules);
+        if (KFTEST_CHECK(result.players != nullptr))
+            check_players(*result.players);
+    });
+
+    KFTEST_CHECK(answered.size() == SERVERS);
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " path-to-kfserver-sim\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        kftest::process sim(argv[1], {
+            "-p", std::to_string(FIRST_PORT), "-n", std::to_string(SERVERS),
+            "--players", std::to_string(PLAYERS), "--slots", std::to_string(SLOTS), "--rules", std::to_string(RULES),
+            "--name-length", std::to_string(NAME_LENGTH), "--split", "500",
+            "--latency", "2", "--jitter", "3", "--reorder", "25"
+        });
+
+        if (!KFTEST_CHECK(kftest::wait_for_server(FIRST_PORT)))
+            return kftest::result();
+
+        query_client();
+        query_batch(kfc::kfengine::asio);
+
+        if (kfc::kfuring_batch::available())
+            query_batch(kfc::kfengine::io_uring);
+        else
+            std::cout << "io_uring is not available, its batch was skipped\n";
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "kftest.hpp"
+
+// A timed receive on a server that never answers must time out without running the handlers of
+// the io_context the client was given, and leave that context usable afterwards.
+
+int main() {
+    try {
+        boost::asio::io_context context;
+
+        // a socket that receives the requests and never answers them
+        boost::asio::ip::udp::socket silent(context, boost::asio::ip::udp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0));
+        boost::asio::ip::udp::resolver resolver(context);
+        kfc::kfclient client(context, resolver.resolve(boost::asio::ip::udp::v4(), "127.0.0.1", std::to_string(silent.local_endpoint().port())));
+        client.timeout(std::chrono::milliseconds(200));
+
+        bool ran = false;
+        boost::asio::post(context, [&ran]() { ran = true; });
+
+        bool timed_out = false;
+        auto start = std::chrono::steady_clock::now();
+        try {
+            client.request_details();
+        } catch (const kfc::timeout_error&) {
+            timed_out = true;
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        KFTEST_CHECK(timed_out);
+        KFTEST_CHECK(elapsed >= std::chrono::milliseconds(200));
+        KFTEST_CHECK(elapsed < std::chrono::seconds(5));
+        KFTEST_CHECK(!ran);
+        KFTEST_CHECK(silent.available() > 0);
+
+        // the handler is still the caller's to run
+        context.run();
+        KFTEST_CHECK(ran);
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "kftest.hpp"
+
+#include <kfplayers.hpp>
+#include <kfutf8.hpp>
+
+// Checks utf8::scan and utf8::sanitize on valid and invalid sequences, at every offset around the
+// sixteen byte blocks of the SSE2 path, and the policy a parse is given.
+
+static const std::string REPLACEMENT = "\xEF\xBF\xBD";
+
+struct scanned {
+    std::size_t length;
+    bool clean;
+    bool found;
+};
+
+// scans the text followed by a NUL, and as much padding as the limit allows
+static scanned scan(const std::string& text, bool terminate = true) {
+    std::vector<std::uint8_t> bytes(text.begin(), text.end());
+    if (terminate)
+        bytes.push_back(0);
+
+    try {
+        auto result = kfc::utf8::scan(bytes.data(), bytes.size());
+        return { result.length, result.clean, true };
+    } catch (const std::range_error&) {
+        return { 0, false, false };
+    }
+}
+
+static std::string sanitize(const std::string& text) {
+    std::string out;
+    kfc::utf8::sanitize(text.data(), text.size(), out);
+    return out;
+}
+
+// a string that must pass through unchanged
+static void check_clean(const std::string& text) {
+    auto result = scan(text);
+    KFTEST_CHECK(result.found && result.length == text.size() && result.clean);
+    KFTEST_CHECK(kfc::utf8::clean(text.data(), text.size()));
+    KFTEST_CHECK(sanitize(text) == text);
+}
+
+// a string that is not clean, which sanitize must turn into expected
+static void check_dirty(const std::string& text, const std::string& expected) {
+    auto result = scan(text);
+    KFTEST_CHECK(result.found && result.length == text.size() && !result.clean);
+    KFTEST_CHECK(!kfc::utf8::clean(text.data(), text.size()));
+    KFTEST_CHECK(sanitize(text) == expected);
+    KFTEST_CHECK(kfc::utf8::clean(expected.data(), expected.size()));
+}
+
+static void check_sequences() {
+    check_clean("");
+    check_clean("KF-BurningParis");
+    check_clean("caf\xC3\xA9");                   // U+00E9
+    check_clean("\xE2\x82\xAC 5");                // U+20AC
+    check_clean("\xED\x9F\xBF");                  // U+D7FF, the last code point before the surrogates
+    check_clean("\xEE\x80\x80");                  // U+E000, the first one after them
+    check_clean("\xF0\x9F\x98\x80");              // U+1F600
+    check_clean("\xF4\x8F\xBF\xBF");              // U+10FFFF
+
+    // overlong forms
+    check_dirty("\xC0\xAF", REPLACEMENT + REPLACEMENT);
+    check_dirty("\xC1\xBF", REPLACEMENT + REPLACEMENT);
+    check_dirty("a\xE0\x80\xAF", "a" + REPLACEMENT + REPLACEMENT + REPLACEMENT);
+    check_dirty("\xF0\x80\x80\xAF", REPLACEMENT + REPLACEMENT + REPLACEMENT + REPLACEMENT);
+
+    // surrogates
+    check_dirty("\xED\xA0\x80", REPLACEMENT + REPLACEMENT + REPLACEMENT);
+    check_dirty("\xED\xBF\xBF", REPLACEMENT + REPLACEMENT + REPLACEMENT);
+
+    // above U+10FFFF
+    check_dirty("\xF4\x90\x80\x80", REPLACEMENT + REPLACEMENT + REPLACEMENT + REPLACEMENT);
+    check_dirty("\xF5\x80\x80\x80", REPLACEMENT + REPLACEMENT + REPLACEMENT + REPLACEMENT);
+    check_dirty("\xFF", REPLACEMENT);
+
+    // stray continuation bytes and truncated sequences
+    check_dirty("\x80x", REPLACEMENT + "x");
+    check_dirty("\xC3", REPLACEMENT);
+    check_dirty("\xE2\x82x", REPLACEMENT + REPLACEMENT + "x");
+
+    // C0 control characters and DEL
+    check_dirty("a\tb", "a" + REPLACEMENT + "b");
+    check_dirty("\x1B[31mred", REPLACEMENT + "[31mred");
+    check_dirty("\x7F", REPLACEMENT);
+    check_dirty(std::string(1, '\x01'), REPLACEMENT);
+}
+
+// every sequence at every offset across two blocks, so it is cut at a block boundary at least once
+static void check_block_boundaries() {
+    const std::vector<std::pair<std::string, std::string>> sequences = {
+        { "\xC3\xA9", "\xC3\xA9" },
+        { "\xE2\x82\xAC", "\xE2\x82\xAC" },
+        { "\xF0\x9F\x98\x80", "\xF0\x9F\x98\x80" },
+        { "\xED\xA0\x80", REPLACEMENT + REPLACEMENT + REPLACEMENT },
+        { "\xC0\xAF", REPLACEMENT + REPLACEMENT },
+        { "\x7F", REPLACEMENT },
+        { "\x1F", REPLACEMENT }
+    };
+
+    for (const auto& sequence : sequences) {
+        for (std::size_t offset = 0; offset < 32; ++offset) {
+            for (std::size_t after : { 0, 1, 17 }) {
+                auto text = std::string(offset, 'a') + sequence.first + std::string(after, 'b');
+                auto expected = std::string(offset, 'a') + sequence.second + std::string(after, 'b');
+
+                if (sequence.first == sequence.second)
+                    check_clean(text);
+                else
+                    check_dirty(text, expected);
+            }
+        }
+    }
+
+    // a NUL in every position of the first two blocks ends the string there
+    for (std::size_t offset = 0; offset < 32; ++offset) {
+        auto text = std::string(offset, 'a') + std::string(1, '\0') + std::string(40, 'b');
+        std::vector<std::uint8_t> bytes(text.begin(), text.end());
+        auto result = kfc::utf8::scan(bytes.data(), bytes.size());
+        KFTEST_CHECK(result.length == offset && result.clean);
+    }
+}
+
+// without a NUL within the limit the scan throws instead of reading past it
+static void check_missing_nul() {
+    for (std::size_t size = 0; size < 40; ++size) {
+        KFTEST_CHECK(!scan(std::string(size, 'a'), false).found);
+        KFTEST_CHECK(!scan(std::string(size, 'a') + "\xC3", false).found);
+    }
+
+    // the NUL just past the limit does not count
+    std::string text(20, 'a');
+    text.push_back('\0');
+    bool thrown = false;
+    try {
+        kfc::utf8::scan(static_cast<const std::uint8_t*>(static_cast<const void*>(text.data())), 20);
+    } catch (const std::range_error&) {
+        thrown = true;
+    }
+
+    KFTEST_CHECK(thrown);
+}
+
+// the same response parsed with either policy, each parse using only the policy it was given
+static void check_policy() {
+    kfc::kfplayer player;
+    player.id = 1;
+    player.name.assign("\x1B[2Jbad\xFFname", 12);
+    player.score = 100;
+    player.time = 90;
+
+    kfc::schema::writer wire;
+    kfc::schema::serialize(player, wire);
+
+    kfc::kfbuffer keep_buffer(wire.data(), wire.size());
+    kfc::kfplayer kept(keep_buffer);
+    KFTEST_CHECK(kept.name == "\x1B[2Jbad\xFFname");
+    KFTEST_CHECK(!kept.name.clean());
+    KFTEST_CHECK(kept.score == 100);
+
+    kfc::kfbuffer replace_buffer(wire.data(), wire.size());
+    kfc::kfplayer replaced(replace_buffer, nullptr, kfc::utf8::policy::replace);
+    KFTEST_CHECK(replaced.name == REPLACEMENT + "[2Jbad" + REPLACEMENT + "name");
+    KFTEST_CHECK(!replaced.name.clean());
+    KFTEST_CHECK(replaced.score == 100);
+    KFTEST_CHECK(replace_buffer.tell() == wire.size());
+
+    // a parse after it, without a policy, keeps the bytes again
+    kfc::kfbuffer again(wire.data(), wire.size());
+    KFTEST_CHECK(kfc::kfplayer(again).name == "\x1B[2Jbad\xFFname");
+
+    // clean names are the bytes of the packet with either policy
+    player.name.assign("Player 1", 8);
+    wire.clear();
+    kfc::schema::serialize(player, wire);
+    kfc::kfbuffer clean_buffer(wire.data(), wire.size());
+    kfc::kfplayer clean(clean_buffer, nullptr, kfc::utf8::policy::replace);
+    KFTEST_CHECK(clean.name == "Player 1" && clean.name.clean());
+}
+
+int main() {
+    try {
+        check_sequences();
+        check_block_boundaries();
+        check_missing_nul();
+        check_policy();
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
\ No newline at end of file
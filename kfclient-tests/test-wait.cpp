@@ -0,0 +1,70 @@
+#include "kftest.hpp"
+
+#include <kfwait.hpp>
+
+#include <map>
+
+// Waits for servers with a limit that passes while polls are in flight, then for empty
+// kfserver-sim servers without one: what the first run left pending must neither report the
+// servers again nor keep the second run waiting for it to time out.
+
+static const std::uint16_t FIRST_PORT = 47680;
+static const std::uint16_t SERVERS = 3;
+
+int main(int argc, const char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " path-to-kfserver-sim\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        kfc::kfwait_options options;
+        options.grace = std::chrono::milliseconds(500);
+        options.interval = std::chrono::milliseconds(50);
+        options.timeout = std::chrono::seconds(4);
+
+        kfc::kfwaiter waiter(options);
+        for (std::uint16_t i = 0; i < SERVERS; ++i)
+            waiter.add_target("127.0.0.1", static_cast<std::uint16_t>(FIRST_PORT + i));
+
+        std::map<std::uint16_t, std::size_t> empty;
+        auto handler = [&empty](const std::string&, std::uint16_t port) { empty[port]++; };
+
+        {
+            // sockets that never answer, so the first polls are still waiting when the limit passes
+            boost::asio::io_context context;
+            std::vector<std::unique_ptr<boost::asio::ip::udp::socket>> silent;
+            for (std::uint16_t i = 0; i < SERVERS; ++i) {
+                silent.push_back(std::make_unique<boost::asio::ip::udp::socket>(context,
+                    boost::asio::ip::udp::endpoint(boost::asio::ip::make_address("127.0.0.1"), static_cast<std::uint16_t>(FIRST_PORT + i))));
+            }
+
+            KFTEST_CHECK(!waiter.run(handler, std::chrono::milliseconds(300)));
+            KFTEST_CHECK(empty.empty());
+        }
+
+        kftest::process sim(argv[1], { "-p", std::to_string(FIRST_PORT), "-n", std::to_string(SERVERS), "--players", "0" });
+        if (!KFTEST_CHECK(kftest::wait_for_server(FIRST_PORT)))
+            return kftest::result();
+
+        // the polls of the first run would only time out long after the servers were reported
+        auto start = std::chrono::steady_clock::now();
+        KFTEST_CHECK(waiter.run(handler));
+        KFTEST_CHECK(std::chrono::steady_clock::now() - start < options.timeout / 2);
+        KFTEST_CHECK(empty.size() == SERVERS);
+        for (const auto& pair : empty)
+            KFTEST_CHECK(pair.second == 1);
+
+        // and a later run starts over
+        empty.clear();
+        KFTEST_CHECK(waiter.run(handler));
+        KFTEST_CHECK(empty.size() == SERVERS);
+        for (const auto& pair : empty)
+            KFTEST_CHECK(pair.second == 1);
+    } catch (const std::exception& ex) {
+        std::cerr << "error: " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return kftest::result();
+}
\ No newline at end of file
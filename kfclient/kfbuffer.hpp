@@ -37,6 +37,7 @@ namespace kfc {
         std::uint8_t* data() noexcept { return data_; }
         const std::uint8_t* data() const noexcept { return data_; }
         std::size_t size() const noexcept { return size_; }
+        std::size_t tell() const noexcept { return pos_; }
 
         void rewind() const { 
             pos_ = 0;
@@ -0,0 +1,173 @@
+#include "kfcapture.hpp"
+#include "kfvarint.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+
+namespace {
+    constexpr const std::array<char, 8> KFCAP_FILE_MAGIC = { 'K', 'F', 'C', 'A', 'P', 0, 0, 1 };
+    constexpr const std::uint8_t KFCAP_PEER = 0;
+
+    std::uint64_t now_micros() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+}
+
+kfc::kfcapture_writer::kfcapture_writer(const std::string& path)
+    : file_(path, std::ios::binary | std::ios::trunc) {
+        if (!file_)
+            throw std::runtime_error("kfcapture_writer cannot open " + path);
+        file_.write(KFCAP_FILE_MAGIC.data(), KFCAP_FILE_MAGIC.size());
+}
+
+kfc::kfcapture_writer::~kfcapture_writer() {
+    try {
+        flush();
+    } catch (...) { // NOLINT(bugprone-empty-catch) -- destructors must not throw
+    }
+}
+
+void kfc::kfcapture_writer::record(const std::string& peer, kfcapture_direction direction, const std::uint8_t* data, std::size_t size) {
+    auto timestamp = now_micros();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto iter = peers_.find(peer);
+    if (iter == peers_.end()) {
+        iter = peers_.emplace(peer, peers_.size()).first;
+        buffer_.push_back(KFCAP_PEER);
+        detail::put_varint(buffer_, peer.size());
+        buffer_.insert(buffer_.end(), peer.begin(), peer.end());
+    }
+
+    buffer_.push_back(static_cast<std::uint8_t>(direction));
+    detail::put_varint(buffer_, iter->second);
+    detail::put_zigzag(buffer_, static_cast<std::int64_t>(timestamp - last_timestamp_));
+    detail::put_varint(buffer_, size);
+    buffer_.insert(buffer_.end(), data, data + size);
+    last_timestamp_ = timestamp;
+
+    if (buffer_.size() >= FLUSH_SIZE)
+        flush_locked();
+}
+
+void kfc::kfcapture_writer::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_locked();
+}
+
+void kfc::kfcapture_writer::flush_locked() {
+    if (buffer_.empty())
+        return;
+
+    file_.write(static_cast<const char*>(static_cast<const void*>(buffer_.data())), static_cast<std::streamsize>(buffer_.size()));
+    file_.flush();
+    buffer_.clear();
+
+    if (!file_)
+        throw std::runtime_error("kfcapture_writer failed to write the capture");
+}
+
+kfc::kfcapture_reader::kfcapture_reader(const std::string& path)
+    : position_(KFCAP_FILE_MAGIC.size()), timestamp_(0), defined_(0) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("kfcapture_reader cannot open " + path);
+
+        data_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        if (data_.size() < KFCAP_FILE_MAGIC.size() || std::memcmp(data_.data(), KFCAP_FILE_MAGIC.data(), KFCAP_FILE_MAGIC.size()) != 0)
+            throw std::runtime_error(path + " is not a kfclient capture");
+}
+
+bool kfc::kfcapture_reader::next(kfcapture_record& record) {
+    const auto* end = data_.data() + data_.size();
+
+    try {
+        while (position_ < data_.size()) {
+            const auto* p = data_.data() + position_;
+            auto kind = *p++;
+
+            if (kind == KFCAP_PEER) {
+                auto length = detail::get_varint(p, end);
+                if (length > static_cast<std::uint64_t>(end - p))
+                    return false;
+
+                // after a rewind the peers are read again and already known
+                if (defined_++ == peers_.size())
+                    peers_.emplace_back(static_cast<const char*>(static_cast<const void*>(p)), static_cast<std::size_t>(length));
+                position_ = static_cast<std::size_t>(p + length - data_.data());
+                continue;
+            }
+
+            if (kind != static_cast<std::uint8_t>(kfcapture_direction::sent) && kind != static_cast<std::uint8_t>(kfcapture_direction::received))
+                throw std::runtime_error("corrupt capture entry");
+
+            auto peer = detail::get_varint(p, end);
+            auto timestamp = timestamp_ + static_cast<std::uint64_t>(detail::get_zigzag(p, end));
+            auto size = detail::get_varint(p, end);
+            if (size > static_cast<std::uint64_t>(end - p) || peer >= defined_)
+                return false;
+
+            record.timestamp = timestamp;
+            record.direction = static_cast<kfcapture_direction>(kind);
+            record.peer = &peers_.at(static_cast<std::size_t>(peer));
+            record.data = p;
+            record.size = static_cast<std::size_t>(size);
+
+            timestamp_ = timestamp;
+            position_ = static_cast<std::size_t>(p + size - data_.data());
+            return true;
+        }
+    } catch (const std::range_error&) {
+        // a torn final entry
+    }
+
+    return false;
+}
+
+void kfc::kfcapture_reader::rewind() noexcept {
+    position_ = KFCAP_FILE_MAGIC.size();
+    timestamp_ = 0;
+    defined_ = 0;
+}
+
+kfc::kfreplay_transport::kfreplay_transport(const std::string& path, const std::string& peer)
+    : reader_(path), peer_(peer), position_(0) {
+        kfcapture_record record;
+        while (reader_.next(record)) {
+            if (peer_.empty() || *record.peer == peer_)
+                records_.push_back(record);
+        }
+
+        if (records_.empty())
+            throw std::runtime_error(peer_.empty() ? path + " holds no datagrams" : path + " holds no datagrams of " + peer_);
+}
+
+void kfc::kfreplay_transport::send(const std::uint8_t* /*data*/, std::size_t /*size*/) {
+    // the captured requests are skipped rather than compared, responses follow the captured order
+    auto iter = std::find_if(records_.begin() + static_cast<std::ptrdiff_t>(position_), records_.end(), [](const kfcapture_record& r) {
+        return r.direction == kfcapture_direction::sent;
+    });
+
+    if (iter == records_.end())
+        throw std::runtime_error("end of capture reached");
+
+    position_ = static_cast<std::size_t>(std::distance(records_.begin(), iter)) + 1;
+}
+
+std::size_t kfc::kfreplay_transport::receive(std::uint8_t* data, std::size_t size, std::chrono::milliseconds /*timeout*/) {
+    if (position_ >= records_.size() || records_.at(position_).direction != kfcapture_direction::received)
+        throw timeout_error("timed out waiting for a response");
+
+    const auto& record = records_.at(position_++);
+    auto length = std::min(size, record.size); // a datagram larger than the buffer is truncated, like a socket does
+    std::memcpy(data, record.data, length);
+    return length;
+}
+
+std::string kfc::kfreplay_transport::peer() const {
+    return peer_.empty() ? std::string("replay") : peer_;
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef kfclient_capture_hpp
+#define kfclient_capture_hpp
+
+#include "libdef.hpp"
+#include "kftransport.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+    A capture file holds every datagram a set of clients sent and received:
+
+        file    := "KFCAP\0\0\1" entry*
+        entry   := 0x00 varint(length) bytes                   -- defines the next peer id as host:port
+                 | kind varint(peer) zigzag(dt) varint(length) bytes
+        kind    := 0x01 (sent) | 0x02 (received)
+
+    dt is the time since the previous datagram in microseconds; the first one is relative to the
+    unix epoch. A torn final entry, left by a crash, ends the capture.
+*/
+
+namespace kfc {
+    enum class kfcapture_direction : std::uint8_t {
+        sent = 1,
+        received = 2
+    };
+
+    struct KFCLIENT_API kfcapture_record {
+        std::uint64_t timestamp = 0; // microseconds since the unix epoch
+        kfcapture_direction direction = kfcapture_direction::sent;
+        const std::string* peer = nullptr;
+        const std::uint8_t* data = nullptr; // points into the reader and lives as long as it does
+        std::size_t size = 0;
+    };
+
+    // Appends datagrams to a new capture file, one writer can be shared by clients on any thread.
+    class KFCLIENT_API kfcapture_writer {
+        static constexpr const std::size_t FLUSH_SIZE = 64 * 1024;
+
+    public:
+        explicit kfcapture_writer(const std::string& path);
+
+        kfcapture_writer(const kfcapture_writer&) = delete;
+        kfcapture_writer(kfcapture_writer&&) = delete;
+        kfcapture_writer& operator=(const kfcapture_writer&) = delete;
+        kfcapture_writer& operator=(kfcapture_writer&&) = delete;
+        ~kfcapture_writer();
+
+        void record(const std::string& peer, kfcapture_direction direction, const std::uint8_t* data, std::size_t size);
+        void flush();
+
+    private:
+        void flush_locked();
+
+        std::mutex mutex_;
+        std::ofstream file_;
+        std::unordered_map<std::string, std::uint64_t> peers_;
+        std::vector<std::uint8_t> buffer_;
+        std::uint64_t last_timestamp_ = 0;
+    };
+
+    class KFCLIENT_API kfcapture_reader {
+    public:
+        explicit kfcapture_reader(const std::string& path);
+
+        // false at the end of the capture
+        bool next(kfcapture_record& record);
+        void rewind() noexcept;
+
+    private:
+        std::vector<std::uint8_t> data_;
+        std::deque<std::string> peers_; // stable addresses for kfcapture_record::peer
+        std::size_t position_;
+        std::uint64_t timestamp_;
+        std::size_t defined_; // peers defined before position_
+    };
+
+    // Feeds the datagrams a capture received from one peer back to a kfclient without a network.
+    // Every send moves past the next captured request, and a receive with no captured response
+    // before the following request times out, so retries and timeouts replay as they happened.
+    class KFCLIENT_API kfreplay_transport : public kftransport {
+    public:
+        // an empty peer replays the datagrams of every peer in the capture
+        explicit kfreplay_transport(const std::string& path, const std::string& peer = std::string());
+
+        void send(const std::uint8_t* data, std::size_t size) override;
+        std::size_t receive(std::uint8_t* data, std::size_t size, std::chrono::milliseconds timeout) override;
+        std::string peer() const override;
+
+    private:
+        kfcapture_reader reader_;
+        std::string peer_;
+        std::vector<kfcapture_record> records_;
+        std::size_t position_;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -2,89 +2,245 @@
 
 #include <boost/bind.hpp>
 
+#include <cstring>
 #include <stdexcept>
 #include <vector>
 #include <iostream>
 
 kfc::kfclient::kfclient(io_context& context, const udp::resolver::results_type& endpoints, std::size_t receive_buffer_size) 
-    : io_context_(context), socket_(context), recvbuf_(receive_buffer_size), challenge_(0) {
-        do_connect(endpoints);
+    : kfclient(std::make_unique<kfudp_transport>(context, endpoints), receive_buffer_size) {}
+
+kfc::kfclient::kfclient(std::unique_ptr<kftransport> transport, std::size_t receive_buffer_size)
+    : transport_(std::move(transport)), recvbuf_(receive_buffer_size), challenge_(0), timeout_(DEFAULT_TIMEOUT), retries_(DEFAULT_RETRIES), round_trip_(0), capture_(nullptr), interner_(nullptr), utf8_policy_(utf8::policy::keep), memoize_(true), unchanged_(false), reuse_challenge_(false), challenged_(false), abandoned_(0) {}
+
+void kfc::kfclient::capture(kfcapture_writer* writer) {
+    capture_ = writer;
+    if (capture_ != nullptr && capture_peer_.empty())
+        capture_peer_ = transport_->peer();
+}
+
+void kfc::kfclient::interner(kfinterner* interner) noexcept {
+    if (interner != interner_)
+        forget_memos();
+    interner_ = interner;
+}
+
+void kfc::kfclient::utf8_policy(utf8::policy policy) noexcept {
+    if (policy != utf8_policy_)
+        forget_memos();
+    utf8_policy_ = policy;
 }
 
-void kfc::kfclient::do_connect(const udp::resolver::results_type& endpoints) {
-    boost::system::error_code error;
-    socket_.connect(*endpoints.begin(), error);
-    if (error) 
-        throw std::runtime_error(error.message());
+void kfc::kfclient::forget_memos() noexcept {
+    details_memo_.valid = false;
+    rules_memo_.valid = false;
+    players_memo_.valid = false;
 }
 
 const kfc::kfdetails& kfc::kfclient::request_details() {
-    details_ = nullptr;
-    do_request(PACKET_DETAILS, REQUEST_DETAILS);
+    do_request(protocol::PACKET_DETAILS, protocol::REQUEST_DETAILS);
     if (details_ == nullptr)
         throw std::runtime_error("request_details failed, received response could not be processed");
     return *details_;
 }
 
 const kfc::kfrules& kfc::kfclient::request_rules() {
-    rules_ = nullptr;
-    do_request(PACKET_RULES, REQUEST_RULES);
+    do_request(protocol::PACKET_RULES, protocol::REQUEST_RULES);
     if (rules_ == nullptr)
         throw std::runtime_error("request_rules failed, received response could not be processed");
     return *rules_;
 }
 
 const kfc::kfplayers& kfc::kfclient::request_players() {
-    players_ = nullptr;
-    do_request(PACKET_PLAYERS, REQUEST_PLAYERS);
+    do_request(protocol::PACKET_PLAYERS, protocol::REQUEST_PLAYERS);
     if (players_ == nullptr)
         throw std::runtime_error("request_players failed, received repsonse could not be processed");
     return *players_;
 }
 
-void kfc::kfclient::do_challenge() {
-    boost::system::error_code error;
-    socket_.send(boost::asio::buffer(REQUEST_CHALLENGE, sizeof(REQUEST_CHALLENGE)), 0, error);
+kfc::kfrequest kfc::kfclient::request_type(std::int8_t packet) noexcept {
+    switch (packet) {
+    case protocol::PACKET_DETAILS: return kfrequest::details;
+    case protocol::PACKET_RULES: return kfrequest::rules;
+    case protocol::PACKET_PLAYERS: return kfrequest::players;
+    default: return kfrequest::challenge;
+    }
+}
 
-    if (error) 
-        throw std::runtime_error(error.message());
+void kfc::kfclient::do_challenge() {
+    auto sent = std::chrono::steady_clock::now();
+    do_send(protocol::REQUEST_CHALLENGE.data(), protocol::REQUEST_CHALLENGE.size());
+    stats_.count(kfcounter::challenges);
     
-    process_response(PACKET_CHALLENGE);
+    process_response(protocol::PACKET_CHALLENGE);
+    challenged_ = true;
+    stats_.latency(kfrequest::challenge, std::chrono::steady_clock::now() - sent);
+}
+
+void kfc::kfclient::do_request(std::int8_t packet, const std::uint8_t* request, std::size_t size) {
+    unchanged_ = false;
+    assembly_.reset();
+
+    for (std::size_t attempt = 0;; ++attempt) {
+        bool sent_request = false;
+
+        try {
+            if (!reuse_challenge_ || !challenged_)
+                do_challenge();
+
+            for (std::size_t challenges = 1;; ++challenges) {
+                // request data followed by the challenge
+                sendbuf_.assign(request, request + size);
+                sendbuf_.resize(size + sizeof(challenge_));
+                std::memcpy(sendbuf_.data() + size, &challenge_, sizeof(challenge_));
+
+                auto sent = std::chrono::steady_clock::now();
+                do_send(sendbuf_.data(), sendbuf_.size());
+                sent_request = true;
+
+                if (process_response(packet)) {
+                    round_trip_ = std::chrono::steady_clock::now() - sent;
+                    stats_.latency(request_type(packet), round_trip_);
+                    return;
+                }
+
+                // the server replaced its challenge, send the request again with the new one
+                if (challenges >= protocol::MAX_CHALLENGES)
+                    throw std::runtime_error("server keeps answering with a new challenge");
+                stats_.count(kfcounter::challenges);
+            }
+        } catch (const timeout_error&) {
+            // a challenge that answers late is taken as a new one, see parse_response
+            challenged_ = false;
+            if (sent_request)
+                abandoned_++;
+            if (attempt >= retries_)
+                throw;
+            stats_.count(kfcounter::retries);
+        }
+    }
+}
+
+void kfc::kfclient::do_send(const std::uint8_t* data, std::size_t size) {
+    transport_->send(data, size);
+
+    stats_.count(kfcounter::packets_sent);
+    stats_.count(kfcounter::bytes_sent, size);
+
+    if (capture_ != nullptr)
+        capture_->record(capture_peer_, kfcapture_direction::sent, data, size);
 }
 
-void kfc::kfclient::process_response(std::int8_t expected_packet) {
-    boost::system::error_code error;
-    socket_.receive(boost::asio::buffer(recvbuf_.data(), recvbuf_.size()), 0, error);
+std::size_t kfc::kfclient::do_receive() {
+    std::size_t received = 0;
 
-    if (error)
-        throw std::runtime_error(error.message());
+    try {
+        received = transport_->receive(recvbuf_.data(), recvbuf_.size(), timeout_);
+    } catch (const timeout_error&) {
+        stats_.count(kfcounter::timeouts);
+        throw;
+    }
 
-    recvbuf_.rewind();
+    stats_.count(kfcounter::packets_received);
+    stats_.count(kfcounter::bytes_received, received);
 
+    if (capture_ != nullptr)
+        capture_->record(capture_peer_, kfcapture_direction::received, recvbuf_.data(), received);
+
+    return received;
+}
+
+bool kfc::kfclient::process_response(std::int8_t expected_packet) {
+    for (;;) {
+        auto received = do_receive();
+        auto split = protocol::is_split(recvbuf_.data(), received);
+
+        // the datagrams of split responses, late ones among them, are collected until one is complete;
+        // any other datagram is taken (or skipped as late) as it arrives
+        if (split && !assembly_.add(recvbuf_.data(), received))
+            continue;
+
+        kfbuffer response = split ? kfbuffer(assembly_.payload().data(), assembly_.payload().size()) : kfbuffer(recvbuf_.data(), received);
+
+        // the answer to a request that timed out, which the retry replaced
+        if (is_late(response, expected_packet)) {
+            abandoned_--;
+            stats_.count(kfcounter::late_responses);
+            continue;
+        }
+
+        try {
+            return parse_response(response, expected_packet);
+        } catch (const std::exception&) {
+            stats_.count(kfcounter::parse_failures);
+            throw;
+        }
+    }
+}
+
+bool kfc::kfclient::is_late(const kfbuffer& response, std::int8_t expected_packet) const noexcept {
+    if (abandoned_ == 0 || expected_packet == -1 || response.size() < sizeof(std::int32_t) + sizeof(std::int8_t))
+        return false;
+
+    auto type = static_cast<std::int8_t>(response.data()[sizeof(std::int32_t)]);
+    if (type == expected_packet)
+        return false;
+
+    // a challenge while a request is awaited is the server replacing it, see parse_response
+    return type == protocol::PACKET_DETAILS || type == protocol::PACKET_RULES || type == protocol::PACKET_PLAYERS;
+}
+
+template <typename T>
+void kfc::kfclient::parse_memoized(const kfbuffer& response, std::unique_ptr<T>& result, payload_memo& memo) {
+    if (memoize_ && memo.valid && result != nullptr && memo.payload.size() == response.size()
+        && std::memcmp(memo.payload.data(), response.data(), response.size()) == 0) {
+        unchanged_ = true;
+        stats_.count(kfcounter::unchanged_responses);
+        return;
+    }
+
+    memo.valid = false;
+    result = std::make_unique<T>(response, interner_, utf8_policy_);
+
+    // assign keeps the capacity, so only a response longer than any before allocates
+    if (memoize_) {
+        memo.payload.assign(response.data(), response.data() + response.size());
+        memo.valid = true;
+    }
+}
+
+bool kfc::kfclient::parse_response(const kfbuffer& response, std::int8_t expected_packet) {
     kfheader header;
-    recvbuf_.consume(header.magic);
-    recvbuf_.consume(header.type);
+    response.consume(header.magic);
+    response.consume(header.type);
 
     if (header.magic != -1)
         throw std::runtime_error("unexpected header magic received");
     
+    if (header.type == protocol::PACKET_CHALLENGE && expected_packet != protocol::PACKET_CHALLENGE && expected_packet != -1) {
+        challenge_ = response.consume<std::int32_t>();
+        return false;
+    }
+
     if (expected_packet != -1 && header.type != expected_packet)
         throw std::runtime_error("unexpected packet received");
 
     switch (header.type) {
-    case PACKET_CHALLENGE: {
-        challenge_ = recvbuf_.consume<std::uint32_t>();
+    case protocol::PACKET_CHALLENGE: {
+        challenge_ = response.consume<std::uint32_t>();
     } break;
-    case PACKET_DETAILS: {
-        details_ = std::make_unique<kfdetails>(recvbuf_);
+    case protocol::PACKET_DETAILS: {
+        parse_memoized(response, details_, details_memo_);
     } break;
-    case PACKET_RULES: {
-        rules_ = std::make_unique<kfrules>(recvbuf_);
+    case protocol::PACKET_RULES: {
+        parse_memoized(response, rules_, rules_memo_);
     } break;
-    case PACKET_PLAYERS: {
-        players_ = std::make_unique<kfplayers>(recvbuf_);
+    case protocol::PACKET_PLAYERS: {
+        parse_memoized(response, players_, players_memo_);
     } break;
     default:
         throw std::runtime_error("unexpected result type received");
     }
+
+    return true;
 }
\ No newline at end of file
@@ -6,78 +6,130 @@
 #include "kfdetails.hpp"
 #include "kfrules.hpp"
 #include "kfplayers.hpp"
+#include "kfstats.hpp"
+#include "kftransport.hpp"
+#include "kfcapture.hpp"
+#include "kfprotocol.hpp"
 
 #include <boost/asio.hpp>
 
 #include <cstdint>
 #include <cstdlib>
+#include <stdexcept>
+#include <chrono>
 #include <memory>
 #include <array>
+#include <vector>
 
 namespace kfc {
     class KFCLIENT_API kfclient {
         using io_context = boost::asio::io_context;
         using udp = boost::asio::ip::udp;
 
-        static constexpr const std::int8_t PACKET_CHALLENGE = 'A';
-        static constexpr const std::int8_t PACKET_PLAYERS = 'D';
-        static constexpr const std::int8_t PACKET_DETAILS = 'I';
-        static constexpr const std::int8_t PACKET_RULES = 'E';
         static constexpr const std::size_t DEFAULT_RECEIVE_BUFFER_SIZE = 2048;
+        static constexpr const std::chrono::milliseconds DEFAULT_TIMEOUT = std::chrono::seconds(10);
+        static constexpr const std::size_t DEFAULT_RETRIES = 0;
 
-        static constexpr const std::array<std::uint8_t, 9> REQUEST_CHALLENGE = {
-            0xFF, 0xFF, 0xFF, 0xFF, 0x55, 0xFF, 0xFF, 0xFF, 0xFF
-        };
-
-        static constexpr const std::array<std::uint8_t, 25> REQUEST_DETAILS = {
-			0xFF, 0xFF, 0xFF, 0xFF, 0x54, 0x53, 0x6F, 0x75, 0x72, 0x63, 0x65, 0x20, 0x45,
-			0x6E, 0x67, 0x69, 0x6E, 0x65, 0x20, 0x51, 0x75, 0x65, 0x72, 0x79, 0x00
-        };
-
-        static constexpr const std::array<std::uint8_t, 5> REQUEST_PLAYERS = {
-            0xFF, 0xFF, 0xFF, 0xFF, 0x55
-        };
-
-        static constexpr const std::array<std::uint8_t, 5> REQUEST_RULES = {
-            0xFF, 0xFF, 0xFF, 0xFF, 0x56
-        };
     public:
         kfclient(io_context& context, const udp::resolver::results_type& endpoints, std::size_t receive_buffer_size = DEFAULT_RECEIVE_BUFFER_SIZE);
+        explicit kfclient(std::unique_ptr<kftransport> transport, std::size_t receive_buffer_size = DEFAULT_RECEIVE_BUFFER_SIZE);
 
         const kfdetails& request_details();
         const kfrules& request_rules();
         const kfplayers& request_players();
 
-        void do_challenge();
+        // a timeout of zero blocks until a response arrives
+        void timeout(std::chrono::milliseconds timeout) noexcept { timeout_ = timeout; }
+        std::chrono::milliseconds timeout() const noexcept { return timeout_; }
 
-        template <std::size_t _Size>
-        void do_request(std::int8_t packet, const std::array<std::uint8_t, _Size>& request) {
-            do_challenge();
+        // how many times a timed out challenge and request are sent again before giving up; every
+        // request that timed out lets one answer of another type than the one awaited through as late
+        void retries(std::size_t retries) noexcept { retries_ = retries; }
+        std::size_t retries() const noexcept { return retries_; }
+
+        // Send the challenge only for the first request (and after a timeout) and reuse it for the
+        // following ones; a server that replaced its challenge answers with the new one, upon which
+        // the request is sent again. Off by default.
+        void reuse_challenge(bool enabled) noexcept { reuse_challenge_ = enabled; }
+        bool reuse_challenge() const noexcept { return reuse_challenge_; }
+
+        // time between sending the last request and processing its response, excluding the challenge
+        std::chrono::steady_clock::duration round_trip() const noexcept { return round_trip_; }
 
-            boost::system::error_code error;
+        const kfstats& stats() const noexcept { return stats_; }
 
-            std::vector<boost::asio::const_buffer> data = {
-                boost::asio::buffer(request.data(), request.size()), // request data
-                boost::asio::buffer(&challenge_, sizeof(challenge_)) // challenge
-            };
+        // The last response of every packet type is kept; when a response is byte-identical to it
+        // the previously parsed result is returned as is. On by default.
+        void memoize(bool enabled) noexcept { memoize_ = enabled; }
+        bool memoize() const noexcept { return memoize_; }
 
-            socket_.send(data, 0, error);
-            
-            if (error)
-                throw std::runtime_error(error.message());
-            
-            process_response(packet);
+        // whether the result of the last request was returned from the memo, unchanged
+        bool unchanged() const noexcept { return unchanged_; }
+
+        // record every datagram sent and received; the writer is not owned and must outlive the
+        // client (or be detached with nullptr)
+        void capture(kfcapture_writer* writer);
+
+        // share the strings of the responses through an interner; it is not owned and must outlive
+        // the client (or be detached with nullptr), the results may outlive both
+        void interner(kfinterner* interner) noexcept;
+        kfinterner* interner() const noexcept { return interner_; }
+
+        // what parsing does with text that is not clean UTF-8, see utf8::policy; keep by default
+        void utf8_policy(utf8::policy policy) noexcept;
+        utf8::policy utf8_policy() const noexcept { return utf8_policy_; }
+
+        void do_challenge();
+
+        template <std::size_t _Size>
+        void do_request(std::int8_t packet, const std::array<std::uint8_t, _Size>& request) {
+            do_request(packet, request.data(), request.size());
         }
+
+        void do_request(std::int8_t packet, const std::uint8_t* request, std::size_t size);
         
-        void process_response(std::int8_t expected_packet);
+        // false when the server answered with a new challenge instead of the expected packet
+        bool process_response(std::int8_t expected_packet);
 
     private:
-        void do_connect(const udp::resolver::results_type& endpoints);
+        void do_send(const std::uint8_t* data, std::size_t size);
+        std::size_t do_receive();
+        bool parse_response(const kfbuffer& response, std::int8_t expected_packet);
+        bool is_late(const kfbuffer& response, std::int8_t expected_packet) const noexcept;
+        static kfrequest request_type(std::int8_t packet) noexcept;
+
+        struct payload_memo {
+            std::vector<std::uint8_t> payload;
+            bool valid = false;
+        };
+
+        // the memos were parsed with another interner or policy
+        void forget_memos() noexcept;
+
+        template <typename T>
+        void parse_memoized(const kfbuffer& response, std::unique_ptr<T>& result, payload_memo& memo);
 
-        io_context& io_context_;
-        udp::socket socket_;
+        std::unique_ptr<kftransport> transport_;
         kfbuffer recvbuf_;
+        std::vector<std::uint8_t> sendbuf_;
+        kfreassembler assembly_; // the split responses of the current request, and their payload
         std::int32_t challenge_;
+        std::chrono::milliseconds timeout_;
+        std::size_t retries_;
+        std::chrono::steady_clock::duration round_trip_;
+        kfstats stats_;
+        kfcapture_writer* capture_;
+        std::string capture_peer_;
+        kfinterner* interner_;
+        utf8::policy utf8_policy_;
+        bool memoize_;
+        bool unchanged_;
+        bool reuse_challenge_;
+        bool challenged_; // challenge_ holds a challenge received from the server
+        std::size_t abandoned_; // requests that timed out, whose answers may still arrive
+        payload_memo details_memo_;
+        payload_memo rules_memo_;
+        payload_memo players_memo_;
 
         std::unique_ptr<kfdetails> details_;
         std::unique_ptr<kfrules> rules_;
@@ -1,15 +1,18 @@
 #include "kfdetails.hpp"
 
-kfc::kfdetails::kfdetails(const kfbuffer& buff) { 
-    buff.consume(protocol);
-    buff.consume(hostname, map, game_dir, game_description);
-    buff.consume(steam_app_id, player_count, player_cap, unknown1, unknown2, operating_system);
-    buff.consume_cast<std::uint8_t>(password_set);
-    buff.consume(unknown3);
-    buff.consume_string(version, 4);
-    buff.consume(unknown4, unknown5, unknown6);
-    buff.consume(additional_string);
+kfc::kfdetails::kfdetails(const kfbuffer& buff, kfinterner* interner, utf8::policy policy) { 
+    schema::parse(buff, *this, interner, policy);
 
+    additional = tokenize_additional(additional_string);
+
+    if (additional.count("d") != 0) 
+        waves_total = std::stol(additional.at("d"));
+    if (additional.count("e") != 0)
+        waves_current = std::stol(additional.at("e"));
+}
+
+std::unordered_map<std::string, std::string> kfc::kfdetails::tokenize_additional(const std::string& additional_string) {
+    std::unordered_map<std::string, std::string> additional;
     std::size_t i = 0;
     std::string key;
     std::string value;
@@ -33,8 +36,5 @@ kfc::kfdetails::kfdetails(const kfbuffer& buff) {
         }
     }
 
-    if (additional.count("d") != 0) 
-        waves_total = std::stol(additional.at("d"));
-    if (additional.count("e") != 0)
-        waves_current = std::stol(additional.at("e"));
+    return additional;
 }
\ No newline at end of file
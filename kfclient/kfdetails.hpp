@@ -3,6 +3,8 @@
 
 #include "libdef.hpp"
 #include "kfbuffer.hpp"
+#include "kfschema.hpp"
+#include "kfstring.hpp"
 
 #include <cstdint>
 #include <cstdlib>
@@ -11,15 +13,14 @@
 #include <unordered_map>
 
 namespace kfc {
-    struct kfdetails {
-    public:
-        explicit kfdetails(const kfbuffer& buff);
-
+    // Every field of the details but the additional pairs, so a copy can assign all of them at once
+    // and the pairs on their own (see kfresult::assign).
+    struct kfdetails_fields {
         std::uint8_t protocol = 0;
-        std::string hostname;
-        std::string map;
-        std::string game_dir;
-        std::string game_description;
+        kfstring hostname;
+        kfstring map;
+        kfstring game_dir;
+        kfstring game_description;
         std::uint16_t steam_app_id = 0;
         std::uint8_t player_count = 0;
         std::uint8_t player_cap = 0;
@@ -33,12 +34,40 @@ namespace kfc {
         std::uint32_t unknown5 = 0;
         std::uint32_t unknown6 = 0;
         std::string additional_string;
-        
-        std::unordered_map<std::string, std::string> additional;
 
         std::int32_t waves_total = 0;
         std::int32_t waves_current = 0;
     };
+
+    struct kfdetails : kfdetails_fields {
+    public:
+        kfdetails() = default;
+        // the strings are shared through the interner when one is given, see kfinterner, and
+        // checked under the policy, see utf8::policy
+        explicit kfdetails(const kfbuffer& buff, kfinterner* interner = nullptr, utf8::policy policy = utf8::policy::keep);
+
+        // splits the "key:value,key:value," additional string into its pairs
+        static std::unordered_map<std::string, std::string> tokenize_additional(const std::string& additional_string);
+
+        std::unordered_map<std::string, std::string> additional;
+    };
+
+    namespace schema {
+        template <>
+        struct of<kfdetails> {
+            using type = layout<
+                value<&kfdetails::protocol>,
+                string<&kfdetails::hostname>, string<&kfdetails::map>, string<&kfdetails::game_dir>, string<&kfdetails::game_description>,
+                value<&kfdetails::steam_app_id>, value<&kfdetails::player_count>, value<&kfdetails::player_cap>,
+                value<&kfdetails::unknown1>, value<&kfdetails::unknown2>, value<&kfdetails::operating_system>,
+                cast<&kfdetails::password_set, std::uint8_t>,
+                value<&kfdetails::unknown3>,
+                fixed<&kfdetails::version, 4>,
+                value<&kfdetails::unknown4>, value<&kfdetails::unknown5>, value<&kfdetails::unknown6>,
+                string<&kfdetails::additional_string>
+            >;
+        };
+    }
 }
 
 #endif 
\ No newline at end of file
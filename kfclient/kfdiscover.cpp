@@ -0,0 +1,260 @@
+#include "kfdiscover.hpp"
+#include "kfbuffer.hpp"
+#include "kfstats.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    // sweeps are short-lived, so their events are only added to the global statistics
+    kfc::kfstats& discovery_stats() {
+        static thread_local kfc::kfstats stats;
+        return stats;
+    }
+
+    // large enough to absorb the answers of a full window of probes arriving at once
+    constexpr const int SOCKET_RECEIVE_BUFFER = 4 * 1024 * 1024;
+}
+
+kfc::kfdiscovery::kfdiscovery(std::size_t parallel, std::chrono::milliseconds timeout)
+    : context_(), socket_(context_), timer_(context_), parallel_(parallel == 0 ? 1 : parallel), timeout_(timeout) {}
+
+void kfc::kfdiscovery::add_range(const std::string& hosts, std::uint16_t first, std::uint16_t last) {
+    if (first == 0 || last < first)
+        throw std::invalid_argument("invalid port range for " + hosts);
+
+    auto slash = hosts.find('/');
+    if (slash == std::string::npos) {
+        udp::resolver resolver(context_);
+        auto endpoints = resolver.resolve(udp::v4(), hosts, std::to_string(first));
+        ranges_.push_back({ endpoints.begin()->endpoint().address().to_v4().to_uint(), 1, first, last });
+        return;
+    }
+
+    auto address = boost::asio::ip::make_address_v4(hosts.substr(0, slash)).to_uint();
+    auto prefix = std::stoul(hosts.substr(slash + 1));
+    if (prefix > 32)
+        throw std::invalid_argument("invalid network prefix in " + hosts);
+
+    std::uint64_t addresses = 1ULL << (32 - prefix);
+    if (prefix != 0)
+        address &= ~static_cast<std::uint32_t>(addresses - 1);
+    else
+        address = 0;
+
+    if (prefix <= 30) {
+        address++;
+        addresses -= 2;
+    }
+
+    ranges_.push_back({ address, addresses, first, last });
+}
+
+std::uint64_t kfc::kfdiscovery::size() const noexcept {
+    std::uint64_t total = 0;
+    for (const auto& r : ranges_)
+        total += r.addresses * (static_cast<std::uint64_t>(r.last - r.first) + 1);
+    return total;
+}
+
+void kfc::kfdiscovery::run(const handler_type& handler) {
+    handler_ = &handler;
+    range_ = 0;
+    offset_ = 0;
+    probes_.clear();
+    deadlines_.clear();
+    armed_ = false;
+
+    socket_.open(udp::v4());
+
+    error_code ignored;
+    socket_.set_option(boost::asio::socket_base::receive_buffer_size(SOCKET_RECEIVE_BUFFER), ignored);
+
+    receive();
+    fill();
+    finish_if_done();
+
+    context_.restart();
+    try {
+        context_.run();
+    } catch (...) {
+        // the handler threw, the sweep ends here and the next run starts afresh
+        error_code ignored;
+        socket_.close(ignored);
+        timer_.cancel();
+        handler_ = nullptr;
+        throw;
+    }
+    handler_ = nullptr;
+}
+
+std::uint64_t kfc::kfdiscovery::key(const udp::endpoint& endpoint) noexcept {
+    return (static_cast<std::uint64_t>(endpoint.address().to_v4().to_uint()) << 16U) | endpoint.port();
+}
+
+bool kfc::kfdiscovery::next_endpoint(udp::endpoint& endpoint) {
+    while (range_ < ranges_.size()) {
+        const auto& r = ranges_.at(range_);
+        auto ports = static_cast<std::uint64_t>(r.last - r.first) + 1;
+
+        // addresses vary fastest, which spreads the probes of a network over its hosts
+        if (offset_ < r.addresses * ports) {
+            auto address = static_cast<std::uint32_t>(r.address + offset_ % r.addresses);
+            auto port = static_cast<std::uint16_t>(r.first + offset_ / r.addresses);
+            endpoint = udp::endpoint(boost::asio::ip::address_v4(address), port);
+            offset_++;
+            return true;
+        }
+
+        range_++;
+        offset_ = 0;
+    }
+
+    return false;
+}
+
+void kfc::kfdiscovery::fill() {
+    udp::endpoint endpoint;
+    while (probes_.size() < parallel_ && next_endpoint(endpoint)) {
+        auto k = key(endpoint);
+        auto inserted = probes_.try_emplace(k, probe { endpoint, clock_type::now(), 0, 0 });
+        if (!inserted.second)
+            continue; // the same endpoint twice in overlapping ranges
+
+        discovery_stats().count(kfcounter::challenges);
+        send(k, inserted.first->second, protocol::PACKET_CHALLENGE, 0);
+    }
+}
+
+void kfc::kfdiscovery::send(std::uint64_t key, probe& p, std::int8_t packet, std::int32_t challenge) {
+    if (packet == protocol::PACKET_CHALLENGE) {
+        sendbuf_.assign(protocol::REQUEST_CHALLENGE.begin(), protocol::REQUEST_CHALLENGE.end());
+    } else {
+        sendbuf_.assign(protocol::REQUEST_DETAILS.begin(), protocol::REQUEST_DETAILS.end());
+        sendbuf_.resize(protocol::REQUEST_DETAILS.size() + sizeof(challenge));
+        std::memcpy(sendbuf_.data() + protocol::REQUEST_DETAILS.size(), &challenge, sizeof(challenge));
+    }
+
+    // unreachable hosts and networks fail right away, which just means there is no server
+    error_code error;
+    socket_.send_to(boost::asio::buffer(sendbuf_), p.endpoint, 0, error);
+    if (error) {
+        probes_.erase(key);
+        return;
+    }
+
+    discovery_stats().count(kfcounter::packets_sent);
+    discovery_stats().count(kfcounter::bytes_sent, sendbuf_.size());
+
+    p.generation = ++generation_;
+    deadlines_.push_back({ key, p.generation, clock_type::now() + timeout_ });
+    arm();
+}
+
+void kfc::kfdiscovery::receive() {
+    socket_.async_receive_from(boost::asio::buffer(recvbuf_), sender_, [this](const error_code& error, std::size_t received) {
+        on_receive(error, received);
+    });
+}
+
+void kfc::kfdiscovery::on_receive(const error_code& error, std::size_t received) {
+    if (error == boost::asio::error::operation_aborted || !socket_.is_open())
+        return;
+
+    if (!error && sender_.address().is_v4()) {
+        discovery_stats().count(kfcounter::packets_received);
+        discovery_stats().count(kfcounter::bytes_received, received);
+
+        auto it = probes_.find(key(sender_));
+        if (it != probes_.end())
+            process(it->first, it->second, received);
+
+        fill();
+    }
+
+    // errors of earlier sends can surface on the receive, they do not end the sweep
+    finish_if_done();
+    if (socket_.is_open())
+        receive();
+}
+
+void kfc::kfdiscovery::process(std::uint64_t key, probe& p, std::size_t received) {
+    // details responses are far below the split size, a split answer is no query server of ours
+    if (protocol::is_split(recvbuf_.data(), received))
+        return;
+
+    kfdiscovered server;
+    try {
+        kfbuffer response(recvbuf_.data(), received);
+        kfheader header;
+        response.consume(header.magic);
+        response.consume(header.type);
+
+        if (header.magic != protocol::SINGLE_MAGIC)
+            return;
+
+        if (header.type == protocol::PACKET_CHALLENGE) {
+            // the first challenge, or a replaced one in answer to the details request
+            if (++p.challenges > protocol::MAX_CHALLENGES) {
+                probes_.erase(key);
+                return;
+            }
+
+            return send(key, p, protocol::PACKET_DETAILS, response.consume<std::int32_t>());
+        }
+
+        if (header.type != protocol::PACKET_DETAILS || p.challenges == 0)
+            return;
+
+        server.endpoint = p.endpoint;
+        server.details = std::make_shared<const kfdetails>(response, nullptr, utf8_policy_);
+        server.round_trip = clock_type::now() - p.started;
+        probes_.erase(key);
+    } catch (const std::exception&) {
+        discovery_stats().count(kfcounter::parse_failures);
+        probes_.erase(key);
+        return;
+    }
+
+    // outside of the try, what the handler throws is no parse failure but the caller's of run()
+    (*handler_)(server);
+}
+
+void kfc::kfdiscovery::arm() {
+    if (armed_ || deadlines_.empty())
+        return;
+
+    armed_ = true;
+    timer_.expires_at(deadlines_.front().expires);
+    timer_.async_wait([this](const error_code& error) {
+        armed_ = false;
+        if (!error)
+            expire();
+    });
+}
+
+void kfc::kfdiscovery::expire() {
+    // every probe waits equally long, so the deadlines are in order
+    auto now = clock_type::now();
+    while (!deadlines_.empty() && deadlines_.front().expires <= now) {
+        auto it = probes_.find(deadlines_.front().key);
+        if (it != probes_.end() && it->second.generation == deadlines_.front().generation)
+            probes_.erase(it);
+        deadlines_.pop_front();
+    }
+
+    fill();
+    finish_if_done();
+    arm();
+}
+
+void kfc::kfdiscovery::finish_if_done() {
+    // fill() ran before, so no probes left means no endpoints left either
+    if (!probes_.empty() || !socket_.is_open())
+        return;
+
+    error_code ignored;
+    socket_.close(ignored);
+    timer_.cancel();
+    deadlines_.clear();
+}
\ No newline at end of file
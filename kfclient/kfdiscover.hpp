@@ -0,0 +1,117 @@
+#ifndef kfclient_discover_hpp
+#define kfclient_discover_hpp
+
+#include "libdef.hpp"
+#include "kfdetails.hpp"
+#include "kfprotocol.hpp"
+
+#include <boost/asio.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace kfc {
+    struct kfdiscovered {
+        boost::asio::ip::udp::endpoint endpoint;
+        std::shared_ptr<const kfdetails> details;
+
+        // from sending the challenge until the details were received
+        std::chrono::steady_clock::duration round_trip {};
+    };
+
+    // Sweeps hosts and IPv4 networks across port ranges for query servers. Every endpoint is sent
+    // the challenge request and, when it answers, the details request, all from one socket with at
+    // most a given number of endpoints probed at once. Endpoints that do not answer within the
+    // timeout are skipped silently; no server on them is the common case.
+    class KFCLIENT_API kfdiscovery {
+        using io_context = boost::asio::io_context;
+        using udp = boost::asio::ip::udp;
+        using error_code = boost::system::error_code;
+        using clock_type = std::chrono::steady_clock;
+
+        static constexpr const std::size_t RECEIVE_BUFFER_SIZE = 2048;
+
+    public:
+        using handler_type = std::function<void(kfdiscovered& server)>;
+
+        kfdiscovery(std::size_t parallel, std::chrono::milliseconds timeout);
+
+        // A host name, an IPv4 address or an IPv4 network in CIDR notation (192.168.1.0/24), swept
+        // from port first to last. The network and broadcast addresses of a network are skipped.
+        // Throws when the host cannot be resolved or the network is malformed.
+        void add_range(const std::string& hosts, std::uint16_t first, std::uint16_t last);
+
+        // the number of endpoints that will be probed
+        std::uint64_t size() const noexcept;
+
+        // parse the details of the servers found under a policy, see kfclient::utf8_policy
+        void utf8_policy(utf8::policy policy) noexcept { utf8_policy_ = policy; }
+
+        // sweeps every range on the calling thread, the handler is called for every server found;
+        // an exception of the handler ends the sweep and is thrown from run()
+        void run(const handler_type& handler);
+
+    private:
+        struct range {
+            std::uint32_t address;
+            std::uint64_t addresses;
+            std::uint16_t first;
+            std::uint16_t last;
+        };
+
+        struct probe {
+            udp::endpoint endpoint;
+            clock_type::time_point started;
+            std::uint64_t generation;
+            std::size_t challenges;
+        };
+
+        struct deadline {
+            std::uint64_t key;
+            std::uint64_t generation;
+            clock_type::time_point expires;
+        };
+
+        static std::uint64_t key(const udp::endpoint& endpoint) noexcept;
+
+        void fill();
+        bool next_endpoint(udp::endpoint& endpoint);
+        void send(std::uint64_t key, probe& p, std::int8_t packet, std::int32_t challenge);
+        void receive();
+        void on_receive(const error_code& error, std::size_t received);
+        void process(std::uint64_t key, probe& p, std::size_t received);
+        void arm();
+        void expire();
+        void finish_if_done();
+
+        io_context context_;
+        udp::socket socket_;
+        boost::asio::steady_timer timer_;
+        std::vector<range> ranges_;
+        std::size_t parallel_;
+        std::chrono::milliseconds timeout_;
+
+        std::size_t range_ = 0;
+        std::uint64_t offset_ = 0;
+        std::uint64_t generation_ = 0;
+        std::unordered_map<std::uint64_t, probe> probes_;
+        std::deque<deadline> deadlines_;
+        bool armed_ = false;
+
+        std::array<std::uint8_t, RECEIVE_BUFFER_SIZE> recvbuf_ = {};
+        std::vector<std::uint8_t> sendbuf_;
+        udp::endpoint sender_;
+        const handler_type* handler_ = nullptr;
+        utf8::policy utf8_policy_ = utf8::policy::keep;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "kffleet.hpp"
+
+template <typename K, typename V>
+void kfc::kffleet::decrement(std::map<K, V>& counts, const K& key, V amount) {
+    auto it = counts.find(key);
+    if (it == counts.end())
+        return;
+
+    // keys without servers are dropped, so the totals only hold what is there
+    it->second -= amount;
+    if (it->second == 0)
+        counts.erase(it);
+}
+
+void kfc::kffleet::update(const std::string& server, const kfdetails& details) {
+    contribution next;
+    next.players = details.player_count;
+    next.slots = details.player_cap;
+    next.wave = details.waves_current;
+    next.length = details.waves_total;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto inserted = servers_.try_emplace(server);
+    auto& current = inserted.first->second;
+    if (inserted.second) {
+        next.map = details.map;
+        add(next);
+        current = std::move(next);
+        return;
+    }
+
+    // only the aggregates of the fields that changed are touched
+    auto map_changed = current.map != details.map.str();
+    if (map_changed || current.players != next.players) {
+        decrement(totals_.players_by_map, current.map, static_cast<std::uint64_t>(current.players));
+        if (map_changed) {
+            decrement(totals_.servers_by_map, current.map);
+            current.map = details.map;
+            totals_.servers_by_map[current.map]++;
+        }
+        if (next.players != 0)
+            totals_.players_by_map[current.map] += next.players;
+    }
+
+    if (current.players != next.players || current.slots != next.slots) {
+        totals_.players += next.players;
+        totals_.players -= current.players;
+        totals_.slots += next.slots;
+        totals_.slots -= current.slots;
+
+        auto free = free_slots(next);
+        if (free != free_slots(current)) {
+            decrement(totals_.servers_by_free_slots, free_slots(current));
+            totals_.servers_by_free_slots[free]++;
+        }
+
+        current.players = next.players;
+        current.slots = next.slots;
+    }
+
+    if (current.wave != next.wave) {
+        decrement(totals_.servers_by_wave, current.wave);
+        totals_.servers_by_wave[next.wave]++;
+        current.wave = next.wave;
+    }
+
+    if (current.length != next.length) {
+        decrement(totals_.servers_by_length, current.length);
+        totals_.servers_by_length[next.length]++;
+        current.length = next.length;
+    }
+}
+
+void kfc::kffleet::remove(const std::string& server) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = servers_.find(server);
+    if (it == servers_.end())
+        return;
+
+    subtract(it->second);
+    servers_.erase(it);
+}
+
+void kfc::kffleet::update(const kfpoll_result& result) {
+    auto server = result.host + ":" + std::to_string(result.port);
+    if (!result.error.empty())
+        return remove(server);
+    if (result.details != nullptr)
+        update(server, *result.details);
+}
+
+kfc::kffleet_totals kfc::kffleet::totals() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return totals_;
+}
+
+void kfc::kffleet::add(const contribution& c) {
+    totals_.servers++;
+    totals_.players += c.players;
+    totals_.slots += c.slots;
+    if (c.players != 0)
+        totals_.players_by_map[c.map] += c.players;
+    totals_.servers_by_map[c.map]++;
+    totals_.servers_by_wave[c.wave]++;
+    totals_.servers_by_length[c.length]++;
+    totals_.servers_by_free_slots[free_slots(c)]++;
+}
+
+void kfc::kffleet::subtract(const contribution& c) {
+    totals_.servers--;
+    totals_.players -= c.players;
+    totals_.slots -= c.slots;
+    decrement(totals_.players_by_map, c.map, static_cast<std::uint64_t>(c.players));
+    decrement(totals_.servers_by_map, c.map);
+    decrement(totals_.servers_by_wave, c.wave);
+    decrement(totals_.servers_by_length, c.length);
+    decrement(totals_.servers_by_free_slots, free_slots(c));
+}
\ No newline at end of file
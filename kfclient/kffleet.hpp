@@ -0,0 +1,73 @@
+#ifndef kfclient_fleet_hpp
+#define kfclient_fleet_hpp
+
+#include "libdef.hpp"
+#include "kfdetails.hpp"
+#include "kfpoller.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace kfc {
+    // the aggregates of a kffleet at one point in time
+    struct kffleet_totals {
+        std::size_t servers = 0;
+        std::uint64_t players = 0;
+        std::uint64_t slots = 0;
+
+        std::map<std::string, std::uint64_t> players_by_map;
+        std::map<std::string, std::size_t> servers_by_map;
+
+        // by current wave, and by game length (the total number of waves)
+        std::map<std::int32_t, std::size_t> servers_by_wave;
+        std::map<std::int32_t, std::size_t> servers_by_length;
+
+        // the number of servers with this many free slots
+        std::map<std::uint32_t, std::size_t> servers_by_free_slots;
+    };
+
+    // Running aggregates over the latest details of every server of a fleet. An update only
+    // touches the aggregates of the fields that changed since the previous update of the server,
+    // so its cost does not grow with the size of the fleet. Thread-safe.
+    class KFCLIENT_API kffleet {
+    public:
+        // the latest details of a server, which replace its previous ones
+        void update(const std::string& server, const kfdetails& details);
+
+        // a server that is gone or down no longer counts
+        void remove(const std::string& server);
+
+        // updates with the details of a poll as host:port, or removes the server when it failed
+        void update(const kfpoll_result& result);
+
+        kffleet_totals totals() const;
+
+    private:
+        // what a server currently contributes to the aggregates
+        struct contribution {
+            std::string map;
+            std::uint32_t players = 0;
+            std::uint32_t slots = 0;
+            std::int32_t wave = 0;
+            std::int32_t length = 0;
+        };
+
+        void add(const contribution& c);
+        void subtract(const contribution& c);
+
+        template <typename K, typename V>
+        static void decrement(std::map<K, V>& counts, const K& key, V amount = 1);
+
+        static std::uint32_t free_slots(const contribution& c) noexcept { return c.slots > c.players ? c.slots - c.players : 0; }
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, contribution> servers_;
+        kffleet_totals totals_;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef kfclient_hash_hpp
+#define kfclient_hash_hpp
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace kfc {
+    // A fast non-cryptographic 64 bit hash of a byte range: eight bytes per step with a
+    // multiply-rotate mix and the murmur3 finalizer. Good enough to tell responses apart,
+    // never use it where an attacker picks the input to collide, see kfsiphash for that.
+    inline std::uint64_t kfhash(const std::uint8_t* data, std::size_t size) noexcept {
+        constexpr const std::uint64_t K1 = 0x9E3779B97F4A7C15ULL;
+        constexpr const std::uint64_t K2 = 0xC2B2AE3D27D4EB4FULL;
+
+        auto rotl = [](std::uint64_t v, unsigned r) { return (v << r) | (v >> (64U - r)); };
+        std::uint64_t h = K1 ^ (size * K2);
+
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, data + i, sizeof(word));
+            h ^= rotl(word * K2, 31) * K1;
+            h = (rotl(h, 27) * 5) + 0x52DCE729;
+        }
+
+        std::uint64_t tail = 0;
+        std::memcpy(&tail, data + i, size - i);
+        h ^= rotl(tail * K2, 31) * K1;
+
+        h ^= h >> 33U;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33U;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33U;
+        return h;
+    }
+
+    // SipHash-C-D (Aumasson and Bernstein) of a byte range under a 128 bit key, for tables keyed on
+    // text that others choose: without the key, inputs that collide cannot be worked out. The
+    // interner uses SipHash-1-3 under a key drawn once per process. Words are read in host byte
+    // order, which matches the reference on little-endian hosts.
+    template <unsigned C = 1, unsigned D = 3>
+    inline std::uint64_t kfsiphash(const std::uint8_t* data, std::size_t size, const std::array<std::uint64_t, 2>& key) noexcept {
+        auto rotl = [](std::uint64_t v, unsigned r) { return (v << r) | (v >> (64U - r)); };
+
+        std::uint64_t v0 = 0x736F6D6570736575ULL ^ key[0];
+        std::uint64_t v1 = 0x646F72616E646F6DULL ^ key[1];
+        std::uint64_t v2 = 0x6C7967656E657261ULL ^ key[0];
+        std::uint64_t v3 = 0x7465646279746573ULL ^ key[1];
+
+        auto rounds = [&](unsigned count) {
+            for (unsigned r = 0; r < count; ++r) {
+                v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+                v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+                v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+                v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+            }
+        };
+
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, data + i, sizeof(word));
+            v3 ^= word;
+            rounds(C);
+            v0 ^= word;
+        }
+
+        // the last block holds the remaining bytes and the length in its top byte
+        std::uint64_t last = static_cast<std::uint64_t>(size) << 56U;
+        for (std::size_t b = 0; i + b < size; ++b)
+            last |= static_cast<std::uint64_t>(data[i + b]) << (8U * b);
+
+        v3 ^= last;
+        rounds(C);
+        v0 ^= last;
+
+        v2 ^= 0xFF;
+        rounds(D);
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+}
+
+#endif
\ No newline at end of file
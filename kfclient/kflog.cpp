@@ -0,0 +1,312 @@
+#include "kflog.hpp"
+#include "kfvarint.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace {
+    using kfc::detail::put_varint;
+    using kfc::detail::put_zigzag;
+    using kfc::detail::get_varint;
+    using kfc::detail::get_zigzag;
+
+    constexpr const std::array<char, 8> KFLOG_FILE_MAGIC = { 'K', 'F', 'L', 'O', 'G', 0, 0, 1 };
+    constexpr const std::uint32_t KFLOG_SEGMENT_MAGIC = 0x47534B46; // "KFSG"
+    constexpr const std::size_t KFLOG_SEGMENT_HEADER = 2 * sizeof(std::uint32_t);
+
+    void put_u32(std::vector<std::uint8_t>& out, std::uint32_t value) {
+        for (unsigned i = 0; i < 4; ++i)
+            out.push_back(static_cast<std::uint8_t>(value >> (8U * i)));
+    }
+
+    std::uint32_t get_u32(const std::uint8_t* p) {
+        return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8U) |
+            (static_cast<std::uint32_t>(p[2]) << 16U) | (static_cast<std::uint32_t>(p[3]) << 24U);
+    }
+
+    std::string server_key(const std::string& host, std::uint16_t port) {
+        return host + ":" + std::to_string(port);
+    }
+}
+
+kfc::kflog_writer::kflog_writer(const std::string& path, std::size_t segment_records)
+    : segment_records_(segment_records == 0 ? 1 : segment_records), records_(0), first_timestamp_(0), last_timestamp_(0) {
+        std::error_code error;
+        auto exists = std::filesystem::file_size(path, error) > 0 && !error;
+
+        if (exists) {
+            std::size_t valid_size = 0;
+
+            {
+                // continue the string table of the existing log
+                kflog_reader reader(path);
+                for (std::size_t i = 0; i < reader.strings_.size(); ++i)
+                    strings_.emplace(reader.strings_[i], i);
+                valid_size = reader.valid_size_;
+            }
+
+            // drop a segment torn by a crash, so that appended segments remain reachable
+            if (valid_size != std::filesystem::file_size(path))
+                std::filesystem::resize_file(path, valid_size);
+        }
+
+        file_.open(path, std::ios::binary | std::ios::app);
+        if (!file_)
+            throw std::runtime_error("kflog_writer cannot open " + path);
+
+        if (!exists)
+            file_.write(KFLOG_FILE_MAGIC.data(), KFLOG_FILE_MAGIC.size());
+}
+
+kfc::kflog_writer::~kflog_writer() {
+    try {
+        flush();
+    } catch (...) { // NOLINT(bugprone-empty-catch) -- destructors must not throw
+    }
+}
+
+std::uint64_t kfc::kflog_writer::intern(const std::string& value) {
+    auto iter = strings_.find(value);
+    if (iter != strings_.end())
+        return iter->second;
+
+    iter = strings_.emplace(value, strings_.size()).first;
+    new_strings_.push_back(&iter->first);
+    return iter->second;
+}
+
+void kfc::kflog_writer::append(const std::string& host, std::uint16_t port, const kfsnapshot& snapshot) {
+    auto server = intern(server_key(host, port));
+    auto& state = servers_[server];
+
+    record_.clear();
+    put_varint(record_, server);
+    put_zigzag(record_, static_cast<std::int64_t>(snapshot.timestamp - state.timestamp));
+    put_varint(record_, snapshot.flags);
+
+    if ((snapshot.flags & kfsnapshot::HAS_DETAILS) != 0) {
+        put_zigzag(record_, snapshot.player_count - state.player_count);
+        put_zigzag(record_, snapshot.player_cap - state.player_cap);
+        put_zigzag(record_, snapshot.waves_total - state.waves_total);
+        put_zigzag(record_, snapshot.waves_current - state.waves_current);
+        put_varint(record_, intern(snapshot.hostname.str()));
+        put_varint(record_, intern(snapshot.map.str()));
+
+        state.player_count = snapshot.player_count;
+        state.player_cap = snapshot.player_cap;
+        state.waves_total = snapshot.waves_total;
+        state.waves_current = snapshot.waves_current;
+    }
+
+    if ((snapshot.flags & kfsnapshot::HAS_PLAYERS) != 0) {
+        put_varint(record_, snapshot.player_list_count);
+        for (std::size_t i = 0; i < snapshot.player_list_count; ++i) {
+            const auto& player = snapshot.player_list.at(i);
+            put_varint(record_, intern(player.name.str()));
+            put_varint(record_, player.score);
+            put_varint(record_, player.time);
+        }
+    }
+
+    if ((snapshot.flags & kfsnapshot::HAS_ERROR) != 0)
+        put_varint(record_, intern(snapshot.error.str()));
+
+    put_varint(segment_, record_.size());
+    segment_.insert(segment_.end(), record_.begin(), record_.end());
+
+    first_timestamp_ = records_ == 0 ? snapshot.timestamp : std::min(first_timestamp_, snapshot.timestamp);
+    last_timestamp_ = std::max(last_timestamp_, snapshot.timestamp);
+    state.timestamp = snapshot.timestamp;
+    state.records++;
+
+    if (++records_ >= segment_records_)
+        flush();
+}
+
+void kfc::kflog_writer::flush() {
+    if (records_ == 0)
+        return;
+
+    auto index_offset = static_cast<std::uint32_t>(KFLOG_SEGMENT_HEADER + segment_.size());
+
+    put_varint(segment_, new_strings_.size());
+    for (const auto* value : new_strings_) {
+        put_varint(segment_, value->size());
+        segment_.insert(segment_.end(), value->begin(), value->end());
+    }
+
+    put_varint(segment_, first_timestamp_);
+    put_varint(segment_, last_timestamp_ - first_timestamp_);
+
+    put_varint(segment_, servers_.size());
+    for (const auto& pair : servers_) {
+        put_varint(segment_, pair.first);
+        put_varint(segment_, pair.second.records);
+    }
+
+    put_u32(segment_, index_offset);
+
+    std::vector<std::uint8_t> header;
+    put_u32(header, KFLOG_SEGMENT_MAGIC);
+    put_u32(header, static_cast<std::uint32_t>(KFLOG_SEGMENT_HEADER + segment_.size()));
+
+    file_.write(static_cast<const char*>(static_cast<const void*>(header.data())), static_cast<std::streamsize>(header.size()));
+    file_.write(static_cast<const char*>(static_cast<const void*>(segment_.data())), static_cast<std::streamsize>(segment_.size()));
+    file_.flush();
+
+    if (!file_)
+        throw std::runtime_error("kflog_writer failed to write a segment");
+
+    segment_.clear();
+    new_strings_.clear();
+    servers_.clear();
+    records_ = 0;
+    first_timestamp_ = last_timestamp_ = 0;
+}
+
+kfc::kflog_reader::kflog_reader(const std::string& path)
+    : file_(path.c_str(), boost::interprocess::read_only), region_(file_, boost::interprocess::read_only), valid_size_(0) {
+        const auto* begin = static_cast<const std::uint8_t*>(region_.get_address());
+        const auto* end = begin + region_.get_size();
+
+        if (region_.get_size() < KFLOG_FILE_MAGIC.size() || std::memcmp(begin, KFLOG_FILE_MAGIC.data(), KFLOG_FILE_MAGIC.size()) != 0)
+            throw std::runtime_error("kflog_reader " + path + " is not a snapshot log");
+
+        const auto* p = begin + KFLOG_FILE_MAGIC.size();
+        while (end - p >= static_cast<std::ptrdiff_t>(KFLOG_SEGMENT_HEADER)) {
+            auto length = get_u32(p + sizeof(std::uint32_t));
+            if (get_u32(p) != KFLOG_SEGMENT_MAGIC || length < KFLOG_SEGMENT_HEADER + sizeof(std::uint32_t) || length > static_cast<std::size_t>(end - p))
+                break; // a torn trailing segment, ignore it
+
+            const auto* segment_end = p + length - sizeof(std::uint32_t);
+            auto index_offset = get_u32(segment_end);
+            if (index_offset < KFLOG_SEGMENT_HEADER || p + index_offset > segment_end)
+                throw std::runtime_error("kflog_reader " + path + " has a corrupt segment index");
+
+            segment s { p + KFLOG_SEGMENT_HEADER, p + index_offset, 0, 0, {} };
+
+            const auto* index = p + index_offset;
+            auto string_count = get_varint(index, segment_end);
+            for (std::uint64_t i = 0; i < string_count; ++i) {
+                auto size = get_varint(index, segment_end);
+                if (size > static_cast<std::uint64_t>(segment_end - index))
+                    throw std::range_error("kflog string runs past the end of the segment");
+                strings_.emplace_back(static_cast<const char*>(static_cast<const void*>(index)), size);
+                ids_.emplace(strings_.back(), strings_.size() - 1);
+                index += size;
+            }
+
+            s.first_timestamp = get_varint(index, segment_end);
+            s.last_timestamp = s.first_timestamp + get_varint(index, segment_end);
+
+            auto server_count = get_varint(index, segment_end);
+            for (std::uint64_t i = 0; i < server_count; ++i) {
+                auto server = get_varint(index, segment_end);
+                s.servers[server] = get_varint(index, segment_end);
+            }
+
+            segments_.push_back(std::move(s));
+            p += length;
+        }
+
+        valid_size_ = static_cast<std::size_t>(p - begin);
+}
+
+std::vector<std::string> kfc::kflog_reader::servers() const {
+    std::vector<std::string> result;
+    std::unordered_map<std::uint64_t, bool> seen;
+
+    for (const auto& s : segments_) {
+        for (const auto& pair : s.servers) {
+            if (!seen[pair.first]) {
+                seen[pair.first] = true;
+                result.push_back(strings_.at(pair.first));
+            }
+        }
+    }
+
+    return result;
+}
+
+std::size_t kfc::kflog_reader::scan(const std::string& host, std::uint16_t port, const callback_type& callback, std::uint64_t from, std::uint64_t to) const {
+    auto iter = ids_.find(server_key(host, port));
+    if (iter == ids_.end())
+        return 0;
+
+    const auto server = iter->second;
+    const auto string = [this](std::uint64_t id) { return &strings_.at(id); };
+
+    std::size_t matched = 0;
+    kflog_record record;
+    kflog_record details; // the details are delta encoded against the previous record that had them
+
+    for (const auto& s : segments_) {
+        if (s.servers.count(server) == 0 || s.last_timestamp < from || s.first_timestamp > to)
+            continue;
+
+        record = kflog_record();
+        details = kflog_record();
+        const auto* p = s.records;
+
+        while (p < s.records_end) {
+            auto length = get_varint(p, s.records_end);
+            if (length > static_cast<std::uint64_t>(s.records_end - p))
+                throw std::range_error("kflog record runs past the end of the segment");
+
+            const auto* next = p + length;
+            if (get_varint(p, next) != server) {
+                p = next;
+                continue;
+            }
+
+            record.timestamp += static_cast<std::uint64_t>(get_zigzag(p, next));
+            record.flags = static_cast<std::uint32_t>(get_varint(p, next));
+
+            // the details of a record without them are reset, not left over from the one before
+            if ((record.flags & kfsnapshot::HAS_DETAILS) != 0) {
+                details.player_count = static_cast<std::uint8_t>(details.player_count + get_zigzag(p, next));
+                details.player_cap = static_cast<std::uint8_t>(details.player_cap + get_zigzag(p, next));
+                details.waves_total = static_cast<std::int32_t>(details.waves_total + get_zigzag(p, next));
+                details.waves_current = static_cast<std::int32_t>(details.waves_current + get_zigzag(p, next));
+                record.player_count = details.player_count;
+                record.player_cap = details.player_cap;
+                record.waves_total = details.waves_total;
+                record.waves_current = details.waves_current;
+                record.hostname = string(get_varint(p, next));
+                record.map = string(get_varint(p, next));
+            } else {
+                record.player_count = 0;
+                record.player_cap = 0;
+                record.waves_total = 0;
+                record.waves_current = 0;
+                record.hostname = nullptr;
+                record.map = nullptr;
+            }
+
+            record.players.clear();
+            if ((record.flags & kfsnapshot::HAS_PLAYERS) != 0) {
+                auto count = get_varint(p, next);
+                for (std::uint64_t i = 0; i < count; ++i) {
+                    kflog_player player;
+                    player.name = string(get_varint(p, next));
+                    player.score = static_cast<std::uint32_t>(get_varint(p, next));
+                    player.time = static_cast<std::uint32_t>(get_varint(p, next));
+                    record.players.push_back(player);
+                }
+            }
+
+            record.error = (record.flags & kfsnapshot::HAS_ERROR) != 0 ? string(get_varint(p, next)) : nullptr;
+            p = next;
+
+            if (record.timestamp >= from && record.timestamp <= to) {
+                callback(record);
+                matched++;
+            }
+        }
+    }
+
+    return matched;
+}
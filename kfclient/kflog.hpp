@@ -0,0 +1,129 @@
+#ifndef kfclient_log_hpp
+#define kfclient_log_hpp
+
+#include "libdef.hpp"
+#include "kfsnapshot.hpp"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace kfc {
+    /*
+        The snapshot log is an append-only sequence of self-contained segments:
+
+            file    := "KFLOG" 0 0 version(u8) segment*
+            segment := magic(u32) length(u32) record* index index_offset(u32)
+            record  := length(varint) server(varint) payload
+            index   := strings first_timestamp last_timestamp servers
+
+        All integers inside a segment are (zigzag) varints, timestamps and counters are delta encoded
+        against the previous record of the same server in the same segment and strings (hosts, maps,
+        player names, errors) are referenced by id into a string table that every segment index extends.
+        A reader can therefore hop from index to index and only decode the segments containing a server.
+    */
+
+    struct kflog_player {
+        const std::string* name = nullptr;
+        std::uint32_t score = 0;
+        std::uint32_t time = 0;
+    };
+
+    struct kflog_record {
+        std::uint64_t timestamp = 0; // milliseconds since the unix epoch
+        std::uint32_t flags = 0;     // kfsnapshot::HAS_*
+
+        // only set when flags has kfsnapshot::HAS_DETAILS, null and 0 otherwise
+        const std::string* hostname = nullptr;
+        const std::string* map = nullptr;
+        std::uint8_t player_count = 0;
+        std::uint8_t player_cap = 0;
+        std::int32_t waves_total = 0;
+        std::int32_t waves_current = 0;
+
+        std::vector<kflog_player> players;
+        const std::string* error = nullptr;
+    };
+
+    class KFCLIENT_API kflog_writer {
+    public:
+        static constexpr const std::size_t DEFAULT_SEGMENT_RECORDS = 4096;
+
+        // segments are buffered in memory and written when sealed, a crash loses at most one segment
+        explicit kflog_writer(const std::string& path, std::size_t segment_records = DEFAULT_SEGMENT_RECORDS);
+        ~kflog_writer();
+
+        kflog_writer(const kflog_writer&) = delete;
+        kflog_writer(kflog_writer&&) = delete;
+        kflog_writer& operator=(const kflog_writer&) = delete;
+        kflog_writer& operator=(kflog_writer&&) = delete;
+
+        void append(const std::string& host, std::uint16_t port, const kfsnapshot& snapshot);
+        void flush();
+
+    private:
+        struct server_state {
+            std::uint64_t records = 0;
+            std::uint64_t timestamp = 0;
+            std::int64_t player_count = 0;
+            std::int64_t player_cap = 0;
+            std::int64_t waves_total = 0;
+            std::int64_t waves_current = 0;
+        };
+
+        std::uint64_t intern(const std::string& value);
+
+        std::ofstream file_;
+        std::size_t segment_records_;
+        std::size_t records_;
+        std::uint64_t first_timestamp_;
+        std::uint64_t last_timestamp_;
+        std::vector<std::uint8_t> segment_;
+        std::vector<std::uint8_t> record_;
+        std::unordered_map<std::string, std::uint64_t> strings_;
+        std::vector<const std::string*> new_strings_;
+        std::unordered_map<std::uint64_t, server_state> servers_;
+    };
+
+    class KFCLIENT_API kflog_reader {
+    public:
+        using callback_type = std::function<void(const kflog_record&)>;
+
+        explicit kflog_reader(const std::string& path);
+
+        // every server ("host:port") that occurs in the log
+        std::vector<std::string> servers() const;
+
+        // invoke callback for every record of host:port with a timestamp in [from, to], in order
+        std::size_t scan(const std::string& host, std::uint16_t port, const callback_type& callback,
+            std::uint64_t from = 0, std::uint64_t to = std::numeric_limits<std::uint64_t>::max()) const;
+
+    private:
+        friend class kflog_writer;
+
+        struct segment {
+            const std::uint8_t* records;
+            const std::uint8_t* records_end;
+            std::uint64_t first_timestamp;
+            std::uint64_t last_timestamp;
+            std::unordered_map<std::uint64_t, std::uint64_t> servers; // server id -> record count
+        };
+
+        boost::interprocess::file_mapping file_;
+        boost::interprocess::mapped_region region_;
+        std::vector<std::string> strings_;
+        std::unordered_map<std::string, std::uint64_t> ids_;
+        std::vector<segment> segments_;
+        std::size_t valid_size_;
+    };
+}
+
+#endif
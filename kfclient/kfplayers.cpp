@@ -1,12 +1,9 @@
 #include "kfplayers.hpp"
 
-kfc::kfplayer::kfplayer(const kfbuffer& buff) {
-    buff.consume(id, name, score, time);
+kfc::kfplayer::kfplayer(const kfbuffer& buff, kfinterner* interner, utf8::policy policy) {
+    schema::parse(buff, *this, interner, policy);
 }
 
-kfc::kfplayers::kfplayers(const kfbuffer& buff) {
-    buff.consume(count);
-
-    for (std::uint8_t i = 0; i < count; ++i) 
-        players.emplace_back(buff);
+kfc::kfplayers::kfplayers(const kfbuffer& buff, kfinterner* interner, utf8::policy policy) {
+    schema::parse(buff, *this, interner, policy);
 } 
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define kfclient_players_hpp
 
 #include "kfbuffer.hpp"
+#include "kfschema.hpp"
+#include "kfstring.hpp"
 
 #include <cstdint>
 #include <cstdlib>
@@ -11,20 +13,35 @@
 
 namespace kfc {
     struct kfplayer {
-        explicit kfplayer(const kfbuffer& buff);
+        kfplayer() = default;
+        // names are shared through the interner when one is given, see kfinterner
+        explicit kfplayer(const kfbuffer& buff, kfinterner* interner = nullptr, utf8::policy policy = utf8::policy::keep);
 
         std::uint8_t id = 0;
-        std::string name;
+        kfstring name;
         std::uint32_t score = 0;
         std::uint32_t time = 0;
     };
 
     struct kfplayers {
-        explicit kfplayers(const kfbuffer& buff);
+        kfplayers() = default;
+        explicit kfplayers(const kfbuffer& buff, kfinterner* interner = nullptr, utf8::policy policy = utf8::policy::keep);
 
         std::uint8_t count = 0;
         std::vector<kfplayer> players;
     };
+
+    namespace schema {
+        template <>
+        struct of<kfplayer> {
+            using type = layout<value<&kfplayer::id>, string<&kfplayer::name>, value<&kfplayer::score>, value<&kfplayer::time>>;
+        };
+
+        template <>
+        struct of<kfplayers> {
+            using type = layout<repeated<&kfplayers::count, &kfplayers::players>>;
+        };
+    }
 }
 
 #endif 
\ No newline at end of file
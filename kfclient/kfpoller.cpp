@@ -0,0 +1,216 @@
+#include "kfpoller.hpp"
+
+#include <thread>
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+
+static constexpr const std::chrono::milliseconds STOP_CHECK_INTERVAL(100);
+
+// Threads that wait for a job and run it together with the thread that hands it to them, one job
+// at a time. A job must not throw.
+class kfc::kfpoller::workers {
+public:
+    explicit workers(std::size_t count) {
+        threads_.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+            threads_.emplace_back([this]() { loop(); });
+    }
+
+    ~workers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+
+        wake_.notify_all();
+        for (auto& thread : threads_)
+            thread.join();
+    }
+
+    workers(const workers&) = delete;
+    workers(workers&&) = delete;
+    workers& operator=(const workers&) = delete;
+    workers& operator=(workers&&) = delete;
+
+    std::size_t size() const noexcept { return threads_.size(); }
+
+    // runs job on every worker and on the calling thread, returns when all of them are done
+    void run(const std::function<void()>& job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &job;
+            busy_ = threads_.size();
+            ++round_;
+        }
+
+        wake_.notify_all();
+        job();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return busy_ == 0; });
+        job_ = nullptr;
+    }
+
+private:
+    void loop() {
+        std::uint64_t seen = 0;
+
+        for (;;) {
+            const std::function<void()>* job = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this, seen]() { return closed_ || round_ != seen; });
+                if (closed_)
+                    return;
+
+                seen = round_;
+                job = job_;
+            }
+
+            (*job)();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busy_ == 0)
+                done_.notify_one();
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void()>* job_ = nullptr;
+    std::uint64_t round_ = 0;
+    std::size_t busy_ = 0;
+    bool closed_ = false;
+};
+
+kfc::kfpoller::kfpoller(std::chrono::milliseconds interval, std::chrono::milliseconds timeout, std::uint32_t sections)
+    : context_(), interval_(interval), timeout_(timeout), sections_(sections), stopped_(false) {}
+
+kfc::kfpoller::~kfpoller() = default;
+
+void kfc::kfpoller::add_target(const std::string& host, std::uint16_t port) {
+    targets_.push_back({ host, port, nullptr });
+}
+
+void kfc::kfpoller::poll(const callback_type& callback) {
+    auto threads = std::min(parallel_, targets_.size());
+    if (threads > 1)
+        return poll_parallel(callback, threads);
+
+    for (auto& t : targets_) {
+        if (stopped_.load())
+            return;
+        poll_target(t, callback);
+    }
+}
+
+void kfc::kfpoller::poll_parallel(const callback_type& callback, std::size_t threads) {
+    std::atomic<std::size_t> next { 0 };
+    std::mutex mutex;
+    std::exception_ptr error;
+
+    // one at a time, the callers keep the guarantees of a serial poll
+    callback_type serialized = [&callback, &mutex](const kfpoll_result& result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        callback(result);
+    };
+
+    std::function<void()> work = [this, &next, &mutex, &error, &serialized]() {
+        for (;;) {
+            auto index = next++;
+            if (index >= targets_.size() || stopped_.load())
+                return;
+
+            try {
+                poll_target(targets_[index], serialized);
+            } catch (...) {
+                // a callback threw, which ends the round like it ends a serial one
+                std::lock_guard<std::mutex> lock(mutex);
+                if (error == nullptr)
+                    error = std::current_exception();
+                next = targets_.size();
+                return;
+            }
+        }
+    };
+
+    if (workers_ != nullptr && workers_->size() + 1 == threads) {
+        workers_->run(work);
+    } else {
+        workers pool(threads - 1);
+        pool.run(work);
+    }
+
+    if (error != nullptr)
+        std::rethrow_exception(error);
+}
+
+void kfc::kfpoller::run(const callback_type& callback) {
+    auto threads = std::min(parallel_, targets_.size());
+    if (threads > 1)
+        workers_ = std::make_unique<workers>(threads - 1);
+
+    try {
+        while (!stopped_.load()) {
+            auto next = std::chrono::steady_clock::now() + interval_;
+            poll(callback);
+
+            while (!stopped_.load()) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= next)
+                    break;
+                std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(next - now, STOP_CHECK_INTERVAL));
+            }
+        }
+    } catch (...) {
+        workers_ = nullptr;
+        throw;
+    }
+
+    workers_ = nullptr;
+}
+
+void kfc::kfpoller::poll_target(target& t, const callback_type& callback) {
+    kfpoll_result result { t.host, t.port, nullptr, nullptr, nullptr, {}, {}, {}, false, false, false, std::string(), false };
+
+    try {
+        if (t.client == nullptr) {
+            udp::resolver resolver(context_);
+            auto endpoints = resolver.resolve(udp::v4(), t.host, std::to_string(t.port));
+            t.client = std::make_unique<kfclient>(context_, endpoints);
+            t.client->timeout(timeout_);
+            t.client->capture(capture_);
+            t.client->interner(interner_);
+            t.client->utf8_policy(utf8_policy_);
+        }
+
+        if ((sections_ & SECTION_DETAILS) != 0) {
+            result.details = &t.client->request_details();
+            result.details_round_trip = t.client->round_trip();
+            result.details_unchanged = t.client->unchanged();
+        }
+        if ((sections_ & SECTION_RULES) != 0) {
+            result.rules = &t.client->request_rules();
+            result.rules_round_trip = t.client->round_trip();
+            result.rules_unchanged = t.client->unchanged();
+        }
+        if ((sections_ & SECTION_PLAYERS) != 0) {
+            result.players = &t.client->request_players();
+            result.players_round_trip = t.client->round_trip();
+            result.players_unchanged = t.client->unchanged();
+        }
+    } catch (const std::exception& ex) {
+        // reconnect (and resolve again) on the next round
+        t.client = nullptr;
+        result.details = nullptr;
+        result.rules = nullptr;
+        result.players = nullptr;
+        result.error = ex.what();
+        result.timed_out = dynamic_cast<const timeout_error*>(&ex) != nullptr;
+    }
+
+    callback(result);
+}
@@ -0,0 +1,112 @@
+#ifndef kfclient_poller_hpp
+#define kfclient_poller_hpp
+
+#include "libdef.hpp"
+#include "kfclient.hpp"
+
+#include <boost/asio.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace kfc {
+    struct kfpoll_result {
+        const std::string& host;
+        std::uint16_t port;
+
+        // only set for the sections that were requested and succeeded
+        const kfdetails* details = nullptr;
+        const kfrules* rules = nullptr;
+        const kfplayers* players = nullptr;
+
+        // round trip of every successful request, see kfclient::round_trip
+        std::chrono::steady_clock::duration details_round_trip {};
+        std::chrono::steady_clock::duration rules_round_trip {};
+        std::chrono::steady_clock::duration players_round_trip {};
+
+        // set when a section is byte-identical to the previous poll, see kfclient::unchanged
+        bool details_unchanged = false;
+        bool rules_unchanged = false;
+        bool players_unchanged = false;
+
+        std::string error;
+        bool timed_out = false;
+    };
+
+    // Periodically queries a list of servers, reusing one client (and socket) per server. A round
+    // polls up to parallel() servers at the same time, each on a thread of its own, so servers that
+    // do not answer hold up only their own thread; the callback is never called concurrently. run()
+    // starts those threads once and hands them every round.
+    class KFCLIENT_API kfpoller {
+        using io_context = boost::asio::io_context;
+        using udp = boost::asio::ip::udp;
+
+    public:
+        using callback_type = std::function<void(const kfpoll_result&)>;
+
+        kfpoller(std::chrono::milliseconds interval, std::chrono::milliseconds timeout, std::uint32_t sections = SECTION_DETAILS | SECTION_PLAYERS);
+        ~kfpoller();
+
+        kfpoller(const kfpoller&) = delete;
+        kfpoller(kfpoller&&) = delete;
+        kfpoller& operator=(const kfpoller&) = delete;
+        kfpoller& operator=(kfpoller&&) = delete;
+
+        void add_target(const std::string& host, std::uint16_t port);
+
+        // record the datagrams of every target, see kfclient::capture
+        void capture(kfcapture_writer* writer) noexcept { capture_ = writer; }
+
+        // share the strings of every target through an interner, see kfclient::interner
+        void interner(kfinterner* interner) noexcept { interner_ = interner; }
+
+        // parse the text of every target under a policy, see kfclient::utf8_policy
+        void utf8_policy(utf8::policy policy) noexcept { utf8_policy_ = policy; }
+
+        std::size_t size() const noexcept { return targets_.size(); }
+
+        // how many servers are polled at the same time, 1 (one after another) by default
+        void parallel(std::size_t parallel) noexcept { parallel_ = parallel < 1 ? 1 : parallel; }
+        std::size_t parallel() const noexcept { return parallel_; }
+
+        // query every target once
+        void poll(const callback_type& callback);
+
+        // poll every interval until stop() is called; stop() is safe to call from a signal handler
+        void run(const callback_type& callback);
+        void stop() noexcept { stopped_.store(true); }
+
+    private:
+        class workers;
+
+        struct target {
+            std::string host;
+            std::uint16_t port;
+            std::unique_ptr<kfclient> client;
+        };
+
+        void poll_target(target& t, const callback_type& callback);
+        void poll_parallel(const callback_type& callback, std::size_t threads);
+
+        io_context context_;
+        std::unique_ptr<workers> workers_; // the threads of run(), a lone poll() starts its own
+        std::vector<target> targets_;
+        std::size_t parallel_ = 1;
+        std::chrono::milliseconds interval_;
+        std::chrono::milliseconds timeout_;
+        std::uint32_t sections_;
+        std::atomic<bool> stopped_;
+        kfcapture_writer* capture_ = nullptr;
+        kfinterner* interner_ = nullptr;
+        utf8::policy utf8_policy_ = utf8::policy::keep;
+    };
+}
+
+#endif
@@ -0,0 +1,91 @@
+#include "kfprotocol.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+bool kfc::protocol::is_split(const std::uint8_t* data, std::size_t size) noexcept {
+    if (size < sizeof(std::int32_t))
+        return false;
+
+    std::int32_t magic = 0;
+    std::memcpy(&magic, data, sizeof(magic));
+    return magic == SPLIT_MAGIC;
+}
+
+bool kfc::kfreassembler::add(const std::uint8_t* data, std::size_t size) {
+    if (size < protocol::SPLIT_HEADER_SIZE)
+        throw std::runtime_error("truncated split packet received");
+
+    std::int32_t magic = 0;
+    std::int32_t id = 0;
+    std::memcpy(&magic, data, sizeof(magic));
+    std::memcpy(&id, data + sizeof(magic), sizeof(id));
+    std::uint8_t total = data[8];
+    std::uint8_t number = data[9];
+
+    if (magic != protocol::SPLIT_MAGIC)
+        throw std::runtime_error("unexpected header magic received in split response");
+    if ((static_cast<std::uint32_t>(id) & 0x80000000U) != 0)
+        throw std::runtime_error("compressed split responses are not supported");
+
+    auto& current = find(id, total);
+    if (number >= current.total || total != current.total)
+        throw std::runtime_error("invalid split packet number received");
+
+    if (!current.received[number]) {
+        current.parts.at(number).assign(data + protocol::SPLIT_HEADER_SIZE, data + size);
+        current.received[number] = true;
+        current.remaining--;
+    }
+
+    if (current.remaining != 0)
+        return false;
+
+    payload_.clear();
+    for (std::size_t i = 0; i < current.total; ++i)
+        payload_.insert(payload_.end(), current.parts.at(i).begin(), current.parts.at(i).end());
+
+    current.total = 0;
+    return true;
+}
+
+kfc::kfreassembler::response& kfc::kfreassembler::find(std::int32_t id, std::uint8_t total) {
+    response* unused = nullptr;
+    response* oldest = nullptr;
+
+    for (auto& r : responses_) {
+        if (r.total == 0) {
+            if (unused == nullptr)
+                unused = &r;
+        } else if (r.id == id) {
+            return r;
+        } else if (oldest == nullptr || r.started < oldest->started) {
+            oldest = &r;
+        }
+    }
+
+    if (total == 0)
+        throw std::runtime_error("split response without packets received");
+
+    if (unused == nullptr && responses_.size() < MAX_RESPONSES) {
+        responses_.emplace_back();
+        unused = &responses_.back();
+    }
+
+    // the oldest response was most likely abandoned, its remaining datagrams are ignored
+    auto& r = unused != nullptr ? *unused : *oldest;
+    if (r.parts.size() < total)
+        r.parts.resize(total);
+    r.received.assign(total, false);
+    r.total = r.remaining = total;
+    r.started = ++started_;
+    r.id = id;
+    return r;
+}
+
+void kfc::kfreassembler::reset() noexcept {
+    for (auto& r : responses_) {
+        r.total = 0;
+        r.remaining = 0;
+    }
+}
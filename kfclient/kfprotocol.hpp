@@ -0,0 +1,90 @@
+#ifndef kfclient_protocol_hpp
+#define kfclient_protocol_hpp
+
+#include "libdef.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace kfc {
+    namespace protocol {
+        static constexpr const std::int8_t PACKET_CHALLENGE = 'A';
+        static constexpr const std::int8_t PACKET_PLAYERS = 'D';
+        static constexpr const std::int8_t PACKET_DETAILS = 'I';
+        static constexpr const std::int8_t PACKET_RULES = 'E';
+
+        static constexpr const std::int32_t SINGLE_MAGIC = -1;
+        static constexpr const std::int32_t SPLIT_MAGIC = -2;
+
+        // int32 -2, int32 id, uint8 total, uint8 number, uint16 maximum packet size
+        static constexpr const std::size_t SPLIT_HEADER_SIZE = 12;
+
+        // how often a request is sent again when a server answers it with a new challenge
+        static constexpr const std::size_t MAX_CHALLENGES = 3;
+
+        static constexpr const std::array<std::uint8_t, 9> REQUEST_CHALLENGE = {
+            0xFF, 0xFF, 0xFF, 0xFF, 0x55, 0xFF, 0xFF, 0xFF, 0xFF
+        };
+
+        static constexpr const std::array<std::uint8_t, 25> REQUEST_DETAILS = {
+            0xFF, 0xFF, 0xFF, 0xFF, 0x54, 0x53, 0x6F, 0x75, 0x72, 0x63, 0x65, 0x20, 0x45,
+            0x6E, 0x67, 0x69, 0x6E, 0x65, 0x20, 0x51, 0x75, 0x65, 0x72, 0x79, 0x00
+        };
+
+        static constexpr const std::array<std::uint8_t, 5> REQUEST_PLAYERS = {
+            0xFF, 0xFF, 0xFF, 0xFF, 0x55
+        };
+
+        static constexpr const std::array<std::uint8_t, 5> REQUEST_RULES = {
+            0xFF, 0xFF, 0xFF, 0xFF, 0x56
+        };
+
+        // whether a datagram starts with the split packet header
+        KFCLIENT_API bool is_split(const std::uint8_t* data, std::size_t size) noexcept;
+    }
+
+    enum kfsection : std::uint32_t {
+        SECTION_DETAILS = 1U << 0U,
+        SECTION_RULES = 1U << 1U,
+        SECTION_PLAYERS = 1U << 2U,
+        SECTION_ALL = SECTION_DETAILS | SECTION_RULES | SECTION_PLAYERS
+    };
+
+    // Collects the datagrams of split responses in any order. Those of up to MAX_RESPONSES responses
+    // (say the answer to a request that timed out and the answer to its retry) may arrive interleaved,
+    // each is collected by its id and the oldest is dropped to make room for another. The buffers are
+    // kept between responses to avoid allocations.
+    class KFCLIENT_API kfreassembler {
+    public:
+        static constexpr const std::size_t MAX_RESPONSES = 4;
+
+        // true when a response is complete and payload() holds it
+        bool add(const std::uint8_t* data, std::size_t size);
+
+        // drops every response that is not complete
+        void reset() noexcept;
+
+        std::vector<std::uint8_t>& payload() noexcept { return payload_; }
+        const std::vector<std::uint8_t>& payload() const noexcept { return payload_; }
+
+    private:
+        struct response {
+            std::vector<std::vector<std::uint8_t>> parts;
+            std::vector<bool> received;
+            std::size_t total = 0; // 0 when no response is collected in it
+            std::size_t remaining = 0;
+            std::uint64_t started = 0;
+            std::int32_t id = 0;
+        };
+
+        response& find(std::int32_t id, std::uint8_t total);
+
+        std::vector<response> responses_;
+        std::uint64_t started_ = 0;
+        std::vector<std::uint8_t> payload_;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,330 @@
+#include "kfquery.hpp"
+#include "kfstats.hpp"
+#include "kfuring.hpp"
+
+#include <cstring>
+
+namespace {
+    // queries are short-lived, so their events are only added to the global statistics
+    kfc::kfstats& query_stats() {
+        static thread_local kfc::kfstats stats;
+        return stats;
+    }
+
+    kfc::kfrequest request_type(std::int8_t packet) noexcept {
+        switch (packet) {
+        case kfc::protocol::PACKET_DETAILS: return kfc::kfrequest::details;
+        case kfc::protocol::PACKET_RULES: return kfc::kfrequest::rules;
+        case kfc::protocol::PACKET_PLAYERS: return kfc::kfrequest::players;
+        default: return kfc::kfrequest::challenge;
+        }
+    }
+}
+
+kfc::kfexchange::kfexchange(std::uint32_t sections, kfquery_result& result, kfinterner* interner, utf8::policy policy)
+    : result_(result), interner_(interner), policy_(policy), sections_(sections & SECTION_ALL) {}
+
+kfc::kfexchange::step kfc::kfexchange::start() {
+    if (result_.challenge.has_value()) {
+        challenge_ = *result_.challenge;
+        return next();
+    }
+
+    query_stats().count(kfcounter::challenges);
+    return prepare(protocol::PACKET_CHALLENGE, protocol::REQUEST_CHALLENGE.data(), protocol::REQUEST_CHALLENGE.size());
+}
+
+kfc::kfexchange::step kfc::kfexchange::receive(const std::uint8_t* data, std::size_t size) {
+    query_stats().count(kfcounter::packets_received);
+    query_stats().count(kfcounter::bytes_received, size);
+
+    try {
+        if (!protocol::is_split(data, size))
+            return process(data, size);
+        if (assembly_.add(data, size))
+            return process(assembly_.payload().data(), assembly_.payload().size());
+    } catch (const std::exception&) {
+        query_stats().count(kfcounter::parse_failures);
+        throw;
+    }
+
+    return step::wait;
+}
+
+void kfc::kfexchange::sent() noexcept {
+    query_stats().count(kfcounter::packets_sent);
+    query_stats().count(kfcounter::bytes_sent, request_.size());
+}
+
+void kfc::kfexchange::expired() noexcept {
+    query_stats().count(kfcounter::timeouts);
+}
+
+kfc::kfexchange::step kfc::kfexchange::prepare(std::int8_t packet, const std::uint8_t* request, std::size_t size) {
+    expected_ = packet;
+
+    // requests other than the challenge are followed by the challenge
+    request_.assign(request, request + size);
+    if (packet != protocol::PACKET_CHALLENGE) {
+        request_.resize(size + sizeof(challenge_));
+        std::memcpy(request_.data() + size, &challenge_, sizeof(challenge_));
+    }
+
+    sent_ = std::chrono::steady_clock::now();
+    assembly_.reset();
+    return step::send;
+}
+
+kfc::kfexchange::step kfc::kfexchange::process(const std::uint8_t* data, std::size_t size) {
+    kfbuffer response(const_cast<std::uint8_t*>(data), size); // NOLINT(cppcoreguidelines-pro-type-const-cast) -- kfbuffer only reads
+    kfheader header;
+    response.consume(header.magic);
+    response.consume(header.type);
+
+    if (header.magic != protocol::SINGLE_MAGIC)
+        throw std::runtime_error("unexpected header magic received");
+
+    if (header.type == protocol::PACKET_CHALLENGE) {
+        challenge_ = response.consume<std::int32_t>();
+        result_.challenge = challenge_;
+
+        if (expected_ == protocol::PACKET_CHALLENGE) {
+            query_stats().latency(kfrequest::challenge, std::chrono::steady_clock::now() - sent_);
+            return next();
+        }
+
+        // the server replaced its challenge, send the request again with the new one
+        if (++challenges_ >= protocol::MAX_CHALLENGES)
+            throw std::runtime_error("server keeps answering with a new challenge");
+
+        query_stats().count(kfcounter::challenges);
+        auto request = request_;
+        return prepare(expected_, request.data(), request.size() - sizeof(challenge_));
+    }
+
+    if (header.type != expected_)
+        throw std::runtime_error("unexpected packet received");
+
+    switch (header.type) {
+    case protocol::PACKET_DETAILS: result_.details = std::make_shared<const kfdetails>(response, interner_, policy_); break;
+    case protocol::PACKET_RULES: result_.rules = std::make_shared<const kfrules>(response, interner_, policy_); break;
+    case protocol::PACKET_PLAYERS: result_.players = std::make_shared<const kfplayers>(response, interner_, policy_); break;
+    default: throw std::runtime_error("unexpected result type received");
+    }
+
+    query_stats().latency(request_type(header.type), std::chrono::steady_clock::now() - sent_);
+    return next();
+}
+
+kfc::kfexchange::step kfc::kfexchange::next() {
+    if ((sections_ & SECTION_DETAILS) != 0) {
+        sections_ &= ~static_cast<std::uint32_t>(SECTION_DETAILS);
+        return prepare(protocol::PACKET_DETAILS, protocol::REQUEST_DETAILS.data(), protocol::REQUEST_DETAILS.size());
+    }
+    if ((sections_ & SECTION_RULES) != 0) {
+        sections_ &= ~static_cast<std::uint32_t>(SECTION_RULES);
+        return prepare(protocol::PACKET_RULES, protocol::REQUEST_RULES.data(), protocol::REQUEST_RULES.size());
+    }
+    if ((sections_ & SECTION_PLAYERS) != 0) {
+        sections_ &= ~static_cast<std::uint32_t>(SECTION_PLAYERS);
+        return prepare(protocol::PACKET_PLAYERS, protocol::REQUEST_PLAYERS.data(), protocol::REQUEST_PLAYERS.size());
+    }
+
+    return step::done;
+}
+
+void kfc::kfquery::start(io_context& context, const udp::endpoint& endpoint, std::uint32_t sections, std::chrono::milliseconds timeout, handler_type handler, std::optional<std::int32_t> challenge, kfinterner* interner, utf8::policy policy) {
+    auto query = std::make_shared<kfquery>(token {}, context, endpoint, sections, timeout, std::move(handler), challenge, interner, policy);
+    boost::asio::dispatch(query->socket_.get_executor(), [query]() { query->begin(); });
+}
+
+kfc::kfquery::kfquery(token /*unused*/, io_context& context, const udp::endpoint& endpoint, std::uint32_t sections, std::chrono::milliseconds timeout, handler_type handler, std::optional<std::int32_t> challenge, kfinterner* interner, utf8::policy policy)
+    : socket_(boost::asio::make_strand(context)), timer_(socket_.get_executor()), timeout_(timeout), handler_(std::move(handler)), exchange_(sections, result_, interner, policy) {
+    result_.endpoint = endpoint;
+    result_.challenge = challenge;
+}
+
+void kfc::kfquery::begin() {
+    started_ = std::chrono::steady_clock::now();
+
+    error_code error;
+    socket_.open(result_.endpoint.protocol(), error);
+    if (!error)
+        socket_.connect(result_.endpoint, error);
+    if (error)
+        return fail(error.message());
+
+    advance(exchange_.start());
+}
+
+void kfc::kfquery::advance(kfexchange::step step) {
+    switch (step) {
+    case kfexchange::step::send: return send();
+    case kfexchange::step::wait: return receive();
+    case kfexchange::step::done: return finish();
+    }
+}
+
+void kfc::kfquery::send() {
+    error_code error;
+    socket_.send(boost::asio::buffer(exchange_.request()), 0, error);
+    if (error)
+        return fail(error.message());
+
+    exchange_.sent();
+    receive();
+}
+
+void kfc::kfquery::receive() {
+    expired_ = false;
+    auto generation = ++receiving_;
+
+    if (timeout_.count() != 0) {
+        timer_.expires_after(timeout_);
+        timer_.async_wait([self = shared_from_this(), generation](const error_code& error) {
+            // a timer that completed before the receive it guarded, but was handled after it, must
+            // not cancel the next receive; cancel() cannot stop a completion that is queued already
+            if (error || self->done_ || generation != self->receiving_)
+                return;
+            self->expired_ = true;
+            self->socket_.cancel();
+        });
+    }
+
+    socket_.async_receive(boost::asio::buffer(recvbuf_), [self = shared_from_this()](const error_code& error, std::size_t received) {
+        self->on_receive(error, received);
+    });
+}
+
+void kfc::kfquery::on_receive(const error_code& error, std::size_t received) {
+    timer_.cancel();
+
+    if (error == boost::asio::error::operation_aborted && expired_) {
+        exchange_.expired();
+        return fail("timed out waiting for a response", true);
+    }
+    if (error)
+        return fail(error.message());
+
+    auto step = kfexchange::step::wait;
+    try {
+        step = exchange_.receive(recvbuf_.data(), received);
+    } catch (const std::exception& ex) {
+        return fail(ex.what());
+    }
+
+    advance(step);
+}
+
+void kfc::kfquery::fail(const std::string& message, bool timed_out) {
+    result_.details = nullptr;
+    result_.rules = nullptr;
+    result_.players = nullptr;
+    result_.challenge.reset();
+    result_.error = message;
+    result_.timed_out = timed_out;
+    finish();
+}
+
+void kfc::kfquery::finish() {
+    if (done_)
+        return;
+
+    done_ = true;
+    result_.round_trip = std::chrono::steady_clock::now() - started_;
+
+    error_code ignored;
+    timer_.cancel();
+    socket_.close(ignored);
+
+    auto handler = std::move(handler_);
+    handler(result_);
+}
+
+kfc::kfbatch::kfbatch(std::size_t parallel, std::chrono::milliseconds timeout, std::uint32_t sections)
+    : context_(), resolver_(context_), parallel_(parallel == 0 ? 1 : parallel), timeout_(timeout), sections_(sections) {}
+
+void kfc::kfbatch::add_target(const std::string& host, std::uint16_t port) {
+    targets_.push_back({ host, port });
+}
+
+void kfc::kfbatch::run(const handler_type& handler) {
+    if (engine_ == kfengine::io_uring)
+        return run_uring(handler);
+
+    handler_ = &handler;
+    next_ = 0;
+    active_ = 0;
+
+    start_next();
+
+    context_.restart();
+    context_.run();
+    handler_ = nullptr;
+}
+
+void kfc::kfbatch::run_uring(const handler_type& handler) {
+    kfuring_batch uring(parallel_, timeout_, sections_);
+    uring.interner(interner_);
+    uring.utf8_policy(utf8_policy_);
+    std::vector<udp::endpoint> endpoints;
+    std::vector<const target*> resolved;
+
+    for (const auto& t : targets_) {
+        error_code error;
+        auto address = boost::asio::ip::make_address(t.host, error);
+        if (!error) {
+            endpoints.emplace_back(address, t.port);
+            resolved.push_back(&t);
+            continue;
+        }
+
+        auto results = resolver_.resolve(udp::v4(), t.host, std::to_string(t.port), error);
+        if (!error && !results.empty()) {
+            endpoints.push_back(results.begin()->endpoint());
+            resolved.push_back(&t);
+            continue;
+        }
+
+        kfquery_result result;
+        result.error = error ? error.message() : "host not found";
+        handler(t.host, t.port, result);
+    }
+
+    uring.run(endpoints, [&handler, &resolved](std::size_t index, kfquery_result& result) {
+        handler(resolved.at(index)->host, resolved.at(index)->port, result);
+    });
+}
+
+void kfc::kfbatch::start_next() {
+    while (active_ < parallel_ && next_ < targets_.size()) {
+        const auto& t = targets_.at(next_++);
+        active_++;
+
+        error_code error;
+        auto address = boost::asio::ip::make_address(t.host, error);
+        if (!error) {
+            start(t, udp::endpoint(address, t.port));
+            continue;
+        }
+
+        resolver_.async_resolve(udp::v4(), t.host, std::to_string(t.port), [this, &t](const error_code& ec, const udp::resolver::results_type& endpoints) {
+            if (!ec && !endpoints.empty())
+                return start(t, endpoints.begin()->endpoint());
+
+            kfquery_result result;
+            result.error = ec ? ec.message() : "host not found";
+            complete(t, result);
+        });
+    }
+}
+
+void kfc::kfbatch::start(const target& t, const udp::endpoint& endpoint) {
+    kfquery::start(context_, endpoint, sections_, timeout_, [this, &t](kfquery_result& result) { complete(t, result); }, std::nullopt, interner_, utf8_policy_);
+}
+
+void kfc::kfbatch::complete(const target& t, kfquery_result& result) {
+    active_--;
+    (*handler_)(t.host, t.port, result);
+    start_next();
+}
\ No newline at end of file
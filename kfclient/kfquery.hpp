@@ -0,0 +1,188 @@
+#ifndef kfclient_query_hpp
+#define kfclient_query_hpp
+
+#include "libdef.hpp"
+#include "kfdetails.hpp"
+#include "kfrules.hpp"
+#include "kfplayers.hpp"
+#include "kfprotocol.hpp"
+
+#include <boost/asio.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace kfc {
+    struct kfquery_result {
+        boost::asio::ip::udp::endpoint endpoint;
+
+        // only set for the sections that were requested and succeeded; results are immutable and
+        // may be shared between threads
+        std::shared_ptr<const kfdetails> details;
+        std::shared_ptr<const kfrules> rules;
+        std::shared_ptr<const kfplayers> players;
+
+        // from sending the challenge until the last response was processed
+        std::chrono::steady_clock::duration round_trip {};
+
+        // the challenge the server handed out, which can be passed to its next query
+        std::optional<std::int32_t> challenge;
+
+        std::string error;
+        bool timed_out = false;
+    };
+
+    // The protocol of one query without any I/O: the challenge followed by every requested
+    // section. Transports send request() whenever a step asks for it and hand every datagram to
+    // receive(); the sections and the challenge end up in the result.
+    class KFCLIENT_API kfexchange {
+    public:
+        enum class step { wait, send, done };
+
+        // with result.challenge set the challenge request is skipped; the strings of the sections
+        // are shared through the interner when one is given and checked under the policy
+        kfexchange(std::uint32_t sections, kfquery_result& result, kfinterner* interner = nullptr, utf8::policy policy = utf8::policy::keep);
+
+        step start();
+
+        // throws when the datagram is malformed or not the response that was expected
+        step receive(const std::uint8_t* data, std::size_t size);
+
+        // valid until the next call of start() or receive()
+        const std::vector<std::uint8_t>& request() const noexcept { return request_; }
+
+        // counts a request that went out, and one that was never answered
+        void sent() noexcept;
+        void expired() noexcept;
+
+    private:
+        step prepare(std::int8_t packet, const std::uint8_t* request, std::size_t size);
+        step process(const std::uint8_t* data, std::size_t size);
+        step next();
+
+        kfquery_result& result_;
+        kfinterner* interner_;
+        utf8::policy policy_;
+        std::uint32_t sections_; // still to be requested
+        std::vector<std::uint8_t> request_;
+        kfreassembler assembly_;
+        std::int8_t expected_ = protocol::PACKET_CHALLENGE;
+        std::int32_t challenge_ = 0;
+        std::size_t challenges_ = 0;
+        std::chrono::steady_clock::time_point sent_;
+    };
+
+    // One asynchronous query of a server: the challenge followed by every requested section, on a
+    // socket of its own. The query keeps itself alive until it completes and runs on a strand, so
+    // the io_context may be run by any number of threads. The handler is called exactly once, on
+    // one of those threads.
+    class KFCLIENT_API kfquery : public std::enable_shared_from_this<kfquery> {
+        using io_context = boost::asio::io_context;
+        using udp = boost::asio::ip::udp;
+        using error_code = boost::system::error_code;
+
+        static constexpr const std::size_t RECEIVE_BUFFER_SIZE = 2048;
+
+        struct token {};
+
+    public:
+        using handler_type = std::function<void(kfquery_result&)>;
+
+        // A timeout of zero waits for every response indefinitely. With a known challenge the
+        // challenge request is skipped; a server that replaced it answers with the new one. The
+        // interner, if any, must outlive the query, see kfclient::interner and kfclient::utf8_policy.
+        static void start(io_context& context, const udp::endpoint& endpoint, std::uint32_t sections, std::chrono::milliseconds timeout, handler_type handler, std::optional<std::int32_t> challenge = std::nullopt, kfinterner* interner = nullptr, utf8::policy policy = utf8::policy::keep);
+
+        kfquery(token, io_context& context, const udp::endpoint& endpoint, std::uint32_t sections, std::chrono::milliseconds timeout, handler_type handler, std::optional<std::int32_t> challenge, kfinterner* interner, utf8::policy policy);
+
+    private:
+        void begin();
+        void advance(kfexchange::step step);
+        void send();
+        void receive();
+        void on_receive(const error_code& error, std::size_t received);
+        void fail(const std::string& message, bool timed_out = false);
+        void finish();
+
+        udp::socket socket_;
+        boost::asio::steady_timer timer_;
+        std::chrono::milliseconds timeout_;
+        handler_type handler_;
+
+        std::array<std::uint8_t, RECEIVE_BUFFER_SIZE> recvbuf_ = {};
+        bool expired_ = false;
+        bool done_ = false;
+        std::uint64_t receiving_ = 0; // counts the receives, tells the timer of each apart
+
+        std::chrono::steady_clock::time_point started_;
+        kfquery_result result_;
+        kfexchange exchange_;
+    };
+
+    // how a kfbatch moves its datagrams, see kfuring.hpp for io_uring
+    enum class kfengine { asio, io_uring };
+
+    // Queries a list of servers with at most a given number of queries in flight at once. Hosts are
+    // resolved when their query starts; numeric addresses skip the resolver. Results are handed to
+    // the handler as each query finishes, in completion order.
+    class KFCLIENT_API kfbatch {
+        using io_context = boost::asio::io_context;
+        using udp = boost::asio::ip::udp;
+        using error_code = boost::system::error_code;
+
+    public:
+        using handler_type = std::function<void(const std::string& host, std::uint16_t port, kfquery_result& result)>;
+
+        kfbatch(std::size_t parallel, std::chrono::milliseconds timeout, std::uint32_t sections = SECTION_DETAILS | SECTION_PLAYERS);
+
+        void add_target(const std::string& host, std::uint16_t port);
+        std::size_t size() const noexcept { return targets_.size(); }
+
+        // asio by default; io_uring resolves every host up front and throws std::runtime_error
+        // from run() where it is not available
+        void engine(kfengine engine) noexcept { engine_ = engine; }
+
+        // share the strings of every result through an interner, see kfclient::interner
+        void interner(kfinterner* interner) noexcept { interner_ = interner; }
+
+        // parse the text of every result under a policy, see kfclient::utf8_policy
+        void utf8_policy(utf8::policy policy) noexcept { utf8_policy_ = policy; }
+
+        // runs every query on the calling thread and returns when all of them completed
+        void run(const handler_type& handler);
+
+    private:
+        struct target {
+            std::string host;
+            std::uint16_t port;
+        };
+
+        void run_uring(const handler_type& handler);
+        void start_next();
+        void start(const target& t, const udp::endpoint& endpoint);
+        void complete(const target& t, kfquery_result& result);
+
+        io_context context_;
+        udp::resolver resolver_;
+        std::vector<target> targets_;
+        std::size_t parallel_;
+        std::chrono::milliseconds timeout_;
+        std::uint32_t sections_;
+        kfengine engine_ = kfengine::asio;
+        kfinterner* interner_ = nullptr;
+        utf8::policy utf8_policy_ = utf8::policy::keep;
+
+        std::size_t next_ = 0;
+        std::size_t active_ = 0;
+        const handler_type* handler_ = nullptr;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "kfqueue.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace {
+    // Copy assigning an unordered_map reuses its nodes but destroys and rebuilds the key and value
+    // strings in them, two allocations per long pair. Servers report the same keys on every poll,
+    // so the values are assigned in place (keeping their buffers) and only a new key copies it all.
+    void assign_additional(std::unordered_map<std::string, std::string>& to, const std::unordered_map<std::string, std::string>& from) {
+        if (to.size() == from.size()) {
+            bool same = true;
+            for (const auto& pair : from) {
+                auto it = to.find(pair.first);
+                if (it == to.end()) {
+                    same = false;
+                    break;
+                }
+                it->second = pair.second;
+            }
+
+            if (same)
+                return;
+        }
+
+        to = from;
+    }
+}
+
+void kfc::kfresult::assign(const kfpoll_result& result) {
+    host = result.host;
+    port = result.port;
+
+    // copy assignment keeps the buffers of strings and vectors that are large enough already
+    sections = 0;
+    if (result.details != nullptr) {
+        static_cast<kfdetails_fields&>(details) = *result.details;
+        assign_additional(details.additional, result.details->additional);
+        sections |= SECTION_DETAILS;
+    }
+    if (result.rules != nullptr) {
+        rules = *result.rules;
+        sections |= SECTION_RULES;
+    }
+    if (result.players != nullptr) {
+        players = *result.players;
+        sections |= SECTION_PLAYERS;
+    }
+
+    details_round_trip = result.details_round_trip;
+    rules_round_trip = result.rules_round_trip;
+    players_round_trip = result.players_round_trip;
+    details_unchanged = result.details_unchanged;
+    rules_unchanged = result.rules_unchanged;
+    players_unchanged = result.players_unchanged;
+    error = result.error;
+    timed_out = result.timed_out;
+}
+
+kfc::kfpoll_result kfc::kfresult::view() const {
+    return kfpoll_result {
+        host, port,
+        (sections & SECTION_DETAILS) != 0 ? &details : nullptr,
+        (sections & SECTION_RULES) != 0 ? &rules : nullptr,
+        (sections & SECTION_PLAYERS) != 0 ? &players : nullptr,
+        details_round_trip, rules_round_trip, players_round_trip,
+        details_unchanged, rules_unchanged, players_unchanged,
+        error, timed_out
+    };
+}
+
+kfc::kfresult_ptr::kfresult_ptr(kfresult_ptr&& other) noexcept
+    : owner_(other.owner_), result_(other.result_) {
+    other.owner_ = nullptr;
+    other.result_ = nullptr;
+}
+
+kfc::kfresult_ptr& kfc::kfresult_ptr::operator=(kfresult_ptr&& other) noexcept {
+    if (this != &other) {
+        reset();
+        owner_ = other.owner_;
+        result_ = other.result_;
+        other.owner_ = nullptr;
+        other.result_ = nullptr;
+    }
+
+    return *this;
+}
+
+void kfc::kfresult_ptr::reset() noexcept {
+    if (result_ != nullptr)
+        owner_->recycle(result_);
+
+    owner_ = nullptr;
+    result_ = nullptr;
+}
+
+kfc::kfresult_queue::kfresult_queue(std::size_t capacity)
+    : capacity_(capacity), free_(capacity), ready_(capacity) {
+    if (capacity == 0)
+        throw std::invalid_argument("the capacity of a result queue cannot be 0");
+
+    results_ = std::make_unique<kfresult[]>(capacity);
+    for (std::size_t i = 0; i < capacity; ++i)
+        free_.try_push(&results_[i]);
+}
+
+bool kfc::kfresult_queue::push(const kfpoll_result& result) {
+    kfresult* slot = nullptr;
+    if (!free_.try_pop(slot)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    try {
+        slot->assign(result);
+    } catch (...) {
+        free_.try_push(slot);
+        throw;
+    }
+
+    // there are no more results than cells, so this cannot fail
+    ready_.try_push(slot);
+
+    // pairs with the store in pop: either the consumer sees the result before it sleeps, or this
+    // sees the consumer waiting and wakes it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load(std::memory_order_relaxed) != 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_changed_.notify_all();
+    }
+
+    return true;
+}
+
+bool kfc::kfresult_queue::pop(kfresult_ptr& result) noexcept {
+    kfresult* slot = nullptr;
+    if (!ready_.try_pop(slot))
+        return false;
+
+    result = kfresult_ptr(this, slot);
+    return true;
+}
+
+bool kfc::kfresult_queue::pop(kfresult_ptr& result, std::chrono::milliseconds timeout) {
+    if (pop(result))
+        return true;
+
+    waiting_.fetch_add(1, std::memory_order_seq_cst);
+    bool popped = false;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        popped = ready_changed_.wait_for(lock, timeout, [this, &result]() { return pop(result); });
+    }
+
+    waiting_.fetch_sub(1, std::memory_order_relaxed);
+    return popped;
+}
+
+void kfc::kfresult_queue::recycle(kfresult* result) noexcept {
+    free_.try_push(result);
+}
\ No newline at end of file
@@ -0,0 +1,207 @@
+#ifndef kfclient_queue_hpp
+#define kfclient_queue_hpp
+
+#include "libdef.hpp"
+#include "kfpoller.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace kfc {
+    // A bounded lock-free queue of any number of producers and consumers (Vyukov's array queue):
+    // every cell carries a sequence number telling whether it is free for the producer or filled
+    // for the consumer of a position, so pushes and pops only contend on their own counter.
+    template <typename T>
+    class kfring {
+        struct cell {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+
+    public:
+        // the capacity is rounded up to a power of two
+        explicit kfring(std::size_t capacity)
+            : mask_(round_up(capacity) - 1), cells_(std::make_unique<cell[]>(mask_ + 1)) {
+            for (std::size_t i = 0; i <= mask_; ++i)
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        // false when the ring is full
+        bool try_push(T value) noexcept {
+            auto pos = enqueue_.load(std::memory_order_relaxed);
+            cell* c = nullptr;
+
+            for (;;) {
+                c = &cells_[pos & mask_];
+                auto seq = c->sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+
+                if (diff == 0 && enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+                if (diff < 0)
+                    return false;
+                if (diff > 0)
+                    pos = enqueue_.load(std::memory_order_relaxed);
+            }
+
+            c->value = std::move(value);
+            c->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // false when the ring is empty
+        bool try_pop(T& value) noexcept {
+            auto pos = dequeue_.load(std::memory_order_relaxed);
+            cell* c = nullptr;
+
+            for (;;) {
+                c = &cells_[pos & mask_];
+                auto seq = c->sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+
+                if (diff == 0 && dequeue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+                if (diff < 0)
+                    return false;
+                if (diff > 0)
+                    pos = dequeue_.load(std::memory_order_relaxed);
+            }
+
+            value = std::move(c->value);
+            c->sequence.store(pos + mask_ + 1, std::memory_order_release);
+            return true;
+        }
+
+        std::size_t capacity() const noexcept { return mask_ + 1; }
+
+        // a snapshot that may already be stale when other threads are pushing or popping
+        std::size_t size() const noexcept {
+            auto enqueued = enqueue_.load(std::memory_order_relaxed);
+            auto dequeued = dequeue_.load(std::memory_order_relaxed);
+            return enqueued > dequeued ? enqueued - dequeued : 0;
+        }
+
+    private:
+        static std::size_t round_up(std::size_t capacity) noexcept {
+            std::size_t result = 2;
+            while (result < capacity)
+                result <<= 1U;
+            return result;
+        }
+
+        std::size_t mask_;
+        std::unique_ptr<cell[]> cells_;
+        alignas(64) std::atomic<std::size_t> enqueue_ { 0 };
+        alignas(64) std::atomic<std::size_t> dequeue_ { 0 };
+    };
+
+    // A poll result that owns copies of its sections, see kfresult_queue. The objects are pooled
+    // and keep their buffers, so refilling one stops allocating once it has held responses of the
+    // usual size.
+    struct KFCLIENT_API kfresult {
+        std::string host;
+        std::uint16_t port = 0;
+
+        // SECTION_* bits of the sections that are set
+        std::uint32_t sections = 0;
+        kfdetails details;
+        kfrules rules;
+        kfplayers players;
+
+        std::chrono::steady_clock::duration details_round_trip {};
+        std::chrono::steady_clock::duration rules_round_trip {};
+        std::chrono::steady_clock::duration players_round_trip {};
+
+        bool details_unchanged = false;
+        bool rules_unchanged = false;
+        bool players_unchanged = false;
+
+        std::string error;
+        bool timed_out = false;
+
+        void assign(const kfpoll_result& result);
+
+        // the result as the poller reported it, pointing into this object (only the error is copied)
+        kfpoll_result view() const;
+    };
+
+    class kfresult_queue;
+
+    // Owns a kfresult of a kfresult_queue and gives it back to the pool when destroyed.
+    class KFCLIENT_API kfresult_ptr {
+    public:
+        kfresult_ptr() = default;
+        kfresult_ptr(const kfresult_ptr&) = delete;
+        kfresult_ptr(kfresult_ptr&& other) noexcept;
+        kfresult_ptr& operator=(const kfresult_ptr&) = delete;
+        kfresult_ptr& operator=(kfresult_ptr&& other) noexcept;
+        ~kfresult_ptr() { reset(); }
+
+        void reset() noexcept;
+
+        kfresult* get() const noexcept { return result_; }
+        kfresult& operator*() const noexcept { return *result_; }
+        kfresult* operator->() const noexcept { return result_; }
+        explicit operator bool() const noexcept { return result_ != nullptr; }
+
+    private:
+        friend class kfresult_queue;
+        kfresult_ptr(kfresult_queue* owner, kfresult* result) noexcept : owner_(owner), result_(result) {}
+
+        kfresult_queue* owner_ = nullptr;
+        kfresult* result_ = nullptr;
+    };
+
+    // Hands poll results from any number of polling threads to a consumer thread without locks or
+    // allocations: push() copies a result into a pooled kfresult and queues it, pop() moves it out
+    // as a kfresult_ptr that returns it to the pool. There are exactly capacity() results, queued
+    // or held by consumers; when none is left push() returns false and drops the result, which is
+    // the signal to the producer that the consumer falls behind. A poller that dropped a result
+    // must not trust the *_unchanged flags of its next one for the same server.
+    // The queue must outlive every kfresult_ptr it handed out.
+    class KFCLIENT_API kfresult_queue {
+    public:
+        explicit kfresult_queue(std::size_t capacity);
+
+        kfresult_queue(const kfresult_queue&) = delete;
+        kfresult_queue(kfresult_queue&&) = delete;
+        kfresult_queue& operator=(const kfresult_queue&) = delete;
+        kfresult_queue& operator=(kfresult_queue&&) = delete;
+        ~kfresult_queue() = default;
+
+        bool push(const kfpoll_result& result);
+
+        // false when nothing is queued, or nothing was queued within the timeout
+        bool pop(kfresult_ptr& result) noexcept;
+        bool pop(kfresult_ptr& result, std::chrono::milliseconds timeout);
+
+        std::size_t capacity() const noexcept { return capacity_; }
+        std::size_t size() const noexcept { return ready_.size(); }
+
+        // results push() could not queue
+        std::uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        friend class kfresult_ptr;
+        void recycle(kfresult* result) noexcept;
+
+        std::size_t capacity_;
+        std::unique_ptr<kfresult[]> results_;
+        kfring<kfresult*> free_;
+        kfring<kfresult*> ready_;
+        std::atomic<std::uint64_t> dropped_ { 0 };
+
+        // consumers blocked in pop, producers only take the mutex to wake them
+        std::atomic<unsigned> waiting_ { 0 };
+        std::mutex mutex_;
+        std::condition_variable ready_changed_;
+    };
+}
+
+#endif
\ No newline at end of file
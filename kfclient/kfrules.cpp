@@ -2,32 +2,66 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 
 kfc::kfrule::kfrule(const kfbuffer& buff) {
-    std::string value_temp;
-    buff.consume(name, value_temp);
+    schema::parse(buff, *this);
+}
 
+void kfc::kfrule_value::decode(const char* data, std::size_t length, kfrule::variant_t& value) {
     // is it a boolean?
-    if (value_temp == "True" || value_temp == "False") {
-        value = value_temp == "True";
+    if ((length == 4 && std::memcmp(data, "True", 4) == 0) || (length == 5 && std::memcmp(data, "False", 5) == 0)) {
+        value = length == 4;
         return;
     }
     
-    // or perhaps a numeric value?
+    // or perhaps a numeric value? data ends in the NUL of the response
     char* end = nullptr;
-    double val = strtod(value_temp.c_str(), &end);
-    if (end != value_temp.c_str() && *end == '\0' && val != HUGE_VAL) { 
+    double val = strtod(data, &end);
+    if (end != data && end == data + length && val != HUGE_VAL) { 
         value = val;
         return;
     }
 
     // nope, just a string
-    value = value_temp;
+    value = std::string(data, length);
 }
 
-kfc::kfrules::kfrules(const kfbuffer& buff) {
-    buff.consume(count);
+void kfc::kfrule_value::encode(const kfrule::variant_t& value, std::string& out) {
+    if (const auto* b = std::get_if<bool>(&value)) {
+        out = *b ? "True" : "False";
+        return;
+    }
+
+    if (const auto* d = std::get_if<double>(&value)) {
+        if (!std::isfinite(*d)) {
+            out = std::signbit(*d) ? "-" : "";
+            out += std::isnan(*d) ? "nan" : "inf";
+            return;
+        }
+
+        // the fewest digits that read back as the same number, without an exponent from 1e-4 up
+        // to 1e16 like the servers (and fmt's "{}") write them, so 10 is not written as 1e+01
+        char text[32] = {};
+        int precision = 1;
+        for (;; ++precision) {
+            std::snprintf(text, sizeof(text), "%.*e", precision - 1, *d);
+            if (precision == 17 || strtod(text, nullptr) == *d)
+                break;
+        }
+
+        auto exponent = std::atoi(std::strchr(text, 'e') + 1);
+        if (exponent >= -4 && exponent < 16)
+            std::snprintf(text, sizeof(text), "%.*f", std::max(precision - 1 - exponent, 0), *d);
+
+        out = text;
+        return;
+    }
+
+    out = std::get<std::string>(value);
+}
 
-    for (std::uint16_t i = 0; i < count; ++i) 
-        rules.emplace_back(buff);
+kfc::kfrules::kfrules(const kfbuffer& buff, kfinterner* /*interner*/, utf8::policy policy) {
+    schema::parse(buff, *this, nullptr, policy);
 }
\ No newline at end of file
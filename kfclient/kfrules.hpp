@@ -2,6 +2,7 @@
 #define kfclient_rules_hpp
 
 #include "kfbuffer.hpp"
+#include "kfschema.hpp"
 
 #include <cstdint>
 #include <cstdlib>
@@ -14,6 +15,7 @@ namespace kfc {
     struct kfrule {
         using variant_t = std::variant<std::string, bool, double>;
 
+        kfrule() = default;
         kfrule(const kfbuffer& buff);
 
         std::string name;
@@ -21,11 +23,31 @@ namespace kfc {
     };
 
     struct kfrules {
-        kfrules(const kfbuffer& buff);
+        kfrules() = default;
+        // rules hold no kfstrings, the interner is only taken so every response parses alike
+        kfrules(const kfbuffer& buff, kfinterner* interner = nullptr, utf8::policy policy = utf8::policy::keep);
 
         std::uint16_t count = 0;
         std::vector<kfrule> rules;
     };
+
+    // rule values are strings on the wire: True and False, numbers, or any other text
+    struct KFCLIENT_API kfrule_value {
+        static void decode(const char* data, std::size_t length, kfrule::variant_t& value);
+        static void encode(const kfrule::variant_t& value, std::string& out);
+    };
+
+    namespace schema {
+        template <>
+        struct of<kfrule> {
+            using type = layout<string<&kfrule::name>, text<&kfrule::value, kfrule_value>>;
+        };
+
+        template <>
+        struct of<kfrules> {
+            using type = layout<repeated<&kfrules::count, &kfrules::rules>>;
+        };
+    }
 }
 
 #endif 
\ No newline at end of file
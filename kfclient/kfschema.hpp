@@ -0,0 +1,283 @@
+#ifndef kfclient_schema_hpp
+#define kfclient_schema_hpp
+
+#include "kfbuffer.hpp"
+#include "kfutf8.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// The wire layout of every response, described once as a list of fields. Parsing and
+// serializing are both derived from it: a parse checks the minimum size of the layout once and
+// then reads every field without further range checks, strings only search for their NUL
+// within the bytes the fields after them leave over.
+namespace kfc {
+    class kfinterner;
+
+    namespace schema {
+        // a little-endian arithmetic member
+        template <auto Member> struct value {};
+
+        // a member stored as another arithmetic type on the wire (bool as uint8)
+        template <auto Member, typename Wire> struct cast {};
+
+        // a NUL terminated string, into a std::string or a kfstring, checked as UTF-8 while its
+        // NUL is searched (see utf8::scan); invalid bytes are replaced when parsed under
+        // utf8::policy::replace
+        template <auto Member> struct string {};
+
+        // a string of exactly Length bytes, NUL padded when serialized
+        template <auto Member, std::size_t Length> struct fixed {};
+
+        // a NUL terminated string converted by a codec with
+        //   static void decode(const char* data, std::size_t length, T& value), data NUL terminated
+        //   static void encode(const T& value, std::string& out)
+        template <auto Member, typename Codec> struct text {};
+
+        // a count followed by that many elements, each with a layout of its own; the count is
+        // taken from the size of the elements when serializing
+        template <auto Count, auto Elements> struct repeated {};
+
+        template <typename ... Fields> struct layout;
+
+        // specialised next to every response type as: using type = layout<...>;
+        template <typename T> struct of;
+
+        template <typename T> using layout_of = typename of<T>::type;
+
+        struct reader {
+            const std::uint8_t* pos;
+            const std::uint8_t* end;
+            kfinterner* interner; // kfstring members are shared through it when not nullptr
+            utf8::policy policy;
+
+            std::size_t remaining() const noexcept { return static_cast<std::size_t>(end - pos); }
+        };
+
+        using writer = std::vector<std::uint8_t>;
+
+        namespace detail {
+            template <typename M> struct member_traits;
+
+            template <typename C, typename T>
+            struct member_traits<T C::*> {
+                using type = T;
+            };
+
+            template <auto Member> using member_t = typename member_traits<decltype(Member)>::type;
+
+            // Searches the NUL that ends a string at r.pos, leaving at least tail bytes behind it.
+            inline std::size_t string_length(const reader& r, std::size_t tail) {
+                auto limit = r.remaining() - tail;
+                const auto* nul = static_cast<const std::uint8_t*>(std::memchr(r.pos, 0, limit));
+                if (nul == nullptr)
+                    throw std::range_error("consume_string is trying to read outside of the available memory, NUL character not found.");
+                return static_cast<std::size_t>(nul - r.pos);
+            }
+
+            inline void write_bytes(writer& out, const void* data, std::size_t size) {
+                auto offset = out.size();
+                out.resize(offset + size);
+                std::memcpy(out.data() + offset, data, size);
+            }
+
+            template <typename F> struct field;
+
+            template <auto Member>
+            struct field<value<Member>> {
+                using type = member_t<Member>;
+                static_assert(std::is_arithmetic_v<type>, "schema::value needs an arithmetic member");
+                static constexpr std::size_t min_size = sizeof(type);
+
+                template <typename T>
+                static void read(reader& r, T& object, std::size_t /*tail*/) {
+                    std::memcpy(&(object.*Member), r.pos, sizeof(type));
+                    r.pos += sizeof(type);
+                }
+
+                template <typename T>
+                static void write(const T& object, writer& out) {
+                    write_bytes(out, &(object.*Member), sizeof(type));
+                }
+            };
+
+            template <auto Member, typename Wire>
+            struct field<cast<Member, Wire>> {
+                static_assert(std::is_arithmetic_v<Wire>, "schema::cast needs an arithmetic wire type");
+                static constexpr std::size_t min_size = sizeof(Wire);
+
+                template <typename T>
+                static void read(reader& r, T& object, std::size_t /*tail*/) {
+                    Wire wire {};
+                    std::memcpy(&wire, r.pos, sizeof(Wire));
+                    object.*Member = static_cast<member_t<Member>>(wire);
+                    r.pos += sizeof(Wire);
+                }
+
+                template <typename T>
+                static void write(const T& object, writer& out) {
+                    auto wire = static_cast<Wire>(object.*Member);
+                    write_bytes(out, &wire, sizeof(Wire));
+                }
+            };
+
+            template <auto Member>
+            struct field<string<Member>> {
+                static constexpr std::size_t min_size = 1;
+
+                template <typename T>
+                static void read(reader& r, T& object, std::size_t tail) {
+                    auto scanned = utf8::scan(r.pos, r.remaining() - tail);
+                    const auto* data = static_cast<const char*>(static_cast<const void*>(r.pos));
+                    auto& s = object.*Member;
+
+                    // clean strings are copied straight from the packet
+                    if constexpr (std::is_same_v<member_t<Member>, std::string>) {
+                        if (scanned.clean || r.policy == utf8::policy::keep)
+                            s.assign(data, scanned.length);
+                        else
+                            utf8::sanitize(data, scanned.length, s);
+                    } else {
+                        s.assign(data, scanned.length, scanned.clean, r.interner, r.policy);
+                    }
+
+                    r.pos += scanned.length + 1;
+                }
+
+                template <typename T>
+                static void write(const T& object, writer& out) {
+                    const auto& s = object.*Member;
+                    out.insert(out.end(), s.begin(), s.end());
+                    out.push_back(0);
+                }
+            };
+
+            template <auto Member, std::size_t Length>
+            struct field<fixed<Member, Length>> {
+                static constexpr std::size_t min_size = Length;
+
+                template <typename T>
+                static void read(reader& r, T& object, std::size_t /*tail*/) {
+                    (object.*Member).assign(static_cast<const char*>(static_cast<const void*>(r.pos)), Length);
+                    r.pos += Length;
+                }
+
+                template <typename T>
+                static void write(const T& object, writer& out) {
+                    const auto& s = object.*Member;
+                    auto offset = out.size();
+                    out.resize(offset + Length, 0);
+                    std::memcpy(out.data() + offset, s.data(), std::min(Length, s.size()));
+                }
+            };
+
+            template <auto Member, typename Codec>
+            struct field<text<Member, Codec>> {
+                static constexpr std::size_t min_size = 1;
+
+                template <typename T>
+                static void read(reader& r, T& object, std::size_t tail) {
+                    auto length = string_length(r, tail);
+                    Codec::decode(static_cast<const char*>(static_cast<const void*>(r.pos)), length, object.*Member);
+                    r.pos += length + 1;
+                }
+
+                template <typename T>
+                static void write(const T& object, writer& out) {
+                    std::string s;
+                    Codec::encode(object.*Member, s);
+                    out.insert(out.end(), s.begin(), s.end());
+                    out.push_back(0);
+                }
+            };
+
+            template <auto Count, auto Elements>
+            struct field<repeated<Count, Elements>> {
+                using count_type = member_t<Count>;
+                using element_type = typename member_t<Elements>::value_type;
+                static constexpr std::size_t min_size = sizeof(count_type);
+
+                template <typename T>
+                static void read(reader& r, T& object, std::size_t tail) {
+                    count_type count {};
+                    std::memcpy(&count, r.pos, sizeof(count));
+                    r.pos += sizeof(count);
+                    object.*Count = count;
+
+                    // the count comes from the wire, reserve no more elements than the bytes left could hold
+                    auto& elements = object.*Elements;
+                    auto room = r.remaining() > tail ? r.remaining() - tail : 0;
+                    elements.clear();
+                    elements.reserve(std::min<std::size_t>(count, room / layout_of<element_type>::min_size));
+
+                    // the elements vary in size, so each one checks its own minimum size
+                    for (count_type i = 0; i < count; ++i)
+                        layout_of<element_type>::read(r, elements.emplace_back(), tail);
+                }
+
+                template <typename T>
+                static void write(const T& object, writer& out) {
+                    const auto& elements = object.*Elements;
+                    auto count = static_cast<count_type>(elements.size());
+                    write_bytes(out, &count, sizeof(count));
+
+                    for (const auto& element : elements)
+                        layout_of<element_type>::write(element, out);
+                }
+            };
+
+            template <typename T>
+            inline void read_fields(reader& /*r*/, T& /*object*/, std::size_t /*tail*/) {}
+
+            // every field is read knowing the minimum size of the fields after it
+            template <typename T, typename F, typename ... Rest>
+            inline void read_fields(reader& r, T& object, std::size_t tail) {
+                field<F>::read(r, object, tail + (std::size_t(0) + ... + field<Rest>::min_size));
+                read_fields<T, Rest...>(r, object, tail);
+            }
+        }
+
+        template <typename ... Fields>
+        struct layout {
+            static constexpr std::size_t min_size = (std::size_t(0) + ... + detail::field<Fields>::min_size);
+
+            // reads the layout at r.pos, leaving at least tail bytes for what follows it
+            template <typename T>
+            static void read(reader& r, T& object, std::size_t tail = 0) {
+                if (r.remaining() < min_size + tail)
+                    throw std::range_error("response is shorter than its minimum size");
+                detail::read_fields<T, Fields...>(r, object, tail);
+            }
+
+            template <typename T>
+            static void write(const T& object, writer& out) {
+                (detail::field<Fields>::write(object, out), ...);
+            }
+        };
+
+        template <typename T>
+        static constexpr std::size_t min_size = layout_of<T>::min_size;
+
+        // parses an object at the current position of the buffer and moves past it
+        template <typename T>
+        void parse(const kfbuffer& buff, T& object, kfinterner* interner = nullptr, utf8::policy policy = utf8::policy::keep) {
+            reader r { buff.data() + buff.tell(), buff.data() + buff.size(), interner, policy };
+            layout_of<T>::read(r, object);
+            buff.seek(r.pos - (buff.data() + buff.tell()));
+        }
+
+        // appends the wire form of an object
+        template <typename T>
+        void serialize(const T& object, writer& out) {
+            layout_of<T>::write(object, out);
+        }
+    }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,288 @@
+#include "kfshared.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    template <typename T> struct request_traits;
+
+    template <>
+    struct request_traits<kfc::kfdetails> {
+        static constexpr const std::int8_t packet = kfc::protocol::PACKET_DETAILS;
+        static constexpr const auto& request = kfc::protocol::REQUEST_DETAILS;
+    };
+
+    template <>
+    struct request_traits<kfc::kfrules> {
+        static constexpr const std::int8_t packet = kfc::protocol::PACKET_RULES;
+        static constexpr const auto& request = kfc::protocol::REQUEST_RULES;
+    };
+
+    template <>
+    struct request_traits<kfc::kfplayers> {
+        static constexpr const std::int8_t packet = kfc::protocol::PACKET_PLAYERS;
+        static constexpr const auto& request = kfc::protocol::REQUEST_PLAYERS;
+    };
+}
+
+kfc::kfshared_client::kfshared_client(const std::string& host, std::uint16_t port, std::chrono::milliseconds timeout, kfinterner* interner, utf8::policy policy)
+    : context_(), work_(boost::asio::make_work_guard(context_)), socket_(context_), timeout_(timeout), interner_(interner), policy_(policy) {
+    udp::resolver resolver(context_);
+    auto endpoints = resolver.resolve(udp::v4(), host, std::to_string(port));
+
+    socket_.open(udp::v4());
+    socket_.connect(endpoints.begin()->endpoint());
+
+    each([this](auto& f) { f.timer = std::make_unique<boost::asio::steady_timer>(context_); });
+
+    receive();
+    thread_ = std::thread([this]() { context_.run(); });
+}
+
+kfc::kfshared_client::~kfshared_client() {
+    boost::asio::post(context_, [this]() {
+        error_code ignored;
+        socket_.close(ignored);
+        each([](auto& f) { f.timer->cancel(); });
+    });
+
+    work_.reset();
+    thread_.join();
+
+    // callers still waiting are released with an error rather than a broken promise
+    std::lock_guard<std::mutex> lock(mutex_);
+    each([](auto& f) {
+        if (f.active)
+            f.promise.set_exception(std::make_exception_ptr(std::runtime_error("client destroyed while the request was in flight")));
+    });
+}
+
+kfc::kfshared_client::future_type<kfc::kfdetails> kfc::kfshared_client::async_details() {
+    return request<kfdetails>();
+}
+
+kfc::kfshared_client::future_type<kfc::kfrules> kfc::kfshared_client::async_rules() {
+    return request<kfrules>();
+}
+
+kfc::kfshared_client::future_type<kfc::kfplayers> kfc::kfshared_client::async_players() {
+    return request<kfplayers>();
+}
+
+template <typename T>
+kfc::kfshared_client::future_type<T> kfc::kfshared_client::request() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto& f = get<T>();
+    if (!f.active) {
+        f.promise = {};
+        f.future = f.promise.get_future().share();
+        f.active = true;
+        boost::asio::post(context_, [this]() { start<T>(); });
+    }
+
+    return f.future;
+}
+
+template <typename T>
+void kfc::kfshared_client::start() {
+    auto& f = get<T>();
+    f.pending = true;
+    f.sent = false;
+    f.challenges = 0;
+
+    // the deadline covers the challenge, when there is one to wait for
+    if (timeout_.count() != 0) {
+        f.timer->expires_after(timeout_);
+        f.timer->async_wait([this, &f](const error_code& error) {
+            if (error || !f.pending)
+                return;
+
+            fail(f, std::make_exception_ptr(timeout_error("timed out waiting for a response")));
+
+            // the challenge may be what got lost, ask for a new one next time; requests that
+            // started later and still wait for one get a new challenge request of their own
+            challenged_ = false;
+            challenging_ = false;
+            if (awaiting_challenge())
+                send_challenge();
+        });
+    }
+
+    if (challenged_)
+        return send(f);
+    if (!challenging_)
+        send_challenge();
+}
+
+void kfc::kfshared_client::send_challenge() {
+    challenging_ = true;
+
+    error_code error;
+    socket_.send(boost::asio::buffer(protocol::REQUEST_CHALLENGE), 0, error);
+    if (error) {
+        challenging_ = false;
+        auto failure = std::make_exception_ptr(std::runtime_error(error.message()));
+        each([this, &failure](auto& f) { fail(f, failure); });
+    }
+}
+
+bool kfc::kfshared_client::awaiting_challenge() noexcept {
+    auto awaiting = false;
+    each([&awaiting](auto& f) { awaiting = awaiting || (f.pending && !f.sent); });
+    return awaiting;
+}
+
+template <typename T>
+void kfc::kfshared_client::send(flight<T>& f) {
+    const auto& request = request_traits<T>::request;
+
+    // request data followed by the challenge
+    sendbuf_.assign(request.begin(), request.end());
+    sendbuf_.resize(request.size() + sizeof(challenge_));
+    std::memcpy(sendbuf_.data() + request.size(), &challenge_, sizeof(challenge_));
+
+    error_code error;
+    socket_.send(boost::asio::buffer(sendbuf_), 0, error);
+    if (error)
+        return fail(f, std::make_exception_ptr(std::runtime_error(error.message())));
+
+    f.sent = true;
+}
+
+template <typename T>
+void kfc::kfshared_client::complete(flight<T>& f, std::shared_ptr<const T> value) {
+    if (!f.pending)
+        return;
+
+    f.pending = false;
+    f.timer->cancel();
+
+    std::promise<std::shared_ptr<const T>> promise;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        promise = std::move(f.promise);
+        f.active = false;
+    }
+
+    promise.set_value(std::move(value));
+}
+
+template <typename T>
+void kfc::kfshared_client::fail(flight<T>& f, std::exception_ptr error) {
+    if (!f.pending)
+        return;
+
+    f.pending = false;
+    f.timer->cancel();
+
+    std::promise<std::shared_ptr<const T>> promise;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        promise = std::move(f.promise);
+        f.active = false;
+    }
+
+    promise.set_exception(std::move(error));
+}
+
+void kfc::kfshared_client::receive() {
+    socket_.async_receive(boost::asio::buffer(recvbuf_), [this](const error_code& error, std::size_t received) {
+        on_receive(error, received);
+    });
+}
+
+void kfc::kfshared_client::on_receive(const error_code& error, std::size_t received) {
+    if (error == boost::asio::error::operation_aborted || !socket_.is_open())
+        return;
+
+    if (error) {
+        // an unreachable server fails everything in flight, the socket stays usable
+        challenging_ = false;
+        auto failure = std::make_exception_ptr(std::runtime_error(error.message()));
+        each([this, &failure](auto& f) { fail(f, failure); });
+        return receive();
+    }
+
+    if (!protocol::is_split(recvbuf_.data(), received)) {
+        process(recvbuf_.data(), received);
+    } else if (received >= protocol::SPLIT_HEADER_SIZE) {
+        // responses of different sections may be split and arrive interleaved
+        std::int32_t id = 0;
+        std::memcpy(&id, recvbuf_.data() + sizeof(std::int32_t), sizeof(id));
+
+        auto& assembly = assemblies_[id];
+        try {
+            if (assembly.add(recvbuf_.data(), received)) {
+                auto payload = std::move(assembly.payload());
+                assemblies_.erase(id);
+                process(payload.data(), payload.size());
+            }
+        } catch (const std::exception&) {
+            assemblies_.erase(id);
+        }
+    }
+
+    // abandoned split responses are dropped once nothing is in flight
+    if (!get<kfdetails>().pending && !get<kfrules>().pending && !get<kfplayers>().pending)
+        assemblies_.clear();
+
+    receive();
+}
+
+void kfc::kfshared_client::process(const std::uint8_t* data, std::size_t size) {
+    kfbuffer response(const_cast<std::uint8_t*>(data), size); // NOLINT(cppcoreguidelines-pro-type-const-cast) -- kfbuffer only reads
+    kfheader header;
+
+    try {
+        response.consume(header.magic);
+        response.consume(header.type);
+        if (header.magic != protocol::SINGLE_MAGIC)
+            return;
+
+        if (header.type == protocol::PACKET_CHALLENGE) {
+            auto challenge = response.consume<std::int32_t>();
+            auto replaced = challenged_ && challenge != challenge_;
+            if (!challenging_ && !replaced && !awaiting_challenge())
+                return; // one more answer with a challenge that was already sent again
+
+            challenge_ = challenge;
+            challenged_ = true;
+
+            // an answer to our challenge request sends the requests that waited for it, those sent
+            // before carry the same challenge and are still answered; a server that replaced its
+            // challenge and answered a request with the new one instead gets all of them again
+            each([this, replaced](auto& f) {
+                if (!f.pending || (f.sent && !replaced))
+                    return;
+                if (replaced && ++f.challenges >= protocol::MAX_CHALLENGES)
+                    return fail(f, std::make_exception_ptr(std::runtime_error("server keeps answering with a new challenge")));
+                send(f);
+            });
+
+            challenging_ = false;
+            return;
+        }
+    } catch (const std::exception&) {
+        return; // too short to be anything we asked for
+    }
+
+    switch (header.type) {
+    case protocol::PACKET_DETAILS: return parse(get<kfdetails>(), response);
+    case protocol::PACKET_RULES: return parse(get<kfrules>(), response);
+    case protocol::PACKET_PLAYERS: return parse(get<kfplayers>(), response);
+    default: return;
+    }
+}
+
+template <typename T>
+void kfc::kfshared_client::parse(flight<T>& f, const kfbuffer& response) {
+    if (!f.pending)
+        return;
+
+    try {
+        complete(f, std::make_shared<const T>(response, interner_, policy_));
+    } catch (const std::exception&) {
+        fail(f, std::current_exception());
+    }
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#ifndef kfclient_shared_hpp
+#define kfclient_shared_hpp
+
+#include "libdef.hpp"
+#include "kfdetails.hpp"
+#include "kfrules.hpp"
+#include "kfplayers.hpp"
+#include "kfprotocol.hpp"
+#include "kftransport.hpp"
+
+#include <boost/asio.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <array>
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace kfc {
+    // A client for one server that any number of threads can share. Every caller owns its result
+    // as a shared, immutable object. Responses carry no request id, so requests in flight are told
+    // apart by their packet type: concurrent requests for the same section are answered by one
+    // round trip, requests for different sections are in flight side by side. The challenge is
+    // shared by all of them. The socket is driven by a thread of the client's own.
+    class KFCLIENT_API kfshared_client {
+        using io_context = boost::asio::io_context;
+        using udp = boost::asio::ip::udp;
+        using error_code = boost::system::error_code;
+
+        static constexpr const std::size_t RECEIVE_BUFFER_SIZE = 2048;
+        static constexpr const std::chrono::milliseconds DEFAULT_TIMEOUT = std::chrono::seconds(10);
+
+    public:
+        template <typename T>
+        using future_type = std::shared_future<std::shared_ptr<const T>>;
+
+        // a timeout of zero waits for responses indefinitely; the strings of the results are shared
+        // through the interner when one is given, it must outlive the client, and checked under
+        // the policy, see kfclient::utf8_policy
+        kfshared_client(const std::string& host, std::uint16_t port, std::chrono::milliseconds timeout = DEFAULT_TIMEOUT, kfinterner* interner = nullptr, utf8::policy policy = utf8::policy::keep);
+        ~kfshared_client();
+
+        kfshared_client(const kfshared_client&) = delete;
+        kfshared_client(kfshared_client&&) = delete;
+        kfshared_client& operator=(const kfshared_client&) = delete;
+        kfshared_client& operator=(kfshared_client&&) = delete;
+
+        // block until the response arrived, throw timeout_error or std::runtime_error otherwise
+        std::shared_ptr<const kfdetails> request_details() { return async_details().get(); }
+        std::shared_ptr<const kfrules> request_rules() { return async_rules().get(); }
+        std::shared_ptr<const kfplayers> request_players() { return async_players().get(); }
+
+        // start a request, or join the one in flight for the same section
+        future_type<kfdetails> async_details();
+        future_type<kfrules> async_rules();
+        future_type<kfplayers> async_players();
+
+    private:
+        template <typename T>
+        struct flight {
+            // guarded by mutex_
+            std::promise<std::shared_ptr<const T>> promise;
+            future_type<T> future;
+            bool active = false;
+
+            // only touched by the thread of the client
+            std::unique_ptr<boost::asio::steady_timer> timer;
+            std::size_t challenges = 0;
+            bool pending = false;
+            bool sent = false; // the request went out, otherwise it waits for a challenge
+        };
+
+        template <typename T> flight<T>& get() noexcept { return std::get<flight<T>>(flights_); }
+
+        template <typename F>
+        void each(F&& f) {
+            std::apply([&f](auto&... flights) { (f(flights), ...); }, flights_);
+        }
+
+        template <typename T> future_type<T> request();
+        template <typename T> void start();
+        template <typename T> void send(flight<T>& f);
+        template <typename T> void complete(flight<T>& f, std::shared_ptr<const T> value);
+        template <typename T> void fail(flight<T>& f, std::exception_ptr error);
+        template <typename T> void parse(flight<T>& f, const kfbuffer& response);
+
+        void send_challenge();
+        bool awaiting_challenge() noexcept;
+        void receive();
+        void on_receive(const error_code& error, std::size_t received);
+        void process(const std::uint8_t* data, std::size_t size);
+
+        io_context context_;
+        boost::asio::executor_work_guard<io_context::executor_type> work_;
+        udp::socket socket_;
+        std::chrono::milliseconds timeout_;
+        kfinterner* interner_;
+        utf8::policy policy_;
+        std::mutex mutex_;
+        std::tuple<flight<kfdetails>, flight<kfrules>, flight<kfplayers>> flights_;
+
+        // only touched by the thread of the client
+        std::array<std::uint8_t, RECEIVE_BUFFER_SIZE> recvbuf_ = {};
+        std::vector<std::uint8_t> sendbuf_;
+        std::map<std::int32_t, kfreassembler> assemblies_; // by split response id
+        std::int32_t challenge_ = 0;
+        bool challenged_ = false;
+        bool challenging_ = false;
+
+        std::thread thread_;
+    };
+}
+
+#endif
\ No newline at end of file
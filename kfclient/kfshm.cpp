@@ -0,0 +1,173 @@
+#include "kfshm.hpp"
+
+#include <atomic>
+#include <thread>
+#include <stdexcept>
+#include <new>
+
+namespace kfc {
+    namespace detail {
+        static constexpr const std::uint32_t KFSHM_MAGIC = 0x4D48534B; // "KSHM"
+        static constexpr const std::uint32_t KFSHM_VERSION = 1;
+        static constexpr const std::size_t KFSHM_HOST_LENGTH = 64;
+
+        struct alignas(64) kfshm_slot {
+            // the key is written once, before count is incremented, and never changes afterwards
+            std::array<char, KFSHM_HOST_LENGTH> host = {};
+            std::uint16_t port = 0;
+
+            // odd while the publisher is writing snapshot
+            std::atomic<std::uint32_t> sequence {0};
+            kfsnapshot snapshot;
+        };
+
+        struct alignas(64) kfshm_header {
+            std::uint32_t magic = KFSHM_MAGIC;
+            std::uint32_t version = KFSHM_VERSION;
+            std::uint32_t slot_size = sizeof(kfshm_slot);
+            std::uint32_t capacity = 0;
+            std::atomic<std::uint32_t> count {0};
+        };
+
+        static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "the seqlock requires lock-free 32-bit atomics");
+
+        static std::string kfshm_key(const std::string& host, std::uint16_t port) {
+            return host + ":" + std::to_string(port);
+        }
+    }
+}
+
+kfc::kfshm_publisher::kfshm_publisher(const std::string& name, std::size_t capacity, bool replace)
+    : name_(name), header_(nullptr), slots_(nullptr) {
+        using namespace boost::interprocess;
+
+        if (capacity == 0)
+            throw std::invalid_argument("kfshm_publisher capacity must be at least 1");
+
+        if (replace)
+            shared_memory_object::remove(name_.c_str());
+
+        try {
+            shm_ = shared_memory_object(create_only, name_.c_str(), read_write);
+        } catch (const interprocess_exception& ex) {
+            if (ex.get_error_code() == already_exists_error)
+                throw std::runtime_error("kfshm_publisher region " + name_ + " already exists, another publisher may be using it");
+            throw;
+        }
+
+        try {
+            shm_.truncate(static_cast<offset_t>(sizeof(detail::kfshm_header) + (capacity * sizeof(detail::kfshm_slot))));
+            region_ = mapped_region(shm_, read_write);
+        } catch (...) {
+            shared_memory_object::remove(name_.c_str());
+            throw;
+        }
+
+        auto* base = static_cast<std::uint8_t*>(region_.get_address());
+        header_ = new (base) detail::kfshm_header(); // NOLINT(cppcoreguidelines-owning-memory) -- lives in the mapped region
+        header_->capacity = static_cast<std::uint32_t>(capacity);
+        slots_ = static_cast<detail::kfshm_slot*>(static_cast<void*>(base + sizeof(detail::kfshm_header)));
+
+        for (std::size_t i = 0; i < capacity; ++i)
+            new (&slots_[i]) detail::kfshm_slot(); // NOLINT(cppcoreguidelines-owning-memory) -- lives in the mapped region
+}
+
+kfc::kfshm_publisher::~kfshm_publisher() {
+    boost::interprocess::shared_memory_object::remove(name_.c_str());
+}
+
+void kfc::kfshm_publisher::publish(const std::string& host, std::uint16_t port, const kfsnapshot& snapshot) {
+    auto key = detail::kfshm_key(host, port);
+    auto iter = index_.find(key);
+
+    if (iter == index_.end()) {
+        auto count = header_->count.load(std::memory_order_relaxed);
+        if (count >= header_->capacity)
+            throw std::length_error("kfshm_publisher region is full");
+        if (host.size() >= detail::KFSHM_HOST_LENGTH)
+            throw std::length_error("kfshm_publisher host name is too long");
+
+        auto& slot = slots_[count];
+        std::memcpy(slot.host.data(), host.data(), host.size());
+        slot.port = port;
+        header_->count.store(count + 1, std::memory_order_release);
+
+        iter = index_.emplace(key, count).first;
+    }
+
+    auto& slot = slots_[iter->second];
+    auto sequence = slot.sequence.load(std::memory_order_relaxed);
+
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(static_cast<void*>(&slot.snapshot), &snapshot, sizeof(kfsnapshot));
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+kfc::kfshm_reader::kfshm_reader(const std::string& name)
+    : header_(nullptr), slots_(nullptr) {
+        using namespace boost::interprocess;
+
+        shm_ = shared_memory_object(open_only, name.c_str(), read_only);
+        region_ = mapped_region(shm_, read_only);
+
+        if (region_.get_size() < sizeof(detail::kfshm_header))
+            throw std::runtime_error("kfshm_reader region is too small");
+
+        const auto* base = static_cast<const std::uint8_t*>(region_.get_address());
+        header_ = static_cast<const detail::kfshm_header*>(static_cast<const void*>(base));
+
+        if (header_->magic != detail::KFSHM_MAGIC || header_->version != detail::KFSHM_VERSION || header_->slot_size != sizeof(detail::kfshm_slot))
+            throw std::runtime_error("kfshm_reader region has an incompatible layout");
+        if (region_.get_size() < sizeof(detail::kfshm_header) + (header_->capacity * sizeof(detail::kfshm_slot)))
+            throw std::runtime_error("kfshm_reader region is truncated");
+
+        slots_ = static_cast<const detail::kfshm_slot*>(static_cast<const void*>(base + sizeof(detail::kfshm_header)));
+}
+
+std::size_t kfc::kfshm_reader::size() const noexcept {
+    return header_->count.load(std::memory_order_acquire);
+}
+
+bool kfc::kfshm_reader::read(const std::string& host, std::uint16_t port, kfsnapshot& snapshot) const {
+    auto count = size();
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto& slot = slots_[i];
+        if (slot.port != port || host.size() >= detail::KFSHM_HOST_LENGTH)
+            continue;
+        if (std::memcmp(slot.host.data(), host.data(), host.size()) != 0 || slot.host.at(host.size()) != '\0')
+            continue;
+
+        read_slot(slot, snapshot);
+        return true;
+    }
+
+    return false;
+}
+
+void kfc::kfshm_reader::read(std::size_t index, std::string& host, std::uint16_t& port, kfsnapshot& snapshot) const {
+    if (index >= size())
+        throw std::out_of_range("kfshm_reader slot index out of range");
+
+    const auto& slot = slots_[index];
+    host = slot.host.data();
+    port = slot.port;
+    read_slot(slot, snapshot);
+}
+
+void kfc::kfshm_reader::read_slot(const detail::kfshm_slot& slot, kfsnapshot& snapshot) const {
+    for (;;) {
+        auto before = slot.sequence.load(std::memory_order_acquire);
+        if ((before & 1U) != 0) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::memcpy(static_cast<void*>(&snapshot), &slot.snapshot, sizeof(kfsnapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.sequence.load(std::memory_order_relaxed) == before)
+            return;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef kfclient_shm_hpp
+#define kfclient_shm_hpp
+
+#include "libdef.hpp"
+#include "kfsnapshot.hpp"
+
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+
+namespace kfc {
+    namespace detail {
+        struct kfshm_header;
+        struct kfshm_slot;
+    }
+
+    // Publishes the latest kfsnapshot per server into a named shared memory region. There must be
+    // exactly one publisher per region; every slot is guarded by a seqlock so readers never block it.
+    // Creating a region that already exists fails, unless replace is set (for a region left behind
+    // by a publisher that did not exit cleanly); the region is removed when the publisher is destroyed.
+    class KFCLIENT_API kfshm_publisher {
+    public:
+        kfshm_publisher(const std::string& name, std::size_t capacity, bool replace = false);
+        ~kfshm_publisher();
+
+        kfshm_publisher(const kfshm_publisher&) = delete;
+        kfshm_publisher(kfshm_publisher&&) = delete;
+        kfshm_publisher& operator=(const kfshm_publisher&) = delete;
+        kfshm_publisher& operator=(kfshm_publisher&&) = delete;
+
+        void publish(const std::string& host, std::uint16_t port, const kfsnapshot& snapshot);
+
+    private:
+        std::string name_;
+        boost::interprocess::shared_memory_object shm_;
+        boost::interprocess::mapped_region region_;
+        detail::kfshm_header* header_;
+        detail::kfshm_slot* slots_;
+        std::unordered_map<std::string, std::size_t> index_;
+    };
+
+    // Lock-free, read-only view of a region created by kfshm_publisher.
+    class KFCLIENT_API kfshm_reader {
+    public:
+        explicit kfshm_reader(const std::string& name);
+
+        std::size_t size() const noexcept;
+
+        bool read(const std::string& host, std::uint16_t port, kfsnapshot& snapshot) const;
+        void read(std::size_t index, std::string& host, std::uint16_t& port, kfsnapshot& snapshot) const;
+
+    private:
+        void read_slot(const detail::kfshm_slot& slot, kfsnapshot& snapshot) const;
+
+        boost::interprocess::shared_memory_object shm_;
+        boost::interprocess::mapped_region region_;
+        const detail::kfshm_header* header_;
+        const detail::kfshm_slot* slots_;
+    };
+}
+
+#endif
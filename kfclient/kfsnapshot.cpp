@@ -0,0 +1,73 @@
+#include "kfsnapshot.hpp"
+
+void kfc::kfsnapshot::store(const kfdetails& details) {
+    protocol = details.protocol;
+    hostname.assign(details.hostname);
+    map.assign(details.map);
+    game_dir.assign(details.game_dir);
+    game_description.assign(details.game_description);
+    steam_app_id = details.steam_app_id;
+    player_count = details.player_count;
+    player_cap = details.player_cap;
+    operating_system = details.operating_system;
+    password_set = details.password_set;
+    version.assign(details.version);
+    waves_total = details.waves_total;
+    waves_current = details.waves_current;
+    flags |= HAS_DETAILS;
+}
+
+void kfc::kfsnapshot::store(const kfplayers& players) {
+    player_list_count = static_cast<std::uint8_t>(players.players.size() < MAX_PLAYERS ? players.players.size() : MAX_PLAYERS);
+
+    for (std::size_t i = 0; i < player_list_count; ++i) {
+        const auto& player = players.players[i];
+        auto& flat = player_list.at(i);
+        flat.id = player.id;
+        flat.score = player.score;
+        flat.time = player.time;
+        flat.name.assign(player.name);
+    }
+
+    flags |= HAS_PLAYERS;
+}
+
+void kfc::kfsnapshot::store_error(const std::string& message) {
+    error.assign(message);
+    flags |= HAS_ERROR;
+}
+
+kfc::kfdetails kfc::kfsnapshot::details() const {
+    kfdetails details;
+    details.protocol = protocol;
+    details.hostname = hostname.str();
+    details.map = map.str();
+    details.game_dir = game_dir.str();
+    details.game_description = game_description.str();
+    details.steam_app_id = steam_app_id;
+    details.player_count = player_count;
+    details.player_cap = player_cap;
+    details.operating_system = operating_system;
+    details.password_set = password_set;
+    details.version = version.str();
+    details.waves_total = waves_total;
+    details.waves_current = waves_current;
+    return details;
+}
+
+kfc::kfplayers kfc::kfsnapshot::players() const {
+    kfplayers players;
+    players.count = player_list_count;
+    players.players.resize(player_list_count);
+
+    for (std::size_t i = 0; i < player_list_count; ++i) {
+        const auto& flat = player_list.at(i);
+        auto& player = players.players[i];
+        player.id = flat.id;
+        player.name = flat.name.str();
+        player.score = flat.score;
+        player.time = flat.time;
+    }
+
+    return players;
+}
@@ -0,0 +1,91 @@
+#ifndef kfclient_snapshot_hpp
+#define kfclient_snapshot_hpp
+
+#include "libdef.hpp"
+#include "kfdetails.hpp"
+#include "kfplayers.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <array>
+#include <type_traits>
+
+namespace kfc {
+    // a fixed capacity, pointer-free string; values longer than N are truncated at a UTF-8 code point boundary
+    template <std::size_t N>
+    struct kfflat_string {
+        static_assert(N < 256, "kfflat_string length must fit in a byte");
+
+        std::uint8_t length = 0;
+        std::array<char, N> data = {};
+
+        void assign(const std::string& value) noexcept {
+            std::size_t size = value.size() < N ? value.size() : N;
+
+            // do not cut a multi-byte sequence in half: back off over the continuation bytes (10xxxxxx)
+            // that follow the cut, a sequence has at most three of them
+            if (size < value.size()) {
+                std::size_t limit = size > 3 ? size - 3 : 0;
+                while (size > limit && (static_cast<std::uint8_t>(value[size]) & 0xC0U) == 0x80U)
+                    --size;
+            }
+
+            length = static_cast<std::uint8_t>(size);
+            std::memcpy(data.data(), value.data(), length);
+        }
+
+        std::string str() const {
+            return std::string(data.data(), length);
+        }
+    };
+
+    struct kfsnapshot_player {
+        std::uint8_t id = 0;
+        std::uint32_t score = 0;
+        std::uint32_t time = 0;
+        kfflat_string<63> name;
+    };
+
+    // flat, trivially copyable encoding of kfdetails and kfplayers, suitable for shared memory
+    struct KFCLIENT_API kfsnapshot {
+        static constexpr const std::size_t MAX_PLAYERS = 64;
+        static constexpr const std::uint32_t HAS_DETAILS = 1U << 0U;
+        static constexpr const std::uint32_t HAS_PLAYERS = 1U << 1U;
+        static constexpr const std::uint32_t HAS_ERROR = 1U << 2U;
+
+        std::uint64_t timestamp = 0; // milliseconds since the unix epoch
+        std::uint32_t flags = 0;
+
+        std::uint8_t protocol = 0;
+        kfflat_string<127> hostname;
+        kfflat_string<63> map;
+        kfflat_string<31> game_dir;
+        kfflat_string<63> game_description;
+        std::uint16_t steam_app_id = 0;
+        std::uint8_t player_count = 0;
+        std::uint8_t player_cap = 0;
+        std::uint8_t operating_system = 0;
+        bool password_set = false;
+        kfflat_string<4> version;
+        std::int32_t waves_total = 0;
+        std::int32_t waves_current = 0;
+
+        std::uint8_t player_list_count = 0;
+        std::array<kfsnapshot_player, MAX_PLAYERS> player_list = {};
+
+        kfflat_string<127> error;
+
+        void store(const kfdetails& details);
+        void store(const kfplayers& players);
+        void store_error(const std::string& message);
+
+        kfdetails details() const;
+        kfplayers players() const;
+    };
+
+    static_assert(std::is_trivially_copyable_v<kfsnapshot>, "kfsnapshot must be trivially copyable");
+}
+
+#endif
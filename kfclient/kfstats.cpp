@@ -0,0 +1,207 @@
+#include "kfstats.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+namespace {
+    constexpr const std::size_t COUNTERS = static_cast<std::size_t>(kfc::kfcounter::count);
+    constexpr const std::size_t REQUESTS = static_cast<std::size_t>(kfc::kfrequest::count);
+
+    // Only the owning thread writes to a shard, so a relaxed load and store is enough and
+    // avoids locked instructions on the hot path; readers load the values while aggregating.
+    struct shard {
+        std::array<std::atomic<std::uint64_t>, COUNTERS> counters {};
+        std::array<std::array<std::atomic<std::uint64_t>, kfc::kfhistogram::BUCKETS>, REQUESTS> buckets {};
+        std::array<std::atomic<std::uint64_t>, REQUESTS> sums {};
+    };
+
+    void bump(std::atomic<std::uint64_t>& value, std::uint64_t amount) noexcept {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    void collect(const shard& s, kfc::kfstats_snapshot& snapshot) {
+        for (std::size_t i = 0; i < COUNTERS; ++i)
+            snapshot.counters.at(i) += s.counters.at(i).load(std::memory_order_relaxed);
+
+        for (std::size_t r = 0; r < REQUESTS; ++r) {
+            auto& histogram = snapshot.latencies.at(r);
+            for (std::size_t b = 0; b < kfc::kfhistogram::BUCKETS; ++b) {
+                auto count = s.buckets.at(r).at(b).load(std::memory_order_relaxed);
+                if (count != 0)
+                    histogram.add(b, count, 0);
+            }
+            histogram.add(0, 0, s.sums.at(r).load(std::memory_order_relaxed));
+        }
+    }
+
+    struct registry {
+        std::mutex mutex;
+        std::vector<const shard*> live;
+        kfc::kfstats_snapshot retired; // totals of shards whose threads have exited
+    };
+
+    registry& global_registry() {
+        static auto* instance = new registry(); // NOLINT(cppcoreguidelines-owning-memory) -- intentionally leaked, thread_local shards may outlive static destructors
+        return *instance;
+    }
+
+    struct shard_owner {
+        shard data;
+
+        shard_owner() {
+            auto& r = global_registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.live.push_back(&data);
+        }
+
+        shard_owner(const shard_owner&) = delete;
+        shard_owner(shard_owner&&) = delete;
+        shard_owner& operator=(const shard_owner&) = delete;
+        shard_owner& operator=(shard_owner&&) = delete;
+
+        ~shard_owner() {
+            auto& r = global_registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            collect(data, r.retired);
+            r.live.erase(std::remove(r.live.begin(), r.live.end(), &data), r.live.end());
+        }
+    };
+
+    shard& local_shard() {
+        thread_local shard_owner owner;
+        return owner.data;
+    }
+
+    std::atomic<kfc::kfstats_hook*> installed_hook { nullptr };
+}
+
+const char* kfc::to_string(kfcounter counter) noexcept {
+    switch (counter) {
+    case kfcounter::packets_sent: return "packets_sent";
+    case kfcounter::packets_received: return "packets_received";
+    case kfcounter::bytes_sent: return "bytes_sent";
+    case kfcounter::bytes_received: return "bytes_received";
+    case kfcounter::timeouts: return "timeouts";
+    case kfcounter::retries: return "retries";
+    case kfcounter::challenges: return "challenges";
+    case kfcounter::parse_failures: return "parse_failures";
+    case kfcounter::unchanged_responses: return "unchanged_responses";
+    case kfcounter::late_responses: return "late_responses";
+    default: return "unknown";
+    }
+}
+
+const char* kfc::to_string(kfrequest request) noexcept {
+    switch (request) {
+    case kfrequest::challenge: return "challenge";
+    case kfrequest::details: return "details";
+    case kfrequest::rules: return "rules";
+    case kfrequest::players: return "players";
+    default: return "unknown";
+    }
+}
+
+std::size_t kfc::kfhistogram::bucket(std::uint64_t value) noexcept {
+    if (value < SUB_BUCKETS)
+        return static_cast<std::size_t>(value);
+    if (value >= (std::uint64_t(1) << MAX_BITS))
+        return BUCKETS - 1;
+
+#if defined(__GNUC__) || defined(__clang__)
+    auto msb = static_cast<std::size_t>(63 - __builtin_clzll(value));
+#else
+    std::size_t msb = 0;
+    for (auto v = value; v > 1; v >>= 1U)
+        msb++;
+#endif
+
+    auto shift = msb - SUB_BITS;
+    return ((shift + 1) * SUB_BUCKETS) + static_cast<std::size_t>((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+std::uint64_t kfc::kfhistogram::lower_bound(std::size_t bucket) noexcept {
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+
+    auto shift = (bucket / SUB_BUCKETS) - 1;
+    return static_cast<std::uint64_t>(SUB_BUCKETS + (bucket % SUB_BUCKETS)) << shift;
+}
+
+void kfc::kfhistogram::record(std::uint64_t value) noexcept {
+    add(bucket(value), 1, value);
+}
+
+void kfc::kfhistogram::add(std::size_t bucket, std::uint64_t count, std::uint64_t sum) noexcept {
+    buckets_.at(bucket) += count;
+    count_ += count;
+    sum_ += sum;
+}
+
+void kfc::kfhistogram::merge(const kfhistogram& other) noexcept {
+    for (std::size_t i = 0; i < BUCKETS; ++i)
+        buckets_.at(i) += other.buckets_.at(i);
+    count_ += other.count_;
+    sum_ += other.sum_;
+}
+
+std::uint64_t kfc::kfhistogram::percentile(double q) const noexcept {
+    if (count_ == 0)
+        return 0;
+
+    auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count_)));
+    rank = std::max<std::uint64_t>(rank, 1);
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets_.at(i);
+        if (seen >= rank) {
+            auto low = lower_bound(i);
+            return i + 1 < BUCKETS ? low + ((lower_bound(i + 1) - low) / 2) : low;
+        }
+    }
+
+    return lower_bound(BUCKETS - 1);
+}
+
+void kfc::kfstats::count(kfcounter counter, std::uint64_t amount) noexcept {
+    auto index = static_cast<std::size_t>(counter);
+    local_.counters.at(index) += amount;
+    bump(local_shard().counters.at(index), amount);
+
+    if (auto* h = installed_hook.load(std::memory_order_acquire))
+        h->count(counter, amount);
+}
+
+void kfc::kfstats::latency(kfrequest request, std::chrono::steady_clock::duration elapsed) noexcept {
+    auto index = static_cast<std::size_t>(request);
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
+    auto value = static_cast<std::uint64_t>(std::max<std::chrono::microseconds::rep>(micros.count(), 0));
+
+    local_.latencies.at(index).record(value);
+
+    auto& s = local_shard();
+    bump(s.buckets.at(index).at(kfhistogram::bucket(value)), 1);
+    bump(s.sums.at(index), value);
+
+    if (auto* h = installed_hook.load(std::memory_order_acquire))
+        h->latency(request, micros);
+}
+
+kfc::kfstats_snapshot kfc::kfstats::global() {
+    auto& r = global_registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    auto snapshot = r.retired;
+    for (const auto* s : r.live)
+        collect(*s, snapshot);
+
+    return snapshot;
+}
+
+void kfc::kfstats::hook(kfstats_hook* hook) noexcept {
+    installed_hook.store(hook, std::memory_order_release);
+}
@@ -0,0 +1,109 @@
+#ifndef kfclient_stats_hpp
+#define kfclient_stats_hpp
+
+#include "libdef.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+
+namespace kfc {
+    enum class kfcounter : std::size_t {
+        packets_sent,
+        packets_received,
+        bytes_sent,
+        bytes_received,
+        timeouts,
+        retries,
+        challenges,
+        parse_failures,
+        unchanged_responses,
+        late_responses,
+        count
+    };
+
+    enum class kfrequest : std::size_t {
+        challenge,
+        details,
+        rules,
+        players,
+        count
+    };
+
+    KFCLIENT_API const char* to_string(kfcounter counter) noexcept;
+    KFCLIENT_API const char* to_string(kfrequest request) noexcept;
+
+    // Log-linear histogram of microsecond latencies: every power of two is split into SUB_BUCKETS
+    // linear buckets, which bounds the relative error of any percentile to 1 / SUB_BUCKETS.
+    // Values of 2^MAX_BITS microseconds (about 12 days) and up share the last bucket.
+    class KFCLIENT_API kfhistogram {
+    public:
+        static constexpr const std::size_t SUB_BITS = 3;
+        static constexpr const std::size_t MAX_BITS = 40;
+        static constexpr const std::size_t SUB_BUCKETS = std::size_t(1) << SUB_BITS;
+        static constexpr const std::size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+        static std::size_t bucket(std::uint64_t value) noexcept;
+        static std::uint64_t lower_bound(std::size_t bucket) noexcept;
+
+        void record(std::uint64_t value) noexcept;
+        void add(std::size_t bucket, std::uint64_t count, std::uint64_t sum) noexcept;
+        void merge(const kfhistogram& other) noexcept;
+
+        std::uint64_t count() const noexcept { return count_; }
+        std::uint64_t sum() const noexcept { return sum_; }
+        std::uint64_t at(std::size_t bucket) const noexcept { return buckets_.at(bucket); }
+
+        // estimate of the value at quantile q (0..1), in microseconds
+        std::uint64_t percentile(double q) const noexcept;
+
+    private:
+        std::array<std::uint64_t, BUCKETS> buckets_ = {};
+        std::uint64_t count_ = 0;
+        std::uint64_t sum_ = 0;
+    };
+
+    struct KFCLIENT_API kfstats_snapshot {
+        std::array<std::uint64_t, static_cast<std::size_t>(kfcounter::count)> counters = {};
+        std::array<kfhistogram, static_cast<std::size_t>(kfrequest::count)> latencies = {};
+
+        std::uint64_t counter(kfcounter c) const noexcept { return counters.at(static_cast<std::size_t>(c)); }
+        const kfhistogram& latency(kfrequest r) const noexcept { return latencies.at(static_cast<std::size_t>(r)); }
+    };
+
+    // Receives every event as it happens, install one with kfstats::hook to feed another metrics system.
+    // Hooks are called on the thread of the client that produced the event and must not throw.
+    class KFCLIENT_API kfstats_hook {
+    public:
+        kfstats_hook() = default;
+        kfstats_hook(const kfstats_hook&) = default;
+        kfstats_hook(kfstats_hook&&) = default;
+        kfstats_hook& operator=(const kfstats_hook&) = default;
+        kfstats_hook& operator=(kfstats_hook&&) = default;
+        virtual ~kfstats_hook() = default;
+
+        virtual void count(kfcounter /*counter*/, std::uint64_t /*amount*/) {}
+        virtual void latency(kfrequest /*request*/, std::chrono::microseconds /*elapsed*/) {}
+    };
+
+    // Statistics of a single client. Every event is also added to the global statistics, which are
+    // kept in thread-local shards and only aggregated when kfstats::global() is called.
+    class KFCLIENT_API kfstats {
+    public:
+        void count(kfcounter counter, std::uint64_t amount = 1) noexcept;
+        void latency(kfrequest request, std::chrono::steady_clock::duration elapsed) noexcept;
+
+        const kfstats_snapshot& snapshot() const noexcept { return local_; }
+
+        static kfstats_snapshot global();
+
+        // the hook is not owned and must outlive every client, pass nullptr to remove it
+        static void hook(kfstats_hook* hook) noexcept;
+
+    private:
+        kfstats_snapshot local_;
+    };
+}
+
+#endif
@@ -0,0 +1,90 @@
+#include "kfstring.hpp"
+
+#include <chrono>
+#include <random>
+
+void kfc::kfstring::assign(const char* data, std::size_t size, bool clean, kfinterner* interner, utf8::policy policy) {
+    clean_ = clean;
+
+    if (clean || policy == utf8::policy::keep) {
+        set(data, size, interner);
+    } else if (interner == nullptr) {
+        utf8::sanitize(data, size, local());
+    } else {
+        thread_local std::string replaced;
+        utf8::sanitize(data, size, replaced);
+        set(replaced.data(), replaced.size(), interner);
+    }
+}
+
+void kfc::kfstring::set(const char* data, std::size_t size, kfinterner* interner) {
+    if (interner != nullptr && size >= kfinterner::MIN_SHARED_SIZE)
+        value_ = interner->share(data, size);
+    else
+        local().assign(data, size);
+}
+
+// the local string, which keeps its buffer when an object is parsed into again
+std::string& kfc::kfstring::local() {
+    if (auto* value = std::get_if<std::string>(&value_))
+        return *value;
+    return value_.emplace<std::string>();
+}
+
+// random per process, the time stands in on platforms without a source of randomness
+const std::array<std::uint64_t, 2>& kfc::kfinterner::key() noexcept {
+    static const std::array<std::uint64_t, 2> value = []() {
+        std::array<std::uint64_t, 2> result {};
+        try {
+            std::random_device device;
+            for (auto& word : result)
+                word = (static_cast<std::uint64_t>(device()) << 32U) ^ static_cast<std::uint64_t>(device());
+        } catch (const std::exception&) {
+            auto now = static_cast<std::uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+            result = { now, kfhash(static_cast<const std::uint8_t*>(static_cast<const void*>(&now)), sizeof(now)) };
+        }
+        return result;
+    }();
+
+    return value;
+}
+
+std::shared_ptr<const std::string> kfc::kfinterner::share(const char* data, std::size_t size) {
+    std::string_view key(data, size);
+    auto hashed = hash()(key);
+    auto& s = shards_.at(hashed % SHARDS);
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.strings.find(key);
+    if (it == s.strings.end()) {
+        auto value = std::make_shared<const std::string>(data, size);
+        it = s.strings.emplace(std::string_view(*value), value).first;
+    }
+
+    return it->second;
+}
+
+std::size_t kfc::kfinterner::size() const {
+    std::size_t total = 0;
+    for (const auto& s : shards_) {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        total += s.strings.size();
+    }
+    return total;
+}
+
+std::size_t kfc::kfinterner::purge() {
+    std::size_t purged = 0;
+    for (auto& s : shards_) {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for (auto it = s.strings.begin(); it != s.strings.end();) {
+            if (it->second.use_count() == 1) {
+                it = s.strings.erase(it);
+                purged++;
+            } else {
+                ++it;
+            }
+        }
+    }
+    return purged;
+}
\ No newline at end of file
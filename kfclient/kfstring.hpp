@@ -0,0 +1,129 @@
+#ifndef kfclient_string_hpp
+#define kfclient_string_hpp
+
+#include "libdef.hpp"
+#include "kfhash.hpp"
+#include "kfutf8.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+
+namespace kfc {
+    class kfinterner;
+
+    // An immutable string of a parsed response: either held by value or, when parsed with an
+    // interner, shared with every equal string the interner handed out, in which case same()
+    // compares them by pointer.
+    class KFCLIENT_API kfstring {
+        using shared_type = std::shared_ptr<const std::string>;
+
+    public:
+        kfstring() = default;
+        kfstring(std::string value) : value_(std::move(value)) {} // NOLINT(google-explicit-constructor)
+        kfstring(const char* value) : value_(std::string(value)) {} // NOLINT(google-explicit-constructor)
+        explicit kfstring(shared_type shared) : value_(std::move(shared)) {}
+
+        // Parsers assign through the interner they were given (see kfclient::interner), if any,
+        // and apply the utf8::policy they were given; clean is the result of checking the bytes,
+        // which they already know. Strings short enough for the small string buffer are never shared.
+        void assign(const char* data, std::size_t size, bool clean, kfinterner* interner = nullptr, utf8::policy policy = utf8::policy::keep);
+        void assign(const char* data, std::size_t size) { assign(data, size, utf8::clean(data, size)); }
+
+        const std::string& str() const noexcept {
+            if (const auto* shared = std::get_if<shared_type>(&value_))
+                return **shared;
+            return *std::get_if<std::string>(&value_);
+        }
+
+        operator const std::string&() const noexcept { return str(); } // NOLINT(google-explicit-constructor)
+
+        const char* c_str() const noexcept { return str().c_str(); }
+        const char* data() const noexcept { return str().data(); }
+        std::size_t size() const noexcept { return str().size(); }
+        bool empty() const noexcept { return str().empty(); }
+        std::string::const_iterator begin() const noexcept { return str().begin(); }
+        std::string::const_iterator end() const noexcept { return str().end(); }
+
+        bool interned() const noexcept { return std::holds_alternative<shared_type>(value_); }
+
+        // false when the bytes the server sent were not valid UTF-8 or held control characters,
+        // also after utf8::policy::replace replaced them; strings made by hand count as clean
+        bool clean() const noexcept { return clean_; }
+
+        // true when both are the same interned string, without comparing characters
+        bool same(const kfstring& other) const noexcept {
+            const auto* a = std::get_if<shared_type>(&value_);
+            const auto* b = std::get_if<shared_type>(&other.value_);
+            return a != nullptr && b != nullptr && *a == *b;
+        }
+
+        friend bool operator==(const kfstring& a, const kfstring& b) noexcept { return a.same(b) || a.str() == b.str(); }
+        friend bool operator!=(const kfstring& a, const kfstring& b) noexcept { return !(a == b); }
+        friend bool operator==(const kfstring& a, const std::string& b) noexcept { return a.str() == b; }
+        friend bool operator!=(const kfstring& a, const std::string& b) noexcept { return a.str() != b; }
+        friend bool operator==(const kfstring& a, const char* b) noexcept { return a.str() == b; }
+        friend bool operator!=(const kfstring& a, const char* b) noexcept { return a.str() != b; }
+        friend bool operator<(const kfstring& a, const kfstring& b) noexcept { return a.str() < b.str(); }
+
+        friend std::ostream& operator<<(std::ostream& out, const kfstring& value) { return out << value.str(); }
+
+    private:
+        void set(const char* data, std::size_t size, kfinterner* interner);
+        std::string& local();
+
+        std::variant<std::string, shared_type> value_;
+        bool clean_ = true;
+    };
+
+    // A thread-safe set of immutable strings. Hostnames, maps and player names repeat across
+    // servers and polls; a client given an interner (see kfclient::interner) stores each distinct
+    // value once. Strings stay alive as long as a result refers to them, purge() drops those that
+    // none does anymore. The interner must outlive the clients and parses that use it, not their
+    // results.
+    class KFCLIENT_API kfinterner {
+        static constexpr const std::size_t SHARDS = 16;
+
+    public:
+        // parsed strings shorter than this stay in the small string buffer of their kfstring,
+        // sharing them would cost a lookup and save nothing
+        static constexpr const std::size_t MIN_SHARED_SIZE = 16;
+
+        kfstring intern(const char* data, std::size_t size) { return kfstring(share(data, size)); }
+        kfstring intern(const std::string& value) { return intern(value.data(), value.size()); }
+
+        std::shared_ptr<const std::string> share(const char* data, std::size_t size);
+
+        // the number of distinct strings held
+        std::size_t size() const;
+
+        // drops the strings that are only held by the interner, returns how many
+        std::size_t purge();
+
+    private:
+        // the strings come from the servers, which could pick them to collide under a hash without a key
+        static const std::array<std::uint64_t, 2>& key() noexcept;
+
+        struct hash {
+            std::size_t operator()(std::string_view value) const noexcept {
+                return static_cast<std::size_t>(kfsiphash(static_cast<const std::uint8_t*>(static_cast<const void*>(value.data())), value.size(), key()));
+            }
+        };
+
+        struct shard {
+            mutable std::mutex mutex;
+            std::unordered_map<std::string_view, std::shared_ptr<const std::string>, hash> strings; // keys view the values
+        };
+
+        std::array<shard, SHARDS> shards_;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "kftransport.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <system_error>
+
+#ifdef KFCLIENT_UNIX
+#include <poll.h>
+#endif
+
+namespace {
+    // Waits on the socket itself rather than on an io_context, so a timed receive never runs
+    // handlers of the context the socket belongs to. False when the timeout passed first.
+    bool wait_readable(boost::asio::ip::udp::socket& socket, std::chrono::milliseconds timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        for (;;) {
+            auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            auto wait = static_cast<int>(std::clamp<std::chrono::milliseconds::rep>(left, 0, INT_MAX));
+
+#ifdef KFCLIENT_WINDOWS
+            WSAPOLLFD descriptor {};
+            descriptor.fd = socket.native_handle();
+            descriptor.events = POLLRDNORM;
+            auto ready = WSAPoll(&descriptor, 1, wait);
+            if (ready < 0)
+                throw std::system_error(WSAGetLastError(), std::system_category());
+#else
+            pollfd descriptor {};
+            descriptor.fd = socket.native_handle();
+            descriptor.events = POLLIN;
+            auto ready = ::poll(&descriptor, 1, wait);
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready < 0)
+                throw std::system_error(errno, std::system_category());
+#endif
+
+            // errors (a refused port) are readable too, the receive reports them
+            if (ready > 0)
+                return true;
+            if (wait == 0)
+                return false;
+        }
+    }
+}
+
+kfc::kfudp_transport::kfudp_transport(io_context& context, const udp::resolver::results_type& endpoints)
+    : socket_(context) {
+        boost::system::error_code error;
+        socket_.connect(*endpoints.begin(), error);
+        if (error) 
+            throw std::runtime_error(error.message());
+}
+
+void kfc::kfudp_transport::send(const std::uint8_t* data, std::size_t size) {
+    boost::system::error_code error;
+    socket_.send(boost::asio::buffer(data, size), 0, error);
+
+    if (error) 
+        throw std::runtime_error(error.message());
+}
+
+std::size_t kfc::kfudp_transport::receive(std::uint8_t* data, std::size_t size, std::chrono::milliseconds timeout) {
+    if (timeout.count() != 0 && !wait_readable(socket_, timeout))
+        throw timeout_error("timed out waiting for a response");
+
+    boost::system::error_code error;
+    auto received = socket_.receive(boost::asio::buffer(data, size), 0, error);
+    if (error)
+        throw std::runtime_error(error.message());
+
+    return received;
+}
+
+std::string kfc::kfudp_transport::peer() const {
+    auto endpoint = socket_.remote_endpoint();
+    return endpoint.address().to_string() + ":" + std::to_string(endpoint.port());
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef kfclient_transport_hpp
+#define kfclient_transport_hpp
+
+#include "libdef.hpp"
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+namespace kfc {
+    class KFCLIENT_API timeout_error : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // Moves datagrams between a kfclient and one server. Implementations throw timeout_error when
+    // no datagram arrives in time and std::runtime_error on any other failure.
+    class KFCLIENT_API kftransport {
+    public:
+        kftransport() = default;
+        kftransport(const kftransport&) = delete;
+        kftransport(kftransport&&) = delete;
+        kftransport& operator=(const kftransport&) = delete;
+        kftransport& operator=(kftransport&&) = delete;
+        virtual ~kftransport() = default;
+
+        virtual void send(const std::uint8_t* data, std::size_t size) = 0;
+
+        // a timeout of zero blocks until a datagram arrives
+        virtual std::size_t receive(std::uint8_t* data, std::size_t size, std::chrono::milliseconds timeout) = 0;
+
+        // the server as host:port, used to tell captured datagrams apart
+        virtual std::string peer() const = 0;
+    };
+
+    // The default transport: a connected UDP socket on the caller's io_context. Receiving blocks
+    // on the socket and never runs the io_context, so its other handlers stay with the caller.
+    class KFCLIENT_API kfudp_transport : public kftransport {
+        using io_context = boost::asio::io_context;
+        using udp = boost::asio::ip::udp;
+
+    public:
+        kfudp_transport(io_context& context, const udp::resolver::results_type& endpoints);
+
+        void send(const std::uint8_t* data, std::size_t size) override;
+        std::size_t receive(std::uint8_t* data, std::size_t size, std::chrono::milliseconds timeout) override;
+        std::string peer() const override;
+
+    private:
+        udp::socket socket_;
+    };
+}
+
+#endif
\ No newline at end of file
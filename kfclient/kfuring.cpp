@@ -0,0 +1,585 @@
+#include "kfuring.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define KFCLIENT_URING
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <optional>
+
+namespace {
+    constexpr const std::size_t BUFFER_SIZE = 2048; // as large as the receive buffer of kfquery
+    constexpr const std::uint16_t BUFFER_GROUP = 0;
+
+    enum operation : std::uint64_t { OP_RECEIVE = 1, OP_SEND = 2, OP_CANCEL = 3 };
+
+    std::uint64_t user_data(std::size_t slot, operation op) noexcept {
+        return (static_cast<std::uint64_t>(slot) << 8U) | op;
+    }
+
+    unsigned power_of_two(std::size_t value, unsigned low, unsigned high) noexcept {
+        auto result = low;
+        while (result < value && result < high)
+            result <<= 1U;
+        return result;
+    }
+
+    int uring_setup(unsigned entries, io_uring_params& params) noexcept {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    }
+
+    int uring_enter(int fd, unsigned submit, unsigned wait, unsigned flags, const void* arg, std::size_t size) noexcept {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg, size));
+    }
+
+    int uring_register(int fd, unsigned opcode, const void* arg, unsigned count) noexcept {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    std::string message(int error) {
+        return boost::system::error_code(error, boost::system::system_category()).message();
+    }
+
+    template <typename T>
+    T load_acquire(const T* p) noexcept { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+
+    template <typename T>
+    void store_release(T* p, T value) noexcept { __atomic_store_n(p, value, __ATOMIC_RELEASE); }
+
+    struct slot {
+        int fd = -1;
+        std::size_t index = 0;
+        kfc::kfquery_result result;
+        std::optional<kfc::kfexchange> exchange;
+        std::vector<std::uint8_t> sendbuf;
+        bool receiving = false;
+        bool sending = false;
+        bool send_pending = false;
+        bool cancelled = false;
+        bool finished = true;
+        std::uint32_t generation = 0;
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    struct deadline {
+        std::size_t slot;
+        std::uint32_t generation;
+        std::chrono::steady_clock::time_point at;
+    };
+
+    // The ring, the provided buffers and the queries of one kfuring_batch::run.
+    class engine {
+        using udp = boost::asio::ip::udp;
+        using clock_type = std::chrono::steady_clock;
+
+    public:
+        engine(std::size_t parallel, std::chrono::milliseconds timeout, std::uint32_t sections, kfc::kfinterner* interner, kfc::utf8::policy policy)
+            : slots_(parallel), timeout_(timeout), sections_(sections), interner_(interner), policy_(policy) {
+            try {
+                setup(parallel);
+            } catch (...) {
+                release();
+                throw;
+            }
+
+            for (std::size_t i = slots_.size(); i > 0; --i)
+                free_.push_back(i - 1);
+        }
+
+        engine(const engine&) = delete;
+        engine(engine&&) = delete;
+        engine& operator=(const engine&) = delete;
+        engine& operator=(engine&&) = delete;
+
+        ~engine() { release(); }
+
+        void run(const std::vector<udp::endpoint>& endpoints, const kfc::kfuring_batch::handler_type& handler) {
+            handler_ = &handler;
+            std::size_t next = 0;
+
+            for (;;) {
+                while (next < endpoints.size() && !free_.empty()) {
+                    auto id = free_.back();
+                    free_.pop_back();
+                    start(id, next, endpoints.at(next));
+                    next++;
+                }
+
+                publish_buffers();
+                auto wait = expire();
+
+                if (active_ == 0 && next == endpoints.size())
+                    break;
+                if (next < endpoints.size() && !free_.empty())
+                    continue;
+
+                submit_and_wait(wait);
+                reap();
+            }
+
+            // the receives of the last queries are still being cancelled
+            while (free_.size() < slots_.size()) {
+                submit_and_wait(std::nullopt);
+                reap();
+            }
+        }
+
+    private:
+        void setup(std::size_t parallel) {
+            auto entries = power_of_two(parallel * 2, 64, 4096);
+
+            io_uring_params params {};
+            params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+            params.cq_entries = entries * 4;
+            fd_ = uring_setup(entries, params);
+
+            // kernels before 6.1 do not know the task run flags
+            if (fd_ < 0 && errno == EINVAL) {
+                params = io_uring_params {};
+                params.flags = IORING_SETUP_CQSIZE;
+                params.cq_entries = entries * 4;
+                fd_ = uring_setup(entries, params);
+            }
+
+            if (fd_ < 0)
+                throw std::runtime_error("cannot set up io_uring: " + message(errno));
+            if ((params.features & IORING_FEAT_EXT_ARG) == 0 || (params.features & IORING_FEAT_NODROP) == 0)
+                throw std::runtime_error("io_uring of this kernel is too old");
+
+            sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+                sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+
+            sq_ring_ = map(sq_size_, IORING_OFF_SQ_RING);
+            cq_ring_ = (params.features & IORING_FEAT_SINGLE_MMAP) != 0 ? sq_ring_ : map(cq_size_, IORING_OFF_CQ_RING);
+            sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+            sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+
+            auto field = [](void* ring, unsigned offset) { return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset); };
+            sq_head_ = field(sq_ring_, params.sq_off.head);
+            sq_tail_ = field(sq_ring_, params.sq_off.tail);
+            sq_mask_ = *field(sq_ring_, params.sq_off.ring_mask);
+            sq_entries_ = params.sq_entries;
+            cq_head_ = field(cq_ring_, params.cq_off.head);
+            cq_tail_ = field(cq_ring_, params.cq_off.tail);
+            cq_mask_ = *field(cq_ring_, params.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(cq_ring_) + params.cq_off.cqes);
+            sq_local_tail_ = *sq_tail_;
+
+            auto* array = field(sq_ring_, params.sq_off.array);
+            for (unsigned i = 0; i < sq_entries_; ++i)
+                array[i] = i;
+
+            // every query receives into buffers it picks from this ring, two per query in flight
+            buffer_count_ = power_of_two(parallel * 2, 64, 32768);
+            buffer_ring_size_ = buffer_count_ * sizeof(io_uring_buf);
+            auto* ring = mmap(nullptr, buffer_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ring == MAP_FAILED)
+                throw std::runtime_error("cannot map the io_uring buffer ring: " + message(errno));
+            buffer_ring_ = static_cast<io_uring_buf*>(ring);
+
+            io_uring_buf_reg reg {};
+            reg.ring_addr = reinterpret_cast<std::uint64_t>(buffer_ring_);
+            reg.ring_entries = buffer_count_;
+            reg.bgid = BUFFER_GROUP;
+            if (uring_register(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+                throw std::runtime_error("cannot register the io_uring buffer ring: " + message(errno));
+
+            buffers_.resize(buffer_count_ * BUFFER_SIZE);
+            for (unsigned i = 0; i < buffer_count_; ++i)
+                recycle(static_cast<std::uint16_t>(i));
+            publish_buffers();
+        }
+
+        void* map(std::size_t size, std::uint64_t offset) const {
+            auto* result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, static_cast<off_t>(offset));
+            if (result == MAP_FAILED)
+                throw std::runtime_error("cannot map the io_uring rings: " + message(errno));
+            return result;
+        }
+
+        void release() noexcept {
+            for (auto& s : slots_) {
+                if (s.fd >= 0)
+                    ::close(s.fd);
+                s.fd = -1;
+            }
+
+            if (buffer_ring_ != nullptr)
+                munmap(buffer_ring_, buffer_ring_size_);
+            if (sqes_ != nullptr)
+                munmap(sqes_, sqes_size_);
+            if (cq_ring_ != nullptr && cq_ring_ != sq_ring_)
+                munmap(cq_ring_, cq_size_);
+            if (sq_ring_ != nullptr)
+                munmap(sq_ring_, sq_size_);
+            if (fd_ >= 0)
+                ::close(fd_);
+
+            buffer_ring_ = nullptr;
+            sqes_ = nullptr;
+            cq_ring_ = nullptr;
+            sq_ring_ = nullptr;
+            fd_ = -1;
+        }
+
+        // the buffer goes back to the tail of the ring, the kernel sees it after publish_buffers
+        void recycle(std::uint16_t id) noexcept {
+            auto& buffer = buffer_ring_[buffer_tail_ & (buffer_count_ - 1)];
+            buffer.addr = reinterpret_cast<std::uint64_t>(buffers_.data() + static_cast<std::size_t>(id) * BUFFER_SIZE);
+            buffer.len = BUFFER_SIZE;
+            buffer.bid = id;
+            buffer_tail_++;
+        }
+
+        // the tail of the buffer ring overlays the reserved field of its first entry
+        void publish_buffers() noexcept {
+            store_release(&buffer_ring_[0].resv, buffer_tail_);
+        }
+
+        io_uring_sqe* acquire() {
+            while (sq_local_tail_ - load_acquire(sq_head_) >= sq_entries_)
+                submit(0, nullptr);
+
+            auto* sqe = &sqes_[sq_local_tail_ & sq_mask_];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sq_local_tail_++;
+            queued_++;
+            return sqe;
+        }
+
+        void submit(unsigned wait, const io_uring_getevents_arg* arg) {
+            store_release(sq_tail_, sq_local_tail_);
+
+            auto flags = wait != 0 ? IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG : 0U;
+            auto result = uring_enter(fd_, queued_, wait, flags, arg, arg != nullptr ? sizeof(*arg) : 0);
+            if (result >= 0) {
+                queued_ -= std::min(queued_, static_cast<unsigned>(result));
+                return;
+            }
+
+            if (errno != ETIME && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                throw std::runtime_error("io_uring_enter failed: " + message(errno));
+        }
+
+        // submits everything queued and waits for one completion, or until the timeout passes
+        void submit_and_wait(std::optional<clock_type::duration> timeout) {
+            __kernel_timespec ts {};
+            io_uring_getevents_arg arg {};
+
+            if (timeout.has_value()) {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(*timeout).count();
+                ts.tv_sec = ns / 1000000000;
+                ts.tv_nsec = ns % 1000000000;
+                arg.ts = reinterpret_cast<std::uint64_t>(&ts);
+            }
+
+            submit(1, &arg);
+        }
+
+        void reap() {
+            auto head = *cq_head_;
+            auto tail = load_acquire(cq_tail_);
+
+            while (head != tail) {
+                const auto& cqe = cqes_[head & cq_mask_];
+                auto data = cqe.user_data;
+                auto res = cqe.res;
+                auto flags = cqe.flags;
+                store_release(cq_head_, ++head);
+
+                complete(static_cast<std::size_t>(data >> 8U), static_cast<operation>(data & 0xFFU), res, flags);
+            }
+        }
+
+        void start(std::size_t id, std::size_t index, const udp::endpoint& endpoint) {
+            auto& s = slots_.at(id);
+            s.index = index;
+            s.result = kfc::kfquery_result();
+            s.result.endpoint = endpoint;
+            s.exchange.emplace(sections_, s.result, interner_, policy_);
+            s.send_pending = false;
+            s.cancelled = false;
+            s.finished = false;
+            s.generation++;
+            s.started = clock_type::now();
+            active_++;
+
+            s.fd = ::socket(endpoint.protocol().family(), SOCK_DGRAM | SOCK_CLOEXEC, 0);
+            if (s.fd < 0 || ::connect(s.fd, endpoint.data(), static_cast<socklen_t>(endpoint.size())) != 0)
+                return fail(id, message(errno));
+
+            receive(id);
+            advance(id, s.exchange->start());
+        }
+
+        void receive(std::size_t id) {
+            auto& s = slots_.at(id);
+            auto* sqe = acquire();
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = s.fd;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = BUFFER_GROUP;
+            sqe->user_data = user_data(id, OP_RECEIVE);
+            s.receiving = true;
+        }
+
+        // one send at a time per query, its buffer has to stay untouched until it completed
+        void send(std::size_t id) {
+            auto& s = slots_.at(id);
+            if (s.sending) {
+                s.send_pending = true;
+                return;
+            }
+
+            s.sendbuf = s.exchange->request();
+            auto* sqe = acquire();
+            sqe->opcode = IORING_OP_SEND;
+            sqe->fd = s.fd;
+            sqe->addr = reinterpret_cast<std::uint64_t>(s.sendbuf.data());
+            sqe->len = static_cast<std::uint32_t>(s.sendbuf.size());
+            sqe->user_data = user_data(id, OP_SEND);
+            s.sending = true;
+            arm(id);
+        }
+
+        void arm(std::size_t id) {
+            if (timeout_.count() == 0)
+                return;
+
+            auto& s = slots_.at(id);
+            s.deadline = clock_type::now() + timeout_;
+            deadlines_.push_back({ id, s.generation, s.deadline });
+        }
+
+        void advance(std::size_t id, kfc::kfexchange::step step) {
+            switch (step) {
+            case kfc::kfexchange::step::send: return send(id);
+            case kfc::kfexchange::step::wait: return arm(id);
+            case kfc::kfexchange::step::done: return finish(id);
+            }
+        }
+
+        // every query has the same timeout, so the deadlines are queued in the order they expire;
+        // returns how long until the next one
+        std::optional<clock_type::duration> expire() {
+            auto now = clock_type::now();
+
+            while (!deadlines_.empty()) {
+                auto next = deadlines_.front();
+                const auto& s = slots_.at(next.slot);
+
+                if (s.finished || s.generation != next.generation || s.deadline != next.at) {
+                    deadlines_.pop_front();
+                    continue;
+                }
+                if (next.at > now)
+                    return next.at - now;
+
+                deadlines_.pop_front();
+                slots_.at(next.slot).exchange->expired();
+                fail(next.slot, "timed out waiting for a response", true);
+            }
+
+            return std::nullopt;
+        }
+
+        void complete(std::size_t id, operation op, std::int32_t res, std::uint32_t flags) {
+            auto& s = slots_.at(id);
+
+            switch (op) {
+            case OP_RECEIVE:
+                if ((flags & IORING_CQE_F_BUFFER) != 0) {
+                    auto buffer = static_cast<std::uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+                    if (res >= 0 && !s.finished)
+                        datagram(id, buffers_.data() + static_cast<std::size_t>(buffer) * BUFFER_SIZE, static_cast<std::size_t>(res));
+                    recycle(buffer);
+                }
+
+                if ((flags & IORING_CQE_F_MORE) != 0)
+                    return;
+
+                s.receiving = false;
+                if (s.finished)
+                    return settle(id);
+                if (res == -EINVAL)
+                    throw std::runtime_error("io_uring multishot receives need Linux 6.0 or newer");
+                if (res < 0 && res != -ENOBUFS)
+                    return fail(id, message(-res));
+
+                // the ring ran out of buffers for a moment
+                return receive(id);
+
+            case OP_SEND:
+                s.sending = false;
+                if (s.finished)
+                    return settle(id);
+                if (res < 0)
+                    return fail(id, message(-res));
+
+                s.exchange->sent();
+                if (s.send_pending) {
+                    s.send_pending = false;
+                    send(id);
+                }
+                return;
+
+            default:
+                return;
+            }
+        }
+
+        void datagram(std::size_t id, const std::uint8_t* data, std::size_t size) {
+            auto step = kfc::kfexchange::step::wait;
+            try {
+                step = slots_.at(id).exchange->receive(data, size);
+            } catch (const std::exception& ex) {
+                return fail(id, ex.what());
+            }
+
+            advance(id, step);
+        }
+
+        void fail(std::size_t id, const std::string& error, bool timed_out = false) {
+            auto& result = slots_.at(id).result;
+            result.details = nullptr;
+            result.rules = nullptr;
+            result.players = nullptr;
+            result.challenge.reset();
+            result.error = error;
+            result.timed_out = timed_out;
+            finish(id);
+        }
+
+        void finish(std::size_t id) {
+            auto& s = slots_.at(id);
+            if (s.finished)
+                return;
+
+            s.finished = true;
+            s.result.round_trip = clock_type::now() - s.started;
+            active_--;
+
+            (*handler_)(s.index, s.result);
+            s.exchange.reset();
+
+            // the socket is closed once the kernel let go of the receive and the send
+            if (s.receiving && !s.cancelled) {
+                auto* sqe = acquire();
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->addr = user_data(id, OP_RECEIVE);
+                sqe->user_data = user_data(id, OP_CANCEL);
+                s.cancelled = true;
+            }
+
+            settle(id);
+        }
+
+        void settle(std::size_t id) {
+            auto& s = slots_.at(id);
+            if (s.receiving || s.sending)
+                return;
+
+            if (s.fd >= 0)
+                ::close(s.fd);
+            s.fd = -1;
+            free_.push_back(id);
+        }
+
+        std::vector<slot> slots_;
+        std::vector<std::size_t> free_;
+        std::deque<deadline> deadlines_;
+        std::chrono::milliseconds timeout_;
+        std::uint32_t sections_;
+        kfc::kfinterner* interner_;
+        kfc::utf8::policy policy_;
+        std::size_t active_ = 0;
+        const kfc::kfuring_batch::handler_type* handler_ = nullptr;
+
+        int fd_ = -1;
+        void* sq_ring_ = nullptr;
+        void* cq_ring_ = nullptr;
+        io_uring_sqe* sqes_ = nullptr;
+        std::size_t sq_size_ = 0;
+        std::size_t cq_size_ = 0;
+        std::size_t sqes_size_ = 0;
+        unsigned* sq_head_ = nullptr;
+        unsigned* sq_tail_ = nullptr;
+        unsigned sq_mask_ = 0;
+        unsigned sq_entries_ = 0;
+        unsigned sq_local_tail_ = 0;
+        unsigned queued_ = 0;
+        unsigned* cq_head_ = nullptr;
+        unsigned* cq_tail_ = nullptr;
+        unsigned cq_mask_ = 0;
+        io_uring_cqe* cqes_ = nullptr;
+
+        io_uring_buf* buffer_ring_ = nullptr;
+        std::size_t buffer_ring_size_ = 0;
+        unsigned buffer_count_ = 0;
+        std::uint16_t buffer_tail_ = 0;
+        std::vector<std::uint8_t> buffers_;
+    };
+}
+
+#endif
+
+kfc::kfuring_batch::kfuring_batch(std::size_t parallel, std::chrono::milliseconds timeout, std::uint32_t sections)
+    : parallel_(parallel == 0 ? 1 : parallel), timeout_(timeout), sections_(sections) {
+    if (!available())
+        throw std::runtime_error("io_uring is not available on this system");
+}
+
+bool kfc::kfuring_batch::available() noexcept {
+#ifdef KFCLIENT_URING
+    io_uring_params params {};
+    auto fd = uring_setup(2, params);
+    if (fd < 0)
+        return false;
+
+    // provided buffer rings came with Linux 5.19, just before multishot receives
+    auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    auto* ring = mmap(nullptr, page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    auto supported = ring != MAP_FAILED && (params.features & IORING_FEAT_EXT_ARG) != 0 && (params.features & IORING_FEAT_NODROP) != 0;
+
+    if (supported) {
+        io_uring_buf_reg reg {};
+        reg.ring_addr = reinterpret_cast<std::uint64_t>(ring);
+        reg.ring_entries = 1;
+        reg.bgid = BUFFER_GROUP;
+        supported = uring_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0;
+    }
+
+    if (ring != MAP_FAILED)
+        munmap(ring, page);
+    ::close(fd);
+    return supported;
+#else
+    return false;
+#endif
+}
+
+void kfc::kfuring_batch::run(const std::vector<udp::endpoint>& endpoints, const handler_type& handler) {
+#ifdef KFCLIENT_URING
+    if (endpoints.empty())
+        return;
+    engine(std::min(parallel_, endpoints.size()), timeout_, sections_, interner_, utf8_policy_).run(endpoints, handler);
+#else
+    (void)endpoints;
+    (void)handler;
+    throw std::runtime_error("io_uring is not available on this system");
+#endif
+}
\ No newline at end of file
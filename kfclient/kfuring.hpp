@@ -0,0 +1,52 @@
+#ifndef kfclient_uring_hpp
+#define kfclient_uring_hpp
+
+#include "libdef.hpp"
+#include "kfquery.hpp"
+
+#include <boost/asio.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+namespace kfc {
+    // Runs the queries of a batch on one thread through Linux io_uring rather than the Asio
+    // reactor. Every query has a connected socket with a single multishot receive that picks its
+    // buffers from a ring shared by all queries, and every request and receive queued while
+    // handling completions goes out with the one io_uring_enter that also waits for the next
+    // ones. Needs Linux 6.0 or newer; construction throws std::runtime_error elsewhere. The ring
+    // only lives for the duration of run(), on the thread that calls it.
+    class KFCLIENT_API kfuring_batch {
+        using udp = boost::asio::ip::udp;
+
+    public:
+        using handler_type = std::function<void(std::size_t index, kfquery_result& result)>;
+
+        kfuring_batch(std::size_t parallel, std::chrono::milliseconds timeout, std::uint32_t sections);
+
+        // true when this system can run the engine
+        static bool available() noexcept;
+
+        // share the strings of every result through an interner, see kfclient::interner
+        void interner(kfinterner* interner) noexcept { interner_ = interner; }
+
+        // parse the text of every result under a policy, see kfclient::utf8_policy
+        void utf8_policy(utf8::policy policy) noexcept { utf8_policy_ = policy; }
+
+        // queries every endpoint and returns when all of them completed; the handler gets the
+        // index of the endpoint and runs on the calling thread
+        void run(const std::vector<udp::endpoint>& endpoints, const handler_type& handler);
+
+    private:
+        std::size_t parallel_;
+        std::chrono::milliseconds timeout_;
+        std::uint32_t sections_;
+        kfinterner* interner_ = nullptr;
+        utf8::policy utf8_policy_ = utf8::policy::keep;
+    };
+}
+
+#endif
\ No newline at end of file
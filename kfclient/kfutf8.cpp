@@ -0,0 +1,150 @@
+#include "kfutf8.hpp"
+
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KFCLIENT_SSE2 // NOLINT(cppcoreguidelines-macro-usage)
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+    constexpr const char REPLACEMENT[] = "\xEF\xBF\xBD";
+
+#ifdef KFCLIENT_SSE2
+    inline unsigned trailing_zeros(unsigned value) noexcept {
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        _BitScanForward(&index, value);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctz(value));
+#endif
+    }
+#endif
+
+    // the number of printable ASCII bytes (0x20 to 0x7E) data starts with, which is all of most
+    // names; a NUL ends the run like any other control character
+    std::size_t printable_run(const std::uint8_t* data, std::size_t size) noexcept {
+        std::size_t i = 0;
+
+#ifdef KFCLIENT_SSE2
+        // signed compares, so bytes from 0x80 up fail the lower bound as well
+        const auto low = _mm_set1_epi8(0x1F);
+        const auto high = _mm_set1_epi8(0x7F);
+
+        for (; i + 16 <= size; i += 16) {
+            auto v = _mm_loadu_si128(static_cast<const __m128i*>(static_cast<const void*>(data + i)));
+            auto printable = _mm_and_si128(_mm_cmpgt_epi8(v, low), _mm_cmplt_epi8(v, high));
+            auto mask = static_cast<unsigned>(_mm_movemask_epi8(printable));
+            if (mask != 0xFFFFU)
+                return i + trailing_zeros(~mask);
+        }
+#endif
+
+        while (i < size && data[i] >= 0x20 && data[i] < 0x7F)
+            ++i;
+        return i;
+    }
+
+    // the length of the valid multibyte sequence at data, 0 when it is not one
+    std::size_t sequence_length(const std::uint8_t* data, std::size_t size) noexcept {
+        auto lead = data[0];
+        std::uint8_t low = 0x80;
+        std::uint8_t high = 0xBF;
+        std::size_t length = 0;
+
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            if (lead == 0xE0) low = 0xA0;  // overlong
+            if (lead == 0xED) high = 0x9F; // surrogates
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            if (lead == 0xF0) low = 0x90;  // overlong
+            if (lead == 0xF4) high = 0x8F; // above U+10FFFF
+        } else {
+            return 0;
+        }
+
+        if (size < length || data[1] < low || data[1] > high)
+            return 0;
+
+        for (std::size_t i = 2; i < length; ++i) {
+            if (data[i] < 0x80 || data[i] > 0xBF)
+                return 0;
+        }
+
+        return length;
+    }
+}
+
+kfc::utf8::scan_result kfc::utf8::scan(const std::uint8_t* data, std::size_t limit) {
+    std::size_t i = 0;
+    bool clean = true;
+
+    for (;;) {
+        i += printable_run(data + i, limit - i);
+        if (i >= limit)
+            throw std::range_error("consume_string is trying to read outside of the available memory, NUL character not found.");
+
+        auto c = data[i];
+        if (c == 0)
+            return { i, clean };
+
+        if (c < 0x80) {
+            clean = false;
+            ++i;
+        } else if (auto length = sequence_length(data + i, limit - i); length != 0) {
+            i += length;
+        } else {
+            clean = false;
+            ++i;
+        }
+    }
+}
+
+bool kfc::utf8::clean(const char* data, std::size_t size) noexcept {
+    const auto* bytes = static_cast<const std::uint8_t*>(static_cast<const void*>(data));
+    std::size_t i = 0;
+
+    for (;;) {
+        i += printable_run(bytes + i, size - i);
+        if (i >= size)
+            return true;
+
+        auto length = bytes[i] < 0x80 ? 0 : sequence_length(bytes + i, size - i);
+        if (length == 0)
+            return false;
+        i += length;
+    }
+}
+
+void kfc::utf8::sanitize(const char* data, std::size_t size, std::string& out) {
+    const auto* bytes = static_cast<const std::uint8_t*>(static_cast<const void*>(data));
+    std::size_t i = 0;
+
+    out.clear();
+    out.reserve(size);
+
+    for (;;) {
+        auto run = printable_run(bytes + i, size - i);
+        out.append(data + i, run);
+        i += run;
+        if (i >= size)
+            return;
+
+        auto length = bytes[i] < 0x80 ? 0 : sequence_length(bytes + i, size - i);
+        if (length == 0) {
+            out.append(REPLACEMENT, sizeof(REPLACEMENT) - 1);
+            ++i;
+        } else {
+            out.append(data + i, length);
+            i += length;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef kfclient_utf8_hpp
+#define kfclient_utf8_hpp
+
+#include "libdef.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+namespace kfc {
+    // Checks the text servers send before it reaches JSON, tables and terminals. Text is clean
+    // when it is valid UTF-8 (RFC 3629: no overlong forms, surrogates or code points above
+    // U+10FFFF) without C0 control characters or DEL.
+    namespace utf8 {
+        // What a parse does with text that is not clean. Clients take it like an interner (see
+        // kfclient::utf8_policy), so one client never changes how another one parses.
+        enum class policy {
+            // strings keep the bytes the server sent, kfstring::clean() tells whether to trust them
+            keep,
+            // every invalid sequence and control character is replaced by U+FFFD while parsing
+            replace
+        };
+
+        struct scan_result {
+            std::size_t length;
+            bool clean;
+        };
+
+        // Finds the NUL that ends a string within limit bytes of data and checks the bytes before
+        // it on the way, sixteen printable ASCII bytes per step where SSE2 is available. Throws
+        // std::range_error when there is no NUL within the limit.
+        KFCLIENT_API scan_result scan(const std::uint8_t* data, std::size_t limit);
+
+        // true when the bytes are clean
+        KFCLIENT_API bool clean(const char* data, std::size_t size) noexcept;
+
+        // replaces out with the bytes, every invalid sequence and control character replaced by U+FFFD
+        KFCLIENT_API void sanitize(const char* data, std::size_t size, std::string& out);
+    }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef kfclient_varint_hpp
+#define kfclient_varint_hpp
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// LEB128 style variable length integers shared by the on-disk formats (kflog, kfcapture).
+namespace kfc {
+    namespace detail {
+        inline void put_varint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<std::uint8_t>(value | 0x80U));
+                value >>= 7U;
+            }
+            out.push_back(static_cast<std::uint8_t>(value));
+        }
+
+        inline void put_zigzag(std::vector<std::uint8_t>& out, std::int64_t value) {
+            put_varint(out, (static_cast<std::uint64_t>(value) << 1U) ^ static_cast<std::uint64_t>(value >> 63));
+        }
+
+        inline std::uint64_t get_varint(const std::uint8_t*& p, const std::uint8_t* end) {
+            std::uint64_t value = 0;
+            for (unsigned shift = 0; shift < 64; shift += 7) {
+                if (p == end)
+                    throw std::range_error("varint runs past the end of the data");
+                auto byte = *p++;
+                value |= static_cast<std::uint64_t>(byte & 0x7FU) << shift;
+                if ((byte & 0x80U) == 0)
+                    return value;
+            }
+            throw std::range_error("varint is too long");
+        }
+
+        inline std::int64_t get_zigzag(const std::uint8_t*& p, const std::uint8_t* end) {
+            auto value = get_varint(p, end);
+            return static_cast<std::int64_t>(value >> 1U) ^ -static_cast<std::int64_t>(value & 1U);
+        }
+    }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "kfwait.hpp"
+
+#include <algorithm>
+
+kfc::kfwaiter::kfwaiter(const kfwait_options& options)
+    : options_(options) {}
+
+void kfc::kfwaiter::add_target(const std::string& host, std::uint16_t port) {
+    targets_.push_back({ host, port, udp::endpoint(), nullptr, std::nullopt, std::chrono::milliseconds(0), std::nullopt, false, false });
+}
+
+std::vector<std::pair<std::string, std::uint16_t>> kfc::kfwaiter::unresolved() const {
+    std::vector<std::pair<std::string, std::uint16_t>> result;
+    for (const auto& t : targets_) {
+        if (!t.resolved && ran_)
+            result.emplace_back(t.host, t.port);
+    }
+    return result;
+}
+
+bool kfc::kfwaiter::run(const handler_type& handler, std::chrono::milliseconds limit) {
+    handler_ = &handler;
+    remaining_ = targets_.size();
+    ran_ = true;
+    context_ = std::make_unique<io_context>();
+
+    udp::resolver resolver(*context_);
+    for (auto& t : targets_) {
+        boost::system::error_code error;
+        t.resolved = false;
+        auto endpoints = resolver.resolve(udp::v4(), t.host, std::to_string(t.port), error);
+        if (!error && !endpoints.empty()) {
+            t.endpoint = endpoints.begin()->endpoint();
+            t.resolved = true;
+        }
+
+        t.timer = std::make_unique<boost::asio::steady_timer>(*context_);
+        t.interval = options_.interval;
+        t.empty_since.reset();
+        t.done = false;
+
+        if (t.resolved)
+            poll(t);
+    }
+
+    if (limit.count() == 0)
+        context_->run();
+    else
+        context_->run_for(limit);
+
+    // abandon the polls and timers that are still pending: destroying the context destroys their
+    // handlers without calling them, and with those the queries and their sockets
+    for (auto& t : targets_)
+        t.timer = nullptr;
+    context_ = nullptr;
+
+    handler_ = nullptr;
+    return remaining_ == 0;
+}
+
+void kfc::kfwaiter::poll(target& t) {
+    kfquery::start(*context_, t.endpoint, SECTION_DETAILS, options_.timeout, [this, &t](kfquery_result& result) {
+        complete(t, result);
+    }, t.challenge);
+}
+
+void kfc::kfwaiter::schedule(target& t, std::chrono::milliseconds delay) {
+    t.timer->expires_after(delay);
+    t.timer->async_wait([this, &t](const boost::system::error_code& error) {
+        if (!error)
+            poll(t);
+    });
+}
+
+void kfc::kfwaiter::complete(target& t, kfquery_result& result) {
+    if (handler_ == nullptr || t.done)
+        return;
+
+    t.challenge = result.challenge;
+    auto now = clock_type::now();
+
+    // a failed poll neither confirms nor ends an empty period, try again soon
+    if (result.details == nullptr)
+        return schedule(t, options_.interval);
+
+    if (result.details->player_count != 0) {
+        t.empty_since.reset();
+        schedule(t, t.interval);
+        t.interval = std::min(t.interval * 2, options_.max_interval);
+        return;
+    }
+
+    t.interval = options_.interval;
+    if (!t.empty_since.has_value())
+        t.empty_since = now;
+
+    auto empty_for = now - *t.empty_since;
+    if (empty_for >= options_.grace) {
+        t.done = true;
+        remaining_--;
+        (*handler_)(t.host, t.port);
+        return;
+    }
+
+    // poll again within the grace period, and right at its end
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(options_.grace - empty_for);
+    schedule(t, std::min(options_.interval, left));
+}
\ No newline at end of file
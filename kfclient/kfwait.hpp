@@ -0,0 +1,84 @@
+#ifndef kfclient_wait_hpp
+#define kfclient_wait_hpp
+
+#include "libdef.hpp"
+#include "kfquery.hpp"
+
+#include <boost/asio.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace kfc {
+    struct kfwait_options {
+        // the player count has to stay zero for this long before a server counts as empty
+        std::chrono::milliseconds grace = std::chrono::seconds(60);
+
+        // the polling interval while a server is empty or was just seen with players; the interval
+        // doubles with every poll that still finds players, up to max_interval
+        std::chrono::milliseconds interval = std::chrono::seconds(5);
+        std::chrono::milliseconds max_interval = std::chrono::minutes(5);
+
+        std::chrono::milliseconds timeout = std::chrono::seconds(5);
+    };
+
+    // Waits for servers to become empty by polling only their details (A2S_INFO) and the player
+    // count in it, reusing the challenge of every server between polls. Any number of servers is
+    // waited for on one thread. Every run() has an io_context of its own, which is destroyed with
+    // the polls and timers still pending when it returns.
+    class KFCLIENT_API kfwaiter {
+        using io_context = boost::asio::io_context;
+        using udp = boost::asio::ip::udp;
+        using clock_type = std::chrono::steady_clock;
+
+    public:
+        // called once per server, when it has been empty for the grace period
+        using handler_type = std::function<void(const std::string& host, std::uint16_t port)>;
+
+        explicit kfwaiter(const kfwait_options& options);
+
+        void add_target(const std::string& host, std::uint16_t port);
+        std::size_t size() const noexcept { return targets_.size(); }
+
+        // Returns true when every server became empty, or false when the limit (if not zero)
+        // passed first. Servers that cannot be resolved are never empty, run() returns false as
+        // soon as the others are; unresolved() lists them.
+        bool run(const handler_type& handler, std::chrono::milliseconds limit = std::chrono::milliseconds(0));
+
+        // the targets the last run() could not resolve
+        std::vector<std::pair<std::string, std::uint16_t>> unresolved() const;
+
+    private:
+        struct target {
+            std::string host;
+            std::uint16_t port;
+            udp::endpoint endpoint;
+            std::unique_ptr<boost::asio::steady_timer> timer;
+            std::optional<std::int32_t> challenge;
+            std::chrono::milliseconds interval {};
+            std::optional<clock_type::time_point> empty_since;
+            bool resolved = false;
+            bool done = false;
+        };
+
+        void poll(target& t);
+        void schedule(target& t, std::chrono::milliseconds delay);
+        void complete(target& t, kfquery_result& result);
+
+        std::unique_ptr<io_context> context_; // of the current run()
+        kfwait_options options_;
+        std::vector<target> targets_;
+        std::size_t remaining_ = 0;
+        bool ran_ = false;
+        const handler_type* handler_ = nullptr;
+    };
+}
+
+#endif
\ No newline at end of file
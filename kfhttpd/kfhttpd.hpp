@@ -0,0 +1,177 @@
+#ifndef kfhttpd_hpp
+#define kfhttpd_hpp
+
+#include <boost/asio.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace kfc {
+    namespace httpd {
+        struct request {
+            std::string method;
+            std::string target;
+            std::unordered_map<std::string, std::string> headers; // names are lower case
+
+            const std::string* header(const std::string& name) const {
+                auto iter = headers.find(name);
+                return iter == headers.end() ? nullptr : &iter->second;
+            }
+        };
+
+        struct response {
+            int status = 200;
+            std::string content_type = "text/plain; charset=utf-8";
+            std::string body;
+            std::vector<std::pair<std::string, std::string>> headers;
+        };
+
+        using handler_type = std::function<void(const request&, response&)>;
+
+        inline const char* reason(int status) {
+            switch (status) {
+            case 200: return "OK";
+            case 304: return "Not Modified";
+            case 400: return "Bad Request";
+            case 404: return "Not Found";
+            case 405: return "Method Not Allowed";
+            case 503: return "Service Unavailable";
+            default: return "Internal Server Error";
+            }
+        }
+
+        // One request per connection (Connection: close), which is all a scraper or a local proxy needs.
+        // A client that does not complete its headers in time is disconnected, so connections that
+        // never send anything cannot pile up.
+        class session : public std::enable_shared_from_this<session> {
+            using tcp = boost::asio::ip::tcp;
+            static constexpr const std::size_t MAX_REQUEST_SIZE = 16384;
+            static constexpr const std::chrono::seconds HEADER_TIMEOUT { 5 };
+
+        public:
+            session(tcp::socket socket, const handler_type& handler)
+                : socket_(std::move(socket)), timer_(socket_.get_executor()), buffer_(MAX_REQUEST_SIZE), handler_(handler) {}
+
+            void start() {
+                auto self = shared_from_this();
+
+                // closing the socket ends the read with an error, which drops the session; a read that
+                // completed moves the expiry out of reach, even when the wait completed already
+                timer_.expires_after(HEADER_TIMEOUT);
+                timer_.async_wait([self](const boost::system::error_code& error) {
+                    if (error || self->timer_.expiry() > boost::asio::steady_timer::clock_type::now())
+                        return;
+                    boost::system::error_code ignored;
+                    self->socket_.close(ignored);
+                });
+
+                boost::asio::async_read_until(socket_, buffer_, "\r\n\r\n", [self](const boost::system::error_code& error, std::size_t) {
+                    self->timer_.expires_at(boost::asio::steady_timer::time_point::max());
+                    if (!error)
+                        self->respond();
+                });
+            }
+
+        private:
+            void respond() {
+                request req;
+                response res;
+
+                std::istream stream(&buffer_);
+                std::string line;
+                std::getline(stream, line);
+
+                auto first = line.find(' ');
+                auto second = line.find(' ', first + 1);
+
+                if (first == std::string::npos || second == std::string::npos) {
+                    res.status = 400;
+                } else {
+                    req.method = line.substr(0, first);
+                    req.target = line.substr(first + 1, second - first - 1);
+
+                    while (std::getline(stream, line) && line != "\r") {
+                        auto colon = line.find(':');
+                        if (colon == std::string::npos)
+                            continue;
+
+                        auto name = line.substr(0, colon);
+                        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+                        auto value = line.substr(colon + 1);
+                        value.erase(0, value.find_first_not_of(" \t"));
+                        value.erase(value.find_last_not_of(" \t\r") + 1);
+                        req.headers[name] = value;
+                    }
+
+                    try {
+                        handler_(req, res);
+                    } catch (const std::exception& ex) {
+                        res = response();
+                        res.status = 500;
+                        res.body = ex.what();
+                    }
+                }
+
+                out_ = "HTTP/1.1 " + std::to_string(res.status) + " " + reason(res.status) + "\r\n";
+                out_ += "Content-Type: " + res.content_type + "\r\n";
+                // a HEAD response announces the length of the body a GET would get, a 304 has none
+                if (res.status != 304)
+                    out_ += "Content-Length: " + std::to_string(res.body.size()) + "\r\n";
+                for (const auto& header : res.headers)
+                    out_ += header.first + ": " + header.second + "\r\n";
+                out_ += "Connection: close\r\n\r\n";
+
+                if (req.method != "HEAD" && res.status != 304)
+                    out_ += res.body;
+
+                auto self = shared_from_this();
+                boost::asio::async_write(socket_, boost::asio::buffer(out_), [self](const boost::system::error_code&, std::size_t) {
+                    boost::system::error_code ignored;
+                    self->socket_.shutdown(tcp::socket::shutdown_both, ignored);
+                });
+            }
+
+            tcp::socket socket_;
+            boost::asio::steady_timer timer_;
+            boost::asio::streambuf buffer_;
+            const handler_type& handler_;
+            std::string out_;
+        };
+
+        class server {
+            using tcp = boost::asio::ip::tcp;
+
+        public:
+            server(boost::asio::io_context& context, const tcp::endpoint& endpoint, handler_type handler)
+                : acceptor_(context, endpoint), handler_(std::move(handler)) {
+                    accept();
+            }
+
+            tcp::endpoint local_endpoint() const { return acceptor_.local_endpoint(); }
+
+        private:
+            void accept() {
+                acceptor_.async_accept([this](const boost::system::error_code& error, tcp::socket socket) {
+                    if (!error)
+                        std::make_shared<session>(std::move(socket), handler_)->start();
+                    if (acceptor_.is_open())
+                        accept();
+                });
+            }
+
+            tcp::acceptor acceptor_;
+            handler_type handler_;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef kfserver_sim_definition_hpp
+#define kfserver_sim_definition_hpp
+
+#include <dynacli.hpp>
+#include <string>
+
+namespace commandline {
+	namespace descriptors {
+		static constexpr auto PROGRAM_NAME = "kfserver-sim";
+		static constexpr auto PROGRAM_DESC = "a fake Killing Floor 2 query server that answers with synthetic content, for tests and load generation";
+
+		static constexpr auto NAME_ADDRESS = "address";
+		static constexpr const option_descriptor DESC_ADDRESS(NAME_ADDRESS, "-a,--address", "the address to listen on.");
+
+		static constexpr auto NAME_PORT = "port";
+		static constexpr const option_descriptor DESC_PORT(NAME_PORT, "-p,--port", "the first query port to listen on.");
+
+		static constexpr auto NAME_SERVERS = "servers";
+		static constexpr const option_descriptor DESC_SERVERS(NAME_SERVERS, "-n,--servers", "the number of virtual servers, one per port starting at --port.");
+
+		static constexpr auto NAME_THREADS = "threads";
+		static constexpr const option_descriptor DESC_THREADS(NAME_THREADS, "-j,--threads", "the number of threads the virtual servers are spread over.");
+
+		static constexpr auto NAME_PLAYERS = "players";
+		static constexpr const option_descriptor DESC_PLAYERS(NAME_PLAYERS, "--players", "the number of players on every server (at most 255).");
+
+		static constexpr auto NAME_SLOTS = "slots";
+		static constexpr const option_descriptor DESC_SLOTS(NAME_SLOTS, "--slots", "the player cap of every server.");
+
+		static constexpr auto NAME_RULES = "rules";
+		static constexpr const option_descriptor DESC_RULES(NAME_RULES, "--rules", "the number of rules of every server.");
+
+		static constexpr auto NAME_NAME_LENGTH = "namelength";
+		static constexpr const option_descriptor DESC_NAME_LENGTH(NAME_NAME_LENGTH, "--name-length", "pad host and player names to this many bytes.");
+
+		static constexpr auto NAME_SPLIT = "split";
+		static constexpr const option_descriptor DESC_SPLIT(NAME_SPLIT, "--split", "the maximum datagram size, larger responses are split (0 never splits).");
+
+		static constexpr auto NAME_CHURN = "churn";
+		static constexpr const option_descriptor DESC_CHURN(NAME_CHURN, "--churn", "change players, scores and waves every this many milliseconds (0 keeps them fixed).");
+
+		static constexpr auto NAME_LATENCY = "latency";
+		static constexpr const option_descriptor DESC_LATENCY(NAME_LATENCY, "--latency", "the delay in milliseconds before every datagram is sent.");
+
+		static constexpr auto NAME_JITTER = "jitter";
+		static constexpr const option_descriptor DESC_JITTER(NAME_JITTER, "--jitter", "a random extra delay of up to this many milliseconds.");
+
+		static constexpr auto NAME_LOSS = "loss";
+		static constexpr const option_descriptor DESC_LOSS(NAME_LOSS, "--loss", "the percentage of datagrams that are dropped.");
+
+		static constexpr auto NAME_REORDER = "reorder";
+		static constexpr const option_descriptor DESC_REORDER(NAME_REORDER, "--reorder", "the percentage of datagrams that are held back behind later ones.");
+
+		static constexpr auto NAME_SEED = "seed";
+		static constexpr const option_descriptor DESC_SEED(NAME_SEED, "--seed", "the seed of the impairment random number generators.");
+
+		static constexpr auto NAME_VERBOSE = "verbose";
+		static constexpr const option_descriptor DESC_VERBOSE(NAME_VERBOSE, "-V,--verbose", "print every request that is answered.");
+	}
+
+	using kfserver_sim_cli = commandline::dynacli<
+		bool, std::size_t, double, std::string
+	>;
+}
+
+#endif
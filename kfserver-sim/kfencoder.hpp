@@ -0,0 +1,117 @@
+#ifndef kfserver_sim_encoder_hpp
+#define kfserver_sim_encoder_hpp
+
+#include <kfdetails.hpp>
+#include <kfrules.hpp>
+#include <kfplayers.hpp>
+#include <kfprotocol.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace sim {
+    using kfc::protocol::PACKET_CHALLENGE;
+    using kfc::protocol::PACKET_PLAYERS;
+    using kfc::protocol::PACKET_DETAILS;
+    using kfc::protocol::PACKET_RULES;
+    using kfc::protocol::SINGLE_MAGIC;
+    using kfc::protocol::SPLIT_MAGIC;
+    using kfc::protocol::SPLIT_HEADER_SIZE;
+
+    using datagram = std::vector<std::uint8_t>;
+
+    // Writes the headers of responses and split packets, and any raw fields tests need.
+    class kfencoder {
+    public:
+        explicit kfencoder(datagram& out) : out_(out) {}
+
+        template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+        kfencoder& put(T value) {
+            auto offset = out_.size();
+            out_.resize(offset + sizeof(T));
+            std::memcpy(out_.data() + offset, &value, sizeof(T));
+            return *this;
+        }
+
+        kfencoder& put(const std::string& value) {
+            out_.insert(out_.end(), value.begin(), value.end());
+            out_.push_back(0);
+            return *this;
+        }
+
+        kfencoder& put_fixed(const std::string& value, std::size_t length) {
+            auto offset = out_.size();
+            out_.resize(offset + length, 0);
+            std::memcpy(out_.data() + offset, value.data(), std::min(length, value.size()));
+            return *this;
+        }
+
+        template <typename ... T>
+        kfencoder& put(const T&... values) {
+            (put(values), ...);
+            return *this;
+        }
+
+    private:
+        datagram& out_;
+    };
+
+    inline datagram encode_challenge(std::int32_t challenge) {
+        datagram out;
+        kfencoder(out).put(SINGLE_MAGIC, PACKET_CHALLENGE, challenge);
+        return out;
+    }
+
+    // the bodies are serialized from the same schema the parsers of libkfclient are derived from
+    template <typename T>
+    inline datagram encode(std::int8_t packet, const T& body) {
+        datagram out;
+        kfencoder(out).put(SINGLE_MAGIC, packet);
+        kfc::schema::serialize(body, out);
+        return out;
+    }
+
+    inline datagram encode(const kfc::kfdetails& details) {
+        return encode(PACKET_DETAILS, details);
+    }
+
+    inline datagram encode(const kfc::kfrules& rules) {
+        return encode(PACKET_RULES, rules);
+    }
+
+    inline datagram encode(const kfc::kfplayers& players) {
+        return encode(PACKET_PLAYERS, players);
+    }
+
+    // Splits a response into datagrams of at most max_size bytes using the Source engine
+    // split header (int32 -2, int32 id, uint8 total, uint8 number, uint16 max_size).
+    inline std::vector<datagram> split(const datagram& response, std::size_t max_size, std::int32_t id) {
+        if (max_size == 0 || response.size() <= max_size)
+            return { response };
+        if (max_size <= SPLIT_HEADER_SIZE)
+            throw std::invalid_argument("split size does not fit the split packet header");
+
+        auto chunk = max_size - SPLIT_HEADER_SIZE;
+        auto total = (response.size() + chunk - 1) / chunk;
+        if (total > 255)
+            throw std::length_error("response does not fit in 255 split packets");
+
+        std::vector<datagram> packets(total);
+        for (std::size_t i = 0; i < total; ++i) {
+            auto begin = i * chunk;
+            auto end = std::min(response.size(), begin + chunk);
+
+            kfencoder(packets.at(i)).put(SPLIT_MAGIC, id & 0x7FFFFFFF, static_cast<std::uint8_t>(total), static_cast<std::uint8_t>(i), static_cast<std::uint16_t>(max_size));
+            packets.at(i).insert(packets.at(i).end(), response.begin() + static_cast<std::ptrdiff_t>(begin), response.begin() + static_cast<std::ptrdiff_t>(end));
+        }
+
+        return packets;
+    }
+}
+
+#endif
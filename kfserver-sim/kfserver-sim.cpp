@@ -0,0 +1,448 @@
+#include <boost/asio.hpp>
+#include <kfstats.hpp>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include "definition.hpp"
+#include "kfencoder.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifdef KFCLIENT_UNIX
+#include <sys/resource.h>
+#endif
+
+using udp = boost::asio::ip::udp;
+
+static const std::size_t DEFAULT_PORT = 27015;
+static const std::size_t DEFAULT_SERVERS = 1;
+static const std::size_t DEFAULT_THREADS = 1;
+static const std::size_t DEFAULT_PLAYERS = 6;
+static const std::size_t DEFAULT_SLOTS = 6;
+static const std::size_t DEFAULT_RULES = 30;
+static const std::size_t DEFAULT_SPLIT = 1248; // the payload size Source engine servers split at
+static const std::size_t DEFAULT_SEED = 27015;
+static const std::int32_t WAVES_TOTAL = 10;
+static inline const std::string DEFAULT_ADDRESS = "127.0.0.1";
+
+// held back datagrams wait this much longer than the slowest regular datagram
+static constexpr const std::chrono::milliseconds REORDER_DELAY(5);
+
+static constexpr const std::array<const char*, 8> MAPS = {
+    "KF-BurningParis", "KF-Outpost", "KF-BioticsLab", "KF-VolterManor",
+    "KF-Catacombs", "KF-EvacuationPoint", "KF-Farmhouse", "KF-BlackForest"
+};
+
+static constexpr const char SOURCE_ENGINE_QUERY[] = "Source Engine Query";
+
+struct options {
+    std::size_t players = DEFAULT_PLAYERS;
+    std::size_t slots = DEFAULT_SLOTS;
+    std::size_t rules = DEFAULT_RULES;
+    std::size_t name_length = 0;
+    std::size_t split = DEFAULT_SPLIT;
+    std::chrono::milliseconds churn { 0 };
+    double latency = 0.0; // milliseconds
+    double jitter = 0.0;
+    double loss = 0.0; // percent
+    double reorder = 0.0;
+    bool verbose = false;
+};
+
+struct counters {
+    std::array<std::uint64_t, static_cast<std::size_t>(kfc::kfrequest::count)> requests = {};
+    std::uint64_t datagrams_sent = 0;
+    std::uint64_t datagrams_dropped = 0;
+    std::uint64_t datagrams_held_back = 0;
+
+    void merge(const counters& other) {
+        for (std::size_t i = 0; i < requests.size(); ++i)
+            requests.at(i) += other.requests.at(i);
+        datagrams_sent += other.datagrams_sent;
+        datagrams_dropped += other.datagrams_dropped;
+        datagrams_held_back += other.datagrams_held_back;
+    }
+};
+
+static std::string pad(std::string name, std::size_t length) {
+    static constexpr const char PATTERN[] = "abcdefghijklmnopqrstuvwxyz";
+    for (std::size_t i = 0; name.size() < length; ++i)
+        name += PATTERN[i % (sizeof(PATTERN) - 1)];
+    return name;
+}
+
+// The synthetic content of a server is a pure function of its index and the churn generation,
+// so every run with the same options answers with the same bytes.
+static kfc::kfplayers make_players(const options& opts, std::size_t index, std::size_t generation) {
+    kfc::kfplayers result;
+    auto count = opts.churn.count() == 0 ? opts.players : (index + generation) % (opts.players + 1);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        kfc::kfplayer player;
+        player.id = static_cast<std::uint8_t>(i);
+        player.name = pad(fmt::format("Player {}", i + 1), opts.name_length);
+        player.score = static_cast<std::uint32_t>((i * 100) + (generation * 10));
+        player.time = static_cast<std::uint32_t>((60 * (i + 1)) + generation);
+        result.players.push_back(std::move(player));
+    }
+
+    result.count = static_cast<std::uint8_t>(result.players.size());
+    return result;
+}
+
+static kfc::kfdetails make_details(const options& opts, std::size_t index, std::size_t generation, std::size_t player_count) {
+    auto round = index + generation;
+    kfc::kfdetails result;
+
+    result.protocol = 17;
+    result.hostname = pad(fmt::format("kfserver-sim #{}", index), opts.name_length);
+    result.map = MAPS.at((index + (round / (WAVES_TOTAL + 1))) % MAPS.size());
+    result.game_dir = "kfgame";
+    result.game_description = "Killing Floor 2";
+    result.player_count = static_cast<std::uint8_t>(player_count);
+    result.player_cap = static_cast<std::uint8_t>(std::max(opts.slots, player_count));
+    result.unknown2 = 'd';
+    result.operating_system = 'l';
+    result.unknown3 = 1;
+    result.version = "1113";
+    result.waves_total = WAVES_TOTAL;
+    result.waves_current = static_cast<std::int32_t>(round % (WAVES_TOTAL + 1));
+    result.additional_string = fmt::format("d:{},e:{},", result.waves_total, result.waves_current);
+    return result;
+}
+
+static kfc::kfrules make_rules(const options& opts) {
+    kfc::kfrules result;
+
+    for (std::size_t i = 0; i < opts.rules; ++i) {
+        kfc::kfrule rule;
+        rule.name = fmt::format("SimRule{:03}", i);
+
+        switch (i % 3) {
+        case 0: rule.value = (i % 2) == 0; break;
+        case 1: rule.value = static_cast<double>(i) / 2; break;
+        default: rule.value = fmt::format("value {}", i); break;
+        }
+
+        result.rules.push_back(std::move(rule));
+    }
+
+    result.count = static_cast<std::uint16_t>(result.rules.size());
+    return result;
+}
+
+class group;
+
+class virtual_server {
+    static constexpr const std::size_t MAX_REQUEST_SIZE = 1400;
+
+public:
+    virtual_server(group& owner, const udp::endpoint& endpoint, std::size_t index);
+
+    void regenerate(std::size_t generation);
+    void start() { receive(); }
+
+private:
+    void receive();
+    void handle(std::size_t size);
+    void respond(kfc::kfrequest request, const std::vector<sim::datagram>& packets);
+    void transmit(const sim::datagram& packet);
+
+    group& owner_;
+    udp::socket socket_;
+    udp::endpoint sender_;
+    std::array<std::uint8_t, MAX_REQUEST_SIZE> buffer_ = {};
+    std::size_t index_;
+    std::int32_t challenge_;
+
+    // pre-encoded (and pre-split) responses, rebuilt when the content churns
+    std::vector<sim::datagram> challenge_packets_;
+    std::vector<sim::datagram> details_packets_;
+    std::vector<sim::datagram> rules_packets_;
+    std::vector<sim::datagram> players_packets_;
+};
+
+class group {
+public:
+    group(const options& opts, std::size_t seed)
+        : opts(opts), rng(static_cast<std::mt19937::result_type>(seed)), churn_timer_(context) {}
+
+    void add(const udp::endpoint& endpoint, std::size_t index) {
+        servers_.push_back(std::make_unique<virtual_server>(*this, endpoint, index));
+    }
+
+    void start() {
+        for (auto& server : servers_)
+            server->start();
+        if (opts.churn.count() != 0)
+            churn();
+    }
+
+    const options& opts;
+    boost::asio::io_context context;
+    std::mt19937 rng;
+    std::uniform_real_distribution<double> percent { 0.0, 100.0 };
+    counters stats;
+
+private:
+    void churn() {
+        churn_timer_.expires_after(opts.churn);
+        churn_timer_.async_wait([this](const boost::system::error_code& error) {
+            if (error)
+                return;
+            generation_++;
+            for (auto& server : servers_)
+                server->regenerate(generation_);
+            churn();
+        });
+    }
+
+    boost::asio::steady_timer churn_timer_;
+    std::size_t generation_ = 0;
+    std::vector<std::unique_ptr<virtual_server>> servers_;
+};
+
+virtual_server::virtual_server(group& owner, const udp::endpoint& endpoint, std::size_t index)
+    : owner_(owner), socket_(owner.context, endpoint), index_(index) {
+    // any value but -1 (which asks for a challenge) will do, it only has to be stable per server
+    challenge_ = static_cast<std::int32_t>(((index * 2654435761U) ^ 0x4B463200U) & 0x7FFFFFFFU);
+    challenge_packets_ = { sim::encode_challenge(challenge_) };
+    regenerate(0);
+}
+
+void virtual_server::regenerate(std::size_t generation) {
+    const auto& opts = owner_.opts;
+    auto players = make_players(opts, index_, generation);
+    auto id = static_cast<std::int32_t>(generation * 3);
+
+    details_packets_ = sim::split(sim::encode(make_details(opts, index_, generation, players.players.size())), opts.split, id);
+    rules_packets_ = sim::split(sim::encode(make_rules(opts)), opts.split, id + 1);
+    players_packets_ = sim::split(sim::encode(players), opts.split, id + 2);
+}
+
+void virtual_server::receive() {
+    socket_.async_receive_from(boost::asio::buffer(buffer_), sender_, [this](const boost::system::error_code& error, std::size_t size) {
+        if (error == boost::asio::error::operation_aborted)
+            return;
+        if (!error)
+            handle(size);
+        receive();
+    });
+}
+
+void virtual_server::handle(std::size_t size) {
+    std::int32_t magic = 0;
+    std::int32_t challenge = -1;
+
+    if (size < sizeof(magic) + 1)
+        return;
+
+    std::memcpy(&magic, buffer_.data(), sizeof(magic));
+    if (magic != sim::SINGLE_MAGIC)
+        return;
+
+    auto type = buffer_.at(sizeof(magic));
+    auto payload = sizeof(magic) + 1;
+
+    if (type == 0x54) {
+        if (size < payload + sizeof(SOURCE_ENGINE_QUERY) || std::memcmp(buffer_.data() + payload, SOURCE_ENGINE_QUERY, sizeof(SOURCE_ENGINE_QUERY)) != 0)
+            return;
+        payload += sizeof(SOURCE_ENGINE_QUERY);
+    }
+
+    if (size >= payload + sizeof(challenge))
+        std::memcpy(&challenge, buffer_.data() + payload, sizeof(challenge));
+
+    // like a real server, answer anything without the current challenge with a new challenge
+    if (type == 0x57 || challenge != challenge_) {
+        if (type == 0x54 || type == 0x55 || type == 0x56 || type == 0x57)
+            respond(kfc::kfrequest::challenge, challenge_packets_);
+        return;
+    }
+
+    switch (type) {
+    case 0x54: respond(kfc::kfrequest::details, details_packets_); break;
+    case 0x55: respond(kfc::kfrequest::players, players_packets_); break;
+    case 0x56: respond(kfc::kfrequest::rules, rules_packets_); break;
+    default: break;
+    }
+}
+
+void virtual_server::respond(kfc::kfrequest request, const std::vector<sim::datagram>& packets) {
+    owner_.stats.requests.at(static_cast<std::size_t>(request))++;
+
+    if (owner_.opts.verbose)
+        fmt::print("{} {} from {}:{}\n", socket_.local_endpoint().port(), kfc::to_string(request), sender_.address().to_string(), sender_.port());
+
+    for (const auto& packet : packets)
+        transmit(packet);
+}
+
+void virtual_server::transmit(const sim::datagram& packet) {
+    const auto& opts = owner_.opts;
+
+    if (opts.loss > 0.0 && owner_.percent(owner_.rng) < opts.loss) {
+        owner_.stats.datagrams_dropped++;
+        return;
+    }
+
+    auto delay = opts.latency;
+    if (opts.jitter > 0.0)
+        delay += std::uniform_real_distribution<double>(0.0, opts.jitter)(owner_.rng);
+    if (opts.reorder > 0.0 && owner_.percent(owner_.rng) < opts.reorder) {
+        delay = opts.latency + opts.jitter + std::chrono::duration<double, std::milli>(REORDER_DELAY).count();
+        owner_.stats.datagrams_held_back++;
+    }
+
+    owner_.stats.datagrams_sent++;
+
+    if (delay <= 0.0) {
+        boost::system::error_code ignored;
+        socket_.send_to(boost::asio::buffer(packet), sender_, 0, ignored);
+        return;
+    }
+
+    auto timer = std::make_shared<boost::asio::steady_timer>(owner_.context, std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(delay)));
+    auto data = std::make_shared<sim::datagram>(packet);
+    timer->async_wait([this, timer, data, endpoint = sender_](const boost::system::error_code& error) {
+        if (error)
+            return;
+        boost::system::error_code ignored;
+        socket_.send_to(boost::asio::buffer(*data), endpoint, 0, ignored);
+    });
+}
+
+// every virtual server needs its own socket, so allow as many descriptors as the hard limit permits
+static void raise_descriptor_limit() {
+#ifdef KFCLIENT_UNIX
+    rlimit limit {};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+#endif
+}
+
+std::unique_ptr<commandline::kfserver_sim_cli> create_cli() {
+    using namespace commandline;
+
+    auto cli = std::make_unique<kfserver_sim_cli>(descriptors::PROGRAM_DESC, descriptors::PROGRAM_NAME);
+
+    cli->add_option<std::string>(descriptors::DESC_ADDRESS)->required(false)->default_val(DEFAULT_ADDRESS)->default_str(DEFAULT_ADDRESS);
+    cli->add_option<std::size_t>(descriptors::DESC_PORT)->required(false)->default_val(DEFAULT_PORT)->default_str(std::to_string(DEFAULT_PORT));
+    cli->add_option<std::size_t>(descriptors::DESC_SERVERS)->required(false)->default_val(DEFAULT_SERVERS)->default_str(std::to_string(DEFAULT_SERVERS));
+    cli->add_option<std::size_t>(descriptors::DESC_THREADS)->required(false)->default_val(DEFAULT_THREADS)->default_str(std::to_string(DEFAULT_THREADS));
+    cli->add_option<std::size_t>(descriptors::DESC_PLAYERS)->required(false)->default_val(DEFAULT_PLAYERS)->default_str(std::to_string(DEFAULT_PLAYERS));
+    cli->add_option<std::size_t>(descriptors::DESC_SLOTS)->required(false)->default_val(DEFAULT_SLOTS)->default_str(std::to_string(DEFAULT_SLOTS));
+    cli->add_option<std::size_t>(descriptors::DESC_RULES)->required(false)->default_val(DEFAULT_RULES)->default_str(std::to_string(DEFAULT_RULES));
+    cli->add_option<std::size_t>(descriptors::DESC_NAME_LENGTH)->required(false)->default_val(0)->default_str("0");
+    cli->add_option<std::size_t>(descriptors::DESC_SPLIT)->required(false)->default_val(DEFAULT_SPLIT)->default_str(std::to_string(DEFAULT_SPLIT));
+    cli->add_option<std::size_t>(descriptors::DESC_CHURN)->required(false)->default_val(0)->default_str("0");
+    cli->add_option<double>(descriptors::DESC_LATENCY)->required(false)->default_val(0.0)->default_str("0");
+    cli->add_option<double>(descriptors::DESC_JITTER)->required(false)->default_val(0.0)->default_str("0");
+    cli->add_option<double>(descriptors::DESC_LOSS)->required(false)->default_val(0.0)->default_str("0");
+    cli->add_option<double>(descriptors::DESC_REORDER)->required(false)->default_val(0.0)->default_str("0");
+    cli->add_option<std::size_t>(descriptors::DESC_SEED)->required(false)->default_val(DEFAULT_SEED)->default_str(std::to_string(DEFAULT_SEED));
+    cli->add_flag(descriptors::DESC_VERBOSE);
+
+    return cli;
+}
+
+int main(int argc, const char* argv[]) {
+    using namespace commandline;
+
+    std::unique_ptr<commandline::kfserver_sim_cli> cli;
+
+    try {
+        cli = create_cli();
+    } catch (const std::exception& error) {
+        fmt::print(std::cerr, "error: cannot initialize cli parser: {}\n", error.what());
+        return EXIT_FAILURE;
+    }
+
+    try {
+        cli->command().parse(argc, argv);
+    } catch (const CLI::ParseError& e) {
+        return cli->command().exit(e);
+    }
+
+    try {
+        options opts;
+        opts.players = cli->get<std::size_t>(descriptors::NAME_PLAYERS);
+        opts.slots = cli->get<std::size_t>(descriptors::NAME_SLOTS);
+        opts.rules = cli->get<std::size_t>(descriptors::NAME_RULES);
+        opts.name_length = cli->get<std::size_t>(descriptors::NAME_NAME_LENGTH);
+        opts.split = cli->get<std::size_t>(descriptors::NAME_SPLIT);
+        opts.churn = std::chrono::milliseconds(cli->get<std::size_t>(descriptors::NAME_CHURN));
+        opts.latency = cli->get<double>(descriptors::NAME_LATENCY);
+        opts.jitter = cli->get<double>(descriptors::NAME_JITTER);
+        opts.loss = cli->get<double>(descriptors::NAME_LOSS);
+        opts.reorder = cli->get<double>(descriptors::NAME_REORDER);
+        opts.verbose = cli->isset(descriptors::NAME_VERBOSE);
+
+        if (opts.players > 255 || opts.slots > 255)
+            throw std::invalid_argument("a server holds at most 255 players");
+        if (opts.rules > 65535)
+            throw std::invalid_argument("a server has at most 65535 rules");
+
+        auto address = boost::asio::ip::make_address(cli->get<std::string>(descriptors::NAME_ADDRESS));
+        auto first_port = cli->get<std::size_t>(descriptors::NAME_PORT);
+        auto servers = std::max<std::size_t>(cli->get<std::size_t>(descriptors::NAME_SERVERS), 1);
+        auto threads = std::min(std::max<std::size_t>(cli->get<std::size_t>(descriptors::NAME_THREADS), 1), servers);
+        auto seed = cli->get<std::size_t>(descriptors::NAME_SEED);
+
+        if (first_port == 0 || first_port + servers - 1 > 65535)
+            throw std::invalid_argument("the port range does not fit in 1..65535");
+
+        raise_descriptor_limit();
+
+        std::vector<std::unique_ptr<group>> groups;
+        for (std::size_t i = 0; i < threads; ++i)
+            groups.push_back(std::make_unique<group>(opts, seed + i));
+
+        for (std::size_t i = 0; i < servers; ++i)
+            groups.at(i % threads)->add(udp::endpoint(address, static_cast<std::uint16_t>(first_port + i)), i);
+
+        for (auto& g : groups)
+            g->start();
+
+        boost::asio::signal_set signals(groups.front()->context, SIGINT, SIGTERM);
+        signals.async_wait([&groups](const boost::system::error_code&, int) {
+            for (auto& g : groups)
+                g->context.stop();
+        });
+
+        fmt::print("serving {} virtual servers on {} ports {}-{} with {} threads\n", servers, address.to_string(), first_port, first_port + servers - 1, threads);
+
+        std::vector<std::thread> workers;
+        for (std::size_t i = 1; i < groups.size(); ++i)
+            workers.emplace_back([&g = *groups.at(i)]() { g.context.run(); });
+
+        groups.front()->context.run();
+
+        for (auto& worker : workers)
+            worker.join();
+
+        counters total;
+        for (const auto& g : groups)
+            total.merge(g->stats);
+
+        for (std::size_t i = 0; i < total.requests.size(); ++i)
+            fmt::print("{:<10} {}\n", kfc::to_string(static_cast<kfc::kfrequest>(i)), total.requests.at(i));
+        fmt::print("datagrams sent {}, dropped {}, held back {}\n", total.datagrams_sent, total.datagrams_dropped, total.datagrams_held_back);
+
+        return 0;
+    } catch (const std::exception& ex) {
+        fmt::print(std::cerr, "error: {}\n", ex.what());
+        return EXIT_FAILURE;
+    }
+}
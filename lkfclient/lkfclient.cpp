@@ -1,6 +1,15 @@
 #include <lua.hpp>
 #include <kfclient.hpp>
+#include <kfshm.hpp>
+#include <kfquery.hpp>
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <cstring>
 #include <vector>
 #include <memory>
 #include <type_traits>
@@ -16,6 +25,7 @@ template <typename T, std::enable_if_t<lkfclient_is_integer<T>::value, int> = 0>
 void push(lua_State* L, T v)                  { lua_pushinteger(L, static_cast<lua_Integer>(v)); }
 void push(lua_State* L, bool v)               { lua_pushboolean(L, static_cast<int>(v)); }
 void push(lua_State* L, const std::string& v) { lua_pushstring(L, v.c_str()); }
+void push(lua_State* L, const kfc::kfstring& v) { lua_pushstring(L, v.c_str()); }
 
 // NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
 #define push_field(L, S, F)\
@@ -30,6 +40,12 @@ void push(lua_State* L, const std::string& v) { lua_pushstring(L, v.c_str()); }
     lua_rawset(L, -3);
 
 static constexpr const char *meta_name = "kfclient";
+static constexpr const char *snapshot_meta_name = "kfclient.snapshot";
+static constexpr const char *engine_meta_name = "kfclient.engine";
+
+// the registry key of the engine of a state, its address is the key; the metatable is registered
+// under engine_meta_name, so the instance cannot be stored there as well
+static const char engine_key = 0;
 
 struct lkfclient_instance {
     boost::asio::io_context context;
@@ -38,10 +54,383 @@ struct lkfclient_instance {
 
     std::unique_ptr<kfc::kfclient> client;
 
+    // results are returned as lazy views, see client:lazy
+    bool lazy = false;
+    std::shared_ptr<const kfc::kfdetails> details;
+    std::shared_ptr<const kfc::kfrules> rules;
+    std::shared_ptr<const kfc::kfplayers> players;
+
     lkfclient_instance()
         : context(), resolver(context) {}
 };
 
+// A query that completed on the engine thread, waiting for kfclient.dispatch to resume its coroutine.
+struct lkfclient_completion {
+    int coroutine = LUA_NOREF; // registry reference, keeps the coroutine alive while it is suspended
+    kfc::kfquery_result result;
+};
+
+// One per Lua state, kept in the registry: the background thread that does the I/O of every
+// asynchronous request. Lua itself is only ever touched by the thread calling kfclient.dispatch.
+struct lkfclient_engine {
+    boost::asio::io_context context;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work;
+    std::thread thread;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<lkfclient_completion> completed;
+    std::size_t pending = 0; // suspended coroutines, only used by the Lua thread
+
+    // the query kfclient.dispatch is resuming a coroutine with, a continuation resumed with anything
+    // else was resumed by someone else
+    const kfc::kfquery_result* resuming = nullptr;
+
+    lkfclient_engine()
+        : context(), work(context.get_executor()), thread([this]() { context.run(); }) {}
+
+    lkfclient_engine(const lkfclient_engine&) = delete;
+    lkfclient_engine(lkfclient_engine&&) = delete;
+    lkfclient_engine& operator=(const lkfclient_engine&) = delete;
+    lkfclient_engine& operator=(lkfclient_engine&&) = delete;
+
+    ~lkfclient_engine() {
+        work.reset();
+        context.stop();
+        thread.join();
+    }
+
+    void complete(int coroutine, kfc::kfquery_result& result) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            completed.push_back({ coroutine, std::move(result) });
+        }
+        ready.notify_one();
+    }
+};
+
+struct lkfclient_snapshot {
+    std::unique_ptr<kfc::kfshm_reader> reader;
+    kfc::kfsnapshot snapshot;
+};
+
+static void push(lua_State* L, const kfc::kfrule::variant_t& v) {
+    if (std::holds_alternative<double>(v))
+        lua_pushnumber(L, static_cast<lua_Number>(std::get<double>(v)));
+    else if (std::holds_alternative<bool>(v))
+        lua_pushboolean(L, static_cast<int>(std::get<bool>(v)));
+    else
+        lua_pushstring(L, std::get<std::string>(v).c_str());
+}
+
+// removes every key of the table at index, keeping the memory it allocated
+static void clear_table(lua_State* L, int index) {
+    index = lua_absindex(L, index);
+    lua_pushnil(L);
+    while (lua_next(L, index) != 0) {
+        lua_pop(L, 1);
+        lua_pushvalue(L, -1);
+        lua_pushnil(L);
+        lua_rawset(L, index);
+    }
+}
+
+// pushes the table in field name of the table on top of the stack, or a new one
+static void reuse_table(lua_State* L, const char* name) {
+    if (lua_getfield(L, -1, name) == LUA_TTABLE)
+        return clear_table(L, -1);
+    lua_pop(L, 1);
+    lua_newtable(L);
+}
+
+// The fill functions (re)write a result into the table on top of the stack, reusing its nested
+// tables so that polling into the same table does not create garbage.
+static void fill_details(lua_State* L, const kfc::kfdetails& details) {
+    push_field(L, details, protocol);
+    push_field(L, details, hostname);
+    push_field(L, details, map);
+    push_field(L, details, game_dir);
+    push_field(L, details, game_description);
+    push_field(L, details, steam_app_id);
+    push_field(L, details, player_count);
+    push_field(L, details, player_cap);
+    push_field(L, details, unknown1);
+    push_field(L, details, unknown2);
+    push_field(L, details, operating_system);
+    push_field(L, details, password_set);
+    push_field(L, details, unknown3);
+    push_field(L, details, version);
+    push_field(L, details, unknown4);
+    push_field(L, details, unknown5);
+    push_field(L, details, unknown6);
+    push_field(L, details, additional_string);
+    push_field(L, details, waves_total);
+    push_field(L, details, waves_current);
+    
+    // looked up on the details table, before anything else is pushed on top of it
+    reuse_table(L, "additional");
+    for (const auto& pair : details.additional) {
+        lua_pushstring(L, pair.first.c_str());
+        lua_pushstring(L, pair.second.c_str());
+        lua_rawset(L, -3);
+    }
+    lua_setfield(L, -2, "additional");
+}
+
+static void fill_players(lua_State* L, const kfc::kfplayers& players) {
+    lua_Integer index = 0;
+    for (const auto& player : players.players) {
+        if (lua_rawgeti(L, -1, ++index) != LUA_TTABLE) {
+            lua_pop(L, 1);
+            lua_createtable(L, 0, 4);
+        }
+        push_field(L, player, id);
+        push_field(L, player, name);
+        push_field(L, player, score);
+        push_field(L, player, time);
+        lua_rawseti(L, -2, index);
+    }
+
+    for (auto last = static_cast<lua_Integer>(lua_rawlen(L, -1)); last > index; --last) {
+        lua_pushnil(L);
+        lua_rawseti(L, -2, last);
+    }
+}
+
+static void fill_rules(lua_State* L, const kfc::kfrules& rules) {
+    clear_table(L, -1);
+    for (const auto& rule : rules.rules) {
+        lua_pushstring(L, rule.name.c_str());
+        push(L, rule.value);
+        lua_rawset(L, -3);
+    }
+}
+
+static void push_details(lua_State* L, const kfc::kfdetails& details) {
+    lua_newtable(L);
+    fill_details(L, details);
+}
+
+static void push_players(lua_State* L, const kfc::kfplayers& players) {
+    lua_createtable(L, static_cast<int>(players.players.size()), 0);
+    fill_players(L, players);
+}
+
+static void fill_result(lua_State* L, const kfc::kfdetails& details) { fill_details(L, details); }
+static void fill_result(lua_State* L, const kfc::kfrules& rules) { fill_rules(L, rules); }
+static void fill_result(lua_State* L, const kfc::kfplayers& players) { fill_players(L, players); }
+
+// Lazy results: userdata sharing ownership of a parsed result, which only push the fields that
+// are read. Players are views of one player in the list they share.
+template <typename T>
+struct lkfclient_view {
+    std::shared_ptr<const T> value;
+};
+
+template <typename T> struct lkfclient_view_traits;
+
+template <> struct lkfclient_view_traits<kfc::kfdetails> { static constexpr const char *name = "kfclient.details"; };
+template <> struct lkfclient_view_traits<kfc::kfrules> { static constexpr const char *name = "kfclient.rules"; };
+template <> struct lkfclient_view_traits<kfc::kfplayers> { static constexpr const char *name = "kfclient.players"; };
+template <> struct lkfclient_view_traits<kfc::kfplayer> { static constexpr const char *name = "kfclient.player"; };
+
+template <typename T>
+using lkfclient_field = std::pair<const char*, void (*)(lua_State*, const T&)>;
+
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
+#define view_field(T, F) lkfclient_field<T> { #F, [](lua_State* L, const T& s) { push(L, s.F); } }
+
+static const std::vector<lkfclient_field<kfc::kfdetails>> details_fields {
+    view_field(kfc::kfdetails, protocol),
+    view_field(kfc::kfdetails, hostname),
+    view_field(kfc::kfdetails, map),
+    view_field(kfc::kfdetails, game_dir),
+    view_field(kfc::kfdetails, game_description),
+    view_field(kfc::kfdetails, steam_app_id),
+    view_field(kfc::kfdetails, player_count),
+    view_field(kfc::kfdetails, player_cap),
+    view_field(kfc::kfdetails, unknown1),
+    view_field(kfc::kfdetails, unknown2),
+    view_field(kfc::kfdetails, operating_system),
+    view_field(kfc::kfdetails, password_set),
+    view_field(kfc::kfdetails, unknown3),
+    view_field(kfc::kfdetails, version),
+    view_field(kfc::kfdetails, unknown4),
+    view_field(kfc::kfdetails, unknown5),
+    view_field(kfc::kfdetails, unknown6),
+    view_field(kfc::kfdetails, additional_string),
+    view_field(kfc::kfdetails, waves_total),
+    view_field(kfc::kfdetails, waves_current),
+    { "additional", [](lua_State* L, const kfc::kfdetails& details) {
+        lua_createtable(L, 0, static_cast<int>(details.additional.size()));
+        for (const auto& pair : details.additional) {
+            lua_pushstring(L, pair.first.c_str());
+            lua_pushstring(L, pair.second.c_str());
+            lua_rawset(L, -3);
+        }
+    } }
+};
+
+static const std::vector<lkfclient_field<kfc::kfplayer>> player_fields {
+    view_field(kfc::kfplayer, id),
+    view_field(kfc::kfplayer, name),
+    view_field(kfc::kfplayer, score),
+    view_field(kfc::kfplayer, time)
+};
+
+template <typename T>
+static void push_view(lua_State* L, std::shared_ptr<const T> value) {
+    auto *memory = lua_newuserdata(L, sizeof(lkfclient_view<T>));
+    new (memory) lkfclient_view<T> { std::move(value) }; // NOLINT(cppcoreguidelines-owning-memory) -- Lua owns the memory and collects it, see lua_newuserdata.
+    luaL_setmetatable(L, lkfclient_view_traits<T>::name);
+}
+
+template <typename T>
+static const T& check_view(lua_State* L, int index) {
+    return *static_cast<lkfclient_view<T>*>(luaL_checkudata(L, index, lkfclient_view_traits<T>::name))->value;
+}
+
+template <typename T>
+static int lkfclient_view__gc(lua_State* L) {
+    static_cast<lkfclient_view<T>*>(luaL_checkudata(L, 1, lkfclient_view_traits<T>::name))->~lkfclient_view<T>();
+    return 0;
+}
+
+template <typename T>
+static int lkfclient_fields__index(lua_State* L, const std::vector<lkfclient_field<T>>& fields) {
+    const auto& value = check_view<T>(L, 1);
+    const auto *const key = lua_tostring(L, 2);
+
+    if (key != nullptr) {
+        for (const auto& field : fields) {
+            if (std::strcmp(field.first, key) == 0) {
+                field.second(L, value);
+                return 1;
+            }
+        }
+    }
+
+    lua_pushnil(L);
+    return 1;
+}
+
+// the iterator returned by __pairs, the position is kept in its first upvalue
+template <typename T>
+static int lkfclient_fields_next(lua_State* L, const std::vector<lkfclient_field<T>>& fields) {
+    const auto& value = check_view<T>(L, 1);
+    auto position = static_cast<std::size_t>(lua_tointeger(L, lua_upvalueindex(1)));
+    if (position >= fields.size())
+        return 0;
+
+    lua_pushinteger(L, static_cast<lua_Integer>(position + 1));
+    lua_replace(L, lua_upvalueindex(1));
+
+    lua_pushstring(L, fields.at(position).first);
+    fields.at(position).second(L, value);
+    return 2;
+}
+
+static int lkfclient_details__index(lua_State* L) { return lkfclient_fields__index(L, details_fields); }
+static int lkfclient_player__index(lua_State* L) { return lkfclient_fields__index(L, player_fields); }
+static int lkfclient_details_next(lua_State* L) { return lkfclient_fields_next(L, details_fields); }
+static int lkfclient_player_next(lua_State* L) { return lkfclient_fields_next(L, player_fields); }
+
+// the rules are few and looked up by name rarely, a linear search avoids building an index
+static int lkfclient_rules__index(lua_State* L) {
+    const auto& rules = check_view<kfc::kfrules>(L, 1);
+    const auto *const key = lua_tostring(L, 2);
+
+    if (key != nullptr) {
+        for (const auto& rule : rules.rules) {
+            if (rule.name == key) {
+                push(L, rule.value);
+                return 1;
+            }
+        }
+    }
+
+    lua_pushnil(L);
+    return 1;
+}
+
+static int lkfclient_rules_next(lua_State* L) {
+    const auto& rules = check_view<kfc::kfrules>(L, 1);
+    auto position = static_cast<std::size_t>(lua_tointeger(L, lua_upvalueindex(1)));
+    if (position >= rules.rules.size())
+        return 0;
+
+    lua_pushinteger(L, static_cast<lua_Integer>(position + 1));
+    lua_replace(L, lua_upvalueindex(1));
+
+    lua_pushstring(L, rules.rules.at(position).name.c_str());
+    push(L, rules.rules.at(position).value);
+    return 2;
+}
+
+static int lkfclient_players__index(lua_State* L) {
+    auto *view = static_cast<lkfclient_view<kfc::kfplayers>*>(luaL_checkudata(L, 1, lkfclient_view_traits<kfc::kfplayers>::name));
+    auto index = lua_tointeger(L, 2);
+
+    if (index < 1 || static_cast<std::size_t>(index) > view->value->players.size()) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    // shares ownership of the whole list, see the aliasing constructor of std::shared_ptr
+    push_view(L, std::shared_ptr<const kfc::kfplayer>(view->value, &view->value->players.at(static_cast<std::size_t>(index) - 1)));
+    return 1;
+}
+
+static int lkfclient_players__len(lua_State* L) {
+    push(L, check_view<kfc::kfplayers>(L, 1).players.size());
+    return 1;
+}
+
+// __pairs(view) -> next, view, nil
+template <lua_CFunction F>
+static int lkfclient_view__pairs(lua_State* L) {
+    lua_pushinteger(L, 0);
+    lua_pushcclosure(L, F, 1);
+    lua_pushvalue(L, 1);
+    lua_pushnil(L);
+    return 3;
+}
+
+// Pushes a result: filled into the table at fill_index when there is one, otherwise as a lazy view
+// when lazy, otherwise as a new table.
+template <typename T>
+static void push_result(lua_State* L, std::shared_ptr<const T> value, bool lazy, int fill_index) {
+    if (fill_index != 0 && lua_istable(L, fill_index)) {
+        lua_pushvalue(L, fill_index);
+        fill_result(L, *value);
+    } else if (lazy) {
+        push_view(L, std::move(value));
+    } else {
+        lua_newtable(L);
+        fill_result(L, *value);
+    }
+}
+
+// The blocking requests return a reference to the result kept by the client; lazy views need a
+// shared copy, which is reused for as long as the client reports the response unchanged. Only the
+// lazy path keeps that copy up to date, so any other request drops it.
+template <typename T>
+static void push_result(lua_State* L, lkfclient_instance* instance, const T& value, std::shared_ptr<const T>& shared, int fill_index) {
+    if (fill_index != 0 && lua_istable(L, fill_index)) {
+        shared = nullptr;
+        lua_pushvalue(L, fill_index);
+        fill_result(L, value);
+    } else if (instance->lazy) {
+        if (shared == nullptr || !instance->client->unchanged())
+            shared = std::make_shared<const T>(value);
+        push_view(L, shared);
+    } else {
+        shared = nullptr;
+        lua_newtable(L);
+        fill_result(L, value);
+    }
+}
+
 static int lkfclient_open(lua_State* L) {
     const auto *const host = luaL_checkstring(L, 1);
     const auto port = luaL_checkinteger(L, 2);
@@ -73,43 +462,43 @@ static int lkfclient_instance_close(lua_State* L) {
     return 0;
 }
 
+// client:lazy(enabled) -> previous; results are returned as userdata that read fields on demand
+static int lkfclient_instance_lazy(lua_State* L) {
+    auto *instance = static_cast<lkfclient_instance*>(luaL_checkudata(L, 1, meta_name));
+    auto previous = instance->lazy;
+
+    if (!lua_isnoneornil(L, 2))
+        instance->lazy = lua_toboolean(L, 2) != 0;
+
+    push(L, previous);
+    return 1;
+}
+
+// client:timeout(milliseconds) -> previous; zero blocks until a response arrives
+static int lkfclient_instance_timeout(lua_State* L) {
+    auto *instance = static_cast<lkfclient_instance*>(luaL_checkudata(L, 1, meta_name));
+    if (instance->client == nullptr)
+        return luaL_error(L, "kfclient is closed");
+
+    auto previous = instance->client->timeout();
+
+    if (!lua_isnoneornil(L, 2)) {
+        auto timeout = luaL_checkinteger(L, 2);
+        luaL_argcheck(L, timeout >= 0, 2, "timeout must not be negative");
+        instance->client->timeout(std::chrono::milliseconds(timeout));
+    }
+
+    push(L, previous.count());
+    return 1;
+}
+
 static int lkfclient_instance_details(lua_State* L) {
     auto *instance = static_cast<lkfclient_instance*>(luaL_checkudata(L, 1, meta_name));
 
     try {
         const auto& details = instance->client->request_details();
 
-        lua_newtable(L);
-        push_field(L, details, protocol);
-        push_field(L, details, hostname);
-        push_field(L, details, map);
-        push_field(L, details, game_dir);
-        push_field(L, details, game_description);
-        push_field(L, details, steam_app_id);
-        push_field(L, details, player_count);
-        push_field(L, details, player_cap);
-        push_field(L, details, unknown1);
-        push_field(L, details, unknown2);
-        push_field(L, details, operating_system);
-        push_field(L, details, password_set);
-        push_field(L, details, unknown3);
-        push_field(L, details, version);
-        push_field(L, details, unknown4);
-        push_field(L, details, unknown5);
-        push_field(L, details, unknown6);
-        push_field(L, details, additional_string);
-        push_field(L, details, waves_total);
-        push_field(L, details, waves_current);
-        
-        lua_pushstring(L, "additional");
-        
-        { lua_newtable(L);
-            for (const auto& pair : details.additional) {
-                lua_pushstring(L, pair.first.c_str());
-                lua_pushstring(L, pair.second.c_str());
-                lua_rawset(L, -3);
-            }
-        lua_rawset(L, -3); } 
+        push_result(L, instance, details, instance->details, 2);
 
         return 1;
     } catch (const std::exception& ex) {
@@ -124,17 +513,7 @@ static int lkfclient_instance_rules(lua_State* L) {
     try {
         const auto& rules = instance->client->request_rules();
 
-        lua_newtable(L);
-        for (const auto& rule : rules.rules) {
-            lua_pushstring(L, rule.name.c_str());
-            if (std::holds_alternative<double>(rule.value))
-                lua_pushnumber(L, static_cast<lua_Number>(std::get<double>(rule.value)));
-            else if (std::holds_alternative<bool>(rule.value))
-                lua_pushboolean(L, static_cast<int>(std::get<bool>(rule.value)));
-            else if (std::holds_alternative<std::string>(rule.value))
-                lua_pushstring(L, std::get<std::string>(rule.value).c_str());
-            lua_rawset(L, -3);
-        }
+        push_result(L, instance, rules, instance->rules, 2);
 
         return 1;
     } catch (const std::exception& ex) {
@@ -149,16 +528,7 @@ static int lkfclient_instance_players(lua_State* L) {
     try {
         const auto& players = instance->client->request_players();
 
-        lua_Integer index = 0;
-        lua_newtable(L);
-        for (const auto& player : players.players) {
-            lua_newtable(L);
-            push_field(L, player, id);
-            push_field(L, player, name);
-            push_field(L, player, score);
-            push_field(L, player, time);
-            lua_rawseti(L, -2, ++index);
-        }
+        push_result(L, instance, players, instance->players, 2);
 
         return 1;
     } catch (const std::exception& ex) {
@@ -167,9 +537,440 @@ static int lkfclient_instance_players(lua_State* L) {
     }
 }
 
+static int lkfclient_engine__gc(lua_State* L) {
+    auto *engine = static_cast<lkfclient_engine*>(luaL_checkudata(L, 1, engine_meta_name));
+    engine->~lkfclient_engine();
+    return 0;
+}
+
+static lkfclient_engine* lkfclient_get_engine(lua_State* L) {
+    if (lua_rawgetp(L, LUA_REGISTRYINDEX, &engine_key) == LUA_TUSERDATA) {
+        auto *engine = static_cast<lkfclient_engine*>(lua_touserdata(L, -1));
+        lua_pop(L, 1);
+        return engine;
+    }
+
+    lua_pop(L, 1);
+
+    auto *memory = lua_newuserdata(L, sizeof(lkfclient_engine));
+    auto *engine = new (memory) lkfclient_engine(); // NOLINT(cppcoreguidelines-owning-memory) -- Lua owns the memory and collects it, see lua_newuserdata.
+    luaL_setmetatable(L, engine_meta_name);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &engine_key);
+    return engine;
+}
+
+// Continues an asynchronous request in its coroutine once kfclient.dispatch resumed it with the
+// completed query (a light userdata valid for the duration of the resume) on top of the stack.
+static int lkfclient_async_continue(lua_State* L, int /*status*/, lua_KContext section) {
+    auto *instance = static_cast<lkfclient_instance*>(luaL_checkudata(L, 1, meta_name));
+    auto *engine = lkfclient_get_engine(L);
+
+    // coroutine.resume passes whatever it was given, a pointer from it must not be read
+    if (lua_islightuserdata(L, -1) == 0 || lua_touserdata(L, -1) != engine->resuming)
+        return luaL_error(L, "resumed outside kfclient.dispatch");
+
+    const auto *result = engine->resuming;
+    lua_pop(L, 1);
+
+    if (!result->error.empty())
+        return luaL_error(L, "%s", result->error.c_str());
+
+    if (section == kfc::SECTION_DETAILS && result->details != nullptr)
+        push_result(L, result->details, instance->lazy, 2);
+    else if (section == kfc::SECTION_RULES && result->rules != nullptr)
+        push_result(L, result->rules, instance->lazy, 2);
+    else if (section == kfc::SECTION_PLAYERS && result->players != nullptr)
+        push_result(L, result->players, instance->lazy, 2);
+    else
+        return luaL_error(L, "received response could not be processed");
+
+    return 1;
+}
+
+static int lkfclient_async_request(lua_State* L, std::uint32_t section, const char* name) {
+    auto *instance = static_cast<lkfclient_instance*>(luaL_checkudata(L, 1, meta_name));
+
+    if (lua_isyieldable(L) == 0)
+        return luaL_error(L, "%s must be called from a coroutine", name);
+    if (instance->client == nullptr || instance->endpoints.empty())
+        return luaL_error(L, "kfclient is closed");
+
+    auto *engine = lkfclient_get_engine(L);
+
+    lua_pushthread(L);
+    auto coroutine = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    // raised once the handler is done with the exception, raising from it would skip its cleanup
+    auto started = true;
+    try {
+        kfc::kfquery::start(engine->context, instance->endpoints.begin()->endpoint(), section, instance->client->timeout(),
+            [engine, coroutine](kfc::kfquery_result& result) { engine->complete(coroutine, result); });
+    } catch (const std::exception& ex) {
+        lua_pushstring(L, ex.what());
+        started = false;
+    }
+
+    if (!started) {
+        luaL_unref(L, LUA_REGISTRYINDEX, coroutine);
+        return lua_error(L);
+    }
+
+    engine->pending++;
+    return lua_yieldk(L, 0, section, lkfclient_async_continue);
+}
+
+static int lkfclient_instance_details_async(lua_State* L) {
+    return lkfclient_async_request(L, kfc::SECTION_DETAILS, "details_async");
+}
+
+static int lkfclient_instance_rules_async(lua_State* L) {
+    return lkfclient_async_request(L, kfc::SECTION_RULES, "rules_async");
+}
+
+static int lkfclient_instance_players_async(lua_State* L) {
+    return lkfclient_async_request(L, kfc::SECTION_PLAYERS, "players_async");
+}
+
+// kfclient.dispatch([timeout_ms]) -> resumed
+// Resumes the coroutines whose requests completed, waiting up to timeout_ms (indefinitely when
+// omitted) for the first one if none completed yet. Errors raised by a resumed coroutine are
+// raised again here; the coroutines that are still ready are resumed by the next call. A coroutine
+// that is no longer suspended, because it was resumed by someone else, is dropped uncounted.
+static int lkfclient_dispatch(lua_State* L) {
+    auto *engine = lkfclient_get_engine(L);
+    auto wait = luaL_optinteger(L, 1, -1);
+    lua_Integer resumed = 0;
+    auto failed = false;
+
+    while (!failed) {
+        lkfclient_completion completion;
+        {
+            std::unique_lock<std::mutex> lock(engine->mutex);
+            if (resumed == 0 && engine->pending != 0) {
+                auto ready = [engine]() { return !engine->completed.empty(); };
+                if (wait < 0)
+                    engine->ready.wait(lock, ready);
+                else
+                    engine->ready.wait_for(lock, std::chrono::milliseconds(wait), ready);
+            }
+
+            if (engine->completed.empty())
+                break;
+
+            completion = std::move(engine->completed.front());
+            engine->completed.pop_front();
+        }
+
+        engine->pending--;
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, completion.coroutine);
+        auto *coroutine = lua_tothread(L, -1);
+        lua_pop(L, 1);
+        luaL_unref(L, LUA_REGISTRYINDEX, completion.coroutine);
+
+        // resumed outside of dispatch in the meantime, it failed or waits for something else now
+        if (lua_status(coroutine) != LUA_YIELD)
+            continue;
+
+        resumed++;
+        engine->resuming = &completion.result;
+        lua_pushlightuserdata(coroutine, &completion.result);
+        auto status = lua_resume(coroutine, L, 1);
+        engine->resuming = nullptr;
+        if (status != LUA_OK && status != LUA_YIELD) {
+            // raised below, once the completion was destroyed
+            lua_xmove(coroutine, L, 1);
+            failed = true;
+        }
+    }
+
+    if (failed)
+        return lua_error(L);
+
+    push(L, resumed);
+    return 1;
+}
+
+// kfclient.pending() -> the number of coroutines waiting for a request to complete
+static int lkfclient_pending(lua_State* L) {
+    push(L, lkfclient_get_engine(L)->pending);
+    return 1;
+}
+
+static constexpr const lua_Integer DEFAULT_QUERY_TIMEOUT = 5000;
+static constexpr const lua_Integer DEFAULT_QUERY_PARALLEL = 64;
+
+struct lkfclient_target {
+    std::string host;
+    std::uint16_t port = 0;
+    kfc::kfquery_result result;
+};
+
+// reads the options table of query_many: { sections = { "details", "rules", "players" }, timeout = ms, parallel = 64, lazy = false }
+static std::uint32_t lkfclient_query_options(lua_State* L, int index, std::chrono::milliseconds& timeout, std::size_t& parallel, bool& lazy) {
+    std::uint32_t sections = kfc::SECTION_DETAILS | kfc::SECTION_PLAYERS;
+    timeout = std::chrono::milliseconds(DEFAULT_QUERY_TIMEOUT);
+    parallel = DEFAULT_QUERY_PARALLEL;
+    lazy = false;
+
+    if (lua_isnoneornil(L, index))
+        return sections;
+
+    luaL_checktype(L, index, LUA_TTABLE);
+
+    if (lua_getfield(L, index, "timeout") != LUA_TNIL)
+        timeout = std::chrono::milliseconds(luaL_checkinteger(L, -1));
+    lua_pop(L, 1);
+
+    if (lua_getfield(L, index, "parallel") != LUA_TNIL) {
+        auto value = luaL_checkinteger(L, -1);
+        if (value <= 0)
+            luaL_error(L, "parallel must be positive");
+        parallel = static_cast<std::size_t>(value);
+    }
+    lua_pop(L, 1);
+
+    lua_getfield(L, index, "lazy");
+    lazy = lua_toboolean(L, -1) != 0;
+    lua_pop(L, 1);
+
+    if (lua_getfield(L, index, "sections") == LUA_TTABLE) {
+        sections = 0;
+        // the names stay on the stack, raising skips the destructors of C++ objects
+        for (lua_Integer i = 1; lua_rawgeti(L, -1, i) != LUA_TNIL; ++i) {
+            const auto *name = luaL_checkstring(L, -1);
+
+            if (std::strcmp(name, "details") == 0)
+                sections |= kfc::SECTION_DETAILS;
+            else if (std::strcmp(name, "rules") == 0)
+                sections |= kfc::SECTION_RULES;
+            else if (std::strcmp(name, "players") == 0)
+                sections |= kfc::SECTION_PLAYERS;
+            else
+                luaL_error(L, "unknown section '%s'", name);
+
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+    } else if (!lua_isnil(L, -1)) {
+        luaL_error(L, "sections must be a table of section names");
+    }
+    lua_pop(L, 1);
+
+    return sections;
+}
+
+// pushes the host and port of server i of the list at index 1, raises when they are missing
+static void lkfclient_push_target(lua_State* L, lua_Integer i) {
+    if (lua_rawgeti(L, 1, i) != LUA_TTABLE)
+        luaL_error(L, "server %d is not a { host, port } table", static_cast<int>(i));
+
+    if (lua_rawgeti(L, -1, 1) == LUA_TNIL) {
+        lua_pop(L, 1);
+        lua_getfield(L, -1, "host");
+    }
+    if (lua_rawgeti(L, -2, 2) == LUA_TNIL) {
+        lua_pop(L, 1);
+        lua_getfield(L, -2, "port");
+    }
+
+    luaL_checkstring(L, -2);
+    luaL_checkinteger(L, -1);
+}
+
+// queries the checked list at index 1 and pushes the results, or pushes the error and returns false
+static bool lkfclient_query_targets(lua_State* L, std::uint32_t sections, std::chrono::milliseconds timeout, std::size_t parallel, bool lazy) {
+    std::vector<lkfclient_target> targets(lua_rawlen(L, 1));
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+        lkfclient_push_target(L, static_cast<lua_Integer>(i + 1));
+        targets.at(i).host = lua_tostring(L, -2);
+        targets.at(i).port = static_cast<std::uint16_t>(lua_tointeger(L, -1));
+        lua_pop(L, 3);
+    }
+
+    try {
+        kfc::kfbatch batch(parallel, timeout, sections);
+
+        // the batch reports by host and port, a server listed twice takes its results in list order
+        std::map<std::pair<std::string, std::uint16_t>, std::deque<std::size_t>> waiting;
+        for (std::size_t i = 0; i < targets.size(); ++i) {
+            batch.add_target(targets.at(i).host, targets.at(i).port);
+            waiting[{ targets.at(i).host, targets.at(i).port }].push_back(i);
+        }
+
+        batch.run([&targets, &waiting](const std::string& host, std::uint16_t port, kfc::kfquery_result& result) {
+            auto& indices = waiting.at({ host, port });
+            targets.at(indices.front()).result = std::move(result);
+            indices.pop_front();
+        });
+    } catch (const std::exception& ex) {
+        lua_pushstring(L, ex.what());
+        return false;
+    }
+
+    lua_createtable(L, static_cast<int>(targets.size()), 0);
+    lua_Integer index = 0;
+    for (const auto& target : targets) {
+        const auto& result = target.result;
+
+        lua_createtable(L, 0, 8);
+        push_field(L, target, host);
+        push_field(L, target, port);
+
+        if (result.details != nullptr) {
+            lua_pushstring(L, "details");
+            push_result(L, result.details, lazy, 0);
+            lua_rawset(L, -3);
+        }
+        if (result.rules != nullptr) {
+            lua_pushstring(L, "rules");
+            push_result(L, result.rules, lazy, 0);
+            lua_rawset(L, -3);
+        }
+        if (result.players != nullptr) {
+            lua_pushstring(L, "players");
+            push_result(L, result.players, lazy, 0);
+            lua_rawset(L, -3);
+        }
+        if (!result.error.empty()) {
+            push_field(L, result, error);
+            push_field(L, result, timed_out);
+        }
+
+        lua_pushstring(L, "round_trip");
+        lua_pushnumber(L, std::chrono::duration<lua_Number, std::milli>(result.round_trip).count());
+        lua_rawset(L, -3);
+
+        lua_rawseti(L, -2, ++index);
+    }
+
+    return true;
+}
+
+// kfclient.query_many({ { host, port }, ... }, [options]) -> { { host, port, details, rules, players, error, timed_out, round_trip }, ... }
+// Queries the servers with up to options.parallel queries in flight and returns one result per
+// server, in the order given; numeric addresses are not resolved. A failed server has an error
+// message instead of results; the call itself only raises on bad arguments. The round trip is in
+// milliseconds.
+static int lkfclient_query_many(lua_State* L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    std::chrono::milliseconds timeout {};
+    std::size_t parallel = 0;
+    auto lazy = false;
+    auto sections = lkfclient_query_options(L, 2, timeout, parallel, lazy);
+
+    // every argument is checked before the targets exist, raising skips the destructors of C++ objects
+    auto count = static_cast<lua_Integer>(lua_rawlen(L, 1));
+    for (lua_Integer i = 1; i <= count; ++i) {
+        lkfclient_push_target(L, i);
+        lua_pop(L, 3);
+    }
+
+    if (!lkfclient_query_targets(L, sections, timeout, parallel, lazy))
+        return lua_error(L);
+
+    return 1;
+}
+
+static int lkfclient_snapshot_open(lua_State* L) {
+    const auto *const region = luaL_checkstring(L, 1);
+
+    auto *memory = lua_newuserdata(L, sizeof(lkfclient_snapshot));
+    auto *instance = new (memory) lkfclient_snapshot(); // NOLINT(cppcoreguidelines-owning-memory) -- Lua owns the memory and collects it, see lua_newuserdata.
+    luaL_setmetatable(L, snapshot_meta_name);
+
+    try {
+        instance->reader = std::make_unique<kfc::kfshm_reader>(region);
+    } catch (const std::exception& ex) {
+        luaL_error(L, "kfclient snapshot region cannot be opened: %s", ex.what());
+    }
+
+    return 1;
+}
+
+static int lkfclient_snapshot__gc(lua_State* L) {
+    auto *instance = static_cast<lkfclient_snapshot*>(luaL_checkudata(L, 1, snapshot_meta_name));
+    instance->~lkfclient_snapshot();
+    return 0;
+}
+
+static int lkfclient_snapshot_close(lua_State* L) {
+    auto *instance = static_cast<lkfclient_snapshot*>(luaL_checkudata(L, 1, snapshot_meta_name));
+    instance->reader = nullptr;
+    return 0;
+}
+
+// snapshot:read(host, port) -> details, players, timestamp (ms) | nil, error
+static int lkfclient_snapshot_read(lua_State* L) {
+    auto *instance = static_cast<lkfclient_snapshot*>(luaL_checkudata(L, 1, snapshot_meta_name));
+    const auto *const host = luaL_checkstring(L, 2);
+    const auto port = luaL_checkinteger(L, 3);
+
+    if (instance->reader == nullptr)
+        return luaL_error(L, "kfclient snapshot region is closed");
+
+    try {
+        auto& snapshot = instance->snapshot;
+        if (!instance->reader->read(host, static_cast<std::uint16_t>(port), snapshot)) {
+            lua_pushnil(L);
+            lua_pushstring(L, "no snapshot has been published for this server");
+            return 2;
+        }
+
+        if ((snapshot.flags & (kfc::kfsnapshot::HAS_DETAILS | kfc::kfsnapshot::HAS_PLAYERS)) == 0) {
+            lua_pushnil(L);
+            lua_pushstring(L, snapshot.error.str().c_str());
+            return 2;
+        }
+
+        if ((snapshot.flags & kfc::kfsnapshot::HAS_DETAILS) != 0)
+            push_details(L, snapshot.details());
+        else
+            lua_pushnil(L);
+
+        if ((snapshot.flags & kfc::kfsnapshot::HAS_PLAYERS) != 0)
+            push_players(L, snapshot.players());
+        else
+            lua_pushnil(L);
+
+        push(L, snapshot.timestamp);
+        return 3;
+    } catch (const std::exception& ex) {
+        luaL_error(L, "%s", ex.what());
+        return 0;
+    }
+}
+
+template <typename T>
+static void register_view(lua_State* L, lua_CFunction index, lua_CFunction pairs, lua_CFunction length = nullptr) {
+    luaL_newmetatable(L, lkfclient_view_traits<T>::name);
+    {
+        lua_pushstring(L, "__name");
+        lua_pushstring(L, lkfclient_view_traits<T>::name);
+        lua_rawset(L, -3);
+
+        push_function(L, "__gc", lkfclient_view__gc<T>);
+        push_function(L, "__index", index);
+
+        if (pairs != nullptr) {
+            push_function(L, "__pairs", pairs);
+        }
+        if (length != nullptr) {
+            push_function(L, "__len", length);
+        }
+    }
+
+    lua_pop(L, 1);
+}
+
 extern "C" int luaopen_kfclient(lua_State* L) {
     static const std::vector<luaL_Reg> lkfclient_api {
         { "open", lkfclient_open },
+        { "snapshot", lkfclient_snapshot_open },
+        { "dispatch", lkfclient_dispatch },
+        { "pending", lkfclient_pending },
+        { "query_many", lkfclient_query_many },
         { nullptr, nullptr }
     };
 
@@ -188,10 +989,50 @@ extern "C" int luaopen_kfclient(lua_State* L) {
             push_function(L, "details", lkfclient_instance_details);
             push_function(L, "rules", lkfclient_instance_rules);
             push_function(L, "players", lkfclient_instance_players);
+            push_function(L, "lazy", lkfclient_instance_lazy);
+            push_function(L, "timeout", lkfclient_instance_timeout);
+            push_function(L, "details_async", lkfclient_instance_details_async);
+            push_function(L, "rules_async", lkfclient_instance_rules_async);
+            push_function(L, "players_async", lkfclient_instance_players_async);
         }
         lua_rawset(L, -3);
     }
 
+    lua_pop(L, 1);
+
+    luaL_newmetatable(L, snapshot_meta_name);
+    {
+        lua_pushstring(L, "__name");
+        lua_pushstring(L, snapshot_meta_name);
+        lua_rawset(L, -3);
+
+        push_function(L, "__gc", lkfclient_snapshot__gc);
+
+        lua_pushstring(L, "__index");
+        lua_newtable(L);
+        {
+            push_function(L, "close", lkfclient_snapshot_close);
+            push_function(L, "read", lkfclient_snapshot_read);
+        }
+        lua_rawset(L, -3);
+    }
+
+    lua_pop(L, 1);
+
+    register_view<kfc::kfdetails>(L, lkfclient_details__index, lkfclient_view__pairs<lkfclient_details_next>);
+    register_view<kfc::kfrules>(L, lkfclient_rules__index, lkfclient_view__pairs<lkfclient_rules_next>);
+    register_view<kfc::kfplayers>(L, lkfclient_players__index, nullptr, lkfclient_players__len);
+    register_view<kfc::kfplayer>(L, lkfclient_player__index, lkfclient_view__pairs<lkfclient_player_next>);
+
+    luaL_newmetatable(L, engine_meta_name);
+    {
+        lua_pushstring(L, "__name");
+        lua_pushstring(L, engine_meta_name);
+        lua_rawset(L, -3);
+
+        push_function(L, "__gc", lkfclient_engine__gc);
+    }
+
     lua_pop(L, 1);
     
     luaL_checkversion(L);